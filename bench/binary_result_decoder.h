@@ -0,0 +1,234 @@
+#pragma once
+#include <string>
+#include <vector>
+#include <cstring>
+#include <cstddef>
+#include <cstdint>
+
+/**
+ * @brief 二进制查询结果的参考解码器（客户端用，不依赖服务器代码）
+ * 格式说明见include/binary_result.h。解码一个完整的响应帧：列头、全部行、状态和消息。
+ * TEXT/BLOB值指向传入的数据，不做拷贝，数据须在使用结果期间保持有效
+ */
+class BinaryResultDecoder {
+public:
+    enum Type {
+        NULL_VALUE = 0,
+        INTEGER = 1,
+        FLOAT = 2,
+        TEXT = 3,
+        BLOB = 4
+    };
+
+    struct Value {
+        Type type;
+        int64_t integer;
+        double real;
+        const char* data;   // TEXT/BLOB的内容
+        size_t size;
+    };
+
+    struct Column {
+        std::string name;
+        std::string declType;
+    };
+
+    BinaryResultDecoder() : pos(nullptr), end(nullptr), rowCount(0), status(0) {}
+
+    /**
+     * @brief 响应是否为二进制结果（否则是JSON）
+     */
+    static bool isBinary(const char* data, size_t len) {
+        return len >= 2 && static_cast<uint8_t>(data[0]) == kMagic;
+    }
+
+    /**
+     * @brief 解码一个响应
+     * @return 格式是否正确，失败原因见getError()
+     */
+    bool decode(const char* data, size_t len) {
+        pos = data;
+        end = data + len;
+        columns.clear();
+        values.clear();
+        rowCount = 0;
+        status = 0;
+        msg.clear();
+        extra.clear();
+        error.clear();
+
+        if (!isBinary(data, len) || static_cast<uint8_t>(data[1]) != kVersion) {
+            return fail("not a version 1 binary result");
+        }
+        pos += 2;
+        uint64_t columnCount;
+        if (!readVarint(columnCount) || columnCount > static_cast<uint64_t>(end - pos)) {
+            return fail("bad column count");
+        }
+        columns.resize(static_cast<size_t>(columnCount));
+        for (Column& column : columns) {
+            if (!readString(column.name) || !readString(column.declType)) {
+                return fail("truncated column header");
+            }
+        }
+
+        std::vector<uint8_t> types(columns.size());
+        for (;;) {
+            uint64_t rows;
+            if (!readVarint(rows)) {
+                return fail("truncated batch");
+            }
+            if (rows == 0) {
+                break;
+            }
+            if (!decodeBatch(static_cast<size_t>(rows), types)) {
+                return false;
+            }
+        }
+
+        int64_t code;
+        if (!readSigned(code) || !readString(msg) || !readString(extra)) {
+            return fail("truncated trailer");
+        }
+        status = static_cast<int>(code);
+        return true;
+    }
+
+    const std::vector<Column>& getColumns() const { return columns; }
+    size_t getRowCount() const { return rowCount; }
+
+    /**
+     * @brief 第row行第col列的值
+     */
+    const Value& at(size_t row, size_t col) const { return values[row * columns.size() + col]; }
+
+    int getStatus() const { return status; }
+    const std::string& getMsg() const { return msg; }
+
+    /**
+     * @brief 附加字段（JSON对象成员文本，如"cursor":1,"done":false），没有时为空
+     */
+    const std::string& getExtra() const { return extra; }
+    const std::string& getError() const { return error; }
+
+private:
+    static const uint8_t kMagic = 0xB1;
+    static const uint8_t kVersion = 1;
+    static const uint8_t kMixed = 5;
+
+    bool decodeBatch(size_t rows, std::vector<uint8_t>& types) {
+        size_t count = columns.size();
+        size_t bitmapSize = (rows * count + 7) / 8;
+        if (static_cast<size_t>(end - pos) < count + bitmapSize) {
+            return fail("truncated batch header");
+        }
+        std::memcpy(types.data(), pos, count);
+        pos += count;
+        const uint8_t* nulls = reinterpret_cast<const uint8_t*>(pos);
+        pos += bitmapSize;
+
+        size_t base = values.size();
+        values.resize(base + rows * count);
+        Value* out = values.data() + base;
+        size_t bit = 0;
+        for (size_t row = 0; row < rows; row++) {
+            for (size_t col = 0; col < count; col++, bit++, out++) {
+                if (nulls[bit / 8] & (1 << (bit % 8))) {
+                    out->type = NULL_VALUE;
+                    continue;
+                }
+                uint8_t type = types[col];
+                if (type == kMixed) {
+                    if (pos >= end) {
+                        return fail("truncated value");
+                    }
+                    type = static_cast<uint8_t>(*pos++);
+                }
+                if (!readValue(type, *out)) {
+                    return false;
+                }
+            }
+        }
+        rowCount += rows;
+        return true;
+    }
+
+    bool readValue(uint8_t type, Value& value) {
+        value.type = static_cast<Type>(type);
+        switch (type) {
+        case INTEGER:
+            return readSigned(value.integer) || fail("truncated integer");
+        case FLOAT: {
+            if (end - pos < 8) {
+                return fail("truncated float");
+            }
+            uint64_t bits = 0;
+            for (int i = 0; i < 8; i++) {
+                bits |= static_cast<uint64_t>(static_cast<uint8_t>(pos[i])) << (i * 8);
+            }
+            std::memcpy(&value.real, &bits, sizeof(bits));
+            pos += 8;
+            return true;
+        }
+        case TEXT:
+        case BLOB: {
+            uint64_t size;
+            if (!readVarint(size) || size > static_cast<uint64_t>(end - pos)) {
+                return fail("truncated string");
+            }
+            value.data = pos;
+            value.size = static_cast<size_t>(size);
+            pos += value.size;
+            return true;
+        }
+        default:
+            return fail("unknown value type");
+        }
+    }
+
+    bool readVarint(uint64_t& value) {
+        value = 0;
+        for (int shift = 0; shift < 64 && pos < end; shift += 7) {
+            uint8_t byte = static_cast<uint8_t>(*pos++);
+            value |= static_cast<uint64_t>(byte & 0x7F) << shift;
+            if (!(byte & 0x80)) {
+                return true;
+            }
+        }
+        return false;
+    }
+
+    bool readSigned(int64_t& value) {
+        uint64_t bits;
+        if (!readVarint(bits)) {
+            return false;
+        }
+        value = static_cast<int64_t>((bits >> 1) ^ (~(bits & 1) + 1));
+        return true;
+    }
+
+    bool readString(std::string& text) {
+        uint64_t size;
+        if (!readVarint(size) || size > static_cast<uint64_t>(end - pos)) {
+            return false;
+        }
+        text.assign(pos, static_cast<size_t>(size));
+        pos += size;
+        return true;
+    }
+
+    bool fail(const char* reason) {
+        error = reason;
+        return false;
+    }
+
+    const char* pos;
+    const char* end;
+    std::vector<Column> columns;
+    std::vector<Value> values;      // 按行存放，每行columns.size()个
+    size_t rowCount;
+    int status;
+    std::string msg;
+    std::string extra;
+    std::string error;
+};
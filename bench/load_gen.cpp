@@ -0,0 +1,733 @@
+/**
+ * @file load_gen.cpp
+ * @brief 负载生成器：按功能号100000/100001协议对本地服务器施压
+ * 闭环模式下每个连接发完一个请求、收到响应后才发下一个；
+ * 开环模式下按固定速率发送（请求可在连接上排队），延迟从计划发送时刻算起，避免协同遗漏。
+ * 默认换行分帧、JSON结果；--encoding binary时改用长度前缀帧并协商二进制结果，
+ * 用bench/binary_result_decoder.h解码每个响应。--decode 1时JSON响应也完整解析，以便比较客户端解码耗时。
+ * 每次运行结束输出一行JSON：吞吐、总体延迟分位数、各操作类型的延迟分位数，以及响应的平均字节数和解码耗时
+ * 用法: load_gen [--host 127.0.0.1] [--port 8083] [--connections 8] [--duration 10] [--warmup 1]
+ *               [--mode closed|open] [--rate 总请求每秒] [--mix point=70,range=20,insert=8,txn=2]
+ *               [--db 数据库路径] [--rows 预置行数] [--range-size 50] [--label 标签]
+ *               [--encoding json|binary] [--decode 0|1]
+ */
+#include "metrics.h"
+#include "json_writer.h"
+#include "binary_result_decoder.h"
+#include <json/json.h>
+#include <sys/socket.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <arpa/inet.h>
+#include <unistd.h>
+#include <atomic>
+#include <condition_variable>
+#include <cstdlib>
+#include <cstring>
+#include <deque>
+#include <iostream>
+#include <memory>
+#include <mutex>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace {
+
+/**
+ * @brief 操作类型
+ */
+enum Op {
+    POINT,      // 按主键查一行
+    RANGE,      // 主键范围扫描
+    INSERT,     // 单行插入
+    TXN,        // 多语句写事务（更新+插入）
+    OP_COUNT
+};
+
+const char* const kOpNames[OP_COUNT] = {"point", "range", "insert", "txn"};
+
+struct Options {
+    Options()
+        : host("127.0.0.1")
+        , port(8083)
+        , connections(8)
+        , duration(10.0)
+        , warmup(1.0)
+        , open(false)
+        , rate(1000.0)
+        , mix("point=70,range=20,insert=8,txn=2")
+        , db("db/bench.db")
+        , rows(100000)
+        , rangeSize(50)
+        , binary(false)
+        , decode(false)
+    {
+    }
+
+    std::string host;
+    int port;
+    int connections;
+    double duration;        // 计入结果的时长（秒）
+    double warmup;          // 预热时长（秒），期间的请求不计入结果
+    bool open;
+    double rate;            // 开环模式下所有连接合计的请求速率
+    std::string mix;
+    std::string db;
+    int rows;
+    int rangeSize;
+    std::string label;
+    bool binary;            // 协商二进制结果（长度前缀帧）
+    bool decode;            // JSON响应也完整解析并计时（二进制响应总是解码）
+    int weights[OP_COUNT];
+};
+
+/**
+ * @brief 解析"point=70,range=20"形式的操作比例
+ */
+bool parseMix(Options& options) {
+    for (int i = 0; i < OP_COUNT; i++) {
+        options.weights[i] = 0;
+    }
+    std::stringstream ss(options.mix);
+    std::string item;
+    int total = 0;
+    while (std::getline(ss, item, ',')) {
+        size_t eq = item.find('=');
+        if (eq == std::string::npos) {
+            return false;
+        }
+        std::string name = item.substr(0, eq);
+        int weight = std::atoi(item.c_str() + eq + 1);
+        int op = 0;
+        while (op < OP_COUNT && name != kOpNames[op]) {
+            op++;
+        }
+        if (op == OP_COUNT || weight < 0) {
+            return false;
+        }
+        options.weights[op] = weight;
+        total += weight;
+    }
+    return total > 0;
+}
+
+/**
+ * @brief xorshift64*：每个线程一个，足够快且不共享状态
+ */
+class Random {
+public:
+    explicit Random(uint64_t seed) : state(seed * 0x9E3779B97F4A7C15ULL + 1) {}
+
+    uint64_t next() {
+        state ^= state >> 12;
+        state ^= state << 25;
+        state ^= state >> 27;
+        return state * 0x2545F4914F6CDD1DULL;
+    }
+
+    int uniform(int n) { return static_cast<int>(next() % static_cast<uint64_t>(n)); }
+
+private:
+    uint64_t state;
+};
+
+/**
+ * @brief 一个到服务器的阻塞连接，按行或按长度前缀帧收发
+ */
+class Client {
+public:
+    Client(const std::string& host, int port, bool lengthPrefixed = false)
+        : fd(-1)
+        , lengthPrefixed(lengthPrefixed)
+    {
+        fd = socket(AF_INET, SOCK_STREAM, 0);
+        if (fd < 0) {
+            throw std::runtime_error(std::string("socket failed: ") + std::strerror(errno));
+        }
+        struct sockaddr_in addr;
+        std::memset(&addr, 0, sizeof(addr));
+        addr.sin_family = AF_INET;
+        addr.sin_port = htons(port);
+        if (inet_pton(AF_INET, host.c_str(), &addr.sin_addr) != 1) {
+            close(fd);
+            throw std::runtime_error("invalid host: " + host);
+        }
+        if (connect(fd, (struct sockaddr*)&addr, sizeof(addr)) < 0) {
+            int err = errno;
+            close(fd);
+            throw std::runtime_error("connect to " + host + ":" + std::to_string(port) +
+                                     " failed: " + std::strerror(err));
+        }
+        int on = 1;
+        setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &on, sizeof(on));
+    }
+
+    ~Client() {
+        if (fd >= 0) {
+            close(fd);
+        }
+    }
+
+    Client(const Client&) = delete;
+    Client& operator=(const Client&) = delete;
+
+    /**
+     * @brief 发送一个请求（自动追加换行或加上4字节大端长度头）
+     */
+    bool send(const std::string& request) {
+        std::string frame;
+        if (lengthPrefixed) {
+            uint32_t len = htonl(static_cast<uint32_t>(request.size()));
+            frame.assign(reinterpret_cast<const char*>(&len), 4);
+            frame += request;
+        } else {
+            frame = request;
+            frame.push_back('\n');
+        }
+        size_t sent = 0;
+        while (sent < frame.size()) {
+            ssize_t n = ::send(fd, frame.data() + sent, frame.size() - sent, MSG_NOSIGNAL);
+            if (n < 0) {
+                if (errno == EINTR) {
+                    continue;
+                }
+                return false;
+            }
+            sent += static_cast<size_t>(n);
+        }
+        return true;
+    }
+
+    /**
+     * @brief 读取一个响应（不含换行或长度头）
+     */
+    bool receive(std::string& line) {
+        for (;;) {
+            if (lengthPrefixed) {
+                if (inBuf.size() >= 4) {
+                    uint32_t len;
+                    std::memcpy(&len, inBuf.data(), 4);
+                    len = ntohl(len);
+                    if (inBuf.size() >= 4 + static_cast<size_t>(len)) {
+                        line.assign(inBuf, 4, len);
+                        inBuf.erase(0, 4 + static_cast<size_t>(len));
+                        return true;
+                    }
+                }
+                if (!fill()) {
+                    return false;
+                }
+                continue;
+            }
+            size_t nl = inBuf.find('\n', scanned);
+            if (nl != std::string::npos) {
+                line.assign(inBuf, 0, nl);
+                inBuf.erase(0, nl + 1);
+                scanned = 0;
+                return true;
+            }
+            scanned = inBuf.size();
+            if (!fill()) {
+                return false;
+            }
+        }
+    }
+
+    bool call(const std::string& request, std::string& response) {
+        return send(request) && receive(response);
+    }
+
+    /**
+     * @brief 关闭写端，通知服务器不再有请求
+     */
+    void shutdownWrite() { shutdown(fd, SHUT_WR); }
+
+private:
+    /**
+     * @brief 从socket读取一次追加到inBuf
+     */
+    bool fill() {
+        char buf[65536];
+        for (;;) {
+            ssize_t n = recv(fd, buf, sizeof(buf), 0);
+            if (n < 0 && errno == EINTR) {
+                continue;
+            }
+            if (n <= 0) {
+                return false;
+            }
+            inBuf.append(buf, static_cast<size_t>(n));
+            return true;
+        }
+    }
+
+    int fd;
+    bool lengthPrefixed;
+    std::string inBuf;
+    size_t scanned = 0;     // inBuf中已确认没有换行的前缀长度
+};
+
+bool isSuccess(const std::string& response) {
+    return response.find("\"status\":0") != std::string::npos;
+}
+
+std::string quote(const std::string& text) {
+    std::string out;
+    JsonWriter::appendString(out, text.data(), text.size());
+    return out;
+}
+
+std::string connectRequest(const Options& options, bool binary = false) {
+    return "{\"funcid\":\"100000\",\"msg\":{\"dbpath\":" + quote(options.db) +
+           (binary ? ",\"encoding\":\"binary\"}}" : "}}");
+}
+
+std::string sqlRequest(const std::string& sql, const std::string& params = std::string()) {
+    std::string request = "{\"funcid\":\"100001\",\"msg\":{\"sqlstr\":" + quote(sql);
+    if (!params.empty()) {
+        request += ",\"params\":" + params;
+    }
+    return request + "}}";
+}
+
+/**
+ * @brief 生成一个操作的请求
+ */
+std::string makeRequest(Op op, const Options& options, Random& random) {
+    int id = 1 + random.uniform(options.rows);
+    switch (op) {
+    case POINT:
+        return sqlRequest("SELECT id, k, v FROM bench WHERE id = ?", "[" + std::to_string(id) + "]");
+    case RANGE:
+        return sqlRequest("SELECT id, k, v FROM bench WHERE id BETWEEN ? AND ?",
+                          "[" + std::to_string(id) + "," + std::to_string(id + options.rangeSize - 1) + "]");
+    case INSERT:
+        return sqlRequest("INSERT INTO bench(k, v) VALUES(?, ?)",
+                          "[" + std::to_string(random.uniform(1000)) + ",\"load_gen\"]");
+    case TXN:
+    default:
+        return sqlRequest("UPDATE bench SET k = k + 1 WHERE id = :id; "
+                          "INSERT INTO bench(k, v) VALUES(:k, 'load_gen_txn')",
+                          "{\"id\":" + std::to_string(id) + ",\"k\":" + std::to_string(random.uniform(1000)) + "}");
+    }
+}
+
+Op pickOp(const Options& options, int totalWeight, Random& random) {
+    int r = random.uniform(totalWeight);
+    for (int op = 0; op < OP_COUNT; op++) {
+        if (r < options.weights[op]) {
+            return static_cast<Op>(op);
+        }
+        r -= options.weights[op];
+    }
+    return POINT;
+}
+
+/**
+ * @brief 建表并预置数据；表中已有足够的行时跳过
+ */
+void prepareTable(const Options& options) {
+    Client client(options.host, options.port);
+    std::string response;
+    if (!client.call(connectRequest(options), response) || !isSuccess(response)) {
+        throw std::runtime_error("connect request failed: " + response);
+    }
+    if (!client.call(sqlRequest("CREATE TABLE IF NOT EXISTS bench(id INTEGER PRIMARY KEY, k INTEGER, v TEXT)"),
+                     response) || !isSuccess(response)) {
+        throw std::runtime_error("create table failed: " + response);
+    }
+    if (!client.call(sqlRequest("SELECT count(*) AS n FROM bench"), response) || !isSuccess(response)) {
+        throw std::runtime_error("count failed: " + response);
+    }
+    // 响应形如 {"rows":[{"n":"123"}],...}
+    size_t pos = response.find("\"n\":\"");
+    int existing = pos == std::string::npos ? 0 : std::atoi(response.c_str() + pos + 5);
+
+    const int kBatch = 1000;
+    for (int start = existing; start < options.rows; start += kBatch) {
+        std::string sql = "INSERT INTO bench(k, v) VALUES";
+        int end = start + kBatch < options.rows ? start + kBatch : options.rows;
+        for (int i = start; i < end; i++) {
+            sql += (i == start ? "(" : ",(") + std::to_string(i % 1000) + ",'row_" + std::to_string(i) + "')";
+        }
+        if (!client.call(sqlRequest(sql), response) || !isSuccess(response)) {
+            throw std::runtime_error("populate failed: " + response);
+        }
+    }
+}
+
+/**
+ * @brief 一个连接的统计（只由该连接的线程写入）
+ */
+struct Stats {
+    Stats() : requests(0), errors(0), responses(0), responseBytes(0), decoded(0), decodeNs(0) {
+        for (int i = 0; i < OP_COUNT; i++) {
+            opErrors[i] = 0;
+        }
+    }
+
+    Histogram all;
+    Histogram ops[OP_COUNT];
+    uint64_t requests;
+    uint64_t errors;
+    uint64_t opErrors[OP_COUNT];
+    uint64_t responses;
+    uint64_t responseBytes;
+    uint64_t decoded;       // 完整解码的响应数
+    uint64_t decodeNs;      // 其解码耗时合计
+
+    void record(Op op, uint64_t latency, bool ok) {
+        requests++;
+        if (!ok) {
+            errors++;
+            opErrors[op]++;
+            return;
+        }
+        all.record(latency);
+        ops[op].record(latency);
+    }
+};
+
+/**
+ * @brief 所有连接共享的运行参数
+ */
+struct Run {
+    const Options* options;
+    int totalWeight;
+    uint64_t measureStart;      // 预热结束时刻
+    uint64_t deadline;          // 运行结束时刻
+    std::atomic<int> failures;  // 连接异常断开的次数
+};
+
+bool openSession(Client& client, const Options& options) {
+    std::string response;
+    if (!client.call(connectRequest(options, options.binary), response) || !isSuccess(response)) {
+        return false;
+    }
+    if (options.binary && response.find("\"encoding\":\"binary\"") == std::string::npos) {
+        std::cerr << "load_gen: server did not accept binary encoding: " << response << std::endl;
+        return false;
+    }
+    return true;
+}
+
+/**
+ * @brief 检查响应是否成功；二进制结果（或--decode时的JSON）完整解码并计入解码耗时
+ * @param measured 是否在计时区间内，是则记录响应大小和解码耗时
+ */
+bool checkResponse(const std::string& response, const Options& options, bool measured, Stats& stats) {
+    bool binary = BinaryResultDecoder::isBinary(response.data(), response.size());
+    if (!binary && !options.decode) {
+        if (measured) {
+            stats.responses++;
+            stats.responseBytes += response.size();
+        }
+        return isSuccess(response);
+    }
+
+    bool ok;
+    uint64_t start = Metrics::now();
+    if (binary) {
+        BinaryResultDecoder decoder;
+        ok = decoder.decode(response.data(), response.size()) && decoder.getStatus() == 0;
+    } else {
+        Json::Value root;
+        Json::Reader reader;
+        ok = reader.parse(response, root, false) && root["status"].asInt() == 0;
+    }
+    if (measured) {
+        stats.responses++;
+        stats.responseBytes += response.size();
+        stats.decoded++;
+        stats.decodeNs += Metrics::now() - start;
+    }
+    return ok;
+}
+
+/**
+ * @brief 闭环：收到上一个响应后立即发下一个请求
+ */
+void closedLoop(Run& run, int index, Stats& stats) {
+    const Options& options = *run.options;
+    Random random(index + 1);
+    try {
+        Client client(options.host, options.port, options.binary);
+        if (!openSession(client, options)) {
+            run.failures++;
+            return;
+        }
+        std::string response;
+        for (;;) {
+            Op op = pickOp(options, run.totalWeight, random);
+            std::string request = makeRequest(op, options, random);
+            uint64_t start = Metrics::now();
+            if (start >= run.deadline) {
+                break;
+            }
+            if (!client.call(request, response)) {
+                run.failures++;
+                return;
+            }
+            uint64_t latency = Metrics::now() - start;
+            bool measured = start >= run.measureStart;
+            bool ok = checkResponse(response, options, measured, stats);
+            if (measured) {
+                stats.record(op, latency, ok);
+            }
+        }
+    } catch (const std::exception& e) {
+        std::cerr << "load_gen: " << e.what() << std::endl;
+        run.failures++;
+    }
+}
+
+/**
+ * @brief 开环：发送线程按计划时刻发送，接收线程按顺序匹配响应
+ * 服务器对同一连接上的请求按顺序响应，因此用FIFO记录每个请求的计划时刻和类型
+ */
+void openLoop(Run& run, int index, Stats& stats) {
+    const Options& options = *run.options;
+    Random random(index + 1);
+    try {
+        Client client(options.host, options.port, options.binary);
+        if (!openSession(client, options)) {
+            run.failures++;
+            return;
+        }
+
+        std::mutex mutex;
+        std::deque<std::pair<uint64_t, Op>> pending;
+        bool senderDone = false;
+        std::condition_variable cv;
+
+        std::thread receiver([&]() {
+            std::string response;
+            for (;;) {
+                std::pair<uint64_t, Op> entry;
+                {
+                    std::unique_lock<std::mutex> lock(mutex);
+                    cv.wait(lock, [&]() { return !pending.empty() || senderDone; });
+                    if (pending.empty()) {
+                        return;
+                    }
+                    entry = pending.front();
+                    pending.pop_front();
+                }
+                if (!client.receive(response)) {
+                    run.failures++;
+                    return;
+                }
+                uint64_t latency = Metrics::now() - entry.first;
+                bool measured = entry.first >= run.measureStart;
+                bool ok = checkResponse(response, options, measured, stats);
+                if (measured) {
+                    stats.record(entry.second, latency, ok);
+                }
+            }
+        });
+
+        // 各连接错开起始相位，合计速率为options.rate
+        uint64_t interval = static_cast<uint64_t>(1e9 * options.connections / options.rate);
+        uint64_t scheduled = Metrics::now() + interval * index / options.connections;
+        while (scheduled < run.deadline) {
+            uint64_t now = Metrics::now();
+            if (now < scheduled) {
+                std::this_thread::sleep_for(std::chrono::nanoseconds(scheduled - now));
+            }
+            Op op = pickOp(options, run.totalWeight, random);
+            std::string request = makeRequest(op, options, random);
+            {
+                std::lock_guard<std::mutex> lock(mutex);
+                pending.push_back(std::make_pair(scheduled, op));
+            }
+            cv.notify_one();
+            if (!client.send(request)) {
+                run.failures++;
+                break;
+            }
+            scheduled += interval;
+        }
+
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            senderDone = true;
+        }
+        cv.notify_one();
+        client.shutdownWrite();
+        receiver.join();
+    } catch (const std::exception& e) {
+        std::cerr << "load_gen: " << e.what() << std::endl;
+        run.failures++;
+    }
+}
+
+void writeLatency(JsonWriter& writer, const Histogram::Snapshot& snapshot) {
+    // 输出单位为微秒，保留一位小数
+    auto us = [](uint64_t ns) { return static_cast<double>(ns / 100) / 10.0; };
+    writer.key("p50_us").value(us(snapshot.percentile(0.5)));
+    writer.key("p90_us").value(us(snapshot.percentile(0.9)));
+    writer.key("p99_us").value(us(snapshot.percentile(0.99)));
+    writer.key("p999_us").value(us(snapshot.percentile(0.999)));
+    writer.key("max_us").value(us(snapshot.max));
+    writer.key("mean_us").value(us(snapshot.count ? snapshot.sum / snapshot.count : 0));
+}
+
+void usage(const char* program) {
+    std::cerr << "Usage: " << program << " [--host ip] [--port n] [--connections n] [--duration s] [--warmup s]\n"
+              << "       [--mode closed|open] [--rate req/s] [--mix point=70,range=20,insert=8,txn=2]\n"
+              << "       [--db path] [--rows n] [--range-size n] [--label text]\n"
+              << "       [--encoding json|binary] [--decode 0|1]" << std::endl;
+}
+
+}
+
+int main(int argc, char* argv[]) {
+    Options options;
+    for (int i = 1; i < argc; i++) {
+        std::string arg = argv[i];
+        if (i + 1 >= argc) {
+            usage(argv[0]);
+            return 2;
+        }
+        std::string value = argv[++i];
+        if (arg == "--host") {
+            options.host = value;
+        } else if (arg == "--port") {
+            options.port = std::atoi(value.c_str());
+        } else if (arg == "--connections") {
+            options.connections = std::atoi(value.c_str());
+        } else if (arg == "--duration") {
+            options.duration = std::atof(value.c_str());
+        } else if (arg == "--warmup") {
+            options.warmup = std::atof(value.c_str());
+        } else if (arg == "--mode") {
+            if (value != "closed" && value != "open") {
+                usage(argv[0]);
+                return 2;
+            }
+            options.open = value == "open";
+        } else if (arg == "--rate") {
+            options.rate = std::atof(value.c_str());
+        } else if (arg == "--mix") {
+            options.mix = value;
+        } else if (arg == "--db") {
+            options.db = value;
+        } else if (arg == "--rows") {
+            options.rows = std::atoi(value.c_str());
+        } else if (arg == "--range-size") {
+            options.rangeSize = std::atoi(value.c_str());
+        } else if (arg == "--label") {
+            options.label = value;
+        } else if (arg == "--encoding") {
+            if (value != "json" && value != "binary") {
+                usage(argv[0]);
+                return 2;
+            }
+            options.binary = value == "binary";
+        } else if (arg == "--decode") {
+            options.decode = std::atoi(value.c_str()) != 0;
+        } else {
+            usage(argv[0]);
+            return 2;
+        }
+    }
+    if (!parseMix(options) || options.connections < 1 || options.duration <= 0 || options.rows < 1 ||
+        options.rangeSize < 1 || (options.open && options.rate <= 0)) {
+        usage(argv[0]);
+        return 2;
+    }
+
+    try {
+        prepareTable(options);
+    } catch (const std::exception& e) {
+        std::cerr << "load_gen: " << e.what() << std::endl;
+        return 1;
+    }
+
+    Run run;
+    run.options = &options;
+    run.totalWeight = 0;
+    for (int op = 0; op < OP_COUNT; op++) {
+        run.totalWeight += options.weights[op];
+    }
+    run.measureStart = Metrics::now() + static_cast<uint64_t>(options.warmup * 1e9);
+    run.deadline = run.measureStart + static_cast<uint64_t>(options.duration * 1e9);
+    run.failures = 0;
+
+    std::vector<std::unique_ptr<Stats>> stats;
+    std::vector<std::thread> threads;
+    for (int i = 0; i < options.connections; i++) {
+        stats.emplace_back(new Stats());
+        Stats& connStats = *stats.back();
+        threads.emplace_back([&run, i, &connStats, &options]() {
+            if (options.open) {
+                openLoop(run, i, connStats);
+            } else {
+                closedLoop(run, i, connStats);
+            }
+        });
+    }
+    for (std::thread& thread : threads) {
+        thread.join();
+    }
+
+    Histogram::Snapshot all;
+    Histogram::Snapshot ops[OP_COUNT];
+    uint64_t requests = 0, errors = 0;
+    uint64_t responses = 0, responseBytes = 0, decoded = 0, decodeNs = 0;
+    uint64_t opErrors[OP_COUNT] = {0};
+    for (const auto& s : stats) {
+        s->all.snapshot(all);
+        for (int op = 0; op < OP_COUNT; op++) {
+            s->ops[op].snapshot(ops[op]);
+            opErrors[op] += s->opErrors[op];
+        }
+        requests += s->requests;
+        errors += s->errors;
+        responses += s->responses;
+        responseBytes += s->responseBytes;
+        decoded += s->decoded;
+        decodeNs += s->decodeNs;
+    }
+
+    std::string line;
+    JsonWriter writer(line);
+    writer.beginObject();
+    writer.key("bench").value(std::string("load_gen"));
+    writer.key("label").value(options.label);
+    writer.key("mode").value(std::string(options.open ? "open" : "closed"));
+    writer.key("mix").value(options.mix);
+    writer.key("encoding").value(std::string(options.binary ? "binary" : "json"));
+    writer.key("connections").value(options.connections);
+    writer.key("duration_s").value(options.duration);
+    if (options.open) {
+        writer.key("target_rps").value(options.rate);
+    }
+    writer.key("requests").value(static_cast<int64_t>(requests));
+    writer.key("errors").value(static_cast<int64_t>(errors));
+    writer.key("connection_failures").value(run.failures.load());
+    writer.key("throughput_rps").value(static_cast<double>(static_cast<int64_t>(requests / options.duration)));
+    writeLatency(writer, all);
+    writer.key("response_bytes_mean").value(static_cast<int64_t>(responses ? responseBytes / responses : 0));
+    if (decoded) {
+        writer.key("decode_us_mean").value(static_cast<double>(decodeNs / decoded / 100) / 10.0);
+    }
+    writer.key("ops").beginObject();
+    for (int op = 0; op < OP_COUNT; op++) {
+        if (!options.weights[op]) {
+            continue;
+        }
+        writer.key(kOpNames[op]).beginObject();
+        writer.key("requests").value(static_cast<int64_t>(ops[op].count + opErrors[op]));
+        writer.key("errors").value(static_cast<int64_t>(opErrors[op]));
+        writeLatency(writer, ops[op]);
+        writer.endObject();
+    }
+    writer.endObject();
+    writer.endObject();
+    std::cout << line << std::endl;
+    return run.failures.load() ? 1 : 0;
+}
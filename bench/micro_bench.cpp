@@ -0,0 +1,786 @@
+/**
+ * @file micro_bench.cpp
+ * @brief 热路径微基准：结果序列化（及客户端解码）、语句拆分与分类、查询执行、请求分发、经回环连接的完整请求
+ * 每个基准自动校准迭代次数（至少运行--min-time秒），每行输出一个JSON对象：
+ *   {"bench":"...","iterations":N,"ns_per_op":X,"bytes_per_op":B,"allocs_per_op":A}
+ * allocs_per_op为每次操作调用全局operator new的次数（所有线程合计）
+ * 运行基准前先用sqlite3核对SqlLexer的切分和只读判断（见checkLexer()），不一致时报告并以1退出
+ * 用法: micro_bench [--min-time 秒] [--filter 子串]
+ */
+#include "table_data.h"
+#include "sqlite3_handler.h"
+#include "sql_exec_handler.h"
+#include "sqlite_connect_handler.h"
+#include "epoll_server.h"
+#include "connection.h"
+#include "request_view.h"
+#include "row_decoder.h"
+#include "json_writer.h"
+#include "logger.h"
+#include "metrics.h"
+#include "worker_pool.h"
+#include "binary_result_decoder.h"
+#include "sql_lexer.h"
+#include <sqlite3.h>
+#include <unistd.h>
+#include <sys/socket.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <arpa/inet.h>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <atomic>
+#include <functional>
+#include <initializer_list>
+#include <iostream>
+#include <map>
+#include <memory>
+#include <new>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace {
+std::atomic<uint64_t> heapAllocs(0);    // 全局operator new的调用次数
+}
+
+// 替换全局分配函数以统计每次操作的堆分配次数（只在基准程序中）
+void* operator new(size_t size) {
+    heapAllocs.fetch_add(1, std::memory_order_relaxed);
+    void* p = std::malloc(size ? size : 1);
+    if (!p) {
+        throw std::bad_alloc();
+    }
+    return p;
+}
+
+void* operator new[](size_t size) {
+    return operator new(size);
+}
+
+void* operator new(size_t size, const std::nothrow_t&) noexcept {
+    heapAllocs.fetch_add(1, std::memory_order_relaxed);
+    return std::malloc(size ? size : 1);
+}
+
+void* operator new[](size_t size, const std::nothrow_t& tag) noexcept {
+    return operator new(size, tag);
+}
+
+void operator delete(void* p) noexcept {
+    std::free(p);
+}
+
+void operator delete[](void* p) noexcept {
+    std::free(p);
+}
+
+void operator delete(void* p, size_t) noexcept {
+    std::free(p);
+}
+
+void operator delete[](void* p, size_t) noexcept {
+    std::free(p);
+}
+
+namespace {
+double minTime = 0.2;
+std::string filter;
+volatile size_t sink;       // 防止被测代码的结果被优化掉
+
+/**
+ * @brief 运行一个基准并输出一行JSON
+ * @param name 基准名
+ * @param op 执行一次操作，返回本次处理的字节数（用于计算吞吐，可为0）
+ */
+void run(const std::string& name, const std::function<size_t()>& op) {
+    if (!filter.empty() && name.find(filter) == std::string::npos) {
+        return;
+    }
+
+    // 预热一次，然后成倍增加迭代次数直到单轮耗时超过minTime
+    sink = op();
+    uint64_t iterations = 1;
+    uint64_t elapsed = 0;
+    uint64_t allocs = 0;
+    size_t bytes = 0;
+    for (;;) {
+        bytes = 0;
+        uint64_t allocsBefore = heapAllocs.load(std::memory_order_relaxed);
+        uint64_t start = Metrics::now();
+        for (uint64_t i = 0; i < iterations; i++) {
+            bytes += op();
+        }
+        elapsed = Metrics::now() - start;
+        allocs = heapAllocs.load(std::memory_order_relaxed) - allocsBefore;
+        if (elapsed >= minTime * 1e9 || iterations >= (uint64_t(1) << 40)) {
+            break;
+        }
+        // 按已测耗时估算目标迭代数，至少翻倍、最多放大100倍
+        double scale = elapsed ? minTime * 1.2e9 / elapsed : 100.0;
+        scale = scale < 2.0 ? 2.0 : (scale > 100.0 ? 100.0 : scale);
+        iterations = static_cast<uint64_t>(iterations * scale);
+    }
+    sink = bytes;
+
+    std::string line;
+    JsonWriter writer(line);
+    writer.beginObject();
+    writer.key("bench").value(name);
+    writer.key("iterations").value(static_cast<int64_t>(iterations));
+    writer.key("ns_per_op").value(std::round(10.0 * elapsed / iterations) / 10.0);
+    writer.key("bytes_per_op").value(static_cast<int64_t>(bytes / iterations));
+    writer.key("allocs_per_op").value(std::round(10.0 * allocs / iterations) / 10.0);
+    writer.endObject();
+    std::cout << line << std::endl;
+}
+
+/**
+ * @brief 构造一个rows行的结果集：整数、浮点、短文本、可为NULL的文本、BLOB各一列
+ */
+TableData makeTable(size_t rows) {
+    TableData table;
+    table.addColumn("id", "INTEGER");
+    table.addColumn("score", "REAL");
+    table.addColumn("name", "TEXT");
+    table.addColumn("note", "TEXT");
+    table.addColumn("data", "BLOB");
+    const char blob[8] = {0, 1, 2, 3, 4, 5, 6, 7};
+    for (size_t i = 0; i < rows; i++) {
+        table.beginRow();
+        table.appendInteger(0, static_cast<int64_t>(i * 7919));
+        table.appendReal(1, i * 0.25 + 0.1);
+        std::string name = "user_" + std::to_string(i);
+        table.appendText(2, name.data(), name.size());
+        if (i % 4 == 0) {
+            table.appendNull(3);
+        } else {
+            const char note[] = "line one\nline \"two\"";
+            table.appendText(3, note, sizeof(note) - 1);
+        }
+        table.appendBlob(4, blob, sizeof(blob));
+    }
+    return table;
+}
+
+std::string tempDbPath(const char* tag) {
+    return "/tmp/micro_bench_" + std::to_string(getpid()) + "_" + tag + ".db";
+}
+
+void removeDb(const std::string& path) {
+    std::remove(path.c_str());
+    std::remove((path + "-wal").c_str());
+    std::remove((path + "-shm").c_str());
+}
+
+/**
+ * @brief 建一张rows行的表t(id INTEGER PRIMARY KEY, k INTEGER, v TEXT)
+ */
+bool populate(Sqlite3Handler& db, int rows) {
+    if (!db.executeUpdate("CREATE TABLE IF NOT EXISTS t(id INTEGER PRIMARY KEY, k INTEGER, v TEXT)") ||
+        !db.beginTransaction()) {
+        return false;
+    }
+    for (int i = 1; i <= rows; i++) {
+        SqlParams params;
+        std::string error;
+        Json::Value values(Json::arrayValue);
+        values.append(i);
+        values.append(i % 100);
+        values.append("value_" + std::to_string(i));
+        if (!params.parse(values, error) ||
+            !db.executeUpdate("INSERT INTO t(id, k, v) VALUES(?, ?, ?)", &params)) {
+            db.rollback();
+            return false;
+        }
+    }
+    return db.commitTransaction();
+}
+
+/**
+ * @brief 是否有任一基准名被--filter选中（需要较重准备工作的基准据此跳过准备）
+ */
+bool selected(std::initializer_list<const char*> names) {
+    for (const char* name : names) {
+        if (filter.empty() || std::string(name).find(filter) != std::string::npos) {
+            return true;
+        }
+    }
+    return false;
+}
+
+/**
+ * @brief 取一个当前空闲的回环端口，失败返回-1
+ */
+int freePort() {
+    int fd = socket(AF_INET, SOCK_STREAM | SOCK_CLOEXEC, 0);
+    if (fd < 0) {
+        return -1;
+    }
+    sockaddr_in addr;
+    std::memset(&addr, 0, sizeof(addr));
+    addr.sin_family = AF_INET;
+    addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    addr.sin_port = 0;
+    socklen_t len = sizeof(addr);
+    int port = -1;
+    if (bind(fd, reinterpret_cast<sockaddr*>(&addr), sizeof(addr)) == 0 &&
+        getsockname(fd, reinterpret_cast<sockaddr*>(&addr), &len) == 0) {
+        port = ntohs(addr.sin_port);
+    }
+    close(fd);
+    return port;
+}
+
+/**
+ * @brief 按换行分帧的阻塞客户端：发出一个请求后读到一个完整响应为止
+ */
+class LineClient {
+public:
+    LineClient() : fd(-1) {}
+    ~LineClient() {
+        if (fd >= 0) {
+            close(fd);
+        }
+    }
+
+    /**
+     * @brief 连接127.0.0.1:port；服务器线程可能还没开始监听，约1秒内重试
+     */
+    bool connect(int port) {
+        sockaddr_in addr;
+        std::memset(&addr, 0, sizeof(addr));
+        addr.sin_family = AF_INET;
+        addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+        addr.sin_port = htons(static_cast<uint16_t>(port));
+        for (int attempt = 0; attempt < 100; attempt++) {
+            fd = socket(AF_INET, SOCK_STREAM | SOCK_CLOEXEC, 0);
+            if (fd < 0) {
+                return false;
+            }
+            if (::connect(fd, reinterpret_cast<sockaddr*>(&addr), sizeof(addr)) == 0) {
+                int one = 1;
+                setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+                return true;
+            }
+            close(fd);
+            fd = -1;
+            usleep(10000);
+        }
+        return false;
+    }
+
+    /**
+     * @brief 发送request（已带换行）并读取一行响应（不含换行）
+     */
+    bool call(const std::string& request, std::string& response) {
+        for (size_t sent = 0; sent < request.size();) {
+            ssize_t n = send(fd, request.data() + sent, request.size() - sent, MSG_NOSIGNAL);
+            if (n <= 0) {
+                return false;
+            }
+            sent += static_cast<size_t>(n);
+        }
+        size_t end;
+        while ((end = buffer.find('\n')) == std::string::npos) {
+            char chunk[65536];
+            ssize_t n = recv(fd, chunk, sizeof(chunk), 0);
+            if (n <= 0) {
+                return false;
+            }
+            buffer.append(chunk, static_cast<size_t>(n));
+        }
+        response.assign(buffer, 0, end);
+        buffer.erase(0, end + 1);
+        return true;
+    }
+
+private:
+    int fd;
+    std::string buffer;     // 已收到但还不属于本次响应的字节
+};
+
+/**
+ * @brief 核对SqlLexer与sqlite3对同一段SQL的理解
+ * 逐条用sqlite3_prepare_v2编译，比较：
+ * - 语句边界：词法切出的每条语句的结束位置与sqlite3返回的tail一致（最后一条没有分号时tail为输入末尾）
+ * - 只读判断：isReadOnly()为真的语句sqlite3_stmt_readonly()也必须为真（否则只读连接上会执行写操作）；
+ *   事务控制、PRAGMA和其他语句允许反过来（sqlite3认为只读而这里保守地交给写连接），其余类别必须相同
+ * - EXPLAIN：类别为EXPLAIN当且仅当sqlite3_stmt_isexplain()。sqlite3_stmt_readonly()对EXPLAIN返回
+ *   被解释语句的结果，因此改为在query_only下执行一遍，确认它确实不写数据库
+ * @return 全部一致时返回true，不一致的语句输出到stderr
+ */
+bool checkLexer() {
+    static const char* const corpus[] = {
+        // 字符串、带引号的标识符中的分号和转义的引号
+        "SELECT 'a;b' AS [c;d], 'it''s;' AS \"e;f\", 1 AS `g;h`; SELECT v FROM t WHERE v = ';'",
+        "INSERT INTO t(k, v) VALUES(1, 'x;y'); REPLACE INTO t(id, v) VALUES(1, '\"');",
+        // 注释（含分号、未结束的行注释）、空语句
+        "-- leading; comment\nSELECT 1; /* block; */ SELECT /* ; */ 2 -- tail;\n; ;; SELECT 3 -- no semicolon",
+        "/* only a comment */ ; -- and another\n",
+        // 触发器体内的分号，体内的CASE ... END
+        "CREATE TRIGGER tr1 AFTER INSERT ON t BEGIN INSERT INTO log VALUES(new.id); "
+        "UPDATE t SET k = k + 1 WHERE id = new.id; END; SELECT 1;",
+        "create temp trigger tr2 before update on t begin "
+        "select case when new.k < 0 then raise(abort, 'negative;') end; end; DELETE FROM t WHERE id = 0;",
+        // WITH：公共表表达式之后的主语句决定类别，括号嵌套
+        "WITH c(x) AS (SELECT 1) INSERT INTO t(k) SELECT x FROM c; "
+        "WITH a AS (SELECT (1) AS n), b AS (SELECT n FROM a WHERE n IN (SELECT 1)) SELECT * FROM b; "
+        "WITH d AS (SELECT 1 AS id) DELETE FROM t WHERE id IN (SELECT id FROM d); "
+        "WITH u AS (SELECT 2 AS id) UPDATE t SET v = 'w' WHERE id IN (SELECT id FROM u);",
+        "WITH RECURSIVE r(n) AS (SELECT 1 UNION ALL SELECT n + 1 FROM r WHERE n < 3) SELECT n FROM r",
+        // EXPLAIN
+        "EXPLAIN SELECT * FROM t; EXPLAIN QUERY PLAN DELETE FROM t WHERE k = 1; explain insert into t(k) values(1);",
+        // 事务、PRAGMA、DDL和其他语句
+        "BEGIN; SAVEPOINT sp; RELEASE sp; COMMIT; BEGIN IMMEDIATE; ROLLBACK; END;",
+        "PRAGMA user_version; PRAGMA user_version = 3; PRAGMA table_info(t);",
+        "CREATE TABLE IF NOT EXISTS t2(a, b); CREATE INDEX i1 ON t(k); ALTER TABLE t ADD COLUMN w; "
+        "DROP TABLE IF EXISTS t3; CREATE VIEW v1 AS SELECT k FROM t;",
+        "VALUES(1), (2); ANALYZE; VACUUM;",
+    };
+
+    sqlite3* db = nullptr;
+    if (sqlite3_open(":memory:", &db) != SQLITE_OK ||
+        sqlite3_exec(db, "CREATE TABLE t(id INTEGER PRIMARY KEY, k INTEGER, v TEXT); CREATE TABLE log(x);",
+                     nullptr, nullptr, nullptr) != SQLITE_OK ||
+        sqlite3_exec(db, "PRAGMA query_only = 1", nullptr, nullptr, nullptr) != SQLITE_OK) {
+        std::cerr << "micro_bench: lexer check: " << sqlite3_errmsg(db) << std::endl;
+        sqlite3_close(db);
+        return false;
+    }
+
+    size_t checked = 0;
+    size_t mismatches = 0;
+    auto report = [&mismatches](const char* what, const char* sql, size_t len) {
+        std::cerr << "micro_bench: lexer check: " << what << ": " << std::string(sql, len) << std::endl;
+        mismatches++;
+    };
+    for (const char* sql : corpus) {
+        size_t size = std::strlen(sql);
+        const char* end = sql + size;
+        SqlLexer lexer(sql, size);
+        SqlLexer::Statement statement;
+        const char* tail = sql;
+        while (tail < end) {
+            sqlite3_stmt* stmt = nullptr;
+            const char* start = tail;
+            if (sqlite3_prepare_v2(db, start, static_cast<int>(end - start), &stmt, &tail) != SQLITE_OK) {
+                report(sqlite3_errmsg(db), start, static_cast<size_t>(end - start));
+                break;
+            }
+            if (!stmt) {
+                continue;       // 只有空白、注释或分号
+            }
+            checked++;
+            if (!lexer.next(statement)) {
+                report("lexer found fewer statements than sqlite3", start, static_cast<size_t>(tail - start));
+            } else {
+                const char* lexerEnd = statement.data + statement.size;
+                bool terminated = statement.size > 0 && lexerEnd[-1] == ';';
+                if (statement.data < start || (terminated ? lexerEnd != tail : tail != end)) {
+                    report("statement boundary differs from sqlite3", statement.data, statement.size);
+                }
+                bool readOnly = SqlLexer::isReadOnly(statement.kind);
+                bool sqliteReadOnly = sqlite3_stmt_readonly(stmt) != 0;
+                if (sqlite3_stmt_isexplain(stmt) > 0) {
+                    int rc;
+                    while ((rc = sqlite3_step(stmt)) == SQLITE_ROW) {
+                    }
+                    sqliteReadOnly = rc == SQLITE_DONE;
+                }
+                bool conservative = !readOnly && (statement.kind == SqlLexer::TRANSACTION ||
+                                                  statement.kind == SqlLexer::PRAGMA ||
+                                                  statement.kind == SqlLexer::OTHER);
+                if (readOnly != sqliteReadOnly && !conservative) {
+                    report("read-only classification differs from sqlite3", statement.data, statement.size);
+                }
+                if ((statement.kind == SqlLexer::EXPLAIN) != (sqlite3_stmt_isexplain(stmt) > 0)) {
+                    report("EXPLAIN classification differs from sqlite3", statement.data, statement.size);
+                }
+            }
+            sqlite3_finalize(stmt);
+        }
+        if (lexer.next(statement)) {
+            report("lexer found more statements than sqlite3", statement.data, statement.size);
+        }
+    }
+    sqlite3_close(db);
+
+    if (mismatches == 0) {
+        std::cerr << "micro_bench: lexer agrees with sqlite3 on " << checked << " statements" << std::endl;
+    }
+    return mismatches == 0;
+}
+}
+
+/**
+ * @brief 基准本体；只使用各类的公开接口
+ */
+class MicroBench {
+public:
+    static void serialize() {
+        for (size_t rows : {10, 1000}) {
+            TableData table = makeTable(rows);
+            run("table_data.to_json." + std::to_string(rows) + "x5", [&table]() {
+                return table.toJson().size();
+            });
+            run("table_data.to_binary." + std::to_string(rows) + "x5", [&table]() {
+                std::string out;
+                table.writeBinary(out);
+                return out.size();
+            });
+
+            // 客户端解码同一结果：JSON解析成Json::Value，二进制用参考解码器
+            std::string json = table.toJson();
+            std::string binary;
+            table.writeBinary(binary);
+            run("client.decode_json." + std::to_string(rows) + "x5", [&json]() {
+                Json::Value root;
+                Json::Reader reader;
+                reader.parse(json, root, false);
+                return json.size();
+            });
+            BinaryResultDecoder decoder;
+            run("client.decode_binary." + std::to_string(rows) + "x5", [&binary, &decoder]() {
+                decoder.decode(binary.data(), binary.size());
+                return binary.size();
+            });
+        }
+    }
+
+    static void statements() {
+        const std::string single = "SELECT id, k, v FROM t WHERE id = ?";
+        const std::string batch =
+            "BEGIN; INSERT INTO t(k, v) VALUES(1, 'a;b'); "
+            "UPDATE t SET v = 'x' WHERE id = 1; -- trailing; comment\n"
+            "DELETE FROM t WHERE k = 2; /* block; comment */ COMMIT;";
+        std::string large;
+        for (int i = 0; i < 100; i++) {
+            large += "INSERT INTO t(k, v) VALUES(" + std::to_string(i) + ", 'row " + std::to_string(i) + "');\n";
+        }
+
+        // 与处理请求时相同：扫描后把每条语句连同类别拷进新的（堆上的）语句列表
+        auto split = [](const std::string& sql) {
+            std::vector<std::pair<std::string, SqlLexer::Kind>> statements;
+            SqlLexer lexer(sql.data(), sql.size());
+            SqlLexer::Statement statement;
+            while (lexer.next(statement)) {
+                statements.emplace_back(std::string(statement.data, statement.size), statement.kind);
+            }
+            return statements.size();
+        };
+        run("sql.split.single", [&]() {
+            return split(single);
+        });
+        run("sql.split.batch5", [&]() {
+            return split(batch);
+        });
+        run("sql.split.batch100", [&]() {
+            return split(large);
+        });
+
+        // 只扫描和分类，不拷贝语句
+        run("sql.classify.batch5", [&]() {
+            SqlLexer lexer(batch.data(), batch.size());
+            SqlLexer::Statement statement;
+            size_t n = 0;
+            while (lexer.next(statement)) {
+                n += statement.kind + SqlLexer::isReadOnly(statement.kind);
+            }
+            return n;
+        });
+    }
+
+    static void query() {
+        std::string path = tempDbPath("query");
+        removeDb(path);
+        {
+            Sqlite3Handler db(path);
+            if (!db.open() || !populate(db, 10000)) {
+                std::cerr << "micro_bench: failed to prepare " << path << ": " << db.getLastError() << std::endl;
+                removeDb(path);
+                return;
+            }
+
+            SqlParams point;
+            std::string error;
+            Json::Value id(Json::arrayValue);
+            id.append(4242);
+            point.parse(id, error);
+            run("sqlite.execute_query.point", [&]() {
+                return db.executeQuery("SELECT id, k, v FROM t WHERE id = ?", &point).getRowCount();
+            });
+            run("sqlite.execute_query.range100", [&]() {
+                return db.executeQuery("SELECT id, k, v FROM t WHERE id BETWEEN 1000 AND 1099").getRowCount();
+            });
+            run("sqlite.execute_query.range100_to_json", [&]() {
+                return db.executeQuery("SELECT id, k, v FROM t WHERE id BETWEEN 1000 AND 1099").toJson().size();
+            });
+            run("sqlite.execute_update.insert", [&]() {
+                return static_cast<size_t>(db.executeUpdate("INSERT INTO t(k, v) VALUES(1, 'bench')"));
+            });
+        }
+        removeDb(path);
+    }
+
+    static void ingest() {
+        const std::vector<std::string> columns = {"id", "k", "v"};
+        std::string json = "[";
+        std::string csv;
+        for (int i = 0; i < 1000; i++) {
+            std::string n = std::to_string(i);
+            json += (i > 0 ? ",[" : "[") + n + "," + n + ",\"row " + n + "\"]";
+            csv += n + "," + n + ",row " + n + "\n";
+        }
+        json += "]";
+
+        std::vector<SqlValue> row;
+        run("ingest.decode.json1000", [&]() {
+            RowDecoder decoder(RowDecoder::JSON, columns);
+            decoder.reset(json.data(), json.size());
+            size_t n = 0;
+            while (decoder.next(row) == RowDecoder::ROW) {
+                n++;
+            }
+            return n;
+        });
+        run("ingest.decode.csv1000", [&]() {
+            RowDecoder decoder(RowDecoder::CSV, columns);
+            decoder.reset(csv.data(), csv.size());
+            size_t n = 0;
+            while (decoder.next(row) == RowDecoder::ROW) {
+                n++;
+            }
+            return n;
+        });
+
+        std::string path = tempDbPath("ingest");
+        removeDb(path);
+        {
+            Sqlite3Handler db(path);
+            if (!db.open() || !db.executeUpdate("CREATE TABLE t(id INTEGER PRIMARY KEY, k INTEGER, v TEXT)")) {
+                std::cerr << "micro_bench: failed to prepare " << path << ": " << db.getLastError() << std::endl;
+                removeDb(path);
+                return;
+            }
+            // 每次迭代在一个事务里写入1000行再回滚，表大小不随迭代次数增长
+            run("ingest.execute_batch.csv1000", [&]() {
+                RowDecoder decoder(RowDecoder::CSV, columns);
+                decoder.reset(csv.data(), csv.size());
+                size_t executed = 0;
+                db.beginTransaction();
+                db.executeBatch("INSERT INTO t(id, k, v) VALUES(?, ?, ?)", csv.size(), [&](sqlite3_stmt* stmt) {
+                    if (decoder.next(row) != RowDecoder::ROW) {
+                        return false;
+                    }
+                    for (size_t i = 0; i < row.size(); i++) {
+                        SqlParams::bindValue(stmt, static_cast<int>(i + 1), row[i]);
+                    }
+                    return true;
+                }, executed);
+                db.rollback();
+                return executed;
+            });
+        }
+        removeDb(path);
+    }
+
+    /**
+     * @brief 同步处理器的分发：解析请求信封、按功能号找到处理器并调用，与EpollServer对同步请求做的相同
+     */
+    static void dispatch() {
+        std::string path = tempDbPath("dispatch");
+        removeDb(path);
+        {
+            SqliteConnectHandler connectHandler;
+            SqlExecHandler execHandler;
+            std::map<std::string, EpollServer::Handler> handlers;
+            handlers["100000"] = [&connectHandler](const RequestView& request, Connection& conn) {
+                return connectHandler.handle(request, conn);
+            };
+            handlers["100001"] = [&execHandler](const RequestView& request, Connection& conn) {
+                return execHandler.handle(request, conn);
+            };
+            handlers["echo"] = [](const RequestView&, Connection&) {
+                return std::string("{\"status\":0,\"msg\":\"ok\"}");
+            };
+
+            Connection conn;
+            conn.open(-1, FrameCodec::NEWLINE, FrameCodec::kDefaultMaxFrameSize, Metrics::now());
+            std::string response;
+            auto process = [&](const std::string& request) {
+                RequestView view;
+                if (!view.parse(request.data(), request.size())) {
+                    response = "{\"status\":-1,\"msg\":\"Invalid JSON format\"}";
+                    return response.size();
+                }
+                auto it = handlers.find(view.getFuncId());
+                if (it == handlers.end()) {
+                    response = "{\"status\":-1,\"msg\":\"Unknown funcid\"}";
+                } else {
+                    response = it->second(view, conn);
+                }
+                return response.size();
+            };
+
+            process("{\"funcid\":\"100000\",\"msg\":{\"dbpath\":\"" + path + "\"}}");
+            process("{\"funcid\":\"100001\",\"msg\":{\"sqlstr\":"
+                    "\"CREATE TABLE t(id INTEGER PRIMARY KEY, k INTEGER, v TEXT);"
+                    "INSERT INTO t(k, v) VALUES(1, 'one');\"}}");
+            if (response.find("\"status\":0") == std::string::npos) {
+                std::cerr << "micro_bench: dispatch setup failed: " << response << std::endl;
+            }
+
+            const std::string echo = "{\"funcid\":\"echo\",\"msg\":{\"sqlstr\":\"SELECT 1\"}}";
+            const std::string select = "{\"funcid\":\"100001\",\"msg\":{\"sqlstr\":"
+                                       "\"SELECT id, k, v FROM t WHERE id = ?\",\"params\":[1]}}";
+            const std::string invalid = "{\"funcid\":\"100001\",\"msg\":{\"sqlstr\":";
+            run("handler.dispatch.echo", [&]() {
+                return process(echo);
+            });
+            run("handler.dispatch.select", [&]() {
+                return process(select);
+            });
+            run("handler.dispatch.invalid", [&]() {
+                return process(invalid);
+            });
+            conn.close();
+        }
+        removeDb(path);
+    }
+
+    /**
+     * @brief 连接表：10万个打开的连接中按事件数据查找，过期编号（fd已被复用）查找失败
+     */
+    static void connections() {
+        const int kConnections = 100000;
+        ConnectionTable table;
+        std::vector<uint64_t> ids;
+        ids.reserve(kConnections);
+        for (int fd = 0; fd < kConnections; fd++) {
+            ids.push_back(table.open(fd, FrameCodec::NEWLINE, FrameCodec::kDefaultMaxFrameSize, 0).id);
+        }
+        // 关闭后重新打开一半的fd，原来的编号成为过期事件
+        for (int fd = 0; fd < kConnections; fd += 2) {
+            table.close(*table.find(ids[fd]));
+            table.open(fd, FrameCodec::NEWLINE, FrameCodec::kDefaultMaxFrameSize, 0);
+        }
+
+        size_t next = 0;
+        run("reactor.connection_table.find", [&]() {
+            // 大步长跳跃访问，避免只测到缓存命中
+            next = (next + 7919) % kConnections;
+            return table.find(ids[next]) ? size_t(1) : size_t(0);
+        });
+    }
+
+    /**
+     * @brief 服务器实际使用的完整路径：本进程内的EpollServer（一个Reactor、一个工作线程）在回环端口上运行，
+     * 经一条TCP连接逐个发出请求并等待响应，包括Reactor的收发和分帧、校验、工作线程上的执行和结果投递
+     */
+    static void roundTrip() {
+        if (!selected({"server.round_trip.echo", "server.round_trip.select", "server.round_trip.update"})) {
+            return;
+        }
+        int port = freePort();
+        if (port <= 0) {
+            std::cerr << "micro_bench: no free loopback port for the round trip benchmark" << std::endl;
+            return;
+        }
+        std::string path = tempDbPath("round_trip");
+        removeDb(path);
+
+        // 事件循环没有退出接口：服务器在后台线程上一直运行到进程结束，对象及其处理器不释放
+        auto workers = std::make_shared<WorkerPool>(1);
+        auto connectHandler = std::make_shared<SqliteConnectHandler>();
+        auto execHandler = std::make_shared<SqlExecHandler>(workers);
+        EpollServer* server = new EpollServer(port);
+        server->registerHandler("100000", [connectHandler](const RequestView& request, Connection& conn) {
+            return connectHandler->handle(request, conn);
+        });
+        server->registerAsyncHandler("100001", [execHandler](const RequestView& request, Connection& conn,
+                                                             const std::shared_ptr<ResponseStream>& stream) {
+            execHandler->handleAsync(request, conn, stream);
+        });
+        server->registerHandler("echo", [](const RequestView&, Connection&) {
+            return std::string("{\"status\":0,\"msg\":\"ok\"}");
+        });
+
+        // start()进入事件循环前会向stdout打印一行：收到第一个响应（此时已在事件循环中）之前屏蔽stdout
+        std::cout.setstate(std::ios::failbit);
+        std::thread([server]() {
+            try {
+                server->start();
+            } catch (const std::exception& e) {
+                std::cerr << "micro_bench: round trip server: " << e.what() << std::endl;
+            }
+        }).detach();
+
+        LineClient client;
+        std::string response;
+        bool ready = client.connect(port) &&
+                     client.call("{\"funcid\":\"100000\",\"msg\":{\"dbpath\":\"" + path + "\"}}\n", response);
+        std::cout.clear();
+        if (!ready || !client.call("{\"funcid\":\"100001\",\"msg\":{\"sqlstr\":"
+                                   "\"CREATE TABLE t(id INTEGER PRIMARY KEY, k INTEGER, v TEXT);"
+                                   "INSERT INTO t(k, v) VALUES(1, 'one');\"}}\n", response) ||
+            response.find("\"status\":0") == std::string::npos) {
+            std::cerr << "micro_bench: round trip setup failed: " << response << std::endl;
+            removeDb(path);
+            return;
+        }
+
+        const std::string echo = "{\"funcid\":\"echo\",\"msg\":{}}\n";
+        const std::string select = "{\"funcid\":\"100001\",\"msg\":{\"sqlstr\":"
+                                   "\"SELECT id, k, v FROM t WHERE id = ?\",\"params\":[1]}}\n";
+        const std::string update = "{\"funcid\":\"100001\",\"msg\":{\"sqlstr\":"
+                                   "\"UPDATE t SET k = k + 1 WHERE id = 1\"}}\n";
+        run("server.round_trip.echo", [&]() {
+            client.call(echo, response);
+            return response.size();
+        });
+        run("server.round_trip.select", [&]() {
+            client.call(select, response);
+            return response.size();
+        });
+        run("server.round_trip.update", [&]() {
+            client.call(update, response);
+            return response.size();
+        });
+        removeDb(path);
+    }
+};
+
+int main(int argc, char* argv[]) {
+    for (int i = 1; i < argc; i++) {
+        if (std::strcmp(argv[i], "--min-time") == 0 && i + 1 < argc) {
+            minTime = std::atof(argv[++i]);
+        } else if (std::strcmp(argv[i], "--filter") == 0 && i + 1 < argc) {
+            filter = argv[++i];
+        } else {
+            std::cerr << "Usage: " << argv[0] << " [--min-time seconds] [--filter substring]" << std::endl;
+            return 2;
+        }
+    }
+    // 基准输出走stdout，关闭日志避免干扰
+    Logger::setLevel(Logger::OFF);
+
+    if (!checkLexer()) {
+        return 1;
+    }
+    try {
+        MicroBench::serialize();
+        MicroBench::statements();
+        MicroBench::query();
+        MicroBench::ingest();
+        MicroBench::dispatch();
+        MicroBench::roundTrip();
+        MicroBench::connections();
+    } catch (const std::exception& e) {
+        std::cerr << "micro_bench: " << e.what() << std::endl;
+        return 1;
+    }
+    return 0;
+}
@@ -0,0 +1,86 @@
+#!/bin/sh
+# 运行全部基准，每个结果一行JSON，同时输出到终端和$BENCH_OUT
+# 1. 微基准（bin/micro_bench）
+# 2. 在$BENCH_PORT上依次用每种I/O后端启动bin/server（各用一个临时数据库），
+#    用bin/load_gen跑同样的几组典型负载，标签前缀为实际使用的后端
+# 环境变量：
+#   BENCH_PORT         服务器端口，默认9190
+#   BENCH_DURATION     每组负载的计时时长（秒），默认5
+#   BENCH_CONNECTIONS  并发连接数，默认8
+#   BENCH_RATE         开环负载的目标速率（请求/秒），默认2000
+#   BENCH_OUT          结果文件，默认bin/bench_results.jsonl
+#   BENCH_BACKENDS     要比较的I/O后端，默认"epoll io_uring"（内核不支持io_uring时服务器退回epoll，标签注明）
+set -e
+
+BIN=${BIN:-bin}
+PORT=${BENCH_PORT:-9190}
+DURATION=${BENCH_DURATION:-5}
+CONNECTIONS=${BENCH_CONNECTIONS:-8}
+RATE=${BENCH_RATE:-2000}
+OUT=${BENCH_OUT:-$BIN/bench_results.jsonl}
+BACKENDS=${BENCH_BACKENDS:-epoll io_uring}
+
+WORK=$(mktemp -d /tmp/cppserver_bench.XXXXXX)
+SERVER_PID=
+stop_server() {
+    if [ -n "$SERVER_PID" ]; then
+        kill "$SERVER_PID" 2>/dev/null || true
+        wait "$SERVER_PID" 2>/dev/null || true
+        SERVER_PID=
+    fi
+}
+cleanup() {
+    stop_server
+    rm -rf "$WORK"
+}
+trap cleanup EXIT INT TERM
+
+: > "$OUT"
+
+echo "== micro benchmarks"
+"$BIN/micro_bench" | tee -a "$OUT"
+
+for BACKEND in $BACKENDS; do
+    echo "== load (server on port $PORT, IO_BACKEND=$BACKEND)"
+    DB="$WORK/bench_$BACKEND.db"
+    IO_BACKEND=$BACKEND LOG_LEVEL=warn "$BIN/server" "$PORT" > "$WORK/server.log" 2>&1 &
+    SERVER_PID=$!
+
+    # 等待端口就绪
+    i=0
+    until "$BIN/load_gen" --port "$PORT" --db "$DB" --rows 100000 \
+            --duration 0.1 --warmup 0 --connections 1 --mix point=1 > /dev/null 2>&1; do
+        i=$((i + 1))
+        if [ "$i" -ge 50 ] || ! kill -0 "$SERVER_PID" 2>/dev/null; then
+            echo "server did not start, log:" >&2
+            cat "$WORK/server.log" >&2
+            exit 1
+        fi
+        sleep 0.1
+    done
+    TAG=$BACKEND
+    if grep -q "falling back to epoll" "$WORK/server.log"; then
+        TAG="$BACKEND-fallback-epoll"
+        echo "io_uring unavailable, server fell back to epoll" >&2
+    fi
+
+    load() {
+        label=$1
+        shift
+        "$BIN/load_gen" --port "$PORT" --db "$DB" --rows 100000 \
+            --duration "$DURATION" --connections "$CONNECTIONS" --label "$TAG.$label" "$@" | tee -a "$OUT"
+    }
+
+    load point_select --mix point=1
+    load range_scan --mix range=1
+    # 同一范围扫描的JSON与二进制结果：比较响应字节数和客户端解码耗时
+    load range_scan_json_decode --mix range=1 --decode 1
+    load range_scan_binary --mix range=1 --encoding binary
+    load insert --mix insert=1
+    load transaction --mix txn=1
+    load mixed --mix point=70,range=20,insert=8,txn=2
+    load mixed_open --mix point=70,range=20,insert=8,txn=2 --mode open --rate "$RATE"
+    stop_server
+done
+
+echo "== results written to $OUT"
@@ -0,0 +1,168 @@
+#pragma once
+#include "worker_pool.h"
+#include <string>
+#include <map>
+#include <unordered_map>
+#include <memory>
+#include <mutex>
+#include <cstddef>
+#include <cstdint>
+
+class JsonWriter;
+
+/**
+ * @brief 单个功能号的准入限制和优先级
+ */
+struct FuncLimits {
+    FuncLimits() : concurrency(0), rate(0), burst(0), priority(PRIORITY_NORMAL) {}
+
+    size_t concurrency;     // 同时执行的请求数上限，0表示不限
+    double rate;            // 令牌桶速率（请求/秒），0表示不限
+    double burst;           // 令牌桶容量，0时取速率（至少1）
+    TaskPriority priority;  // 在工作线程池上的优先级
+};
+
+/**
+ * @brief 准入控制的配置
+ */
+struct AdmissionOptions {
+    AdmissionOptions();
+
+    size_t clientConcurrency;   // 每个客户端（按IP）同时执行的异步请求数上限，0表示不限
+    double clientRate;          // 每个客户端的令牌桶速率（请求/秒），0表示不限
+    double clientBurst;         // 每个客户端的令牌桶容量，0时取速率（至少1）
+    int queueTargetMs;          // 排队延迟目标（毫秒），0表示不按排队延迟拒绝
+    int queueIntervalMs;        // 排队延迟需持续超标的时长（毫秒）
+    // 按功能号的限制和优先级；默认SQL执行和游标为高优先级、批量导入为低优先级，未列出的功能号不限、普通优先级
+    std::map<std::string, FuncLimits> funcs;
+
+    /**
+     * @brief 解析按功能号的配置并合并进funcs
+     * 格式为"功能号:键=值,键=值;功能号:..."，键为concurrency、rate、burst、priority（high/normal/low），
+     * 如"100002:concurrency=2,priority=low;100001:rate=500"
+     * @return 格式错误时返回false，error为原因
+     */
+    bool parseFuncLimits(const std::string& spec, std::string& error);
+};
+
+/**
+ * @brief 请求准入控制（所有Reactor共享，线程安全）
+ * 异步请求分发给处理器之前依次检查：请求所属优先级的工作队列是否过载（CoDel），
+ * 功能号和客户端的并发上限和令牌桶。不通过的请求立即得到错误响应，不进入工作队列：
+ * 超过并发或速率限制的状态码为kStatusThrottled，排队延迟超标的为kStatusOverloaded，
+ * 客户端可据此区分自身超限和服务器整体过载
+ */
+class AdmissionControl {
+public:
+    static const int kStatusThrottled = -2;
+    static const int kStatusOverloaded = -3;
+    static const char kOverloadedMessage[];
+
+    /**
+     * @brief 过载时的拒绝响应（准入时拒绝，或排队过久被工作线程放弃）
+     */
+    static std::string overloadedResponse();
+
+    struct FuncState;
+
+    /**
+     * @brief 一个已准入请求占用的名额，请求结束时归还
+     */
+    struct Ticket {
+        Ticket() : owner(nullptr), func(nullptr), client(0), priority(PRIORITY_NORMAL) {}
+
+        AdmissionControl* owner;    // 非空表示持有名额
+        FuncState* func;
+        uint32_t client;
+        TaskPriority priority;      // 处理器向工作线程池提交任务时使用的优先级
+    };
+
+    /**
+     * @brief 构造函数
+     * @param options 配置
+     * @param workers 工作线程池，按配置设置其排队延迟目标
+     */
+    AdmissionControl(const AdmissionOptions& options, std::shared_ptr<WorkerPool> workers);
+
+    AdmissionControl(const AdmissionControl&) = delete;
+    AdmissionControl& operator=(const AdmissionControl&) = delete;
+
+    /**
+     * @brief 请求准入（Reactor线程调用）
+     * @param funcId 功能号
+     * @param client 客户端IPv4地址（网络字节序）
+     * @param now 当前时刻（纳秒）
+     * @param ticket [out] 通过时占用的名额
+     * @param response [out] 拒绝时的响应
+     * @return 是否准入
+     */
+    bool admit(const std::string& funcId, uint32_t client, uint64_t now, Ticket& ticket, std::string& response);
+
+    /**
+     * @brief 归还名额（任意线程，未持有名额时什么也不做）
+     */
+    void release(Ticket& ticket);
+
+    /**
+     * @brief 输出队列深度、各功能号的进行中请求数和拒绝次数
+     */
+    void writeStats(JsonWriter& writer);
+
+    struct FuncState {
+        FuncState() : inFlight(0), tokens(0), refilled(0), admitted(0), throttled(0), overloaded(0) {}
+
+        FuncLimits limits;
+        size_t inFlight;
+        double tokens;
+        uint64_t refilled;      // 令牌桶上次补充的时刻（纳秒）
+        uint64_t admitted;
+        uint64_t throttled;
+        uint64_t overloaded;
+    };
+
+private:
+    /**
+     * @brief 单个客户端的状态，空闲时删除
+     */
+    struct ClientState {
+        ClientState() : inFlight(0), tokens(0), refilled(0) {}
+
+        size_t inFlight;
+        double tokens;
+        uint64_t refilled;
+    };
+
+    std::shared_ptr<WorkerPool> workers;
+    const size_t clientConcurrency;
+    const double clientRate;
+    const double clientBurst;
+
+    std::mutex mutex;
+    std::map<std::string, FuncState> funcs;     // 构造后只改值不增删，名额直接持有指针
+    FuncState other;                            // 未配置的功能号共用
+    std::unordered_map<uint32_t, ClientState> clients;
+    size_t sweepAt;             // 客户端数达到该值时清理一遍空闲的客户端
+    uint64_t clientThrottled;
+
+    static const size_t kMinSweepAt = 1024;
+
+    bool tracksClients() const { return clientConcurrency > 0 || clientRate > 0; }
+
+    /**
+     * @brief 客户端没有进行中的请求且令牌桶已满（与新建的状态相同）
+     */
+    bool isIdle(const ClientState& state, uint64_t now) const;
+
+    /**
+     * @brief 删除所有空闲的客户端：被拒绝后不再出现的客户端不会在release()时被删掉
+     */
+    void sweepClients(uint64_t now);
+
+    /**
+     * @brief 补充令牌桶并尝试取一个令牌
+     * @return 成功取到令牌时返回0，否则返回下一个令牌到来前需等待的毫秒数
+     */
+    static int64_t takeToken(double& tokens, uint64_t& refilled, double rate, double burst, uint64_t now);
+
+    static std::string rejectResponse(int status, const std::string& msg, int64_t retryAfterMs);
+};
@@ -0,0 +1,168 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <new>
+#include <string>
+#include <vector>
+#include <utility>
+#include <type_traits>
+
+/**
+ * @brief 请求级的线性分配器（bump arena）
+ * 一个请求从解析到发出响应期间的临时对象都从同一个arena分配：分配只移动指针，
+ * 单个对象不释放，请求结束时整体回收。回收后的arena放回全局空闲列表，
+ * 保留的内存块留给下一个请求，稳定运行后请求路径上不再调用全局堆。
+ * 请求在Reactor线程上解析、在工作线程上执行，arena随请求在线程间传递，
+ * 同一时刻只属于一个线程，因此分配不加锁；只有取用和归还空闲列表时加锁
+ */
+class Arena {
+public:
+    /**
+     * @brief 从空闲列表取一个arena，没有时新建
+     */
+    static Arena* acquire();
+
+    /**
+     * @brief 请求结束：析构create()创建的对象（逆序），回收内存并放回空闲列表
+     * 之后不能再使用从它分配的任何内存
+     */
+    void release();
+
+    /**
+     * @brief 分配一段内存，随arena一起回收
+     * 超过一个内存块的分配单独向堆申请，回收时释放
+     */
+    void* allocate(size_t size, size_t align = alignof(std::max_align_t)) {
+        uintptr_t aligned = (reinterpret_cast<uintptr_t>(cursor) + align - 1) & ~(uintptr_t)(align - 1);
+        if (aligned + size <= reinterpret_cast<uintptr_t>(limit)) {
+            cursor = reinterpret_cast<char*>(aligned + size);
+            return reinterpret_cast<void*>(aligned);
+        }
+        return allocateSlow(size, align);
+    }
+
+    /**
+     * @brief 在arena上构造对象；需要析构的对象登记下来，release()时析构
+     */
+    template<class T, class... Args>
+    T* create(Args&&... args) {
+        void* memory = allocate(sizeof(T), alignof(T));
+        T* object = new (memory) T(std::forward<Args>(args)...);
+        if (!std::is_trivially_destructible<T>::value) {
+            Finalizer* finalizer = static_cast<Finalizer*>(allocate(sizeof(Finalizer), alignof(Finalizer)));
+            finalizer->destroy = &destroy<T>;
+            finalizer->object = object;
+            finalizer->next = finalizers;
+            finalizers = finalizer;
+        }
+        return object;
+    }
+
+    static const size_t kBlockSize = 16 * 1024;     // 标准内存块大小
+    static const size_t kRetainedBlocks = 4;        // 回收时保留的标准块数
+    static const size_t kMaxIdleArenas = 256;       // 空闲列表中最多保留的arena数
+
+private:
+    /**
+     * @brief 内存块头部，数据紧随其后
+     */
+    struct Block {
+        Block* next;
+        size_t size;        // 数据区大小
+    };
+
+    /**
+     * @brief 需要析构的对象
+     */
+    struct Finalizer {
+        void (*destroy)(void*);
+        void* object;
+        Finalizer* next;
+    };
+
+    Block* blocks;          // 标准块链表，current之后的块是上次回收后保留下来的
+    Block* current;         // 正在分配的标准块
+    Block* large;           // 单独申请的大块
+    char* cursor;
+    char* limit;
+    Finalizer* finalizers;
+    Arena* nextIdle;        // 空闲列表中的下一个
+
+    Arena();
+    ~Arena();
+
+    Arena(const Arena&) = delete;
+    Arena& operator=(const Arena&) = delete;
+
+    void* allocateSlow(size_t size, size_t align);
+
+    /**
+     * @brief 析构登记的对象，释放大块和多余的标准块，回到第一个块的开头
+     */
+    void reset();
+
+    static Block* newBlock(size_t size);
+    static char* dataOf(Block* block);
+
+    template<class T>
+    static void destroy(void* object) {
+        static_cast<T*>(object)->~T();
+    }
+};
+
+/**
+ * @brief 从Arena分配内存的标准库分配器
+ * arena为空时退回全局堆，因此同一个容器类型既可用于请求级对象，也可用于长期对象。
+ * 容器移动赋值和交换时分配器随内容一起转移，内容不会被逐元素拷贝
+ */
+template<class T>
+class ArenaAllocator {
+public:
+    typedef T value_type;
+    typedef std::true_type propagate_on_container_move_assignment;
+    typedef std::true_type propagate_on_container_swap;
+
+    template<class U>
+    struct rebind {
+        typedef ArenaAllocator<U> other;
+    };
+
+    ArenaAllocator() : arena(nullptr) {}
+    ArenaAllocator(Arena* arena) : arena(arena) {}
+
+    template<class U>
+    ArenaAllocator(const ArenaAllocator<U>& other) : arena(other.getArena()) {}
+
+    T* allocate(size_t n) {
+        if (arena) {
+            return static_cast<T*>(arena->allocate(n * sizeof(T), alignof(T)));
+        }
+        return static_cast<T*>(::operator new(n * sizeof(T)));
+    }
+
+    void deallocate(T* p, size_t) {
+        if (!arena) {
+            ::operator delete(p);
+        }
+    }
+
+    Arena* getArena() const { return arena; }
+
+private:
+    Arena* arena;
+};
+
+template<class T, class U>
+bool operator==(const ArenaAllocator<T>& a, const ArenaAllocator<U>& b) {
+    return a.getArena() == b.getArena();
+}
+
+template<class T, class U>
+bool operator!=(const ArenaAllocator<T>& a, const ArenaAllocator<U>& b) {
+    return a.getArena() != b.getArena();
+}
+
+typedef std::basic_string<char, std::char_traits<char>, ArenaAllocator<char>> ArenaString;
+
+template<class T>
+using ArenaVector = std::vector<T, ArenaAllocator<T>>;
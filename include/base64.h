@@ -0,0 +1,21 @@
+#pragma once
+#include <string>
+#include <cstddef>
+#include "arena.h"
+
+/**
+ * @brief Base64解码（标准字母表，允许省略末尾的'='，忽略空白）
+ * @param input Base64文本
+ * @param len 文本长度
+ * @param output [out] 解码后的字节
+ * @return 输入是否合法
+ */
+bool base64Decode(const char* input, size_t len, ArenaString& output);
+
+/**
+ * @brief Base64编码（标准字母表，带'='补齐）
+ * @param data 原始字节
+ * @param len 字节数
+ * @param output [out] 追加编码结果
+ */
+void base64Encode(const char* data, size_t len, std::string& output);
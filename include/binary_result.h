@@ -0,0 +1,133 @@
+#pragma once
+#include <string>
+#include <vector>
+#include <cstddef>
+#include <cstdint>
+
+/**
+ * @brief 查询结果的编码，由100000建立连接时协商，之后对该会话的查询结果生效
+ */
+enum ResultEncoding {
+    RESULT_ENCODING_JSON,
+    RESULT_ENCODING_BINARY
+};
+
+/**
+ * @brief 紧凑二进制结果格式（版本1）的编码工具
+ * JSON把每个数值写成带引号的文本、每行重复所有列名；二进制格式只发送一次列头，
+ * 值按类型编码并带长度，每批行附一个NULL位图。多字节定长值均为小端。
+ *
+ *   响应   = 头部 批* 结束标记 尾部
+ *   头部   = u8 0xB1 | u8 版本(1) | varint 列数 | 每列: 字节串 列名, 字节串 声明类型（可为空）
+ *   批     = varint 行数(>0) | 每列1字节: 本批该列的值类型 | NULL位图 | 按行、按列排列的非NULL值
+ *   结束   = varint 0
+ *   尾部   = zigzag varint 状态码 | 字节串 消息 | 字节串 附加字段（JSON对象成员文本，如"cursor":1,"done":false）
+ *
+ *   值类型：1 INTEGER（zigzag varint）、2 FLOAT（8字节IEEE 754）、3 TEXT（字节串，UTF-8）、
+ *           4 BLOB（字节串，原始字节）、0 本批该列全为NULL、5 混合（每个值前带1字节值类型）
+ *   字节串 = varint 长度 | 内容
+ *   NULL位图共ceil(行数*列数/8)字节，第r行第c列对应第r*列数+c位（每字节低位在前），置位表示NULL
+ *
+ * 出错且还没有发出任何行时只返回错误：列数为0、没有批，状态码和消息在尾部。
+ * 客户端按首字节区分：0xB1为二进制结果，'{'为JSON（请求校验失败等不经过结果编码的响应）。
+ * 参考解码器见bench/binary_result_decoder.h
+ */
+class BinaryResult {
+public:
+    enum ValueType {
+        TYPE_NULL = 0,
+        TYPE_INTEGER = 1,
+        TYPE_FLOAT = 2,
+        TYPE_TEXT = 3,
+        TYPE_BLOB = 4,
+        TYPE_MIXED = 5
+    };
+
+    static const uint8_t kMagic = 0xB1;
+    static const uint8_t kVersion = 1;
+
+    /**
+     * @brief SQLite存储类对应的值类型
+     */
+    static ValueType typeOf(int storageClass);
+
+    static void appendVarint(std::string& out, uint64_t value);
+    static void appendSigned(std::string& out, int64_t value);     // zigzag varint
+    static void appendDouble(std::string& out, double value);
+    static void appendBytes(std::string& out, const char* data, size_t len);
+
+    /**
+     * @brief 写入头部的固定部分，随后调用appendColumn写入每一列
+     */
+    static void appendHeader(std::string& out, size_t columnCount);
+    static void appendColumn(std::string& out, const char* name, size_t nameLen,
+                             const char* declType, size_t declTypeLen);
+
+    /**
+     * @brief 写入结束标记和尾部
+     */
+    static void appendTrailer(std::string& out, int status, const char* msg, size_t msgLen,
+                              const std::string& extra);
+};
+
+/**
+ * @brief 正在积累的一批行
+ * 值先连同各自的类型写入暂存区，输出时才知道每列在本批中是否只有一种类型，
+ * 只有一种类型的列去掉逐值的类型字节
+ */
+class BinaryBatch {
+public:
+    BinaryBatch() : columnCount(0), rows(0), column(0) {}
+
+    /**
+     * @brief 按列数清空（复用已有容量）
+     */
+    void reset(size_t columnCount);
+
+    void addNull();
+    void addInteger(int64_t value);
+    void addReal(double value);
+    void addText(const char* data, size_t len);
+    void addBlob(const char* data, size_t len);
+
+    /**
+     * @brief 当前行的各列都已添加
+     */
+    void endRow() {
+        rows++;
+        column = 0;
+    }
+
+    size_t getRowCount() const { return rows; }
+
+    /**
+     * @brief 暂存的值的字节数
+     */
+    size_t getSize() const { return values.size(); }
+
+    /**
+     * @brief 本批是否该输出了
+     */
+    bool isFull() const { return rows >= kMaxRows || values.size() >= kMaxBytes; }
+
+    /**
+     * @brief 把本批编码追加到out并清空，没有行时不输出
+     */
+    void flush(std::string& out);
+
+    static const size_t kMaxRows = 1024;
+    static const size_t kMaxBytes = 16 * 1024;
+
+private:
+    /**
+     * @brief 记录当前值的类型并写入类型字节，返回前移到下一列
+     */
+    void beginValue(BinaryResult::ValueType type);
+
+    size_t columnCount;
+    size_t rows;
+    size_t column;                  // 当前行中下一个值的列号
+    std::vector<uint8_t> types;     // 每列在本批中的值类型
+    std::string nulls;              // NULL位图
+    std::string values;             // 带类型字节的非NULL值
+};
@@ -0,0 +1,104 @@
+#pragma once
+#include "db_session.h"
+#include "row_decoder.h"
+#include "worker_pool.h"
+#include "epoll_server.h"
+#include <string>
+#include <vector>
+#include <memory>
+#include <atomic>
+#include <cstdint>
+
+/**
+ * @brief 一次批量导入的状态，数据分多帧发送时保存在会话上
+ */
+struct BulkLoad {
+    BulkLoad() : format(RowDecoder::JSON), batchSize(0), rows(0), batches(0), started(0) {}
+
+    std::string table;
+    std::vector<std::string> columns;
+    RowDecoder::Format format;
+    std::string sql;                // INSERT INTO "table"("c1", ...) VALUES(?, ...)
+    size_t batchSize;               // 每个事务的行数
+    uint64_t rows;                  // 已写入的行数（之前的帧均已提交）
+    uint64_t batches;               // 已提交的事务数
+    uint64_t started;               // 第一帧开始执行的时刻（纳秒）
+};
+
+/**
+ * @brief 批量导入（功能号100002）
+ * msg字段：
+ *   - table：表名（第一帧必填）
+ *   - columns：列名数组；CSV带表头时可省略
+ *   - rows：行数组，每行是按columns顺序的数组或以列名为键的对象
+ *   - data + format：格式为"csv"或"ndjson"的文本（二选一，与rows互斥）
+ *   - header：CSV第一条记录是否为表头，默认false
+ *   - batchsize：每个事务包含的行数，默认10000
+ *   - onconflict："abort"（默认）、"ignore"或"replace"
+ *   - more：为true时后续帧继续本次导入，后续帧只需带rows或data（每帧包含完整的记录）
+ * 所有行用同一条预编译的INSERT逐行重新绑定执行，每batchsize行提交一次，
+ * 每帧结束时提交未满的批次，事务不跨帧，不会在帧之间占住写连接。
+ * 客户端自己开启了事务时，行写在该事务中，不再分批提交。
+ * 出错时回滚当前批次并结束导入，响应中row为出错行的序号（从0开始、跨帧累计），
+ * committed为已提交的行数；最后一帧的响应给出总行数和每秒行数
+ */
+class BulkIngestHandler {
+public:
+    explicit BulkIngestHandler(std::shared_ptr<WorkerPool> workers);
+
+    /**
+     * @brief 异步处理：在Reactor线程上拷贝出请求字段，写入交给数据库的写串行队列
+     */
+    void handleAsync(const RequestView& request, Connection& conn,
+                     const std::shared_ptr<ResponseStream>& stream);
+
+    static const size_t kDefaultBatchSize = 10000;
+
+private:
+    /**
+     * @brief 一帧请求
+     */
+    struct BulkRequest {
+        BulkRequest() : format(RowDecoder::JSON), hasFormat(false), header(false), batchSize(0), more(false) {}
+
+        std::shared_ptr<DbSession> session;
+        std::string table;                  // 为空表示延续会话上的导入
+        std::vector<std::string> columns;
+        RowDecoder::Format format;
+        bool hasFormat;                     // 带rows或format字段（延续帧的data可省略format）
+        std::string data;                   // rows的原始JSON文本，或data的内容
+        bool header;
+        size_t batchSize;
+        std::string conflict;               // INSERT OR ...，为空表示默认
+        bool more;
+    };
+
+    std::shared_ptr<WorkerPool> workers;
+
+    /**
+     * @brief 解析并校验请求（在Reactor线程上调用）
+     * @param error [out] 校验失败时的响应
+     * @return 是否可以执行
+     */
+    bool parseRequest(const RequestView& view, Connection& conn,
+                      BulkRequest& request, std::string& error);
+
+    /**
+     * @brief 写入一帧的数据，返回序列化后的响应（在工作线程上调用）
+     * @param stream 请求的响应通道：截止标记置位后中止写入，等待写连接不超过截止时刻
+     */
+    std::string execute(BulkRequest& request, const ResponseStream& stream);
+
+    /**
+     * @brief 按第一帧建立导入状态并生成INSERT语句
+     * @return 失败时为nullptr，error为原因
+     */
+    static std::shared_ptr<BulkLoad> startLoad(BulkRequest& request, RowDecoder& decoder, std::string& error);
+
+    /**
+     * @brief 按SQL规则给标识符加双引号
+     */
+    static void appendIdentifier(std::string& out, const std::string& name);
+
+    static std::string errorResponse(const std::string& msg);
+};
@@ -0,0 +1,254 @@
+#pragma once
+#include <string>
+#include <vector>
+#include <cstdint>
+#include <memory>
+#include "frame_codec.h"
+#include "output_queue.h"
+#include "timer_wheel.h"
+
+class ResponseStream;
+class DbSession;
+struct sockaddr_in;
+
+/**
+ * @brief 客户端连接状态（Reactor本地）
+ * 连接对象存放在ConnectionTable中按fd索引的槽位里，关闭后槽位留给复用同一fd的新连接
+ */
+struct Connection {
+    Connection()
+        : fd(-1)
+        , id(0)
+        , generation(0)
+        , active(false)
+        , clientAddr(0)
+        , sending(0)
+        , bytesSent(0)
+        , streamBase(0)
+        , requestStart(0)
+        , lastActive(0)
+        , events(0)
+        , zerocopy(ZEROCOPY_UNTRIED)
+        , readPaused(false)
+        , closeAfterFlush(false)
+        , inFlight(false)
+    {
+        idleTimer.owner = this;
+        deadlineTimer.owner = this;
+    }
+
+    /**
+     * @brief 禁用拷贝（定时器按地址挂在时间轮上）
+     */
+    Connection(const Connection&) = delete;
+    Connection& operator=(const Connection&) = delete;
+
+    /**
+     * @brief 接受新连接：递增代数并重置全部状态
+     * @param now 当前时刻（纳秒），作为最近活动时间
+     */
+    void open(int fd, FrameCodec::Mode frameMode, size_t maxFrameSize, uint64_t now) {
+        generation++;
+        this->fd = fd;
+        id = makeId(fd, generation);
+        codec = FrameCodec(frameMode, maxFrameSize);
+        sending = 0;
+        bytesSent = 0;
+        streamBase = 0;
+        requestStart = 0;
+        lastActive = now;
+        events = 0;
+        zerocopy = ZEROCOPY_UNTRIED;
+        active = true;
+        readPaused = false;
+        closeAfterFlush = false;
+        inFlight = false;
+    }
+
+    /**
+     * @brief 连接已关闭：释放缓冲区、会话和响应通道，不把任何状态留给复用该fd的下一个连接
+     * 工作线程可能仍持有会话和响应通道，它们由shared_ptr在最后一个持有者放手时释放；
+     * 定时器须已由Reactor从时间轮上取消
+     */
+    void close() {
+        active = false;
+        std::string().swap(peer);
+        std::string().swap(inBuf);
+        output.clear();
+        std::string().swap(requestFuncId);
+        session.reset();
+        stream.reset();
+        spareStreams[0].reset();
+        spareStreams[1].reset();
+    }
+
+    /**
+     * @brief MSG_ZEROCOPY状态：第一次有大块数据要写时才对socket开启；
+     * 开启失败或内核回报仍做了拷贝（如回环连接）后不再使用
+     */
+    enum ZerocopyState {
+        ZEROCOPY_UNTRIED,
+        ZEROCOPY_ON,
+        ZEROCOPY_OFF
+    };
+
+    /**
+     * @brief 记录对端地址并生成日志用的客户端描述
+     */
+    void setPeer(const struct sockaddr_in& addr);
+
+    /**
+     * @brief 日志用的客户端描述 "Client[fd: ip:port]"
+     * 接受时没有拿到对端地址的连接（io_uring多次触发的accept）在第一次用到时才取
+     */
+    const std::string& getPeer() {
+        if (peer.empty()) {
+            resolvePeer();
+        }
+        return peer;
+    }
+
+    /**
+     * @brief 对端IPv4地址（网络字节序），取得方式同getPeer()
+     */
+    uint32_t getClientAddr() {
+        if (peer.empty()) {
+            resolvePeer();
+        }
+        return clientAddr;
+    }
+
+    /**
+     * @brief 尚未写入socket的输出字节数（含已交给I/O后端、还在发送中的）
+     */
+    size_t pendingOutput() const { return output.size() + sending; }
+
+    /**
+     * @brief 异步请求已完成：把响应通道放进空的备用槽，没有空槽时替换仍被占用的那个
+     */
+    void retireStream() {
+        std::shared_ptr<ResponseStream>& slot = !spareStreams[0] || !spareStreams[0].unique()
+                                                ? spareStreams[0] : spareStreams[1];
+        slot = std::move(stream);
+    }
+
+    /**
+     * @brief 连接编号：高32位为槽位代数，低32位为fd
+     */
+    static uint64_t makeId(int fd, uint32_t generation) {
+        return (static_cast<uint64_t>(generation) << 32) | static_cast<uint32_t>(fd);
+    }
+
+    int fd;
+    uint64_t id;            // 连接编号，同时作为I/O事件的标识，用于识别fd复用后过期的事件和异步结果
+    uint32_t generation;    // 槽位被使用的次数
+    bool active;            // 槽位上是否是一个打开的连接（与id相邻，查找只触及一个缓存行）
+    std::string peer;       // 日志用的客户端描述，为空表示还没有取对端地址，经getPeer()访问
+    uint32_t clientAddr;    // 对端IPv4地址（网络字节序），准入控制按它区分客户端，经getClientAddr()访问
+    FrameCodec codec;       // 分帧状态（AUTO模式下记录该连接判定出的帧格式）
+    std::string inBuf;      // 已读取但尚未组成完整帧的数据
+    OutputQueue output;     // 待发送的响应数据
+    size_t sending;         // 已从output换出交给I/O后端、尚未确认写出的字节数（io_uring）
+    uint64_t bytesSent;     // 连接上累计写入socket的字节数
+    std::shared_ptr<DbSession> session;         // 100000建立的数据库会话，未连接时为空
+    std::shared_ptr<ResponseStream> stream;     // 进行中的异步请求的响应通道
+    // 用完的响应通道留给后续请求复用；工作线程发出响应后可能还没放开上一个，所以留两个轮换
+    std::shared_ptr<ResponseStream> spareStreams[2];
+    uint64_t streamBase;    // 该响应开始时的bytesSent加积压，用于计算响应已发送的字节数
+    uint64_t requestStart;  // 进行中的异步请求的开始时间（统计用）
+    std::string requestFuncId;  // 进行中的异步请求的功能号（统计用）
+    uint64_t lastActive;    // 最近一次收发数据或完成请求的时刻（纳秒），空闲超时从这里算起
+    TimerWheel::Timer idleTimer;        // 空闲超时和游标空闲超时中较早的一个
+    TimerWheel::Timer deadlineTimer;    // 进行中的异步请求的截止时间
+    uint32_t events;        // 当前在epoll中注册的事件（epoll后端）
+    ZerocopyState zerocopy; // MSG_ZEROCOPY的使用状态（epoll后端）
+    bool readPaused;        // 输出积压超过高水位，暂停读取和处理请求
+    bool closeAfterFlush;   // 对端已关闭写端，发完剩余响应后关闭
+    bool inFlight;          // 有异步请求尚未完成，后续请求等待以保证顺序
+
+private:
+    /**
+     * @brief 用getpeername取对端地址，对端已重置时只记录fd
+     */
+    void resolvePeer();
+};
+
+/**
+ * @brief 按fd直接索引的连接表（Reactor本地）
+ * 槽位按页分配、只增不减：查找是两次数组下标，连接对象的地址在Reactor生命周期内不变，
+ * 关闭连接后仍持有的引用不会悬空，只会看到active为false
+ */
+class ConnectionTable {
+public:
+    ConnectionTable() : count(0) {}
+
+    ConnectionTable(const ConnectionTable&) = delete;
+    ConnectionTable& operator=(const ConnectionTable&) = delete;
+
+    /**
+     * @brief 为新接受的fd打开槽位
+     */
+    Connection& open(int fd, FrameCodec::Mode frameMode, size_t maxFrameSize, uint64_t now) {
+        size_t page = static_cast<size_t>(fd) / kPageSize;
+        if (page >= pages.size()) {
+            pages.resize(page + 1);
+        }
+        if (!pages[page]) {
+            pages[page].reset(new Connection[kPageSize]);
+        }
+        Connection& conn = pages[page][static_cast<size_t>(fd) % kPageSize];
+        if (!conn.active) {
+            count++;
+        }
+        conn.open(fd, frameMode, maxFrameSize, now);
+        return conn;
+    }
+
+    /**
+     * @brief 按连接编号查找，连接已关闭或fd已被新连接复用时返回nullptr
+     */
+    Connection* find(uint64_t id) const {
+        size_t fd = static_cast<uint32_t>(id);
+        size_t page = fd / kPageSize;
+        if (page >= pages.size() || !pages[page]) {
+            return nullptr;
+        }
+        Connection& conn = pages[page][fd % kPageSize];
+        return conn.active && conn.id == id ? &conn : nullptr;
+    }
+
+    /**
+     * @brief 关闭槽位上的连接
+     */
+    void close(Connection& conn) {
+        if (conn.active) {
+            conn.close();
+            count--;
+        }
+    }
+
+    /**
+     * @brief 遍历所有打开的连接
+     */
+    template<class F>
+    void forEach(F f) {
+        for (auto& page : pages) {
+            if (!page) {
+                continue;
+            }
+            for (size_t i = 0; i < kPageSize; i++) {
+                if (page[i].active) {
+                    f(page[i]);
+                }
+            }
+        }
+    }
+
+    size_t size() const { return count; }
+
+private:
+    static const size_t kPageSize = 256;    // 每页的槽位数
+
+    std::vector<std::unique_ptr<Connection[]>> pages;
+    size_t count;
+};
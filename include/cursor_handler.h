@@ -0,0 +1,125 @@
+#pragma once
+#include "db_session.h"
+#include "sql_params.h"
+#include "result_writer.h"
+#include "worker_pool.h"
+#include "epoll_server.h"
+#include <string>
+#include <memory>
+#include <cstdint>
+
+/**
+ * @brief 一个打开的服务器端游标，保存在会话上
+ * 持有专用的只读连接和语句：语句第一次执行后保持着读事务，后续读取看到同一快照
+ */
+struct Cursor {
+    Cursor() : stmt(nullptr), timeoutNs(0), lastUsed(0), rows(0) {}
+    ~Cursor() {
+        if (stmt) {
+            lease->closeCursor(stmt);     // 先结束语句，连接随后由lease归还
+        }
+    }
+
+    Cursor(const Cursor&) = delete;
+    Cursor& operator=(const Cursor&) = delete;
+
+    SqlitePool::Lease lease;
+    SqlParams params;           // 文本参数以SQLITE_STATIC绑定，须与语句同生命周期
+    sqlite3_stmt* stmt;
+    uint64_t timeoutNs;         // 空闲超时（纳秒）
+    uint64_t lastUsed;          // 最近一次读取的时刻（纳秒）
+    uint64_t rows;              // 已返回的行数
+};
+
+/**
+ * @brief 服务器端游标：分批读取大结果集，服务器内存占用只与每批的行数有关
+ * 功能号：
+ *   - 100003 打开：msg.sqlstr为单条只读查询，params同100001，count为随打开一起返回的行数（默认1000，可为0）
+ *   - 100004 读取：msg.cursor为游标编号，count为本次最多返回的行数（默认1000）
+ *   - 100005 关闭：msg.cursor为游标编号
+ * 打开和读取的响应与查询结果格式相同，另带cursor（游标编号）和done（游标是否已关闭）；
+ * 结果集读完或出错时游标自动关闭，done为true。换行分隔的连接上大批次分段发送。
+ * 每个游标占用一个专用只读连接（每个数据库最多SqlitePoolOptions::maxCursors个），
+ * 读取的是打开时已提交数据的快照，看不到会话上未提交的事务中的修改；
+ * 打开期间WAL无法完全检查点，因此空闲超过超时时间的游标由Reactor关闭，
+ * 每个客户端连接同时打开的游标数也有上限
+ */
+class CursorHandler {
+public:
+    /**
+     * @brief 构造函数
+     * @param workers 执行查询的工作线程池
+     * @param maxPerConnection 每个客户端连接同时打开的游标数上限
+     * @param idleTimeoutMs 游标空闲超时（毫秒）
+     */
+    CursorHandler(std::shared_ptr<WorkerPool> workers, size_t maxPerConnection, int idleTimeoutMs);
+
+    /**
+     * @brief 打开游标（异步）
+     */
+    void handleOpen(const RequestView& request, Connection& conn,
+                    const std::shared_ptr<ResponseStream>& stream);
+
+    /**
+     * @brief 读取下一批行（异步）
+     */
+    void handleFetch(const RequestView& request, Connection& conn,
+                     const std::shared_ptr<ResponseStream>& stream);
+
+    /**
+     * @brief 关闭游标（同步，在Reactor线程上执行）
+     */
+    std::string handleClose(const RequestView& request, Connection& conn);
+
+    static const size_t kDefaultFetchRows = 1000;
+    static const size_t kDefaultMaxPerConnection = 8;
+    static const int kDefaultIdleTimeoutMs = 60000;
+
+private:
+    /**
+     * @brief 一次打开或读取请求
+     */
+    struct CursorRequest {
+        CursorRequest() : cursorId(0), count(kDefaultFetchRows) {}
+
+        std::shared_ptr<DbSession> session;
+        std::string sql;                // 打开时的查询
+        SqlParams params;
+        uint64_t cursorId;              // 读取的游标
+        size_t count;
+    };
+
+    std::shared_ptr<WorkerPool> workers;
+    const size_t maxPerConnection;
+    const uint64_t idleTimeoutNs;
+
+    static const size_t kStreamChunkSize = 64 * 1024;
+
+    /**
+     * @brief 解析会话、count和cursor字段（在Reactor线程上调用）
+     * @param needCursor 是否必须带cursor字段
+     * @param error [out] 校验失败时的响应
+     */
+    static bool parseCommon(const RequestView& view, Connection& conn, bool needCursor,
+                            CursorRequest& request, std::string& error);
+
+    /**
+     * @brief 在工作线程上打开游标并返回第一批行
+     */
+    void open(CursorRequest& request, ResponseStream& stream);
+
+    /**
+     * @brief 在工作线程上读取一批行
+     */
+    void fetch(CursorRequest& request, ResponseStream& stream);
+
+    /**
+     * @brief 从游标读取一批行并发送；读完或出错时从会话上关闭游标
+     * 游标表的修改都在发送最后一段之前完成：响应送达后Reactor可能立即分发该连接的下一个请求；
+     * 关闭时也在发送前释放游标，连接先回到池里
+     */
+    static void fetchAndSend(DbSession& session, uint64_t id, std::shared_ptr<Cursor> cursor,
+                             size_t count, ResponseStream& stream);
+
+    static std::string errorResponse(const std::string& msg);
+};
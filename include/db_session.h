@@ -0,0 +1,100 @@
+#pragma once
+#include "sqlite_pool.h"
+#include "binary_result.h"
+#include <map>
+#include <memory>
+#include <string>
+#include <cstdint>
+
+struct BulkLoad;
+struct Cursor;
+
+/**
+ * @brief 客户端数据库会话
+ * 会话只记录所连接的连接池，每个请求从池中租用连接。
+ * 请求结束时如果写连接仍处于事务中（客户端显式BEGIN且尚未COMMIT），
+ * 该连接会被钉在会话上，直到事务结束才归还，保证跨请求事务的语义
+ */
+class DbSession {
+public:
+    /**
+     * @brief 构造函数
+     * @param pool 所连接的连接池
+     * @param encoding 建立连接时协商的查询结果编码
+     */
+    explicit DbSession(std::shared_ptr<SqlitePool> pool, ResultEncoding encoding = RESULT_ENCODING_JSON);
+
+    /**
+     * @brief 为一个请求租用连接
+     * @param readOnly 请求是否只包含只读语句
+     * @param lease [out] 租约
+     * @param error [out] 失败原因
+     * @param deadline 请求的截止时刻（纳秒），等待连接不超过它，0表示没有
+     * @return 是否成功
+     */
+    bool acquire(bool readOnly, SqlitePool::Lease& lease, std::string& error, uint64_t deadline = 0);
+
+    /**
+     * @brief 请求结束后归还连接，事务未结束时钉在会话上
+     */
+    void release(SqlitePool::Lease& lease);
+
+    SqlitePool& getPool() const { return *pool; }
+
+    /**
+     * @brief 结果编码：SQL执行和游标读取的结果按它输出，请求校验失败等其余响应总是JSON
+     */
+    ResultEncoding getEncoding() const { return encoding; }
+
+    /**
+     * @brief 是否有跨请求事务占用着写连接
+     */
+    bool hasPinnedConnection() const { return static_cast<bool>(pinned); }
+
+    /**
+     * @brief 跨多帧进行中的批量导入，没有时为空
+     * 同一连接的请求依次处理，只有处理当前请求的线程会访问
+     */
+    const std::shared_ptr<BulkLoad>& getBulkLoad() const { return bulkLoad; }
+    void setBulkLoad(std::shared_ptr<BulkLoad> load) { bulkLoad = std::move(load); }
+
+    /**
+     * @brief 登记一个打开的服务器端游标
+     * 游标表只在处理本连接请求的线程上访问，或在连接空闲（没有进行中的请求）时由Reactor清理
+     * @return 游标编号（会话内唯一，从1开始）
+     */
+    uint64_t addCursor(std::shared_ptr<Cursor> cursor);
+
+    /**
+     * @brief 按编号查找游标，不存在（已关闭或已超时）时为nullptr
+     */
+    std::shared_ptr<Cursor> findCursor(uint64_t id) const;
+
+    /**
+     * @brief 关闭游标
+     * @return 游标是否存在
+     */
+    bool removeCursor(uint64_t id);
+
+    size_t getCursorCount() const { return cursors.size(); }
+
+    /**
+     * @brief 关闭空闲超时的游标
+     * @param now 当前时刻（纳秒，Metrics::now()）
+     * @return 关闭的游标数
+     */
+    size_t closeIdleCursors(uint64_t now);
+
+    /**
+     * @brief 最早的游标空闲到期时刻（纳秒），没有游标时为0
+     */
+    uint64_t nextCursorExpiry() const;
+
+private:
+    std::shared_ptr<SqlitePool> pool;
+    const ResultEncoding encoding;
+    SqlitePool::Lease pinned;       // 跨请求事务占用的写连接
+    std::shared_ptr<BulkLoad> bulkLoad;
+    std::map<uint64_t, std::shared_ptr<Cursor>> cursors;
+    uint64_t nextCursorId;
+};
@@ -0,0 +1,65 @@
+#pragma once
+#include <sys/epoll.h>
+#include <string>
+#include <vector>
+#include "io_backend.h"
+
+/**
+ * @brief epoll后端
+ * 连接以边缘触发注册，可读时读到EAGAIN，写不完时关注EPOLLOUT；
+ * 事件数据是连接编号，监听socket、eventfd和timerfd的事件数据是fd本身（代数为0），不会与连接编号相同。
+ * 输出队列的各段用sendmsg一次写出；一次写出的数据达到零拷贝阈值时加MSG_ZEROCOPY，
+ * 内核的完成通知放在socket的错误队列里，以EPOLLERR唤醒，取到后释放对应的段
+ */
+class EpollBackend : public IoBackend {
+public:
+    /**
+     * @brief 构造函数
+     * @param zerocopyThreshold 一次写出的数据达到该字节数时使用MSG_ZEROCOPY，0表示不用
+     */
+    EpollBackend(Reactor& reactor, size_t zerocopyThreshold);
+    ~EpollBackend();
+
+    /**
+     * @brief 创建epoll实例并注册监听socket、eventfd和timerfd
+     * @return 失败时返回false，error为原因
+     */
+    bool init(int listenFd, int wakeFd, int timerFd, std::string& error);
+
+    const char* getName() const { return "epoll"; }
+    bool start(std::string&) { return true; }
+    bool wait();
+    void dispatch();
+    void attach(Connection& conn);
+    bool receive(Connection& conn);
+    bool send(Connection& conn);
+    void updateInterest(Connection& conn);
+    void close(Connection& conn);
+
+private:
+    Reactor& reactor;
+    int epollFd;
+    int listenFd;
+    int wakeFd;
+    int timerFd;
+    const size_t zerocopyThreshold;
+    std::vector<struct epoll_event> events;     // epoll_wait结果数组
+    int ready;                                  // 上一次epoll_wait得到的事件数
+
+    void handleAccept();
+
+    /**
+     * @brief 连接可读：未暂停读取时先读到EAGAIN，再交给Reactor处理
+     */
+    void handleRead(Connection& conn);
+
+    /**
+     * @brief 一次写出len字节时是否使用MSG_ZEROCOPY（第一次需要时对socket开启SO_ZEROCOPY）
+     */
+    bool useZerocopy(Connection& conn, size_t len);
+
+    /**
+     * @brief 取出错误队列里的零拷贝完成通知，释放内核已不再引用的段
+     */
+    void reapZerocopy(Connection& conn);
+};
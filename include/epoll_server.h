@@ -4,45 +4,128 @@
 #include <functional>
 #include <map>
 #include <memory>
+#include <vector>
 #include "sqlite3_handler.h"
-#include <sstream>
-#include <ctime>
+#include "frame_codec.h"
+#include "response_stream.h"
+#include "request_view.h"
+#include "admission_control.h"
+#include "io_backend.h"
 #include "json/json.h"
 
+class Reactor;
+struct Connection;
+
 /**
  * @brief Epoll服务器类
+ * 启动时创建N个Reactor（每个一个线程、一个epoll实例、一个SO_REUSEPORT监听socket），
+ * 处理器表在start()之后只读，可被所有Reactor线程无锁共享
  */
 class EpollServer {
 public:
     /**
      * @brief 构造函数
      * @param port 服务器监听端口
+     * @param reactorCount Reactor（事件循环线程）数量，小于1时按1处理
      */
-    explicit EpollServer(int port);
+    explicit EpollServer(int port, int reactorCount = 1);
     ~EpollServer();
+
+    /**
+     * @brief 异步处理器：在Reactor线程上被调用，可把工作交给其他线程，完成后经响应通道送回结果
+     * 连接对象是Reactor本地的，只能在调用期间访问，需要的状态（如会话）应拷贝出来交给工作线程
+     */
+    typedef std::function<void(const RequestView&, Connection&, const std::shared_ptr<ResponseStream>&)> AsyncHandler;
+
+    /**
+     * @brief 同步处理器：在Reactor线程上被调用，直接返回响应
+     */
+    typedef std::function<std::string(const RequestView&, Connection&)> Handler;
     
     void start();
-    void registerHandler(const std::string& funcId, 
-                        std::function<std::string(const Json::Value&, int)> handler);
+    void registerHandler(const std::string& funcId, Handler handler);
+
+    /**
+     * @brief 注册异步处理器
+     * 同一连接上的请求严格按顺序处理：异步请求完成前，该连接后续的请求不会被分发
+     * @param funcId 功能号
+     * @param handler 处理器
+     */
+    void registerAsyncHandler(const std::string& funcId, AsyncHandler handler);
+
+    /**
+     * @brief 设置请求帧格式（需在start()前调用）
+     * @param mode 帧格式，默认AUTO（按连接首字节自动判定）
+     * @param maxFrameSize 单帧最大字节数，超过时关闭连接
+     */
+    void setFrameMode(FrameCodec::Mode mode, size_t maxFrameSize = FrameCodec::kDefaultMaxFrameSize);
+
+    /**
+     * @brief 设置单连接输出积压的高/低水位（需在start()前调用）
+     * 未发送数据超过高水位时暂停读取该连接的请求，降到低水位以下后恢复
+     * @param high 高水位字节数
+     * @param low 低水位字节数
+     */
+    void setOutputWatermarks(size_t high, size_t low);
+
+    /**
+     * @brief 设置超时（需在start()前调用），0表示不限
+     * @param idleTimeoutMs 连接上没有收发数据、也没有进行中的请求超过该时间后关闭连接
+     * @param requestTimeoutMs 异步请求的默认截止时间（从收到请求算起，包括排队时间），
+     *        客户端可用msg.timeout_ms为单个请求另行指定；超时的语句被中止，响应为错误
+     */
+    void setTimeouts(int idleTimeoutMs, int requestTimeoutMs);
+
+    /**
+     * @brief 设置准入控制（需在start()前调用），不设置时所有请求都直接分发
+     * 只作用于异步请求：同步处理器在Reactor线程上直接完成，不占用工作线程
+     */
+    void setAdmission(std::shared_ptr<AdmissionControl> admission);
+
+    /**
+     * @brief 选择Reactor的I/O后端（需在start()前调用），默认epoll
+     * 选择io_uring而内核不支持（低于6.0、被禁用或资源不足）时各Reactor自动退回epoll
+     */
+    void setIoBackend(IoBackendType type);
+
+    /**
+     * @brief 设置零拷贝发送的阈值（需在start()前调用），0表示关闭
+     * epoll后端一次写出的数据达到该字节数时使用MSG_ZEROCOPY，发出的缓冲区保留到内核通知发送完成；
+     * 内核回报仍做了拷贝（如回环连接）的连接随即停用
+     */
+    void setZerocopyThreshold(size_t bytes);
+
+    static const int kDefaultIdleTimeoutMs = 300000;
+    static const int kDefaultRequestTimeoutMs = 30000;
+    static const size_t kDefaultZerocopyThreshold = 128 * 1024;
     
 private:
-    int serverFd;
-    int epollFd;
-    int listenFd;
-    std::map<std::string, std::function<std::string(const Json::Value&, int)>> handlers;
-    std::map<int, std::string> writeBuffers;
-    
-    void handleAccept();
-    void handleRead(int fd);
-    void handleWrite(int fd);
-    void closeConnection(int fd);
-    
-    void initServer();
-    void handleConnection(int clientFd);
-    std::string processRequest(const std::string& request, int clientFd);
+    friend class Reactor;
+
+    int port;
+    int reactorCount;
+    FrameCodec::Mode frameMode;
+    size_t maxFrameSize;
+    size_t outputHighWatermark;
+    size_t outputLowWatermark;
+    uint64_t idleTimeoutNs;
+    uint64_t requestTimeoutNs;
+    std::shared_ptr<AdmissionControl> admission;
+    IoBackendType ioBackend;
+    size_t zerocopyThreshold;
+    std::map<std::string, Handler> handlers;
+    std::map<std::string, AsyncHandler> asyncHandlers;
+    std::vector<std::unique_ptr<Reactor>> reactors;
     
-    void logDebug(const std::string& message) const;
-    void logError(const std::string& message) const;
-    std::string getCurrentTimestamp() const;
-    std::string getClientInfo(int clientFd) const;
-}; 
\ No newline at end of file
+    /**
+     * @brief 解析并分发一个请求
+     * @param data 请求负载（指向连接的输入缓冲区，处理期间不变）
+     * @param len 负载长度
+     * @param reactor 连接所属的Reactor
+     * @param conn 连接
+     * @param response [out] 同步处理时的响应
+     * @return true表示响应已就绪；false表示已交给异步处理器，响应稍后经Reactor送回
+     */
+    bool processRequest(const char* data, size_t len, Reactor& reactor, Connection& conn,
+                        std::string& response);
+}; 
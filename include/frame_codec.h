@@ -0,0 +1,71 @@
+#pragma once
+#include <string>
+#include <vector>
+#include <cstddef>
+#include <cstdint>
+#include "output_queue.h"
+
+/**
+ * @brief 请求分帧编解码器
+ * 支持两种帧格式：
+ *   - 长度前缀：4字节大端无符号长度 + 负载
+ *   - 换行分隔：每行一个JSON请求（允许\r\n）
+ * AUTO模式下根据连接上收到的第一个字节判定：'{'或空白字符为换行分隔，否则为长度前缀。
+ * 响应使用与该连接请求相同的帧格式
+ */
+class FrameCodec {
+public:
+    enum Mode {
+        AUTO,
+        LENGTH_PREFIXED,
+        NEWLINE
+    };
+
+    enum Result {
+        FRAME,          // 解析出一个完整帧
+        NEED_MORE,      // 数据不足，需要继续读取
+        FRAME_ERROR     // 帧非法（超长等），应关闭连接
+    };
+
+    /**
+     * @brief 构造函数
+     * @param mode 帧格式
+     * @param maxFrameSize 单帧最大字节数
+     */
+    explicit FrameCodec(Mode mode = AUTO, size_t maxFrameSize = kDefaultMaxFrameSize);
+
+    /**
+     * @brief 从缓冲区中解析下一帧
+     * @param data 未消费数据起始位置
+     * @param len 未消费数据长度
+     * @param consumed [out] 本帧（含帧头/分隔符）占用的字节数
+     * @param payload [out] 帧负载起始位置（指向data内部）
+     * @param payloadLen [out] 帧负载长度
+     * @return 解析结果
+     */
+    Result decode(const char* data, size_t len, size_t& consumed,
+                  const char*& payload, size_t& payloadLen);
+
+    /**
+     * @brief 按当前帧格式封装一个响应并接到输出队列上（大的负载整段接入，不拷贝）
+     * @param payload 响应负载，接入队列时被取走
+     * @param out 输出队列
+     */
+    void encode(std::string& payload, OutputQueue& out) const;
+
+    /**
+     * @brief 封装一个由多段组成的响应：各段依次接到输出队列上，不拼接成一个字符串
+     * @param head 负载的前面各段，接入队列时被取走
+     * @param payload 负载的最后一段
+     * @param out 输出队列
+     */
+    void encode(std::vector<std::string>& head, std::string& payload, OutputQueue& out) const;
+
+    Mode getMode() const { return mode; }
+
+    static const size_t kDefaultMaxFrameSize = 64 * 1024 * 1024;
+
+private:
+    Mode mode;
+    size_t maxFrameSize;
+};
@@ -0,0 +1,121 @@
+#pragma once
+#include "sqlite3_handler.h"
+#include "worker_pool.h"
+#include <string>
+#include <vector>
+#include <functional>
+#include <mutex>
+#include <condition_variable>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+
+class SqlitePool;
+
+/**
+ * @brief 组提交：把同一数据库上并发到达的小写请求合并到一个外层事务里一次提交
+ * 请求先进入等待列表，由写串行队列中的一个任务成批取走：
+ * BEGIN，每个请求在自己的保存点（SAVEPOINT）里执行，失败的请求回滚到保存点，
+ * 成功的释放保存点，最后一次COMMIT。每个请求仍然各自成功或失败，
+ * 所有响应在COMMIT完成后才发出。
+ * 如果外层事务本身失败（SQLite因I/O错误等回滚了整个事务或COMMIT失败），
+ * 该批请求在回滚后逐个单独重新执行。
+ * 取批时最多再等待window微秒凑批（0表示只合并前一批执行期间排起来的请求，不额外等待），
+ * 凑满maxBatch个立即执行；等待发生在写串行队列的任务中，会占用一个工作线程。
+ * 等待写连接前先答复已过截止时间的请求（包括排在后面、尚未取走的），
+ * 等待时间不超过其余请求中最早的截止时刻
+ */
+class GroupCommit {
+public:
+    /**
+     * @brief 在写连接上执行一个请求，写入序列化后的响应
+     * @return 请求是否成功（失败时回滚到它的保存点）
+     */
+    typedef std::function<bool(Sqlite3Handler*, std::string&)> Work;
+
+    /**
+     * @brief 请求完成（所在批次已提交或失败）后发出响应
+     */
+    typedef std::function<void(std::string)> Done;
+
+    /**
+     * @brief 构造函数
+     * @param pool 所属连接池（提供写连接和写串行队列）
+     * @param maxBatch 一批最多合并的请求数，小于2时不合并
+     * @param windowUs 凑批的等待时间（微秒）
+     */
+    GroupCommit(SqlitePool& pool, size_t maxBatch, int windowUs);
+
+    GroupCommit(const GroupCommit&) = delete;
+    GroupCommit& operator=(const GroupCommit&) = delete;
+
+    bool isEnabled() const { return maxBatch > 1; }
+
+    /**
+     * @brief 提交一个写请求（线程安全）
+     * @param workers 执行写串行队列任务的线程池
+     * @param work 在写连接上执行请求
+     * @param done 响应回调，在工作线程上调用
+     * @param buffer 写响应用的缓冲区（如回收的字符串，可以为空）
+     * @param priority 取批任务在线程池上的优先级
+     * @param expired 请求的截止标志（置位表示已超时），nullptr表示不检查
+     * @param deadline 请求的截止时刻（纳秒，Metrics::now()），0表示没有
+     * @param encoding 请求所在会话的结果编码，超时或租不到写连接时的错误响应按它输出
+     */
+    void submit(WorkerPool& workers, Work work, Done done, std::string buffer = std::string(),
+                TaskPriority priority = PRIORITY_NORMAL,
+                const std::atomic<bool>* expired = nullptr, uint64_t deadline = 0,
+                ResultEncoding encoding = RESULT_ENCODING_JSON);
+
+private:
+    struct Entry {
+        Work work;
+        Done done;
+        std::string response;
+        uint64_t arrived;       // 到达时刻（纳秒）
+        TaskPriority priority;
+        const std::atomic<bool>* expired;
+        uint64_t deadline;
+        ResultEncoding encoding;
+
+        bool isExpired(uint64_t now) const {
+            return (expired && expired->load(std::memory_order_relaxed)) || (deadline > 0 && now >= deadline);
+        }
+    };
+
+    SqlitePool& pool;
+    const size_t maxBatch;
+    static const uint64_t kSweepIntervalNs = 10 * 1000000;    // 等待写连接时清理到期请求的间隔
+
+    const uint64_t windowNs;
+
+    std::mutex mutex;
+    std::condition_variable filled;     // 等待列表凑满一批
+    std::vector<Entry> pending;
+    bool scheduled;                     // 写串行队列中已有取批任务
+    std::vector<Entry> batch;           // 正在执行的一批（取批任务在写串行队列中逐个执行，反复使用）
+
+    /**
+     * @brief 写串行队列中的任务：取走一批并执行
+     */
+    void flush(WorkerPool& workers);
+
+    /**
+     * @brief 从当前批和等待列表中移除已过截止时间的请求并答复错误
+     * @return 其余请求中最早的截止时刻，没有时为0
+     */
+    uint64_t answerExpired();
+
+    /**
+     * @brief 从entries中移出已过截止时间的请求
+     * @param earliest [in,out] 更新为留下的请求中最早的截止时刻
+     */
+    static void takeExpired(std::vector<Entry>& entries, uint64_t now,
+                            std::vector<Entry>& expired, uint64_t& earliest);
+
+    /**
+     * @brief 在一个外层事务中执行一批请求
+     * @return 外层事务是否提交成功；失败时已回滚
+     */
+    bool runGrouped(Sqlite3Handler* db);
+};
@@ -0,0 +1,91 @@
+#pragma once
+#include <string>
+#include <memory>
+#include <cstddef>
+
+class Reactor;
+struct Connection;
+
+/**
+ * @brief I/O后端类型
+ */
+enum IoBackendType {
+    IO_BACKEND_EPOLL,       // 就绪通知：epoll边缘触发，每次收发一个系统调用
+    IO_BACKEND_IO_URING     // 完成通知：io_uring，内核不支持时退回epoll
+};
+
+/**
+ * @brief Reactor的I/O后端：等待事件、接受连接、收发数据
+ * 连接状态、分帧、请求分发、定时器和异步结果都在Reactor里，与后端无关。
+ * 后端把新连接交给Reactor::acceptConnection()，收到的数据交给Reactor::received()，
+ * 写出的进度交给Reactor::sent()，连接可以继续处理时回调Reactor::handleInput()/handleWrite()；
+ * 唤醒eventfd可读时调用Reactor::drainCompletions()
+ */
+class IoBackend {
+public:
+    virtual ~IoBackend() {}
+
+    /**
+     * @brief 创建后端：要求io_uring而内核不支持时退回epoll并记录原因
+     * @param listenFd 监听socket（非阻塞）
+     * @param wakeFd 异步结果到达时被写入的eventfd
+     * @param timerFd 时间轮推进时刻的timerfd
+     * @param zerocopyThreshold 一次写出的数据达到该字节数时使用MSG_ZEROCOPY（epoll后端），0表示不用
+     * @throw std::runtime_error epoll也创建失败
+     */
+    static std::unique_ptr<IoBackend> create(IoBackendType type, Reactor& reactor,
+                                             int listenFd, int wakeFd, int timerFd,
+                                             size_t zerocopyThreshold);
+
+    /**
+     * @brief 按名字（"epoll"/"io_uring"）取后端类型
+     * @return 名字未知时返回false
+     */
+    static bool parseType(const std::string& name, IoBackendType& type);
+
+    virtual const char* getName() const = 0;
+
+    /**
+     * @brief 在Reactor线程上、事件循环开始前调用
+     * @return false表示无法开始，error为原因
+     */
+    virtual bool start(std::string& error) = 0;
+
+    /**
+     * @brief 提交积攒的操作并等待至少一个事件
+     * @return false表示出错，事件循环应退出
+     */
+    virtual bool wait() = 0;
+
+    /**
+     * @brief 处理wait()得到的全部事件
+     */
+    virtual void dispatch() = 0;
+
+    /**
+     * @brief 新连接已打开：开始接收数据
+     */
+    virtual void attach(Connection& conn) = 0;
+
+    /**
+     * @brief 恢复读取时调用：取走暂停期间留在内核里的数据
+     * @return false表示出错，连接已关闭
+     */
+    virtual bool receive(Connection& conn) = 0;
+
+    /**
+     * @brief 把输出队列交给内核，能写多少写多少
+     * @return false表示出错，连接已关闭
+     */
+    virtual bool send(Connection& conn) = 0;
+
+    /**
+     * @brief 按读暂停状态和输出积压调整关注的事件
+     */
+    virtual void updateInterest(Connection& conn) = 0;
+
+    /**
+     * @brief 关闭连接的fd（Reactor随后释放连接槽位）
+     */
+    virtual void close(Connection& conn) = 0;
+};
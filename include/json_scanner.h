@@ -0,0 +1,57 @@
+#pragma once
+#include "sql_params.h"
+#include "arena.h"
+#include <string>
+#include <cstddef>
+
+/**
+ * @brief 在一段JSON文本上移动指针、把标量直接解码成SqlValue的扫描器，不构建DOM
+ * 供批量导入的行解码和绑定参数的解析共用。
+ * JSON值的映射与绑定参数相同：整数->INTEGER（超出int64范围时为REAL），浮点->REAL，
+ * 字符串->TEXT，null->NULL，布尔->INTEGER(0/1)，{"$blob": "<base64>"}->BLOB
+ */
+class JsonScanner {
+public:
+    /**
+     * @brief 构造函数
+     * @param arena 临时缓冲区所用的arena，为空时使用全局堆
+     */
+    explicit JsonScanner(Arena* arena = nullptr);
+
+    /**
+     * @brief 开始扫描一段输入（必须在扫描期间保持有效且不变）
+     */
+    void reset(const char* data, size_t size);
+
+    const std::string& getError() const { return error; }
+
+protected:
+    const char* p;
+    const char* end;
+    std::string error;
+    ArenaString scratch;        // 解码键名、$blob等的临时缓冲区
+
+    void skipSpace();
+
+    /**
+     * @brief 记录错误信息（只在出错时分配）
+     */
+    void fail(const std::string& message) { error = message; }
+
+    /**
+     * @brief 解码一个标量值或{"$blob": ...}
+     */
+    bool parseValue(SqlValue& value);
+
+    /**
+     * @brief 解码一个JSON字符串，p指向开头的引号
+     */
+    bool parseString(ArenaString& out);
+
+    bool parseNumber(SqlValue& value);
+
+    /**
+     * @brief 跳过一个任意JSON值
+     */
+    bool skipValue(int depth);
+};
@@ -0,0 +1,53 @@
+#pragma once
+#include <string>
+#include <cstddef>
+#include <cstdint>
+
+/**
+ * @brief 直接向字符串追加JSON文本的序列化器，不构建Json::Value树
+ * 调用者负责保证调用顺序合法（对象内先key再value），写入器只负责逗号和冒号
+ */
+class JsonWriter {
+public:
+    /**
+     * @brief 构造函数
+     * @param out 输出缓冲区，JSON文本追加到末尾
+     */
+    explicit JsonWriter(std::string& out);
+
+    JsonWriter& beginObject();
+    JsonWriter& endObject();
+    JsonWriter& beginArray();
+    JsonWriter& endArray();
+    JsonWriter& key(const std::string& name);
+    JsonWriter& value(const std::string& text);
+    JsonWriter& value(const char* data, size_t len);
+    JsonWriter& value(int64_t number);
+    JsonWriter& value(int number) { return value(static_cast<int64_t>(number)); }
+    JsonWriter& value(double number);
+    JsonWriter& null();
+
+    /**
+     * @brief 追加带引号并转义的JSON字符串
+     * 每次按8字节扫描需要转义的字符（控制字符、'"'、'\\'和非ASCII字节），
+     * 没有时整块拷贝；非法的UTF-8字节替换为U+FFFD，保证输出总是合法JSON
+     */
+    static void appendString(std::string& out, const char* data, size_t len);
+
+    /**
+     * @brief 追加十进制整数（两位一组查表，不经过snprintf）
+     */
+    static void appendInteger(std::string& out, int64_t value);
+
+    /**
+     * @brief 按SQLite把REAL转成文本的格式（"%!.15g"）追加浮点数
+     * 整数值走快速路径，其余交给sqlite3_snprintf，保证与sqlite3_column_text一致
+     */
+    static void appendReal(std::string& out, double value);
+
+private:
+    std::string& out;
+    bool needComma;     // 下一个元素前是否需要逗号
+
+    void separator();
+};
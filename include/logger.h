@@ -0,0 +1,115 @@
+#pragma once
+#include <string>
+#include <atomic>
+#include <thread>
+#include <cstddef>
+#include <cstdint>
+
+/**
+ * @brief 编译期日志级别：低于该级别的日志语句在编译时整体移除
+ * 0=DEBUG 1=INFO 2=WARN 3=ERROR，例如 make CXXFLAGS+=-DLOG_COMPILE_LEVEL=1
+ */
+#ifndef LOG_COMPILE_LEVEL
+#define LOG_COMPILE_LEVEL 0
+#endif
+
+/**
+ * @brief 异步日志
+ * 调用线程只把记录（级别、时间、消息）拷贝进无锁的有界环形队列，
+ * 由后台线程格式化时间戳并批量写到stdout（DEBUG/INFO）或stderr（WARN/ERROR）。
+ * 队列满时丢弃记录并计数，丢弃数由后台线程定期输出
+ */
+class Logger {
+public:
+    enum Level {
+        DEBUG = 0,
+        INFO = 1,
+        WARN = 2,
+        ERROR = 3,
+        OFF = 4
+    };
+
+    /**
+     * @brief 进程内唯一的日志实例，第一次调用时启动后台线程
+     */
+    static Logger& instance();
+
+    /**
+     * @brief 运行期日志级别，低于该级别的日志不会格式化消息
+     */
+    static bool enabled(Level level) {
+        return level >= runtimeLevel.load(std::memory_order_relaxed);
+    }
+    static void setLevel(Level level) { runtimeLevel.store(level, std::memory_order_relaxed); }
+
+    /**
+     * @brief 按名称（debug/info/warn/error/off，不区分大小写）设置级别
+     * @return 名称是否合法
+     */
+    static bool setLevel(const std::string& name);
+
+    /**
+     * @brief 写入一条日志（线程安全，无锁不阻塞）；超长的消息会被截断
+     */
+    void write(Level level, const std::string& message);
+    void write(Level level, const char* message, size_t len);
+
+    /**
+     * @brief 因队列满被丢弃的记录数
+     */
+    uint64_t getDroppedCount() const { return dropped.load(std::memory_order_relaxed); }
+
+    static const size_t kCapacity = 4096;       // 环形队列槽位数（2的幂）
+    static const size_t kMaxMessage = 480;      // 单条消息最大字节数
+
+private:
+    /**
+     * @brief 环形队列的一个槽位（Vyukov有界队列：seq表示槽位当前可由谁使用）
+     */
+    struct Slot {
+        std::atomic<size_t> seq;
+        int level;
+        int64_t sec;            // 记录时间（秒）
+        int msec;               // 毫秒部分
+        uint16_t len;
+        char text[kMaxMessage];
+    };
+
+    Logger();
+    ~Logger();
+    Logger(const Logger&) = delete;
+    Logger& operator=(const Logger&) = delete;
+
+    static std::atomic<int> runtimeLevel;
+
+    Slot* slots;
+    alignas(64) std::atomic<size_t> enqueuePos;     // 与消费端状态分开缓存行
+    alignas(64) size_t dequeuePos;                  // 只由后台线程访问
+    std::atomic<uint64_t> dropped;
+    std::atomic<bool> stopping;
+    std::thread writer;
+
+    int64_t cachedSec;                  // 已格式化时间戳对应的秒（后台线程使用）
+    char cachedTime[32];                // "YYYY-MM-DD HH:MM:SS"
+    uint64_t reportedDropped;
+
+    void writerLoop();
+
+    /**
+     * @brief 取出并写出队列中的所有记录
+     * @return 是否写出了记录
+     */
+    bool drain();
+};
+
+#define LOG_AT(level, message)                                                   \
+    do {                                                                         \
+        if ((level) >= LOG_COMPILE_LEVEL && Logger::enabled(level)) {            \
+            Logger::instance().write((level), (message));                        \
+        }                                                                        \
+    } while (0)
+
+#define LOG_DEBUG(message) LOG_AT(Logger::DEBUG, message)
+#define LOG_INFO(message) LOG_AT(Logger::INFO, message)
+#define LOG_WARN(message) LOG_AT(Logger::WARN, message)
+#define LOG_ERROR(message) LOG_AT(Logger::ERROR, message)
@@ -0,0 +1,123 @@
+#pragma once
+#include <string>
+#include <vector>
+#include <atomic>
+#include <chrono>
+#include <functional>
+#include <cstddef>
+#include <cstdint>
+
+/**
+ * @brief 对数-线性分桶的延迟直方图（HDR风格，纳秒）
+ * 每个2的幂区间再等分16个子桶，相对误差约6%，覆盖到约37分钟。
+ * 只由所属线程写入（relaxed读改写，不加锁前缀），读取线程可随时做快照
+ */
+class Histogram {
+public:
+    Histogram();
+
+    void record(uint64_t ns);
+
+    /**
+     * @brief 直方图快照，可跨线程合并
+     */
+    struct Snapshot {
+        Snapshot();
+
+        std::vector<uint64_t> counts;
+        uint64_t count;
+        uint64_t sum;
+        uint64_t max;
+
+        void merge(const Snapshot& other);
+
+        /**
+         * @brief 分位数（桶中点），q取0~1
+         */
+        uint64_t percentile(double q) const;
+    };
+
+    void snapshot(Snapshot& out) const;
+
+    static const size_t kSubBuckets = 16;
+    static const size_t kMaxExponent = 41;
+    static const size_t kBucketCount = (kMaxExponent - 3) * kSubBuckets;
+
+    static size_t bucketOf(uint64_t ns);
+    static uint64_t bucketMidpoint(size_t bucket);
+
+private:
+    std::atomic<uint64_t> counts[kBucketCount];
+    std::atomic<uint64_t> count;
+    std::atomic<uint64_t> sum;
+    std::atomic<uint64_t> max;
+};
+
+class JsonWriter;
+
+/**
+ * @brief 服务器运行统计
+ * 所有计数都记在调用线程自己的ThreadMetrics里（首次使用时登记），热路径上没有共享的原子变量；
+ * 读取统计时才遍历所有线程汇总
+ */
+class Metrics {
+public:
+    /**
+     * @brief 请求处理的各阶段
+     */
+    enum Phase {
+        PARSE,          // 解析请求信封
+        DISPATCH,       // 交给工作线程后排队等待的时间
+        PREPARE,        // sqlite3_prepare（语句缓存未命中时）
+        STEP,           // sqlite3_step
+        SERIALIZE,      // 结果序列化
+        WRITE,          // 把响应写入socket
+        PHASE_COUNT
+    };
+
+    /**
+     * @brief 单调时钟（纳秒）
+     */
+    static uint64_t now() {
+        return static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(
+            std::chrono::steady_clock::now().time_since_epoch()).count());
+    }
+
+    static void connectionAccepted();
+    static void connectionClosed();
+    static void bytesIn(size_t n);
+    static void bytesOut(size_t n);
+
+    /**
+     * @brief 记录一个请求从收到到响应就绪的总耗时
+     */
+    static void recordRequest(const std::string& funcId, uint64_t ns);
+    static void recordPhase(Phase phase, uint64_t ns);
+    static void recordCommit(const std::string& dbPath);
+    static void recordRollback(const std::string& dbPath);
+
+    /**
+     * @brief 登记一个额外的统计段（需在服务器启动前调用），快照时以name为键调用write输出一个JSON值
+     */
+    static void addSection(const std::string& name, std::function<void(JsonWriter&)> write);
+
+    /**
+     * @brief 汇总所有线程的统计，序列化为JSON响应
+     */
+    static std::string snapshotJson();
+
+    /**
+     * @brief 作用域计时器：析构时把经过的时间记到指定阶段
+     */
+    class PhaseTimer {
+    public:
+        explicit PhaseTimer(Phase phase) : phase(phase), start(now()) {}
+        ~PhaseTimer() { recordPhase(phase, now() - start); }
+        PhaseTimer(const PhaseTimer&) = delete;
+        PhaseTimer& operator=(const PhaseTimer&) = delete;
+
+    private:
+        Phase phase;
+        uint64_t start;
+    };
+};
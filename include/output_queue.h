@@ -0,0 +1,107 @@
+#pragma once
+#include <sys/uio.h>
+#include <string>
+#include <vector>
+#include <utility>
+#include <cstddef>
+#include <cstdint>
+
+/**
+ * @brief 连接的输出队列：按顺序排列的一串缓冲区段，由I/O后端用sendmsg一次写出多段
+ * - 小的响应、帧头和换行拷贝进末尾可追加的段，合并成一次写出
+ * - 大的响应（如查询结果的各个分段）整段接入，不再拷贝，也不需要一块与响应一样大的连续内存
+ * - 以MSG_ZEROCOPY写出的段在内核通知发送完成之前不能改动或释放，写出后移到等待区
+ */
+class OutputQueue {
+public:
+    OutputQueue();
+
+    /**
+     * @brief 禁用拷贝（写出中的段可能被内核引用）
+     */
+    OutputQueue(const OutputQueue&) = delete;
+    OutputQueue& operator=(const OutputQueue&) = delete;
+
+    /**
+     * @brief 尚未写出的字节数（不含等待零拷贝通知的段）
+     */
+    size_t size() const { return bytes; }
+    bool empty() const { return bytes == 0; }
+
+    /**
+     * @brief 拷贝数据到队尾
+     */
+    void append(const char* data, size_t len);
+
+    /**
+     * @brief 把字符串接到队尾：不小于kTakeThreshold时取走其内容作为独立的段（不拷贝），
+     * 否则拷贝到末尾的段并保留data（调用者可以回收它的缓冲区）
+     */
+    void take(std::string& data);
+
+    /**
+     * @brief 用队首尚未写出的数据填充iovec数组
+     * @param maxCount iov的容量
+     * @param len [out] 填充的总字节数
+     * @return 填充的项数
+     */
+    int fill(struct iovec* iov, int maxCount, size_t& len) const;
+
+    /**
+     * @brief 队首的n字节已写出：写完的段释放，队列清空时保留末尾拷贝得来的段以复用其容量
+     * @param zerocopy 本次是否以MSG_ZEROCOPY写出：涉及的段要等内核通知该次发送完成后才释放
+     */
+    void consume(size_t n, bool zerocopy);
+
+    /**
+     * @brief 内核通知第first到last次零拷贝发送已完成（序号按发送次数从0计，与内核一致，可能乱序到达）
+     */
+    void completeZerocopy(uint32_t first, uint32_t last);
+
+    /**
+     * @brief 是否还有零拷贝发送没有收到完成通知
+     */
+    bool hasZerocopyPending() const { return zerocopyDone != zerocopyIssued; }
+
+    /**
+     * @brief 交换两个队列的全部内容
+     */
+    void swap(OutputQueue& other);
+
+    /**
+     * @brief 释放所有段（连接关闭），零拷贝序号也从头开始
+     */
+    void clear();
+
+    static const size_t kTakeThreshold = 16 * 1024;        // 不小于它的字符串整段接入
+    static const size_t kShrinkThreshold = 1024 * 1024;    // 拷贝段写完后超过此容量则释放
+    static const size_t kMinCapacity = 256;                // 新建拷贝段的初始容量
+
+private:
+    struct Segment {
+        Segment() : zerocopy(false), seq(0) {}
+
+        std::string data;
+        bool zerocopy;      // 是否以零拷贝方式写出过其中的数据
+        uint32_t seq;       // 最后一次涉及它的零拷贝发送的序号
+    };
+
+    /**
+     * @brief 第seq次零拷贝发送是否已完成
+     */
+    bool isDone(uint32_t seq) const { return static_cast<int32_t>(seq - zerocopyDone) < 0; }
+
+    /**
+     * @brief 释放等待区中已完成的段
+     */
+    void releaseHeld();
+
+    std::vector<Segment> segments;
+    size_t frontPos;        // 队首段已写出的字节数
+    size_t bytes;
+    bool tailOpen;          // 末尾的段是否可以追加（拷贝得来、且没有以零拷贝方式写出过）
+    std::vector<Segment> held;                          // 已写出、等待零拷贝完成通知的段（按序号排列）
+    uint32_t zerocopyIssued;                            // 已发起的零拷贝发送次数
+    uint32_t zerocopyDone;                              // 序号小于它的零拷贝发送都已完成
+    std::vector<std::pair<uint32_t, uint32_t>> doneRanges;  // 越过zerocopyDone先到达的完成区间
+};
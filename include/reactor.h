@@ -0,0 +1,173 @@
+#pragma once
+#include <netinet/in.h>
+#include <string>
+#include <vector>
+#include <mutex>
+#include <cstdint>
+#include <memory>
+#include "connection.h"
+#include "response_stream.h"
+#include "timer_wheel.h"
+#include "io_backend.h"
+
+class EpollServer;
+
+/**
+ * @brief 事件循环（Reactor）
+ * 每个Reactor拥有独立的I/O后端（epoll或io_uring）和监听socket（SO_REUSEPORT），
+ * 由内核在各监听socket间分发新连接。连接在其生命周期内只属于接受它的Reactor，
+ * 因此连接相关状态都是Reactor本地的，热路径上无需加锁
+ */
+class Reactor {
+public:
+    /**
+     * @brief 构造函数，创建监听socket和I/O后端
+     * @param server 所属服务器（提供请求分发）
+     * @param id Reactor编号
+     * @param port 监听端口
+     */
+    Reactor(EpollServer& server, int id, int port);
+    ~Reactor();
+
+    /**
+     * @brief 禁用拷贝
+     */
+    Reactor(const Reactor&) = delete;
+    Reactor& operator=(const Reactor&) = delete;
+
+    /**
+     * @brief 运行事件循环（不返回）
+     */
+    void run();
+
+    int getId() const { return id; }
+
+private:
+    friend class EpollServer;
+    friend class ResponseStream;
+    friend class EpollBackend;
+    friend class UringBackend;
+
+    /**
+     * @brief 异步请求的结果，由工作线程投递回Reactor
+     */
+    struct Completion {
+        enum Kind {
+            RESPONSE,   // 完整响应，按帧格式封装
+            CHUNK,      // 分段响应的中间一段，原样追加
+            END         // 分段响应的最后一段，追加后结束该帧
+        };
+
+        uint64_t connId;    // 连接编号（含fd和槽位代数）
+        Kind kind;
+        std::string response;
+        std::vector<std::string> segments;  // 大的完整响应在response之前的各段，依次接到输出队列上
+    };
+
+    EpollServer& server;
+    const int id;
+    int listenFd;
+    int wakeFd;                                 // eventfd，异步结果到达时唤醒事件循环
+    int timerFd;                                // timerfd，在时间轮下一次需要推进时唤醒事件循环
+    uint64_t timerArmed;                        // timerFd当前设定的时刻（纳秒），0表示未设定
+    uint64_t loopTime;                          // 本轮等待返回的时刻（纳秒）
+    TimerWheel timers;                          // 连接空闲超时和请求截止时间
+    ConnectionTable connections;                // 按fd索引的连接槽位
+    std::unique_ptr<IoBackend> backend;
+
+    std::mutex completionMutex;
+    std::vector<Completion> completions;        // 待处理的异步结果（跨线程，受锁保护）
+    std::vector<Completion> ready;              // Reactor线程正在处理的一批结果，与completions交换
+    std::vector<std::string> spareBuffers;      // 回收的响应缓冲区（受completionMutex保护）
+
+    static const size_t kMaxSpareBuffers = 64;
+    static const size_t kMaxSpareCapacity = 16 * 1024;  // 更大的缓冲区直接释放
+
+    /**
+     * @brief 后端接受了新连接：打开连接槽位并交给后端开始接收
+     * @param addr 对端地址，nullptr表示没有取（第一次用到时由Connection自己取）
+     */
+    void acceptConnection(int fd, const struct sockaddr_in* addr);
+
+    /**
+     * @brief 后端收到了连接上的数据
+     */
+    void received(Connection& conn, const char* data, size_t len);
+
+    /**
+     * @brief 后端写出了连接上的数据（len可以为0）：更新统计，告诉分段响应的生产者已写出多少
+     */
+    void sent(Connection& conn, size_t len);
+
+    /**
+     * @brief 处理输入缓冲区里的请求并写出响应；积压降到低水位以下时恢复读取，
+     * 对端已关闭且没有剩余工作时关闭连接
+     */
+    void handleInput(Connection& conn);
+
+    /**
+     * @brief 连接可写或上一次发送已完成：继续写出，积压降到低水位以下后恢复读取
+     */
+    void handleWrite(Connection& conn);
+    bool processFrames(Connection& conn);
+
+    /**
+     * @brief 把输出队列交给后端写出，写不完的部分由后端在可写时继续
+     * @return false表示写出错，连接已关闭
+     */
+    bool flushOutput(Connection& conn);
+    void closeConnection(Connection& conn);
+
+    /**
+     * @brief 按最近活动时间和会话上最早的游标到期时刻设定连接的空闲定时器，都没有时取消
+     */
+    void scheduleIdle(Connection& conn);
+
+    /**
+     * @brief 设定异步请求的截止时间
+     * @param deadline 截止时刻（纳秒），0表示不限
+     */
+    void armDeadline(Connection& conn, uint64_t deadline);
+
+    /**
+     * @brief 定时器到期
+     * 空闲定时器：关闭空闲超时的游标，连接空闲超时则关闭连接；有进行中的请求时不处理
+     * （此时会话可能正被工作线程访问），请求完成时重新计时。
+     * 截止定时器：通知响应通道，由Sqlite3Handler的进度回调中止正在执行的语句
+     */
+    void onTimer(TimerWheel::Timer& timer);
+
+    /**
+     * @brief 按时间轮的下一次推进时刻设定timerFd
+     */
+    void updateTimerFd();
+
+    /**
+     * @brief 为连接上的一个异步请求创建响应通道
+     * 上一个请求的通道已没有其他持有者时直接复用
+     */
+    std::shared_ptr<ResponseStream> makeStream(Connection& conn);
+
+    /**
+     * @brief 取一个回收的响应缓冲区，没有时返回空串（线程安全）
+     */
+    std::string takeBuffer();
+
+    /**
+     * @brief 投递异步结果并唤醒Reactor（线程安全）
+     * @param response 结果内容，被取走
+     * @param segments 完整响应在response之前的各段，被取走；为空指针表示没有
+     */
+    void postCompletion(uint64_t connId, std::string& response, Completion::Kind kind,
+                        std::vector<std::string>* segments = nullptr);
+
+    /**
+     * @brief 在Reactor线程上处理所有已到达的异步结果
+     */
+    void drainCompletions();
+
+    /**
+     * @brief 处理完ready中的结果后调用：回收其中的响应缓冲区并清空ready
+     */
+    void recycleCompletions();
+};
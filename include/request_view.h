@@ -0,0 +1,142 @@
+#pragma once
+#include <string>
+#include <cstddef>
+#include <memory>
+#include <json/json.h>
+#include "arena.h"
+
+/**
+ * @brief 请求信封的原地解析结果
+ * 一次扫描校验整个JSON请求，只记录funcid和msg中各字段在接收缓冲区里的位置，
+ * 常见的信封不做任何堆分配。需要完整DOM的处理器可以调用dom()按需解析。
+ * 视图指向接收缓冲区，只在处理器调用期间有效，需要跨线程使用的值必须先拷贝出来
+ */
+class RequestView {
+public:
+    /**
+     * @brief 指向缓冲区内一段字节的视图
+     */
+    struct Slice {
+        Slice() : data(nullptr), size(0) {}
+        Slice(const char* data, size_t size) : data(data), size(size) {}
+
+        bool empty() const { return size == 0; }
+        std::string str() const { return std::string(data, size); }
+
+        const char* data;
+        size_t size;
+    };
+
+    /**
+     * @brief JSON值的类型
+     */
+    enum Type {
+        MISSING,
+        NULL_VALUE,
+        BOOLEAN,
+        NUMBER,
+        STRING,
+        ARRAY,
+        OBJECT
+    };
+
+    RequestView();
+
+    /**
+     * @brief 禁用拷贝（视图和缓存的DOM都属于本次请求）
+     */
+    RequestView(const RequestView&) = delete;
+    RequestView& operator=(const RequestView&) = delete;
+
+    /**
+     * @brief 解析请求
+     * @param data 请求负载（必须在本对象使用期间保持有效且不变）
+     * @param len 负载长度
+     * @return 是否为合法的JSON对象
+     */
+    bool parse(const char* data, size_t len);
+
+    /**
+     * @brief 功能号：字符串取其内容，数字取其文本，缺失时为空串
+     */
+    std::string getFuncId() const;
+
+    /**
+     * @brief msg中字段的类型，msg不是对象或字段不存在时为MISSING
+     */
+    Type getType(const char* key) const;
+
+    bool hasField(const char* key) const { return getType(key) != MISSING; }
+
+    /**
+     * @brief 读取msg中的标量字段：字符串解码转义，数字和布尔取其文本，null为空串
+     * @param key 字段名
+     * @param out [out] 字段值
+     * @return 字段存在且为标量
+     */
+    bool getString(const char* key, std::string& out) const;
+    bool getString(const char* key, ArenaString& out) const;
+
+    /**
+     * @brief 只把msg中的一个字段解析成Json::Value（例如绑定参数）
+     * @return 字段存在时为true；字段不存在时out为null
+     */
+    bool getJson(const char* key, Json::Value& out) const;
+
+    /**
+     * @brief 拷贝msg中一个字段的原始JSON文本（字符串带引号，不解码转义），
+     * 用于把大字段原样交给工作线程、在那里再逐段解码
+     * @return 字段是否存在
+     */
+    bool getRaw(const char* key, std::string& out) const;
+
+    /**
+     * @brief msg中一个字段原始JSON文本（字符串带引号）在接收缓冲区中的视图，不拷贝
+     * @return 字段存在且可以直接取视图；需要DOM的请求返回false，调用方改用getJson()
+     */
+    bool getSlice(const char* key, Slice& out) const;
+
+    /**
+     * @brief 解码JSON字符串内容（不含引号）中的转义，内容须已校验过格式
+     */
+    static void unescape(const Slice& raw, std::string& out);
+    static void unescape(const Slice& raw, ArenaString& out);
+
+    /**
+     * @brief 完整DOM，第一次调用时才解析
+     */
+    const Json::Value& dom() const;
+
+    /**
+     * @brief 原始请求负载
+     */
+    Slice getPayload() const { return payload; }
+
+    static const size_t kMaxFields = 16;
+
+private:
+    /**
+     * @brief msg中的一个字段
+     */
+    struct Field {
+        Slice key;          // 键的原始内容（不含引号）
+        Slice value;        // 值的原始JSON文本；字符串不含引号
+        Type type;
+        bool escaped;       // 字符串值中含有转义
+    };
+
+    Slice payload;
+    Slice funcId;
+    Type funcIdType;
+    bool funcIdEscaped;
+    Type msgType;
+    Field fields[kMaxFields];
+    size_t fieldCount;
+    bool needDom;           // 键中有转义或字段过多，查找时改用DOM
+    mutable std::unique_ptr<Json::Value> root;
+
+    const Field* findField(const char* key) const;
+
+    template<class String>
+    bool getStringInto(const char* key, String& out) const;
+};
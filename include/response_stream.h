@@ -0,0 +1,136 @@
+#pragma once
+#include <string>
+#include <vector>
+#include <cstdint>
+#include <mutex>
+#include <atomic>
+#include <condition_variable>
+#include "admission_control.h"
+
+class Reactor;
+
+/**
+ * @brief 异步请求的响应通道，可在任意线程使用
+ * 每个请求必须且只能以send()或end()结束一次，结束时归还准入名额。
+ * 换行分隔的连接还可以用write()分段发送同一个响应：已投递但尚未写入socket的字节
+ * 超过窗口时write()阻塞，直到Reactor把数据写出或连接关闭，从而限制大结果集占用的内存。
+ * 长度前缀帧必须先知道总长度，因此不支持分段
+ */
+class ResponseStream {
+public:
+    /**
+     * @brief 构造函数（由Reactor创建）
+     * @param reactor 连接所属的Reactor
+     * @param connId 连接编号
+     * @param chunked 是否支持分段发送
+     * @param window 分段发送时允许积压的最大字节数
+     */
+    ResponseStream(Reactor& reactor, uint64_t connId, bool chunked, size_t window);
+
+    /**
+     * @brief 禁用拷贝
+     */
+    ResponseStream(const ResponseStream&) = delete;
+    ResponseStream& operator=(const ResponseStream&) = delete;
+
+    /**
+     * @brief Reactor线程调用：复用于同一连接上的下一个请求（此时没有其他线程持有本对象）
+     */
+    void restart(bool chunked);
+
+    /**
+     * @brief 取一个Reactor回收的响应缓冲区（内容为空，可能带着容量），
+     * 在其中写好响应再交给send()或end()，避免为每个响应重新分配
+     */
+    std::string takeBuffer();
+
+    /**
+     * @brief 发送完整的响应（由Reactor按连接的帧格式封装）
+     */
+    void send(std::string response);
+
+    /**
+     * @brief 发送由多段组成的完整响应（取走segments的内容）：各段依次接到连接的输出队列上，
+     * 不需要拼成一个连续的字符串
+     * @param segments 响应的前面各段
+     * @param response 响应的最后一段
+     */
+    void send(std::vector<std::string>& segments, std::string response);
+
+    /**
+     * @brief 是否支持write()分段发送
+     */
+    bool isChunked() const { return chunked; }
+
+    /**
+     * @brief 发送响应的一段（取走chunk的内容），积压超过窗口时阻塞
+     * @return false表示连接已关闭，应停止生成后续内容
+     */
+    bool write(std::string& chunk);
+
+    /**
+     * @brief 发送最后一段并结束分段响应（取走tail的内容）
+     */
+    void end(std::string& tail);
+
+    /**
+     * @brief Reactor线程调用：本响应已写入socket的字节数
+     */
+    void acknowledge(uint64_t sent);
+
+    /**
+     * @brief Reactor线程调用：连接已关闭，唤醒等待中的write()
+     */
+    void cancel();
+
+    /**
+     * @brief Reactor线程调用：请求超过截止时间，置位截止标志并唤醒等待中的write()
+     * 正在执行的语句由Sqlite3Handler的进度回调中止，请求仍须以send()或end()结束
+     */
+    void expire();
+
+    /**
+     * @brief 请求是否已超过截止时间
+     */
+    bool isExpired() const { return expired.load(std::memory_order_relaxed); }
+
+    /**
+     * @brief 截止标志，执行期间交给Sqlite3Handler::InterruptScope
+     */
+    const std::atomic<bool>* getDeadlineFlag() const { return &expired; }
+
+    /**
+     * @brief Reactor线程调用：记录请求的截止时刻（纳秒，Metrics::now()），0表示没有截止时间
+     */
+    void setDeadline(uint64_t deadline) { this->deadline = deadline; }
+
+    /**
+     * @brief 请求的截止时刻，等待数据库连接时以它为限
+     */
+    uint64_t getDeadline() const { return deadline; }
+
+    /**
+     * @brief Reactor线程调用：请求通过准入后交给响应通道持有名额，send()或end()时归还
+     */
+    void setTicket(const AdmissionControl::Ticket& ticket) { this->ticket = ticket; }
+
+    /**
+     * @brief 处理器向工作线程池提交任务时使用的优先级（由准入控制按功能号决定）
+     */
+    TaskPriority getPriority() const { return ticket.priority; }
+
+private:
+    Reactor& reactor;
+    const uint64_t connId;
+    bool chunked;
+    const size_t window;
+
+    std::mutex mutex;
+    std::condition_variable cond;
+    uint64_t posted;        // 已投递给Reactor的分段字节数
+    uint64_t acked;         // 其中已写入socket的字节数
+    bool cancelled;
+    std::atomic<bool> expired;
+    uint64_t deadline;      // 交给工作线程之前设置，之后只读
+    AdmissionControl::Ticket ticket;
+};
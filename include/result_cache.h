@@ -0,0 +1,138 @@
+#pragma once
+#include "sql_params.h"
+#include "binary_result.h"
+#include <string>
+#include <vector>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <atomic>
+#include <unordered_map>
+#include <unordered_set>
+#include <cstddef>
+#include <cstdint>
+
+/**
+ * @brief 结果缓存的统计信息
+ */
+struct ResultCacheStats {
+    uint64_t hits;              // 命中次数
+    uint64_t misses;            // 未命中次数
+    uint64_t stores;            // 写入的条目数
+    uint64_t rejected;          // 执行期间数据库有提交、未写入的结果数
+    uint64_t evictions;         // 因容量不足淘汰的条目数
+    uint64_t invalidations;     // 因表被修改而失效的条目数
+    size_t entries;             // 当前条目数
+    size_t bytes;               // 当前占用字节数（估算）
+    size_t capacity;            // 容量（字节），0表示未启用
+};
+
+/**
+ * @brief 只读查询的结果缓存（进程级，默认关闭）
+ * 键为（数据库路径、SQL文本、绑定参数），值为序列化好的完整响应，命中时不再执行和序列化。
+ * 条目记录查询读取的表：写连接提交后按表失效（由Sqlite3Handler的update/commit钩子通知），
+ * 其他进程的写入由SqlitePool用PRAGMA data_version检测后整库失效。
+ * 每个数据库有一个提交计数（epoch），执行查询前取得、写入缓存时比较，
+ * 执行期间发生过提交的结果可能已过期，不写入。
+ * 总大小按字节限制，超出时按LRU淘汰
+ */
+class ResultCache {
+public:
+    static ResultCache& instance();
+
+    /**
+     * @brief 设置容量并启用缓存（需在打开数据库之前调用，钩子在打开连接时安装）
+     * @param bytes 容量（字节），0表示关闭
+     */
+    void setCapacity(size_t bytes);
+
+    bool isEnabled() const { return enabled.load(std::memory_order_relaxed); }
+
+    /**
+     * @brief 生成缓存键
+     * SQL只去掉首尾空白（由语句拆分完成）：结果的列名取自SQL原文，改写空白或大小写会改变列名。
+     * 不同编码的响应分别缓存
+     */
+    static std::string makeKey(const std::string& dbPath, const std::string& sql, const SqlParams* params,
+                               ResultEncoding encoding);
+
+    /**
+     * @brief 查找缓存的响应
+     * @param key 缓存键
+     * @param response [out] 命中时为响应的拷贝
+     * @return 是否命中
+     */
+    bool lookup(const std::string& key, std::string& response);
+
+    /**
+     * @brief 数据库当前的提交计数，执行查询前取得，写入缓存时传回
+     */
+    uint64_t getEpoch(const std::string& dbPath);
+
+    /**
+     * @brief 写入一条查询结果
+     * @param dbPath 数据库路径
+     * @param key 缓存键
+     * @param tables 查询读取的表
+     * @param response 序列化好的响应
+     * @param epoch 执行前取得的提交计数，已变化时不写入
+     */
+    void store(const std::string& dbPath, const std::string& key,
+               const std::vector<std::string>& tables, const std::string& response, uint64_t epoch);
+
+    /**
+     * @brief 数据库中的这些表已被修改：删除读取过它们的条目
+     */
+    void invalidate(const std::string& dbPath, const std::vector<std::string>& tables);
+
+    /**
+     * @brief 删除数据库的全部条目（结构变更、无法确定修改了哪些表或进程外写入）
+     */
+    void invalidateAll(const std::string& dbPath);
+
+    ResultCacheStats getStats() const;
+
+private:
+    struct Entry;
+    typedef std::list<Entry> EntryList;
+
+    /**
+     * @brief 一条缓存的响应
+     */
+    struct Entry {
+        std::string key;
+        std::string dbPath;
+        std::vector<std::string> tables;
+        std::shared_ptr<const std::string> response;    // 命中时在锁外拷贝
+        size_t bytes;
+    };
+
+    /**
+     * @brief 一个数据库的失效索引
+     */
+    struct Database {
+        Database() : epoch(0) {}
+
+        uint64_t epoch;
+        std::unordered_map<std::string, std::unordered_set<Entry*>> byTable;   // 表 -> 读取它的条目
+    };
+
+    ResultCache();
+    ResultCache(const ResultCache&) = delete;
+    ResultCache& operator=(const ResultCache&) = delete;
+
+    std::atomic<bool> enabled;
+
+    mutable std::mutex mutex;
+    EntryList lru;                                              // 表头为最近使用
+    std::unordered_map<std::string, EntryList::iterator> index; // 键 -> 条目
+    std::unordered_map<std::string, Database> databases;
+    size_t capacity;
+    size_t maxEntryBytes;           // 单条上限，避免一个大结果挤掉整个缓存
+    ResultCacheStats stats;
+
+    void erase(EntryList::iterator it);
+    void evict(size_t limit);
+
+    static const size_t kEntryOverhead = 128;   // 节点、索引等的估算开销
+};
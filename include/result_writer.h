@@ -0,0 +1,136 @@
+#pragma once
+#include <sqlite3.h>
+#include <string>
+#include <vector>
+#include <functional>
+#include "table_data.h"
+#include "binary_result.h"
+#include "arena.h"
+
+/**
+ * @brief 查询结果的流式JSON序列化器
+ * 在sqlite3_step的同时把每一行直接写成JSON，不经过TableData和Json::Value。
+ * 输出缓冲区超过分段大小时交给sink发送出去，内存占用与结果集大小无关；
+ * 没有sink（长度前缀帧要先知道总长度）时写满的分段留在writer里，最后与缓冲区一起作为完整响应发送，
+ * 大结果不会拼成一个反复扩容、整体拷贝的连续字符串。
+ * 列类型要看过所有行才能确定（表达式列没有声明类型），因此信封中rows在columns之前：
+ *   {"rows":[...],"columns":{...},"msg":"...","status":0}
+ * 会话协商了二进制编码时按BinaryResult的格式输出，分段和留存的方式不变
+ */
+class ResultWriter {
+public:
+    /**
+     * @brief 分段输出回调，取走chunk的内容；返回false表示接收方已关闭，应停止执行
+     */
+    typedef std::function<bool(std::string& chunk)> Sink;
+
+    /**
+     * @brief 构造函数
+     * @param chunkSize 分段大小，0表示不分段（整个响应留在缓冲区中）
+     * @param sink 分段输出回调，chunkSize为0时不会被调用；为空时分段留在getSegments()中
+     * @param arena 列信息所用的arena，为空时使用全局堆
+     */
+    ResultWriter(size_t chunkSize, const Sink& sink, Arena* arena = nullptr);
+
+    /**
+     * @brief 设置结果编码，须在begin()之前调用（默认JSON）
+     */
+    void setEncoding(ResultEncoding encoding) { this->encoding = encoding; }
+
+    /**
+     * @brief 写入信封开头并记录列名（每个列名只转义一次）
+     * @param stmt 已准备好的语句
+     */
+    void begin(sqlite3_stmt* stmt);
+
+    /**
+     * @brief 把语句当前行写入缓冲区，必要时分段输出或留存
+     * @return false表示接收方已关闭
+     */
+    bool addRow(sqlite3_stmt* stmt);
+
+    /**
+     * @brief 写入列描述、消息和状态，结束信封（重复调用无效）
+     * 还没有分段输出过时，失败的结果只输出错误信封，不带已读取的行（留存的分段一并丢弃）
+     * @param status 状态码（0表示成功）
+     * @param msg 结果消息
+     */
+    void end(int status, const std::string& msg) { end(status, msg.data(), msg.size()); }
+    void end(int status, const char* msg) { end(status, msg, std::char_traits<char>::length(msg)); }
+    void end(int status, const char* msg, size_t len);
+
+    /**
+     * @brief 设置附加字段，end()时写在status之前（如游标编号和是否读完）
+     * @param fields 已序列化的键值对，不带首尾逗号，如"cursor":1,"done":false
+     */
+    void setExtra(const std::string& fields) { extra = fields; }
+
+    /**
+     * @brief 结果无法逐行输出时，改为整体输出一个TableData（尚未分段输出时才可调用）
+     */
+    void writeTable(const TableData& table);
+
+    /**
+     * @brief 是否已经有分段交给了sink（此后缓冲区中只是响应的剩余部分）
+     */
+    bool hasFlushed() const { return flushed; }
+
+    /**
+     * @brief 尚未输出的响应内容；end()之后为完整响应或其最后一段
+     */
+    std::string& getBuffer() { return buffer; }
+
+    /**
+     * @brief 没有sink时写满留存的分段，完整响应为这些分段依次加上getBuffer()
+     */
+    std::vector<std::string>& getSegments() { return segments; }
+
+    /**
+     * @brief 换上调用者提供的输出缓冲区（如回收的响应字符串），须在begin()之前调用
+     */
+    void setBuffer(std::string&& recycled) {
+        buffer = std::move(recycled);
+        buffer.clear();
+    }
+
+    size_t getRowCount() const { return rowCount; }
+
+private:
+    /**
+     * @brief 把当前行加入二进制编码的批，批满时编码进缓冲区
+     */
+    void addBinaryRow(sqlite3_stmt* stmt);
+
+    /**
+     * @brief 二进制编码的end()
+     */
+    void endBinary(int status, const char* msg, size_t len);
+
+    /**
+     * @brief 缓冲区达到分段大小时交给sink或留存
+     * @return false表示接收方已关闭
+     */
+    bool flushChunk();
+
+    /**
+     * @brief 一个结果列：预先转义好的键和按行推断出的类型
+     */
+    struct ColumnInfo {
+        std::string key;            // "name":
+        std::string declType;
+        int storageClass;           // 混合类型时提升为SQLITE_TEXT，规则与TableData相同
+    };
+
+    size_t chunkSize;
+    Sink sink;
+    ResultEncoding encoding;
+    BinaryBatch batch;          // 二进制编码时正在积累的一批行
+    std::string buffer;
+    std::vector<std::string> segments;
+    ArenaVector<ColumnInfo> columns;
+    std::string extra;
+    size_t rowCount;
+    bool begun;
+    bool ended;
+    bool flushed;
+};
@@ -0,0 +1,90 @@
+#pragma once
+#include "json_scanner.h"
+#include <string>
+#include <vector>
+#include <cstddef>
+
+/**
+ * @brief 批量导入的行解码器：从一段文本中逐行取出按列排列的值
+ * 支持三种格式：
+ *   - JSON：行数组，每行是按列顺序的数组或按列名取值的对象，如 [[1,"a"],{"id":2,"v":"b"}]
+ *   - NDJSON：每行一个JSON数组或对象，空行跳过
+ *   - CSV：RFC 4180（双引号包围、""转义，字段中可含逗号和换行），
+ *     值按TEXT绑定（由列的类型亲和性转换），不带引号的空字段为NULL
+ * JSON值的映射与绑定参数相同：整数->INTEGER，浮点->REAL，字符串->TEXT，
+ * null->NULL，布尔->INTEGER(0/1)，{"$blob": "<base64>"}->BLOB；对象中缺少的列为NULL。
+ * 解码器只在输入上移动指针，行缓冲区反复使用，稳定后不再分配内存
+ */
+class RowDecoder : private JsonScanner {
+public:
+    enum Format {
+        JSON,
+        NDJSON,
+        CSV
+    };
+
+    /**
+     * @brief next()的结果
+     */
+    enum Result {
+        ROW,            // 取到一行
+        END,            // 没有更多行
+        ERROR           // 格式错误，错误信息见getError()
+    };
+
+    /**
+     * @brief 构造函数
+     * @param format 输入格式
+     * @param columns 列名，对象按列名取值，数组和CSV记录按位置对应
+     */
+    RowDecoder(Format format, const std::vector<std::string>& columns);
+
+    /**
+     * @brief 开始解码一段输入（必须在解码期间保持有效且不变）
+     * JSON格式为整个行数组的文本，其余格式为数据文本
+     */
+    void reset(const char* data, size_t size);
+
+    /**
+     * @brief 解码下一行
+     * @param row [out] 列值，大小等于列数
+     */
+    Result next(std::vector<SqlValue>& row);
+
+    /**
+     * @brief 读取CSV的表头记录（reset之后、第一次next之前调用）
+     * 构造时没有给出列名时以表头为列名，否则只跳过表头
+     * @return 是否读到表头
+     */
+    bool readHeader();
+
+    const std::vector<std::string>& getColumns() const { return columns; }
+
+    using JsonScanner::getError;
+
+private:
+    Format format;
+    std::vector<std::string> columns;
+    bool started;               // JSON：已越过行数组的'['
+    bool finished;              // JSON：已到行数组的']'
+
+    Result fail(const std::string& message);
+
+    Result nextJson(std::vector<SqlValue>& row);
+    Result nextNdjson(std::vector<SqlValue>& row);
+    Result nextCsv(std::vector<SqlValue>& row);
+
+    /**
+     * @brief 解码一个JSON行（数组或对象），p指向'['或'{'
+     */
+    bool parseRow(std::vector<SqlValue>& row);
+
+    /**
+     * @brief 读取一个CSV字段
+     * @param value [out] 字段值（TEXT或NULL）
+     * @param last [out] 是否为记录的最后一个字段
+     */
+    bool parseCsvField(SqlValue& value, bool& last);
+
+    int findColumn(const char* name, size_t len) const;
+};
@@ -1,19 +1,132 @@
 #pragma once
 #include "./sqlite3_handler.h"
+#include "sql_params.h"
+#include "sql_lexer.h"
+#include "db_session.h"
+#include "worker_pool.h"
+#include "epoll_server.h"
+#include "arena.h"
 #include <string>
 #include <vector>
+#include <memory>
+#include <cstdint>
 #include <json/json.h>
 
 class SqlExecHandler {
 public:
-    SqlExecHandler();
+    /**
+     * @brief 构造函数
+     * @param workers 执行SQL的工作线程池，只使用同步接口handle()时可为空
+     */
+    explicit SqlExecHandler(std::shared_ptr<WorkerPool> workers = nullptr);
     
-    std::string handle(const Json::Value& parsedRequest, int clientFd);
+    /**
+     * @brief 同步处理：在调用线程上执行SQL
+     */
+    std::string handle(const RequestView& request, Connection& conn);
+
+    /**
+     * @brief 异步处理：校验后把SQL交给工作线程执行，结果经stream送回
+     * 只读请求并行执行，写请求按数据库串行执行；单条查询边执行边输出结果。
+     * 请求从解析到发出响应的临时对象都分配在一个请求级arena上，发出响应后整体回收
+     */
+    void handleAsync(const RequestView& request, Connection& conn,
+                     const std::shared_ptr<ResponseStream>& stream);
 
 private:
-    std::vector<std::string> splitSqlStatements(const std::string& sqlStr);
-    bool isQueryStatement(const std::string& sql);
-    bool isDeleteStatement(const std::string& sql);
-    bool isInsertStatement(const std::string& sql);
-    bool needTransaction(const std::vector<std::string>& statements);
+    /**
+     * @brief 一条SQL语句及其类别
+     */
+    struct Statement {
+        explicit Statement(Arena* arena) : sql(ArenaAllocator<char>(arena)), kind(SqlLexer::OTHER) {}
+
+        ArenaString sql;
+        SqlLexer::Kind kind;
+    };
+    typedef ArenaVector<Statement> StatementList;
+
+    /**
+     * @brief 校验完毕、可以执行的SQL请求
+     */
+    struct SqlRequest {
+        explicit SqlRequest(Arena* arena)
+            : arena(arena)
+            , statements(ArenaAllocator<Statement>(arena))
+            , params(arena)
+            , readOnly(false)
+            , groupable(false)
+            , queued(0)
+        {
+        }
+
+        Arena* arena;       // 请求及其语句、参数所在的arena，同步处理时为空（使用全局堆）
+        std::shared_ptr<DbSession> session;
+        std::shared_ptr<ResponseStream> stream;     // 异步请求的响应通道
+        StatementList statements;
+        SqlParams params;
+        bool readOnly;
+        bool groupable;     // 写请求可以和其他连接的写请求合并提交
+        uint64_t queued;    // 交给工作线程的时刻（纳秒），排队时间记为dispatch阶段
+    };
+
+    std::shared_ptr<WorkerPool> workers;
+
+    /**
+     * @brief 解析并校验请求（在Reactor线程上调用）
+     * @param errorResponse [out] 校验失败时的响应
+     * @return 是否可以执行
+     */
+    bool parseRequest(const RequestView& view, Connection& conn,
+                      SqlRequest& request, std::string& errorResponse);
+
+    /**
+     * @brief 租用连接并执行请求，把序列化后的响应写入response（可在任意线程调用）
+     */
+    void execute(SqlRequest& request, std::string& response);
+
+    /**
+     * @brief 执行单条只读查询，逐行序列化并分段发送（连接支持时）
+     */
+    void executeStreaming(SqlRequest& request, ResponseStream& stream);
+
+    /**
+     * @brief 工作线程上执行异步请求的入口：执行、发出响应并回收请求的arena
+     * @param streaming 单条只读查询，边执行边输出
+     */
+    void run(SqlRequest* request, bool streaming);
+
+    static const size_t kStreamChunkSize = 64 * 1024;
+
+    /**
+     * @brief 用SqlLexer切分并分类语句（字符串、注释和触发器体内的分号不切分）
+     */
+    static void splitSqlStatements(SqlText sqlStr, StatementList& statements);
+
+    /**
+     * @brief 是否要把整批语句包在一个事务里
+     * 单条语句本身是原子的；多条语句包在一个事务里（写操作全部成功或全部回滚，读操作看到同一快照）；
+     * 客户端自己控制事务（BEGIN/COMMIT/SAVEPOINT等）时不再包一层
+     */
+    static bool needTransaction(const StatementList& statements);
+
+    /**
+     * @brief 是否所有语句都是只读查询，决定租用只读连接还是写连接
+     */
+    static bool isReadOnlyBatch(const StatementList& statements);
+
+    /**
+     * @brief 写请求能否放进组提交的保存点里执行
+     * 只含查询、增删改和DDL；事务控制语句、PRAGMA、VACUUM/ATTACH等不能在事务中执行或会改变事务状态
+     */
+    static bool isGroupableBatch(const StatementList& statements);
+
+    /**
+     * @brief 在租到的连接上执行一批语句（必要时包在事务里；连接已在事务中时不再包）
+     * @param encoding 响应的编码（会话协商的结果编码）
+     * @param response [out] 序列化后的响应（覆盖原有内容，保留其容量）
+     * @return 是否全部执行成功
+     */
+    bool executeStatements(Sqlite3Handler* dbHandler,
+                           const StatementList& sqlStatements,
+                           const SqlParams* bound, ResultEncoding encoding, std::string& response);
 }; 
\ No newline at end of file
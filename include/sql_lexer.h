@@ -0,0 +1,58 @@
+#pragma once
+#include <cstddef>
+
+/**
+ * @brief 单遍SQL词法扫描：切分语句并按首个关键字分类
+ * 识别字符串（'...'）、带引号的标识符（"..."、`...`、[...]）、行注释和块注释，
+ * 其中的分号不会切断语句；CREATE TRIGGER ... BEGIN ...; END; 作为一条语句
+ * （状态机与sqlite3_complete相同）。只在输入缓冲区上移动指针，不分配内存
+ */
+class SqlLexer {
+public:
+    /**
+     * @brief 语句类别（按首个关键字；WITH按公共表表达式之后的主语句）
+     */
+    enum Kind {
+        QUERY,          // SELECT、VALUES、WITH ... SELECT
+        INSERT,         // INSERT、REPLACE
+        UPDATE,
+        DELETE,
+        TRANSACTION,    // BEGIN、COMMIT、END、ROLLBACK、SAVEPOINT、RELEASE
+        DDL,            // CREATE、DROP、ALTER
+        PRAGMA,
+        EXPLAIN,
+        OTHER           // ANALYZE、VACUUM、ATTACH等及无法识别的语句
+    };
+
+    /**
+     * @brief 一条语句在输入中的位置
+     * 从第一个非空白、非注释的字符开始，到结尾的分号为止（含分号；最后一条语句可能没有分号）
+     */
+    struct Statement {
+        const char* data;
+        size_t size;
+        Kind kind;
+    };
+
+    SqlLexer(const char* data, size_t size);
+
+    /**
+     * @brief 取下一条非空语句
+     * @return 没有更多语句时为false
+     */
+    bool next(Statement& out);
+
+    /**
+     * @brief 该类语句是否只读（可以在只读连接上执行）
+     */
+    static bool isReadOnly(Kind kind) { return kind == QUERY || kind == EXPLAIN; }
+
+    /**
+     * @brief 该类语句是否可能返回结果集
+     */
+    static bool returnsRows(Kind kind) { return kind == QUERY || kind == EXPLAIN || kind == PRAGMA; }
+
+private:
+    const char* pos;
+    const char* end;
+};
@@ -0,0 +1,96 @@
+#pragma once
+#include <sqlite3.h>
+#include <string>
+#include <vector>
+#include <utility>
+#include <cstdint>
+#include <json/json.h>
+#include "arena.h"
+
+class RequestView;
+
+/**
+ * @brief 一个SQL绑定参数值，按SQLite原生存储类型保存
+ */
+struct SqlValue {
+    enum Type {
+        NULL_VALUE,
+        INTEGER,
+        REAL,
+        TEXT,
+        BLOB
+    };
+
+    SqlValue() : type(NULL_VALUE), intValue(0), realValue(0) {}
+    explicit SqlValue(Arena* arena) : type(NULL_VALUE), intValue(0), realValue(0), bytes(ArenaAllocator<char>(arena)) {}
+
+    Type type;
+    int64_t intValue;
+    double realValue;
+    ArenaString bytes;      // TEXT或BLOB的内容
+};
+
+/**
+ * @brief SQL绑定参数集合
+ * 请求中的msg.params可以是：
+ *   - 数组：按位置绑定到 ?、?NNN（第i个元素绑定到第i+1个参数）
+ *   - 对象：按名称绑定到 :name、@name、$name（键可带或不带前缀）
+ * JSON值到SQLite类型的映射：整数->INTEGER，浮点->REAL，字符串->TEXT，
+ * null->NULL，布尔->INTEGER(0/1)，{"$blob": "<base64>"}->BLOB
+ * 给定arena时参数值和名字都分配在arena上，随请求一起回收
+ */
+class SqlParams {
+public:
+    explicit SqlParams(Arena* arena = nullptr);
+
+    /**
+     * @brief 从JSON解析参数
+     * @param json msg.params的值
+     * @param error [out] 解析失败时的错误信息
+     * @return 是否解析成功
+     */
+    bool parse(const Json::Value& json, std::string& error);
+
+    /**
+     * @brief 从请求的一个字段解析参数：直接扫描接收缓冲区中的原始文本，不构建Json::Value；
+     * 请求需要DOM时退回parse(Json::Value)
+     * @param view 请求
+     * @param key 参数所在的字段名
+     * @param error [out] 解析失败时的错误信息
+     * @return 是否解析成功（字段不存在时为空参数）
+     */
+    bool parse(const RequestView& view, const char* key, std::string& error);
+
+    /**
+     * @brief 把参数绑定到预编译语句
+     * 文本和BLOB以SQLITE_STATIC绑定，语句在本对象销毁前必须reset并清除绑定
+     * @param stmt 预编译语句
+     * @param error [out] 绑定失败时的错误信息
+     * @return 是否绑定成功
+     */
+    bool bind(sqlite3_stmt* stmt, std::string& error) const;
+
+    bool empty() const { return positional.empty() && named.empty(); }
+    bool isPositional() const { return !positional.empty(); }
+
+    /**
+     * @brief 把参数按类型和值无歧义地编码追加到out（结果缓存的键）
+     * 类型不同的相等值（如1和1.0）编码不同
+     */
+    void appendKey(std::string& out) const;
+
+    /**
+     * @brief 把一个值绑定到语句的第index个参数（文本和BLOB以SQLITE_STATIC绑定）
+     * @return SQLite返回码
+     */
+    static int bindValue(sqlite3_stmt* stmt, int index, const SqlValue& value);
+
+private:
+    typedef std::pair<ArenaString, SqlValue> NamedValue;
+
+    Arena* arena;
+    ArenaVector<SqlValue> positional;
+    ArenaVector<NamedValue> named;
+
+    static bool parseValue(const Json::Value& json, SqlValue& value, std::string& error);
+};
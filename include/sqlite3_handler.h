@@ -1,7 +1,54 @@
 #pragma once
 #include <sqlite3.h>
 #include <string>
+#include <list>
+#include <vector>
+#include <unordered_map>
+#include <functional>
+#include <atomic>
+#include <cstdint>
+#include <cstring>
 #include "table_data.h"
+#include "sql_params.h"
+#include "result_writer.h"
+
+/**
+ * @brief 预编译语句缓存的统计信息
+ */
+struct StmtCacheStats {
+    uint64_t hits;          // 命中次数
+    uint64_t misses;        // 未命中（需要重新prepare）次数
+    uint64_t evictions;     // 因容量不足被淘汰的语句数
+    size_t size;            // 当前缓存的语句数
+    size_t capacity;        // 缓存容量
+};
+
+/**
+ * @brief 语句读取的表和结果能否缓存，在prepare时由authorizer回调收集
+ */
+struct StatementInfo {
+    StatementInfo() : cacheable(false) {}
+
+    std::vector<std::string> tables;    // 读取的main库中的表（去重）
+    bool cacheable;                     // 单条语句，不读临时/附加库，不调用random()、当前时间等不确定函数
+};
+
+/**
+ * @brief 以NUL结尾的SQL文本的视图（不拥有内存）
+ * 可由std::string、ArenaString和字符串常量隐式构造，执行接口不必为SQL文本另外构造std::string
+ */
+struct SqlText {
+    SqlText(const char* text) : data(text), size(std::strlen(text)) {}
+
+    template<class Alloc>
+    SqlText(const std::basic_string<char, std::char_traits<char>, Alloc>& text)
+        : data(text.c_str()), size(text.size()) {}
+
+    std::string str() const { return std::string(data, size); }
+
+    const char* data;
+    size_t size;
+};
 
 /**
  * @brief SQLite3数据库操作封装类
@@ -12,8 +59,10 @@ public:
     /**
      * @brief 构造函数
      * @param dbPath 数据库文件路径
+     * @param stmtCacheCapacity 预编译语句缓存容量（按SQL文本做LRU），0表示不缓存
      */
-    explicit Sqlite3Handler(const std::string& dbPath);
+    explicit Sqlite3Handler(const std::string& dbPath,
+                            size_t stmtCacheCapacity = kDefaultStmtCacheCapacity);
     ~Sqlite3Handler();
     
     /**
@@ -24,9 +73,10 @@ public:
     
     /**
      * @brief 打开数据库连接
+     * @param flags sqlite3_open_v2的打开标志
      * @return 是否成功打开
      */
-    bool open();
+    bool open(int flags = SQLITE_OPEN_READWRITE | SQLITE_OPEN_CREATE);
 
     /**
      * @brief 关闭数据库连接
@@ -36,16 +86,63 @@ public:
     /**
      * @brief 执行查询语句
      * @param sql SQL查询语句
+     * @param params 绑定参数，nullptr表示无参数
      * @return TableData对象，包含查询结果
      */
-    TableData executeQuery(const std::string& sql);
+    TableData executeQuery(SqlText sql, const SqlParams* params = nullptr);
+
+    /**
+     * @brief 执行查询语句，边执行边把结果序列化到writer（结束时已调用writer.end）
+     * @param sql 单条SQL查询语句（多条语句时退回到executeQuery整体输出）
+     * @param params 绑定参数，nullptr表示无参数
+     * @param writer 结果序列化器
+     * @return 是否执行成功
+     */
+    bool streamQuery(SqlText sql, const SqlParams* params, ResultWriter& writer);
+
+    /**
+     * @brief 为服务器端游标准备一条只读查询并绑定参数（不进语句缓存，由调用者持有）
+     * 语句第一次执行后一直占着该连接的读事务（WAL快照），直到closeCursor
+     * @param sql 单条只读查询语句
+     * @param params 绑定参数，nullptr表示无参数；以SQLITE_STATIC绑定，须在closeCursor之后才能销毁
+     * @return 预编译语句，失败时为nullptr，错误信息见getLastError()
+     */
+    sqlite3_stmt* openCursor(SqlText sql, const SqlParams* params);
+
+    /**
+     * @brief 从游标读取接下来最多maxRows行，序列化到writer（由调用者随后调用writer.end）
+     * 读满maxRows行后再前进一步确认是否还有数据，该行留在语句上作为下一次读取的第一行
+     * @param stmt openCursor返回的语句
+     * @param maxRows 本次最多读取的行数
+     * @param writer 结果序列化器
+     * @param done [out] 结果集是否已读完
+     * @return 是否执行成功，失败时错误信息见getLastError()
+     */
+    bool fetchCursor(sqlite3_stmt* stmt, size_t maxRows, ResultWriter& writer, bool& done);
+
+    /**
+     * @brief 关闭游标，结束它占用的读事务
+     */
+    void closeCursor(sqlite3_stmt* stmt);
 
     /**
      * @brief 执行更新语句（INSERT、UPDATE、DELETE等）
      * @param sql SQL更新语句
+     * @param params 绑定参数，nullptr表示无参数
      * @return 是否执行成功
      */
-    bool executeUpdate(const std::string& sql);
+    bool executeUpdate(SqlText sql, const SqlParams* params = nullptr);
+
+    /**
+     * @brief 用同一条预编译语句逐行绑定并执行（批量写入），不逐行prepare也不逐行解析参数
+     * @param sql 带参数的单条语句
+     * @param maxRows 最多执行的行数
+     * @param bindRow 把下一行绑定到语句上，返回false时停止（没有更多行或行数据有误，由调用者区分）
+     * @param executed [out] 成功执行的行数
+     * @return 已执行的行是否全部成功；失败时executed为出错行之前的行数，错误信息见getLastError()
+     */
+    bool executeBatch(SqlText sql, size_t maxRows,
+                      const std::function<bool(sqlite3_stmt*)>& bindRow, size_t& executed);
 
     /**
      * @brief 开始事务
@@ -65,6 +162,11 @@ public:
      */
     bool rollback();
 
+    /**
+     * @brief 数据库文件路径
+     */
+    const std::string& getPath() const { return dbPath; }
+
     /**
      * @brief 获取最后的错误信息
      * @return 最后的错误信息
@@ -77,25 +179,180 @@ public:
      */
     int getAffectedRows() const;
 
+    /**
+     * @brief 连接当前是否处于事务中（非自动提交模式）
+     */
+    bool inTransaction() const;
+
+    /**
+     * @brief 设置遇到锁时的等待时间
+     * @param ms 毫秒
+     */
+    void setBusyTimeout(int ms);
+
+    /**
+     * @brief 设置预编译语句缓存容量，缩小时立即淘汰多余的语句
+     * @param capacity 缓存容量，0表示不缓存
+     */
+    void setStmtCacheCapacity(size_t capacity);
+
+    /**
+     * @brief 获取预编译语句缓存的命中/未命中/淘汰计数
+     */
+    StmtCacheStats getStmtCacheStats() const;
+
+    /**
+     * @brief 最近一次执行的语句的信息（结果缓存用），在执行下一条语句前有效
+     * 未启用结果缓存时总是不可缓存
+     */
+    const StatementInfo& getStatementInfo() const { return *lastInfo; }
+
+    /**
+     * @brief 设置中断标志：标志置位后，正在执行的语句在下一次进度回调时以SQLITE_INTERRUPT中止，
+     * 错误信息为kDeadlineExceeded；nullptr表示不检查。回滚不会被中止
+     */
+    void setInterruptFlag(const std::atomic<bool>* flag) { interruptFlag = flag; }
+
+    /**
+     * @brief 在作用域内为连接设置中断标志，离开时清除；必须在归还连接之前离开
+     */
+    class InterruptScope {
+    public:
+        InterruptScope(Sqlite3Handler& db, const std::atomic<bool>* flag) : db(db) { db.setInterruptFlag(flag); }
+        ~InterruptScope() { db.setInterruptFlag(nullptr); }
+
+        InterruptScope(const InterruptScope&) = delete;
+        InterruptScope& operator=(const InterruptScope&) = delete;
+
+    private:
+        Sqlite3Handler& db;
+    };
+
+    static const size_t kDefaultStmtCacheCapacity = 64;
+    static const char kDeadlineExceeded[];      // 被中断标志中止时的错误信息
+
 private:
+    /**
+     * @brief 缓存中的一条预编译语句
+     */
+    struct CachedStatement {
+        std::string sql;
+        sqlite3_stmt* stmt;
+        StatementInfo info;
+    };
+    typedef std::list<CachedStatement> StatementList;
+
+    /**
+     * @brief 按内容比较SQL文本的哈希（FNV-1a）和相等比较，查找时不必构造std::string
+     */
+    struct SqlTextHash {
+        size_t operator()(const SqlText& text) const;
+    };
+    struct SqlTextEqual {
+        bool operator()(const SqlText& a, const SqlText& b) const {
+            return a.size == b.size && std::memcmp(a.data, b.data, a.size) == 0;
+        }
+    };
+
+
     sqlite3* db;                    // SQLite3数据库连接句柄
     const std::string dbPath;       // 数据库文件路径
     std::string lastError;          // 最后的错误信息
     
+    StatementList stmtLru;          // 预编译语句，表头为最近使用
+    std::unordered_map<SqlText, StatementList::iterator, SqlTextHash, SqlTextEqual> stmtIndex;  // SQL文本（指向CachedStatement::sql） -> 语句
+    size_t stmtCacheCapacity;
+    StmtCacheStats stmtStats;
+
+    // 结果缓存：读连接在prepare时收集语句读取的表，写连接记录提交修改了哪些表
+    bool trackChanges;                  // 打开时结果缓存已启用，安装了相关钩子
+    StatementInfo* preparingInfo;       // 正在prepare的语句的信息，authorizer写入
+    const StatementInfo* lastInfo;      // 最近执行的语句的信息
+    StatementInfo uncachedInfo;         // 不进语句缓存的语句的信息
+    StatementInfo noInfo;               // 不可缓存
+    std::vector<std::string> changedTables;     // 当前事务中被修改的表
+    uint64_t hookedChanges;             // 当前事务中update钩子报告的行数
+    int changesBase;                    // 当前事务开始时的sqlite3_total_changes
+    bool commitPending;                 // 提交钩子已触发，等语句返回后通知结果缓存
+    bool schemaChanged;                 // prepare过DDL语句，下次提交时整库失效
+    const std::atomic<bool>* interruptFlag;     // 请求的截止标志，由Reactor在超时时置位
+
+    static const int kProgressOps = 1000;       // 每执行这么多条虚拟机指令检查一次中断标志
+
+    /**
+     * @brief 取得SQL对应的预编译语句（优先从缓存中取）
+     * @param sql 单条SQL语句
+     * @param stmt [out] 预编译语句；SQL只含空白/注释时为nullptr
+     * @param cached [out] 语句是否归缓存所有（否则用完后需finalize）
+     * @return SQLITE_OK表示成功；SQL包含多条语句时返回SQLITE_MISUSE
+     */
+    int acquireStatement(SqlText sql, sqlite3_stmt*& stmt, bool& cached);
+
     /**
-     * @brief SQLite3查询回调函数
-     * @param data 用户数据指针
-     * @param argc 列数
-     * @param argv 列值数组
-     * @param azColName 列名数组
-     * @return 0表示继续执行，非0表示中断执行
+     * @brief 用完语句后归还：缓存的语句reset后留待复用，否则finalize
      */
-    static int callback(void* data, int argc, char** argv, char** azColName);
+    void releaseStatement(sqlite3_stmt* stmt, bool cached);
+
+    /**
+     * @brief 取得语句并绑定参数
+     * @return SQLITE_OK表示成功；多语句文本返回SQLITE_MISUSE（此时未绑定参数）
+     */
+    int prepareAndBind(SqlText sql, const SqlParams* params,
+                       sqlite3_stmt*& stmt, bool& cached);
+
+    /**
+     * @brief 淘汰最久未使用的语句直到不超过容量
+     */
+    void evictStatements(size_t capacity);
 
     /**
      * @brief 执行SQL语句的通用方法
      * @param sql SQL语句
+     * @param params 绑定参数，nullptr表示无参数
      * @return 是否执行成功
      */
-    bool executeSql(const std::string& sql);
+    bool executeSql(SqlText sql, const SqlParams* params = nullptr);
+
+    /**
+     * @brief 逐条执行一次包含多条语句的SQL文本（不使用缓存）
+     * @param sql SQL文本
+     * @param result 查询结果，不需要时传nullptr
+     * @return SQLite返回码
+     */
+    int executeUncached(SqlText sql, TableData* result);
+
+    /**
+     * @brief 用sqlite3_step/sqlite3_column_*把语句的结果按类型填入TableData
+     * @param stmt 已绑定参数的语句
+     * @param result 结果表，第一次填充时写入列描述（名称和声明类型）
+     * @return SQLITE_OK或出错时的返回码
+     */
+    static int fillResult(sqlite3_stmt* stmt, TableData& result);
+
+    /**
+     * @brief 语句执行完后调用：事务已提交时把修改过的表通知给结果缓存
+     * 提交钩子在提交完成前触发，此时失效的话，并发的读连接可能又把旧数据写进缓存，
+     * 所以要等语句返回、确认已回到自动提交模式后再失效
+     */
+    void publishChanges();
+
+    /**
+     * @brief 中断标志是否已置位（请求已超过截止时间）
+     */
+    bool deadlineExceeded() const {
+        return interruptFlag && interruptFlag->load(std::memory_order_relaxed);
+    }
+
+    /**
+     * @brief 当前错误信息：被中断标志中止时报告超时，而不是SQLite的"interrupted"
+     */
+    const char* errorMessage() const;
+
+    static int progressHandler(void* arg);
+
+    static int commitHook(void* arg);
+    static void rollbackHook(void* arg);
+    static void updateHook(void* arg, int op, const char* dbName, const char* table, sqlite3_int64 rowid);
+    static int authorizer(void* arg, int action, const char* arg1, const char* arg2,
+                          const char* dbName, const char* trigger);
 }; 
\ No newline at end of file
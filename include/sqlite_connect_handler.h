@@ -1,16 +1,19 @@
 #pragma once
-#include "sqlite3_handler.h"
-#include <json/json.h>
-#include <map>
+#include "db_session.h"
+#include "request_view.h"
 #include <memory>
 
+struct Connection;
+
 class SqliteConnectHandler {
 public:
     SqliteConnectHandler();
-    std::string handle(const Json::Value& request, int clientFd);
-    static Sqlite3Handler* getHandler(int clientFd);
-    static void removeHandler(int clientFd);
 
-private:
-    static std::map<int, std::unique_ptr<Sqlite3Handler>> dbHandlers_;
-}; 
\ No newline at end of file
+    /**
+     * @brief 打开数据库会话并挂在连接上，替换连接上原有的会话
+     * 会话用shared_ptr持有：连接关闭时可能仍有工作线程在使用它。
+     * 可选参数encoding为"json"（默认）或"binary"；二进制结果没有换行分隔的形式，
+     * 只在长度前缀帧的连接上启用，否则退回JSON。响应的encoding字段为实际使用的编码
+     */
+    std::string handle(const RequestView& request, Connection& conn);
+}; 
@@ -0,0 +1,187 @@
+#pragma once
+#include "sqlite3_handler.h"
+#include "worker_pool.h"
+#include "group_commit.h"
+#include <string>
+#include <vector>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <atomic>
+#include <condition_variable>
+#include <chrono>
+#include <cstdint>
+
+/**
+ * @brief 连接池参数
+ */
+struct SqlitePoolOptions {
+    SqlitePoolOptions()
+        : maxReaders(4)
+        , cacheSizeKiB(64 * 1024)
+        , mmapSize(256LL * 1024 * 1024)
+        , synchronous("NORMAL")
+        , busyTimeoutMs(5000)
+        , leaseTimeoutMs(5000)
+        , stmtCacheCapacity(Sqlite3Handler::kDefaultStmtCacheCapacity)
+        , dataVersionCheckMs(100)
+        , groupCommitMaxBatch(64)
+        , groupCommitWindowUs(0)
+        , maxCursors(64)
+    {
+    }
+
+    size_t maxReaders;          // 只读连接上限（按需打开）
+    int cacheSizeKiB;           // PRAGMA cache_size（KiB）
+    long long mmapSize;         // PRAGMA mmap_size（字节）
+    std::string synchronous;    // PRAGMA synchronous（WAL下NORMAL即可保证一致性）
+    int busyTimeoutMs;          // sqlite3_busy_timeout
+    int leaseTimeoutMs;         // 等待空闲连接的最长时间
+    size_t stmtCacheCapacity;   // 每个连接的预编译语句缓存容量
+    int dataVersionCheckMs;     // 启用结果缓存时，检测进程外写入的最小间隔
+    size_t groupCommitMaxBatch; // 组提交一批最多合并的写请求数，小于2时不合并
+    int groupCommitWindowUs;    // 组提交凑批的等待时间（微秒），0表示不额外等待
+    size_t maxCursors;          // 服务器端游标占用的只读连接上限（与maxReaders分开计）
+};
+
+/**
+ * @brief 按规范化数据库路径共享的进程级SQLite连接池
+ * 每个池有一个写连接和若干只读连接，均只打开一次（WAL模式）并长期保持，
+ * 因此schema、页缓存和预编译语句缓存可以在客户端之间复用。
+ * 客户端会话不再拥有连接，而是按请求租用（Lease），用完归还
+ */
+class SqlitePool : public std::enable_shared_from_this<SqlitePool> {
+public:
+    /**
+     * @brief 连接租约，析构时自动归还连接
+     */
+    class Lease {
+    public:
+        Lease();
+        ~Lease();
+        Lease(Lease&& other);
+        Lease& operator=(Lease&& other);
+        Lease(const Lease&) = delete;
+        Lease& operator=(const Lease&) = delete;
+
+        Sqlite3Handler* get() const { return conn.get(); }
+        Sqlite3Handler* operator->() const { return conn.get(); }
+        explicit operator bool() const { return conn != nullptr; }
+        bool isWriter() const { return writer; }
+        bool isCursor() const { return cursor; }
+
+        /**
+         * @brief 提前归还连接
+         */
+        void release();
+
+    private:
+        friend class SqlitePool;
+        std::shared_ptr<SqlitePool> pool;
+        std::unique_ptr<Sqlite3Handler> conn;
+        bool writer;
+        bool cursor;
+    };
+
+    /**
+     * @brief 取得（必要时创建）数据库对应的连接池
+     * @param dbPath 数据库路径，按realpath规范化后作为池的键
+     * @param error [out] 打开失败时的错误信息
+     * @return 连接池，失败时返回nullptr
+     */
+    static std::shared_ptr<SqlitePool> get(const std::string& dbPath, std::string& error);
+
+    /**
+     * @brief 设置之后新建的连接池使用的参数
+     */
+    static void setDefaultOptions(const SqlitePoolOptions& options);
+
+    /**
+     * @brief 租用一个只读连接（内存数据库等不支持共享的情况下退化为写连接）
+     * @param lease [out] 租约
+     * @param error [out] 超时或打开失败时的错误信息
+     * @param deadline 请求的截止时刻（纳秒，Metrics::now()），0表示没有；
+     *        等待不超过它和leaseTimeoutMs中较早的一个，因截止时间失败时错误为kDeadlineExceeded
+     * @return 是否成功
+     */
+    bool acquireReader(Lease& lease, std::string& error, uint64_t deadline = 0);
+
+    /**
+     * @brief 为服务器端游标租用一个只读连接
+     * 游标在多次请求之间一直占用连接（语句和读事务保持打开），因此使用单独的一组连接，
+     * 最多maxCursors个，不挤占普通读请求；达到上限时立即失败而不等待
+     * @param lease [out] 租约
+     * @param error [out] 失败原因
+     * @return 是否成功
+     */
+    bool acquireCursorReader(Lease& lease, std::string& error);
+
+    /**
+     * @brief 租用唯一的写连接
+     * @param lease [out] 租约
+     * @param error [out] 超时时的错误信息
+     * @param deadline 请求的截止时刻，规则同acquireReader
+     * @return 是否成功
+     */
+    bool acquireWriter(Lease& lease, std::string& error, uint64_t deadline = 0);
+
+    const std::string& getPath() const { return path; }
+
+    int getLeaseTimeoutMs() const { return options.leaseTimeoutMs; }
+
+    static const char kWriterBusy[];    // 等待写连接超时的错误信息
+
+    /**
+     * @brief 本数据库的写任务串行队列，保证写请求按到达顺序执行
+     */
+    SerialQueue& getWriteQueue() { return writeQueue; }
+
+    /**
+     * @brief 本数据库的组提交，可合并的写请求经它进入写串行队列
+     */
+    GroupCommit& getGroupCommit() { return groupCommit; }
+
+    /**
+     * @brief 检测其他进程对数据库的提交，有则让结果缓存中本库的条目全部失效
+     * 写连接上的PRAGMA data_version只在其他连接提交后变化，而本池的只读连接从不提交，
+     * 所以变化只能来自进程外。最多每dataVersionCheckMs检查一次，写连接正被租用时跳过
+     */
+    void checkExternalWrites();
+
+    ~SqlitePool();
+
+private:
+    SqlitePool(const std::string& path, const SqlitePoolOptions& options);
+
+    bool init(std::string& error);
+
+    /**
+     * @brief 等待连接的最晚时刻：leaseTimeoutMs与请求截止时刻中较早的一个
+     * @param byDeadline [out] 是否由请求截止时刻决定
+     */
+    std::chrono::steady_clock::time_point waitLimit(uint64_t deadline, bool& byDeadline) const;
+    std::unique_ptr<Sqlite3Handler> openConnection(bool readOnly, std::string& error);
+    void giveBack(std::unique_ptr<Sqlite3Handler> conn, bool writer, bool cursor);
+
+    static std::string canonicalPath(const std::string& dbPath);
+
+    const std::string path;
+    const SqlitePoolOptions options;
+    bool shareable;                 // 文件数据库才能在多个连接间共享
+
+    std::mutex mutex;
+    std::condition_variable available;
+    std::unique_ptr<Sqlite3Handler> writer;                 // 空闲时在此，租出时为nullptr
+    std::vector<std::unique_ptr<Sqlite3Handler>> idleReaders;
+    size_t openReaders;
+    std::vector<std::unique_ptr<Sqlite3Handler>> idleCursorReaders;
+    size_t openCursorReaders;
+    SerialQueue writeQueue;
+    GroupCommit groupCommit;
+    std::atomic<uint64_t> nextVersionCheck;     // 下次检查data_version的时刻（纳秒）
+    int64_t dataVersion;                        // 写连接上次看到的data_version，持有写连接时访问
+
+    static std::mutex registryMutex;
+    static std::map<std::string, std::shared_ptr<SqlitePool>> registry;
+    static SqlitePoolOptions defaultOptions;
+};
@@ -1,15 +1,83 @@
 #pragma once
+#include <sqlite3.h>
 #include <string>
 #include <vector>
-#include <map>
-#include <json/json.h>
+#include <cstdint>
+#include "binary_result.h"
 
 /**
  * @brief 数据表结构类，用于存储数据库查询结果
- * 包含查询状态、消息、列信息和行数据
+ * 包含查询状态、消息、有序的列描述和按列存储的行数据。
+ * 每列的值按存储类型放在连续数组中：整数、浮点各一个数组，文本/BLOB共用一块字节区（按偏移访问），
+ * NULL用位图表示。同一列出现不同存储类型的值时（SQLite允许），该列提升为TEXT（BLOB转为Base64）
  */
 class TableData {
 public:
+    /**
+     * @brief 一列的描述和数据
+     */
+    class Column {
+    public:
+        Column(const std::string& name, const std::string& declType);
+
+        const std::string& getName() const { return name; }
+
+        /**
+         * @brief 声明类型（sqlite3_column_decltype），表达式列为空串
+         */
+        const std::string& getDeclType() const { return declType; }
+
+        /**
+         * @brief 存储类型：SQLITE_INTEGER/SQLITE_FLOAT/SQLITE_TEXT/SQLITE_BLOB，全为NULL时为SQLITE_NULL
+         */
+        int getStorageClass() const { return storageClass; }
+
+        /**
+         * @brief 对外展示的类型名：优先声明类型，否则为存储类型名
+         */
+        std::string getTypeName() const;
+
+        bool isNull(size_t row) const {
+            return (nulls[row >> 6] >> (row & 63)) & 1;
+        }
+        int64_t getInteger(size_t row) const { return ints[row]; }
+        double getReal(size_t row) const { return reals[row]; }
+
+        /**
+         * @brief 取TEXT/BLOB值
+         * @param row 行号
+         * @param len [out] 字节数
+         * @return 指向内部字节区的指针（追加数据后失效）
+         */
+        const char* getBytes(size_t row, size_t& len) const {
+            size_t start = row ? ends[row - 1] : 0;
+            len = ends[row] - start;
+            return arena.data() + start;
+        }
+
+        /**
+         * @brief 把一个值格式化为文本（与sqlite3_column_text的结果一致）
+         */
+        std::string getText(size_t row) const;
+
+    private:
+        friend class TableData;
+
+        std::string name;
+        std::string declType;
+        int storageClass;
+        size_t count;                   // 已追加的值个数
+        std::vector<uint64_t> nulls;    // NULL位图，每行一位
+        std::vector<int64_t> ints;      // SQLITE_INTEGER
+        std::vector<double> reals;      // SQLITE_FLOAT
+        std::string arena;              // SQLITE_TEXT/SQLITE_BLOB的字节区
+        std::vector<size_t> ends;       // 每行值在arena中的结束偏移
+
+        void adopt(int cls);
+        void promoteToText();
+        void markNull();
+    };
+
     TableData();
     ~TableData();
     
@@ -26,17 +94,22 @@ public:
     void setMsg(const std::string& msg);
 
     /**
-     * @brief 添加列名和对应的数据类型
-     * @param column 列名
-     * @param type 数据类型
+     * @brief 按顺序添加一列
+     * @param name 列名
+     * @param declType 声明类型（可为空）
      */
-    void addColumnType(const std::string& column, const std::string& type);
+    void addColumn(const std::string& name, const std::string& declType);
 
     /**
-     * @brief 添加一行数据
-     * @param row 键值对形式的行数据，key为列名，value为列值
+     * @brief 开始新的一行，随后按列顺序为每一列各追加一个值
      */
-    void addRowValue(const std::map<std::string, std::string>& row);
+    void beginRow();
+
+    void appendNull(size_t col);
+    void appendInteger(size_t col, int64_t value);
+    void appendReal(size_t col, double value);
+    void appendText(size_t col, const char* data, size_t len);
+    void appendBlob(size_t col, const void* data, size_t len);
 
     /**
      * @brief 将查询结果序列化为JSON字符串
@@ -44,8 +117,42 @@ public:
      */
     std::string toJson() const;
 
-    size_t getRowCount() const { return rowAndValue.size(); }
+    /**
+     * @brief 将查询结果直接序列化追加到out，不经过Json::Value
+     * @param out 输出缓冲区
+     */
+    void writeJson(std::string& out) const;
+
+    /**
+     * @brief 按二进制结果格式（见binary_result.h）序列化追加到out
+     * @param out 输出缓冲区
+     */
+    void writeBinary(std::string& out) const;
+
+    /**
+     * @brief 按指定编码序列化追加到out
+     */
+    void write(std::string& out, ResultEncoding encoding) const {
+        if (encoding == RESULT_ENCODING_BINARY) {
+            writeBinary(out);
+        } else {
+            writeJson(out);
+        }
+    }
+
+    /**
+     * @brief 把没有列和行的结果（写操作的状态）追加到out，与空表writeJson的输出相同
+     * 消息不必先存成std::string
+     * @param encoding 编码，二进制时为没有列的二进制结果
+     */
+    static void writeStatus(std::string& out, int status, const char* msg,
+                            ResultEncoding encoding = RESULT_ENCODING_JSON);
+
+    size_t getRowCount() const { return rowCount; }
+    size_t getColumnCount() const { return columns.size(); }
+    const Column& getColumn(size_t col) const { return columns[col]; }
     int getStatus() const { return status; }
+    const std::string& getMsg() const { return msg; }
 
     /**
      * @brief 设置影响行数
@@ -56,7 +163,7 @@ public:
 private:
     int status;                     // 查询状态
     std::string msg;                // 查询消息
-    std::map<std::string, std::string> colAndType;      // 列名和类型的映射
-    std::vector<std::map<std::string, std::string>> rowAndValue;  // 行数据数组
+    std::vector<Column> columns;    // 有序的列
+    size_t rowCount;                // 行数
     int affectedRows;
-}; 
\ No newline at end of file
+};
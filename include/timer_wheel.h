@@ -0,0 +1,114 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+
+/**
+ * @brief 分层时间轮（Reactor本地，不加锁）
+ * 4层、每层64个槽，一格为一个tick：第0层覆盖64个tick，每往上一层范围扩大64倍。
+ * 定时器是嵌在所有者对象里的侵入式双向链表节点，添加、取消、重新设定都是O(1)，不分配内存；
+ * 到期前高层槽位里的定时器逐层下移（每个定时器最多移动3次）。
+ * 超出最大范围（2^24个tick）的定时器在范围末尾提前到期，回调应自行检查真正的时间
+ */
+class TimerWheel {
+public:
+    /**
+     * @brief 定时器节点，嵌在所有者对象里；所有者的地址在定时器挂着期间必须不变
+     */
+    struct Timer {
+        Timer() : prev(nullptr), next(nullptr), expires(0), owner(nullptr) {}
+
+        /**
+         * @brief 是否在时间轮上等待到期
+         */
+        bool isPending() const { return prev != nullptr; }
+
+        Timer* prev;
+        Timer* next;
+        uint64_t expires;   // 到期的tick
+        void* owner;        // 所有者，回调用来找回所属对象
+    };
+
+    /**
+     * @brief 构造函数
+     * @param now 当前时刻（纳秒，Metrics::now()）
+     * @param tickNs 一格的时长（纳秒）
+     */
+    explicit TimerWheel(uint64_t now, uint64_t tickNs = kDefaultTickNs);
+
+    TimerWheel(const TimerWheel&) = delete;
+    TimerWheel& operator=(const TimerWheel&) = delete;
+
+    /**
+     * @brief 设定定时器在when（纳秒）之后的第一个tick到期，已在等待的定时器改为新的时刻
+     */
+    void schedule(Timer& timer, uint64_t when);
+
+    /**
+     * @brief 取消定时器（不在等待时什么也不做）
+     */
+    void cancel(Timer& timer);
+
+    /**
+     * @brief 推进到now，对每个到期的定时器调用fire(Timer&)
+     * 回调里可以设定或取消任何定时器，包括同一批里尚未调用的
+     */
+    template<class F>
+    void advance(uint64_t now, F fire) {
+        uint64_t target = now / tickNs;
+        if (count == 0) {
+            current = target > current ? target : current;
+            return;
+        }
+        while (current < target) {
+            current++;
+            cascade();
+            Timer expired;
+            spliceSlot(slots[0][current & kSlotMask], expired);
+            while (expired.next != &expired) {
+                Timer* timer = expired.next;
+                unlink(*timer);
+                count--;
+                fire(*timer);
+            }
+        }
+    }
+
+    /**
+     * @brief 下一次需要推进的时刻（纳秒）：第0层最近的非空槽或下一次逐层下移，没有定时器时为0
+     */
+    uint64_t nextWakeup() const;
+
+    size_t size() const { return count; }
+
+    static const uint64_t kDefaultTickNs = 10 * 1000000;    // 10毫秒
+
+private:
+    static const int kLevels = 4;
+    static const int kSlotBits = 6;
+    static const uint64_t kSlots = uint64_t(1) << kSlotBits;
+    static const uint64_t kSlotMask = kSlots - 1;
+    static const uint64_t kMaxTicks = uint64_t(1) << (kSlotBits * kLevels);
+
+    const uint64_t tickNs;
+    uint64_t current;           // 已推进到的tick
+    size_t count;               // 等待中的定时器数
+    Timer slots[kLevels][kSlots];   // 各槽位链表的哨兵节点
+
+    /**
+     * @brief 按到期tick与current的距离放进对应层的槽位
+     */
+    void insert(Timer& timer);
+
+    /**
+     * @brief current进入新的一轮时，把上一层对应槽位的定时器下移
+     */
+    void cascade();
+
+    static void link(Timer& head, Timer& timer);
+    static void unlink(Timer& timer);
+
+    /**
+     * @brief 把槽位链表整体移到另一个哨兵下，槽位变为空
+     */
+    static void spliceSlot(Timer& slot, Timer& to);
+};
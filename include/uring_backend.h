@@ -0,0 +1,166 @@
+#pragma once
+#include <linux/io_uring.h>
+#include <sys/socket.h>
+#include <sys/uio.h>
+#include <string>
+#include <vector>
+#include <deque>
+#include <memory>
+#include <cstdint>
+#include <cstddef>
+#include <cstring>
+#include "io_backend.h"
+#include "output_queue.h"
+
+/**
+ * @brief io_uring后端（直接使用系统调用，不依赖liburing）
+ * - 监听socket上一个多次触发的accept，新连接不需要任何系统调用就能拿到fd
+ * - 每个连接一个多次触发的recv，数据写进注册给内核的缓冲区环（provided buffer ring），
+ *   拷进输入缓冲区后立即归还
+ * - 发送用sendmsg把输出队列的各段一次交给内核；发送、取消等操作只填提交队列，
+ *   每轮事件循环用一次io_uring_enter提交并等待完成
+ * - eventfd和timerfd用多次触发的poll监视
+ * 需要6.0以上的内核（多次触发的recv）；创建失败时由IoBackend::create()退回epoll，
+ * 在Reactor线程上启用失败时由Reactor::run()退回epoll
+ */
+class UringBackend : public IoBackend {
+public:
+    explicit UringBackend(Reactor& reactor);
+    ~UringBackend();
+
+    /**
+     * @brief 创建io_uring实例和缓冲区环（此时环尚未启用，由start()在Reactor线程上启用）
+     * @return 内核不支持或资源不足时返回false，error为原因
+     */
+    bool init(int listenFd, int wakeFd, int timerFd, std::string& error);
+
+    const char* getName() const { return "io_uring"; }
+    bool start(std::string& error);
+    bool wait();
+    void dispatch();
+    void attach(Connection& conn);
+    bool receive(Connection&) { return true; }
+    bool send(Connection& conn);
+    void updateInterest(Connection& conn);
+    void close(Connection& conn);
+
+private:
+    /**
+     * @brief 按fd索引的后端状态
+     * 连接关闭时若还有操作在内核里，fd保持打开直到它们全部归还：
+     * 这期间fd不会被新连接复用，发送中的数据也一直有效
+     */
+    struct Slot {
+        Slot() : connId(0), pending(0), recvArmed(false), cancelling(false), sending(false), closing(false) {
+            std::memset(&msg, 0, sizeof(msg));
+        }
+
+        uint64_t connId;
+        unsigned pending;       // 在内核里尚未归还的操作数（recv在多次触发结束时才归还）
+        bool recvArmed;         // recv已提交且仍在触发
+        bool cancelling;        // 已提交取消recv（读暂停）
+        bool sending;           // 有send在内核里
+        bool closing;           // Reactor已关闭连接，等待操作归还后关闭fd
+        OutputQueue sendQueue;  // 正在发送的数据：从输出队列整体换出，发送期间Reactor不会改动
+        std::vector<struct iovec> iov;  // 交给内核的各段，与msg一起保持到发送归还
+        struct msghdr msg;
+    };
+
+    enum Op {
+        OP_ACCEPT = 1,
+        OP_WAKE,
+        OP_TIMER,
+        OP_RECV,
+        OP_SEND,
+        OP_CANCEL
+    };
+
+    Reactor& reactor;
+    int ringFd;
+    int listenFd;
+    int wakeFd;
+    int timerFd;
+
+    // 提交队列
+    void* sqRing;
+    size_t sqRingSize;
+    unsigned* sqHead;
+    unsigned* sqTail;
+    unsigned sqMask;
+    unsigned sqEntries;
+    unsigned* sqArray;
+    struct io_uring_sqe* sqes;
+    size_t sqesSize;
+    unsigned toSubmit;          // 已填好、尚未交给内核的提交项数
+    std::deque<struct io_uring_sqe> sqBacklog;  // 提交队列满且内核未取走时暂存的提交项（deque追加不移动已有元素）
+
+    // 完成队列（与提交队列共用一次映射）
+    unsigned* cqHead;
+    unsigned* cqTail;
+    unsigned cqMask;
+    struct io_uring_cqe* cqes;
+
+    // 接收缓冲区环：按io_uring_buf数组访问，尾指针在第0项的resv字段
+    // （头文件里io_uring_buf_ring的柔性数组在C++下偏移不为0，不能直接用bufs成员）
+    struct io_uring_buf* bufRing;
+    size_t bufRingSize;
+    char* bufPool;
+    unsigned short bufTail;
+
+    std::vector<std::unique_ptr<Slot>> slots;  // 元素按指针持有：发送中的msg地址不能随扩容移动
+
+    static const unsigned kQueueDepth = 1024;
+    static const unsigned kCompletionDepth = 8192;
+    static const unsigned kBufCount = 256;          // 接收缓冲区个数（2的幂）
+    static const size_t kBufSize = 16 * 1024;       // 单个接收缓冲区的字节数
+    static const unsigned kBufGroup = 0;
+    static const size_t kMaxIov = 64;               // 一次sendmsg最多交给内核的段数
+
+    Slot& slotOf(int fd);
+
+    /**
+     * @brief 取一个空闲的提交项；提交队列满时先把已填好的交给内核，
+     * 内核仍未取走（完成队列满）时返回暂存区中的项
+     */
+    struct io_uring_sqe* nextSqe();
+
+    bool sqFull() const;
+
+    /**
+     * @brief 把暂存的提交项按顺序移入提交队列，直到队列满
+     */
+    void moveBacklog();
+
+    /**
+     * @brief 把已填好的提交项（含暂存的）交给内核
+     * @param wait 是否等待至少一个完成事件
+     */
+    bool enter(bool wait);
+
+    void armAccept();
+    void armPoll(int fd, Op op);
+    void armRecv(Connection& conn, Slot& slot);
+    void submitSend(int fd, Slot& slot);
+
+    /**
+     * @brief 把接收缓冲区还给内核
+     */
+    void recycleBuffer(unsigned short bid);
+
+    /**
+     * @brief fd已关闭，清空槽位留给复用该fd的下一个连接
+     */
+    void resetSlot(Slot& slot);
+
+    void onAccept(int res, uint32_t flags);
+    void onRecv(int fd, int res, uint32_t flags);
+    void onSend(int fd, int res);
+
+    /**
+     * @brief 一个操作已归还：连接已关闭且没有其他操作时关闭fd
+     * @return 连接已关闭（调用者不应再处理该事件）
+     */
+    bool retire(int fd, Slot& slot);
+
+    static uint64_t makeUserData(Op op, uint64_t connId);
+};
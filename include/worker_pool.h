@@ -0,0 +1,191 @@
+#pragma once
+#include <functional>
+#include <vector>
+#include <thread>
+#include <mutex>
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+
+/**
+ * @brief 任务优先级：工作线程总是先取高优先级队列里的任务
+ */
+enum TaskPriority {
+    PRIORITY_HIGH,      // 交互式短请求
+    PRIORITY_NORMAL,
+    PRIORITY_LOW,       // 批量导入等长时间占用线程的任务
+    PRIORITY_COUNT
+};
+
+/**
+ * @brief 排队中的任务
+ */
+struct QueuedTask {
+    QueuedTask() : queued(0), priority(PRIORITY_NORMAL) {}
+
+    std::function<void()> task;
+    uint64_t queued;            // 入队时刻（纳秒），用于计算排队时间
+    TaskPriority priority;
+};
+
+/**
+ * @brief 任务的环形队列（不加锁，由使用者保护）
+ * 容量按2的幂增长、不收缩，稳定后入队出队不再分配内存；
+ * std::deque每越过一个节点就要释放并重新申请一次
+ */
+class TaskQueue {
+public:
+    TaskQueue() : head(0), count(0) {}
+
+    bool empty() const { return count == 0; }
+    size_t size() const { return count; }
+
+    void push(QueuedTask&& item);
+
+    /**
+     * @brief 队首任务（队列不能为空）
+     */
+    const QueuedTask& front() const { return slots[head]; }
+
+    /**
+     * @brief 取出队首任务（队列不能为空）
+     */
+    QueuedTask pop();
+
+private:
+    std::vector<QueuedTask> slots;
+    size_t head;        // 队首所在的槽
+    size_t count;
+
+    static const size_t kInitialCapacity = 16;
+};
+
+/**
+ * @brief 工作线程池
+ * 用于把SQL执行等阻塞操作移出Reactor线程。每个优先级一个队列，按优先级取任务；
+ * 连续多次越过非空的低优先级队列后让出一次，低优先级任务不会被完全饿死。
+ * 低优先级任务最多同时占用threadCount-1个线程，总有线程留给其他请求
+ */
+class WorkerPool {
+public:
+    typedef std::function<void()> Task;
+
+    /**
+     * @brief 构造函数，立即启动工作线程
+     * @param threadCount 线程数，小于1时按1处理
+     */
+    explicit WorkerPool(size_t threadCount);
+    ~WorkerPool();
+
+    /**
+     * @brief 禁用拷贝
+     */
+    WorkerPool(const WorkerPool&) = delete;
+    WorkerPool& operator=(const WorkerPool&) = delete;
+
+    /**
+     * @brief 提交任务（线程安全）
+     */
+    void submit(Task task, TaskPriority priority = PRIORITY_NORMAL);
+
+    /**
+     * @brief 设置排队延迟目标（CoDel），需在提交任务前调用
+     * 某一优先级出队任务的排队时间持续interval都不低于target时，该优先级进入过载状态，
+     * 直到有任务的排队时间回落到target以下或队列排空
+     * @param targetMs 目标排队时间（毫秒），0表示不判定过载
+     * @param intervalMs 判定过载前排队时间需持续超标的时长（毫秒）
+     */
+    void setQueueDelayTarget(int targetMs, int intervalMs);
+
+    /**
+     * @brief 该优先级是否过载（任意线程，不加锁）
+     */
+    bool isOverloaded(TaskPriority priority) const {
+        return overloaded[priority].load(std::memory_order_relaxed);
+    }
+
+    /**
+     * @brief 工作线程上调用：当前任务是否应放弃执行
+     * 任务所在优先级已过载且它的排队时间超过目标时为true，处理器应直接回复过载错误：
+     * 这样的请求即使执行完，客户端多半也已不再等待，先排空积压才能让后续请求的延迟回到目标以内
+     */
+    static bool shouldShed();
+
+    /**
+     * @brief 各优先级队列的状态快照
+     */
+    struct Stats {
+        size_t queued[PRIORITY_COUNT];      // 排队中的任务数
+        bool overloaded[PRIORITY_COUNT];
+        size_t runningLow;                  // 正在执行的低优先级任务数
+    };
+
+    void getStats(Stats& out);
+
+    size_t getThreadCount() const { return threads.size(); }
+
+private:
+    std::mutex mutex;
+    std::condition_variable cond;
+    TaskQueue queues[PRIORITY_COUNT];
+    size_t runningLow;          // 正在执行的低优先级任务数
+    size_t maxRunningLow;       // 低优先级任务最多同时占用的线程数
+    unsigned bypassed;          // 连续越过非空低优先级队列的次数
+    uint64_t targetNs;
+    uint64_t intervalNs;
+    uint64_t overloadAt[PRIORITY_COUNT];    // 排队时间持续超标时进入过载的时刻，0表示未超标
+    std::atomic<bool> overloaded[PRIORITY_COUNT];
+    std::vector<std::thread> threads;
+    bool stopping;
+
+    static const unsigned kMaxBypass = 8;
+
+    void workerLoop();
+
+    /**
+     * @brief 该优先级是否有可以开始执行的任务（持锁调用）
+     */
+    bool runnable(int priority) const;
+
+    /**
+     * @brief 选出下一个任务的优先级，没有可执行的任务时返回PRIORITY_COUNT（持锁调用）
+     */
+    int pick() const;
+
+    /**
+     * @brief 按出队任务的排队时间更新该优先级的过载状态（持锁调用）
+     */
+    void trackDelay(int priority, uint64_t waited, uint64_t now);
+};
+
+/**
+ * @brief 串行队列
+ * 提交到同一个串行队列的任务在线程池上按提交顺序逐个执行，
+ * 不同串行队列之间以及与直接提交到线程池的任务之间可以并行
+ */
+class SerialQueue {
+public:
+    SerialQueue();
+
+    /**
+     * @brief 禁用拷贝
+     */
+    SerialQueue(const SerialQueue&) = delete;
+    SerialQueue& operator=(const SerialQueue&) = delete;
+
+    /**
+     * @brief 追加任务（线程安全）
+     * @param workers 执行任务的线程池
+     * @param task 任务
+     * @param priority 任务在线程池上的优先级
+     */
+    void post(WorkerPool& workers, WorkerPool::Task task, TaskPriority priority = PRIORITY_NORMAL);
+
+private:
+    std::mutex mutex;
+    TaskQueue tasks;
+    bool running;       // 是否已有一个线程在执行本队列的任务
+
+    void drain(WorkerPool& workers);
+};
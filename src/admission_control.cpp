@@ -0,0 +1,309 @@
+#include "admission_control.h"
+#include "json_writer.h"
+#include "metrics.h"
+#include <algorithm>
+#include <cmath>
+#include <cstdlib>
+
+namespace {
+const char* const kPriorityNames[PRIORITY_COUNT] = { "high", "normal", "low" };
+
+/**
+ * @brief 令牌桶容量：未设置时取速率，至少能放下一个令牌
+ */
+double effectiveBurst(double rate, double burst) {
+    return std::max(burst > 0 ? burst : rate, 1.0);
+}
+}
+
+const char AdmissionControl::kOverloadedMessage[] = "Server overloaded: queue delay exceeds target";
+
+AdmissionOptions::AdmissionOptions()
+    : clientConcurrency(0)
+    , clientRate(0)
+    , clientBurst(0)
+    , queueTargetMs(50)
+    , queueIntervalMs(500)
+{
+    funcs["100001"].priority = PRIORITY_HIGH;
+    funcs["100002"].priority = PRIORITY_LOW;
+    funcs["100003"].priority = PRIORITY_HIGH;
+    funcs["100004"].priority = PRIORITY_HIGH;
+}
+
+bool AdmissionOptions::parseFuncLimits(const std::string& spec, std::string& error) {
+    size_t pos = 0;
+    while (pos < spec.size()) {
+        size_t end = spec.find(';', pos);
+        if (end == std::string::npos) {
+            end = spec.size();
+        }
+        std::string entry = spec.substr(pos, end - pos);
+        pos = end + 1;
+        if (entry.empty()) {
+            continue;
+        }
+        size_t colon = entry.find(':');
+        if (colon == std::string::npos || colon == 0) {
+            error = "Expected funcid:key=value in '" + entry + "'";
+            return false;
+        }
+        FuncLimits& limits = funcs[entry.substr(0, colon)];
+        size_t item = colon + 1;
+        while (item < entry.size()) {
+            size_t comma = entry.find(',', item);
+            if (comma == std::string::npos) {
+                comma = entry.size();
+            }
+            std::string setting = entry.substr(item, comma - item);
+            item = comma + 1;
+            size_t eq = setting.find('=');
+            if (eq == std::string::npos) {
+                error = "Expected key=value in '" + setting + "'";
+                return false;
+            }
+            std::string key = setting.substr(0, eq);
+            std::string value = setting.substr(eq + 1);
+            if (key == "priority") {
+                if (value == "high") {
+                    limits.priority = PRIORITY_HIGH;
+                } else if (value == "normal") {
+                    limits.priority = PRIORITY_NORMAL;
+                } else if (value == "low") {
+                    limits.priority = PRIORITY_LOW;
+                } else {
+                    error = "Unknown priority '" + value + "'";
+                    return false;
+                }
+                continue;
+            }
+            double number = std::atof(value.c_str());
+            if (number < 0) {
+                error = "Negative value in '" + setting + "'";
+                return false;
+            }
+            if (key == "concurrency") {
+                limits.concurrency = static_cast<size_t>(number);
+            } else if (key == "rate") {
+                limits.rate = number;
+            } else if (key == "burst") {
+                limits.burst = number;
+            } else {
+                error = "Unknown key '" + key + "'";
+                return false;
+            }
+        }
+    }
+    return true;
+}
+
+AdmissionControl::AdmissionControl(const AdmissionOptions& options, std::shared_ptr<WorkerPool> workers)
+    : workers(workers)
+    , clientConcurrency(options.clientConcurrency)
+    , clientRate(options.clientRate)
+    , clientBurst(effectiveBurst(options.clientRate, options.clientBurst))
+    , sweepAt(kMinSweepAt)
+    , clientThrottled(0)
+{
+    for (const auto& entry : options.funcs) {
+        FuncState& state = funcs[entry.first];
+        state.limits = entry.second;
+        state.limits.burst = effectiveBurst(state.limits.rate, state.limits.burst);
+        state.tokens = state.limits.burst;
+    }
+    workers->setQueueDelayTarget(options.queueTargetMs, options.queueIntervalMs);
+}
+
+int64_t AdmissionControl::takeToken(double& tokens, uint64_t& refilled, double rate, double burst, uint64_t now) {
+    if (now > refilled) {
+        tokens = std::min(burst, tokens + static_cast<double>(now - refilled) * rate / 1e9);
+        refilled = now;
+    }
+    if (tokens >= 1) {
+        tokens -= 1;
+        return 0;
+    }
+    return static_cast<int64_t>(std::ceil((1 - tokens) * 1000 / rate));
+}
+
+std::string AdmissionControl::rejectResponse(int status, const std::string& msg, int64_t retryAfterMs) {
+    std::string out;
+    JsonWriter writer(out);
+    writer.beginObject();
+    writer.key("status").value(status);
+    writer.key("msg").value(msg);
+    if (retryAfterMs > 0) {
+        writer.key("retry_after_ms").value(retryAfterMs);
+    }
+    writer.endObject();
+    return out;
+}
+
+std::string AdmissionControl::overloadedResponse() {
+    return rejectResponse(kStatusOverloaded, kOverloadedMessage, 0);
+}
+
+bool AdmissionControl::admit(const std::string& funcId, uint32_t client, uint64_t now,
+                             Ticket& ticket, std::string& response) {
+    std::lock_guard<std::mutex> lock(mutex);
+    auto it = funcs.find(funcId);
+    FuncState& func = it != funcs.end() ? it->second : other;
+    const FuncLimits& limits = func.limits;
+
+    // 排队已经持续超标：再排进去只会超时，不如让客户端立即知道、稍后重试
+    if (workers->isOverloaded(limits.priority)) {
+        func.overloaded++;
+        response = overloadedResponse();
+        return false;
+    }
+
+    if (limits.concurrency > 0 && func.inFlight >= limits.concurrency) {
+        func.throttled++;
+        response = rejectResponse(kStatusThrottled, "Too many requests: funcid " + funcId +
+                                  " concurrency limit (" + std::to_string(limits.concurrency) + ") reached", 0);
+        return false;
+    }
+
+    int64_t wait = 0;
+    if (limits.rate > 0) {
+        wait = takeToken(func.tokens, func.refilled, limits.rate, limits.burst, now);
+        if (wait > 0) {
+            func.throttled++;
+            response = rejectResponse(kStatusThrottled, "Too many requests: funcid " + funcId +
+                                      " rate limit exceeded", wait);
+            return false;
+        }
+    }
+
+    ClientState* state = nullptr;
+    if (tracksClients()) {
+        if (clients.size() >= sweepAt) {
+            sweepClients(now);
+        }
+        auto found = clients.find(client);
+        if (found == clients.end()) {
+            found = clients.emplace(client, ClientState()).first;
+            found->second.tokens = clientBurst;
+            found->second.refilled = now;
+        }
+        state = &found->second;
+        if (clientConcurrency > 0 && state->inFlight >= clientConcurrency) {
+            wait = -1;
+            response = rejectResponse(kStatusThrottled, "Too many requests: client concurrency limit (" +
+                                      std::to_string(clientConcurrency) + ") reached", 0);
+        } else if (clientRate > 0) {
+            wait = takeToken(state->tokens, state->refilled, clientRate, clientBurst, now);
+            if (wait > 0) {
+                response = rejectResponse(kStatusThrottled, "Too many requests: client rate limit exceeded", wait);
+            }
+        }
+        if (wait != 0) {
+            // 被客户端限制拒绝的请求不消耗功能号的令牌
+            if (limits.rate > 0) {
+                func.tokens += 1;
+            }
+            clientThrottled++;
+            return false;
+        }
+    }
+
+    func.inFlight++;
+    func.admitted++;
+    if (state) {
+        state->inFlight++;
+    }
+    ticket.owner = this;
+    ticket.func = &func;
+    ticket.client = client;
+    ticket.priority = limits.priority;
+    return true;
+}
+
+bool AdmissionControl::isIdle(const ClientState& state, uint64_t now) const {
+    if (state.inFlight > 0) {
+        return false;
+    }
+    if (clientRate == 0) {
+        return true;
+    }
+    uint64_t elapsed = now > state.refilled ? now - state.refilled : 0;
+    double tokens = state.tokens + static_cast<double>(elapsed) * clientRate / 1e9;
+    return tokens >= clientBurst;
+}
+
+void AdmissionControl::sweepClients(uint64_t now) {
+    for (auto it = clients.begin(); it != clients.end(); ) {
+        if (isIdle(it->second, now)) {
+            it = clients.erase(it);
+        } else {
+            ++it;
+        }
+    }
+    sweepAt = clients.size() * 2 > kMinSweepAt ? clients.size() * 2 : kMinSweepAt;
+}
+
+void AdmissionControl::release(Ticket& ticket) {
+    if (!ticket.owner) {
+        return;
+    }
+    std::lock_guard<std::mutex> lock(mutex);
+    ticket.func->inFlight--;
+    if (tracksClients()) {
+        auto found = clients.find(ticket.client);
+        if (found != clients.end()) {
+            found->second.inFlight--;
+            // 令牌桶已满的空闲客户端与新建的状态相同，删掉不影响限流
+            if (isIdle(found->second, Metrics::now())) {
+                clients.erase(found);
+            }
+        }
+    }
+    ticket.owner = nullptr;
+}
+
+void AdmissionControl::writeStats(JsonWriter& writer) {
+    WorkerPool::Stats queues;
+    workers->getStats(queues);
+
+    std::lock_guard<std::mutex> lock(mutex);
+    writer.beginObject();
+    writer.key("queues").beginObject();
+    for (int p = 0; p < PRIORITY_COUNT; p++) {
+        writer.key(kPriorityNames[p]).beginObject();
+        writer.key("depth").value(static_cast<int64_t>(queues.queued[p]));
+        writer.key("overloaded").value(static_cast<int64_t>(queues.overloaded[p]));
+        if (p == PRIORITY_LOW) {
+            writer.key("running").value(static_cast<int64_t>(queues.runningLow));
+        }
+        writer.endObject();
+    }
+    writer.endObject();
+
+    uint64_t throttled = clientThrottled;
+    uint64_t overloaded = 0;
+    writer.key("funcs").beginObject();
+    auto writeFunc = [&writer, &throttled, &overloaded](const std::string& name, const FuncState& state) {
+        throttled += state.throttled;
+        overloaded += state.overloaded;
+        writer.key(name).beginObject();
+        writer.key("priority").value(std::string(kPriorityNames[state.limits.priority]));
+        writer.key("in_flight").value(static_cast<int64_t>(state.inFlight));
+        writer.key("admitted").value(static_cast<int64_t>(state.admitted));
+        writer.key("throttled").value(static_cast<int64_t>(state.throttled));
+        writer.key("overloaded").value(static_cast<int64_t>(state.overloaded));
+        writer.endObject();
+    };
+    for (const auto& entry : funcs) {
+        writeFunc(entry.first, entry.second);
+    }
+    writeFunc("other", other);
+    writer.endObject();
+
+    writer.key("clients").value(static_cast<int64_t>(clients.size()));
+    writer.key("rejected").beginObject();
+    writer.key("throttled").value(static_cast<int64_t>(throttled));
+    writer.key("client_throttled").value(static_cast<int64_t>(clientThrottled));
+    writer.key("overloaded").value(static_cast<int64_t>(overloaded));
+    writer.endObject();
+    writer.endObject();
+}
@@ -0,0 +1,127 @@
+#include "arena.h"
+#include <mutex>
+
+namespace {
+// 块头部按最大对齐取整，数据区满足任意基本类型的对齐
+const size_t kHeaderSize = (sizeof(void*) * 2 + alignof(std::max_align_t) - 1) & ~(alignof(std::max_align_t) - 1);
+
+std::mutex idleMutex;
+Arena* idleArenas = nullptr;
+size_t idleCount = 0;
+}
+
+Arena::Arena()
+    : blocks(nullptr)
+    , current(nullptr)
+    , large(nullptr)
+    , cursor(nullptr)
+    , limit(nullptr)
+    , finalizers(nullptr)
+    , nextIdle(nullptr)
+{
+}
+
+Arena::~Arena() {
+    reset();
+    while (blocks) {
+        Block* next = blocks->next;
+        ::operator delete(blocks);
+        blocks = next;
+    }
+}
+
+Arena* Arena::acquire() {
+    {
+        std::lock_guard<std::mutex> lock(idleMutex);
+        if (idleArenas) {
+            Arena* arena = idleArenas;
+            idleArenas = arena->nextIdle;
+            idleCount--;
+            arena->nextIdle = nullptr;
+            return arena;
+        }
+    }
+    return new Arena();
+}
+
+void Arena::release() {
+    reset();
+    {
+        std::lock_guard<std::mutex> lock(idleMutex);
+        if (idleCount < kMaxIdleArenas) {
+            nextIdle = idleArenas;
+            idleArenas = this;
+            idleCount++;
+            return;
+        }
+    }
+    delete this;
+}
+
+Arena::Block* Arena::newBlock(size_t size) {
+    Block* block = static_cast<Block*>(::operator new(kHeaderSize + size));
+    block->next = nullptr;
+    block->size = size;
+    return block;
+}
+
+char* Arena::dataOf(Block* block) {
+    return reinterpret_cast<char*>(block) + kHeaderSize;
+}
+
+void* Arena::allocateSlow(size_t size, size_t align) {
+    if (size + align > kBlockSize) {
+        Block* block = newBlock(size + align);
+        block->next = large;
+        large = block;
+        uintptr_t data = reinterpret_cast<uintptr_t>(dataOf(block));
+        return reinterpret_cast<void*>((data + align - 1) & ~(uintptr_t)(align - 1));
+    }
+
+    // 当前块剩余空间不够：换到下一个保留的块，没有时新申请一块
+    Block* next = current ? current->next : blocks;
+    if (!next) {
+        next = newBlock(kBlockSize);
+        if (current) {
+            current->next = next;
+        } else {
+            blocks = next;
+        }
+    }
+    current = next;
+    cursor = dataOf(next);
+    limit = cursor + next->size;
+    return allocate(size, align);
+}
+
+void Arena::reset() {
+    // 登记顺序的逆序析构，后创建的对象可能引用先创建的
+    while (finalizers) {
+        Finalizer* finalizer = finalizers;
+        finalizers = finalizer->next;
+        finalizer->destroy(finalizer->object);
+    }
+    while (large) {
+        Block* next = large->next;
+        ::operator delete(large);
+        large = next;
+    }
+
+    Block* last = blocks;
+    for (size_t kept = 1; last && last->next && kept < kRetainedBlocks; kept++) {
+        last = last->next;
+    }
+    if (last) {
+        Block* extra = last->next;
+        last->next = nullptr;
+        while (extra) {
+            Block* next = extra->next;
+            ::operator delete(extra);
+            extra = next;
+        }
+    }
+
+    current = blocks;
+    cursor = blocks ? dataOf(blocks) : nullptr;
+    limit = blocks ? cursor + blocks->size : nullptr;
+}
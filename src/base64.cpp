@@ -0,0 +1,69 @@
+#include "base64.h"
+
+namespace {
+const char kAlphabet[] = "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/";
+
+int decodeChar(unsigned char c) {
+    if (c >= 'A' && c <= 'Z') return c - 'A';
+    if (c >= 'a' && c <= 'z') return c - 'a' + 26;
+    if (c >= '0' && c <= '9') return c - '0' + 52;
+    if (c == '+') return 62;
+    if (c == '/') return 63;
+    return -1;
+}
+}
+
+bool base64Decode(const char* input, size_t len, ArenaString& output) {
+    output.clear();
+    output.reserve(len / 4 * 3);
+
+    unsigned int acc = 0;
+    int bits = 0;
+    size_t padding = 0;
+    for (size_t i = 0; i < len; i++) {
+        unsigned char c = input[i];
+        if (c == ' ' || c == '\n' || c == '\r' || c == '\t') {
+            continue;
+        }
+        if (c == '=') {
+            padding++;
+            continue;
+        }
+        int v = decodeChar(c);
+        if (v < 0 || padding > 0) {
+            return false;   // 非法字符，或'='之后又出现数据
+        }
+        acc = (acc << 6) | static_cast<unsigned int>(v);
+        bits += 6;
+        if (bits >= 8) {
+            bits -= 8;
+            output.push_back(static_cast<char>((acc >> bits) & 0xff));
+        }
+    }
+    // 剩余不足一个字节的位必须是补齐的0
+    return padding <= 2 && bits < 6 && (acc & ((1u << bits) - 1)) == 0;
+}
+
+void base64Encode(const char* data, size_t len, std::string& output) {
+    const unsigned char* p = reinterpret_cast<const unsigned char*>(data);
+    output.reserve(output.size() + (len + 2) / 3 * 4);
+
+    size_t i = 0;
+    for (; i + 3 <= len; i += 3) {
+        unsigned int v = (p[i] << 16) | (p[i + 1] << 8) | p[i + 2];
+        output.push_back(kAlphabet[(v >> 18) & 63]);
+        output.push_back(kAlphabet[(v >> 12) & 63]);
+        output.push_back(kAlphabet[(v >> 6) & 63]);
+        output.push_back(kAlphabet[v & 63]);
+    }
+    if (i < len) {
+        unsigned int v = p[i] << 16;
+        if (i + 1 < len) {
+            v |= p[i + 1] << 8;
+        }
+        output.push_back(kAlphabet[(v >> 18) & 63]);
+        output.push_back(kAlphabet[(v >> 12) & 63]);
+        output.push_back(i + 1 < len ? kAlphabet[(v >> 6) & 63] : '=');
+        output.push_back('=');
+    }
+}
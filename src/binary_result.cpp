@@ -0,0 +1,159 @@
+#include "binary_result.h"
+#include <sqlite3.h>
+#include <cstring>
+
+BinaryResult::ValueType BinaryResult::typeOf(int storageClass) {
+    switch (storageClass) {
+    case SQLITE_INTEGER: return TYPE_INTEGER;
+    case SQLITE_FLOAT:   return TYPE_FLOAT;
+    case SQLITE_TEXT:    return TYPE_TEXT;
+    case SQLITE_BLOB:    return TYPE_BLOB;
+    default:             return TYPE_NULL;
+    }
+}
+
+void BinaryResult::appendVarint(std::string& out, uint64_t value) {
+    char bytes[10];
+    size_t len = 0;
+    while (value >= 0x80) {
+        bytes[len++] = static_cast<char>((value & 0x7F) | 0x80);
+        value >>= 7;
+    }
+    bytes[len++] = static_cast<char>(value);
+    out.append(bytes, len);
+}
+
+void BinaryResult::appendSigned(std::string& out, int64_t value) {
+    // zigzag：绝对值小的负数也编码得短
+    uint64_t bits = static_cast<uint64_t>(value);
+    appendVarint(out, (bits << 1) ^ (value < 0 ? ~static_cast<uint64_t>(0) : 0));
+}
+
+void BinaryResult::appendDouble(std::string& out, double value) {
+    uint64_t bits;
+    std::memcpy(&bits, &value, sizeof(bits));
+    char bytes[8];
+    for (int i = 0; i < 8; i++) {
+        bytes[i] = static_cast<char>(bits >> (i * 8));
+    }
+    out.append(bytes, 8);
+}
+
+void BinaryResult::appendBytes(std::string& out, const char* data, size_t len) {
+    appendVarint(out, len);
+    out.append(data, len);
+}
+
+void BinaryResult::appendHeader(std::string& out, size_t columnCount) {
+    out.push_back(static_cast<char>(kMagic));
+    out.push_back(static_cast<char>(kVersion));
+    appendVarint(out, columnCount);
+}
+
+void BinaryResult::appendColumn(std::string& out, const char* name, size_t nameLen,
+                                const char* declType, size_t declTypeLen) {
+    appendBytes(out, name, nameLen);
+    appendBytes(out, declType, declTypeLen);
+}
+
+void BinaryResult::appendTrailer(std::string& out, int status, const char* msg, size_t msgLen,
+                                 const std::string& extra) {
+    appendVarint(out, 0);
+    appendSigned(out, status);
+    appendBytes(out, msg, msgLen);
+    appendBytes(out, extra.data(), extra.size());
+}
+
+void BinaryBatch::reset(size_t columnCount) {
+    this->columnCount = columnCount;
+    rows = 0;
+    column = 0;
+    types.assign(columnCount, BinaryResult::TYPE_NULL);
+    nulls.clear();
+    values.clear();
+}
+
+void BinaryBatch::beginValue(BinaryResult::ValueType type) {
+    uint8_t& columnType = types[column];
+    if (columnType == BinaryResult::TYPE_NULL) {
+        columnType = type;
+    } else if (columnType != type) {
+        columnType = BinaryResult::TYPE_MIXED;
+    }
+    values.push_back(static_cast<char>(type));
+    column++;
+}
+
+void BinaryBatch::addNull() {
+    size_t bit = rows * columnCount + column;
+    if (bit / 8 >= nulls.size()) {
+        nulls.resize(bit / 8 + 1, '\0');
+    }
+    nulls[bit / 8] = static_cast<char>(nulls[bit / 8] | (1 << (bit % 8)));
+    column++;
+}
+
+void BinaryBatch::addInteger(int64_t value) {
+    beginValue(BinaryResult::TYPE_INTEGER);
+    BinaryResult::appendSigned(values, value);
+}
+
+void BinaryBatch::addReal(double value) {
+    beginValue(BinaryResult::TYPE_FLOAT);
+    BinaryResult::appendDouble(values, value);
+}
+
+void BinaryBatch::addText(const char* data, size_t len) {
+    beginValue(BinaryResult::TYPE_TEXT);
+    BinaryResult::appendBytes(values, data, len);
+}
+
+void BinaryBatch::addBlob(const char* data, size_t len) {
+    beginValue(BinaryResult::TYPE_BLOB);
+    BinaryResult::appendBytes(values, data, len);
+}
+
+void BinaryBatch::flush(std::string& out) {
+    if (rows == 0) {
+        return;
+    }
+    BinaryResult::appendVarint(out, rows);
+    out.append(reinterpret_cast<const char*>(types.data()), types.size());
+    nulls.resize((rows * columnCount + 7) / 8, '\0');
+    out.append(nulls);
+
+    // 逐个值复制，只有类型混合的列保留类型字节
+    const char* data = values.data();
+    size_t pos = 0;
+    size_t bit = 0;
+    for (size_t row = 0; row < rows; row++) {
+        for (size_t col = 0; col < columnCount; col++, bit++) {
+            if (nulls[bit / 8] & (1 << (bit % 8))) {
+                continue;
+            }
+            uint8_t type = static_cast<uint8_t>(data[pos++]);
+            if (types[col] == BinaryResult::TYPE_MIXED) {
+                out.push_back(static_cast<char>(type));
+            }
+            size_t start = pos;
+            if (type == BinaryResult::TYPE_INTEGER) {
+                while (static_cast<uint8_t>(data[pos++]) & 0x80) {
+                }
+            } else if (type == BinaryResult::TYPE_FLOAT) {
+                pos += 8;
+            } else {
+                uint64_t len = 0;
+                int shift = 0;
+                uint8_t byte;
+                do {
+                    byte = static_cast<uint8_t>(data[pos++]);
+                    len |= static_cast<uint64_t>(byte & 0x7F) << shift;
+                    shift += 7;
+                } while (byte & 0x80);
+                pos += static_cast<size_t>(len);
+            }
+            out.append(data + start, pos - start);
+        }
+    }
+    reset(columnCount);
+}
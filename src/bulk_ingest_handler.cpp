@@ -0,0 +1,340 @@
+#include "bulk_ingest_handler.h"
+#include "connection.h"
+#include "json_writer.h"
+#include "metrics.h"
+#include <cstdlib>
+#include <limits>
+
+BulkIngestHandler::BulkIngestHandler(std::shared_ptr<WorkerPool> workers)
+    : workers(workers)
+{
+}
+
+std::string BulkIngestHandler::errorResponse(const std::string& msg) {
+    std::string out;
+    JsonWriter writer(out);
+    writer.beginObject();
+    writer.key("status").value(-1);
+    writer.key("msg").value(msg);
+    writer.endObject();
+    return out;
+}
+
+void BulkIngestHandler::appendIdentifier(std::string& out, const std::string& name) {
+    out.push_back('"');
+    for (char c : name) {
+        if (c == '"') {
+            out.push_back('"');
+        }
+        out.push_back(c);
+    }
+    out.push_back('"');
+}
+
+bool BulkIngestHandler::parseRequest(const RequestView& view, Connection& conn,
+                                     BulkRequest& request, std::string& error) {
+    request.session = conn.session;
+    if (!request.session) {
+        error = errorResponse("Database connection not initialized");
+        return false;
+    }
+
+    view.getString("table", request.table);
+
+    if (view.getType("columns") == RequestView::ARRAY) {
+        Json::Value columns;
+        view.getJson("columns", columns);
+        for (Json::ArrayIndex i = 0; i < columns.size(); i++) {
+            if (!columns[i].isString() || columns[i].asString().empty()) {
+                error = errorResponse("columns must be an array of non-empty strings");
+                return false;
+            }
+            request.columns.push_back(columns[i].asString());
+        }
+    } else if (view.hasField("columns")) {
+        error = errorResponse("columns must be an array of non-empty strings");
+        return false;
+    }
+
+    bool hasRows = view.hasField("rows");
+    bool hasData = view.hasField("data");
+    if (hasRows == hasData) {
+        error = errorResponse(hasRows ? "rows and data are mutually exclusive" : "Missing rows or data in request");
+        return false;
+    }
+    if (hasRows) {
+        if (view.getType("rows") != RequestView::ARRAY) {
+            error = errorResponse("rows must be an array");
+            return false;
+        }
+        request.format = RowDecoder::JSON;
+        request.hasFormat = true;
+        view.getRaw("rows", request.data);
+    } else {
+        if (view.getType("data") != RequestView::STRING) {
+            error = errorResponse("data must be a string");
+            return false;
+        }
+        view.getString("data", request.data);
+        std::string format;
+        if (view.getString("format", format)) {
+            if (format == "csv") {
+                request.format = RowDecoder::CSV;
+            } else if (format == "ndjson") {
+                request.format = RowDecoder::NDJSON;
+            } else {
+                error = errorResponse("format must be \"csv\" or \"ndjson\"");
+                return false;
+            }
+            request.hasFormat = true;
+        } else if (!request.table.empty()) {
+            error = errorResponse("format is required with data");
+            return false;
+        }
+    }
+
+    std::string text;
+    if (view.getString("header", text)) {
+        request.header = text == "true";
+    }
+    request.batchSize = kDefaultBatchSize;
+    if (view.getString("batchsize", text)) {
+        long long size = std::atoll(text.c_str());
+        if (size <= 0) {
+            error = errorResponse("batchsize must be a positive integer");
+            return false;
+        }
+        request.batchSize = static_cast<size_t>(size);
+    }
+    if (view.getString("onconflict", text) && text != "abort") {
+        if (text != "ignore" && text != "replace") {
+            error = errorResponse("onconflict must be \"abort\", \"ignore\" or \"replace\"");
+            return false;
+        }
+        request.conflict = text == "ignore" ? "IGNORE" : "REPLACE";
+    }
+    if (view.getString("more", text)) {
+        request.more = text == "true";
+    }
+    return true;
+}
+
+std::shared_ptr<BulkLoad> BulkIngestHandler::startLoad(BulkRequest& request, RowDecoder& decoder,
+                                                        std::string& error) {
+    if (request.header) {
+        if (request.format != RowDecoder::CSV) {
+            error = "header is only supported with csv data";
+            return nullptr;
+        }
+        if (!decoder.readHeader()) {
+            error = "Invalid CSV header: " + decoder.getError();
+            return nullptr;
+        }
+    }
+    if (decoder.getColumns().empty()) {
+        error = "Missing columns in request";
+        return nullptr;
+    }
+
+    std::shared_ptr<BulkLoad> load = std::make_shared<BulkLoad>();
+    load->table = request.table;
+    load->columns = decoder.getColumns();
+    load->format = request.format;
+    load->batchSize = request.batchSize;
+    load->started = Metrics::now();
+
+    load->sql = request.conflict.empty() ? "INSERT INTO " : "INSERT OR " + request.conflict + " INTO ";
+    appendIdentifier(load->sql, load->table);
+    load->sql.push_back('(');
+    for (size_t i = 0; i < load->columns.size(); i++) {
+        if (i > 0) {
+            load->sql += ", ";
+        }
+        appendIdentifier(load->sql, load->columns[i]);
+    }
+    load->sql += ") VALUES(";
+    for (size_t i = 0; i < load->columns.size(); i++) {
+        load->sql += i > 0 ? ", ?" : "?";
+    }
+    load->sql.push_back(')');
+    return load;
+}
+
+std::string BulkIngestHandler::execute(BulkRequest& request, const ResponseStream& stream) {
+    DbSession& session = *request.session;
+    std::shared_ptr<BulkLoad> load = session.getBulkLoad();
+
+    // 第一帧建立导入状态；延续帧沿用会话上的状态，格式必须一致
+    std::unique_ptr<RowDecoder> decoder;
+    if (!request.table.empty()) {
+        if (load) {
+            session.setBulkLoad(nullptr);
+            return errorResponse("Previous bulk load was not finished (last frame must not set more)");
+        }
+        decoder.reset(new RowDecoder(request.format, request.columns));
+        decoder->reset(request.data.data(), request.data.size());
+        std::string error;
+        load = startLoad(request, *decoder, error);
+        if (!load) {
+            return errorResponse(error);
+        }
+    } else {
+        if (!load) {
+            return errorResponse("No bulk load in progress; table is required");
+        }
+        bool textData = load->format != RowDecoder::JSON;
+        if ((request.hasFormat && request.format != load->format) ||
+            (!request.hasFormat && !textData)) {
+            session.setBulkLoad(nullptr);
+            return errorResponse("Continuation frame must use the same format as the first frame");
+        }
+        decoder.reset(new RowDecoder(load->format, load->columns));
+        decoder->reset(request.data.data(), request.data.size());
+    }
+    // 本帧结束后没有后续帧，或者出错时结束导入
+    session.setBulkLoad(nullptr);
+
+    SqlitePool::Lease lease;
+    std::string leaseError;
+    if (!session.acquire(false, lease, leaseError, stream.getDeadline())) {
+        return errorResponse(leaseError);
+    }
+    Sqlite3Handler* db = lease.get();
+
+    // 客户端自己开启了事务时写在该事务里，不分批提交
+    bool ownsTransaction = !db->inTransaction();
+    size_t batchSize = ownsTransaction ? load->batchSize : std::numeric_limits<size_t>::max();
+
+    std::vector<SqlValue> row;
+    uint64_t decoded = 0;           // 本帧已解码的行数
+    bool decodeFailed = false;
+    std::string bindError;
+    auto bindRow = [&](sqlite3_stmt* stmt) {
+        RowDecoder::Result result = decoder->next(row);
+        if (result != RowDecoder::ROW) {
+            decodeFailed = result == RowDecoder::ERROR;
+            return false;
+        }
+        decoded++;
+        for (size_t i = 0; i < row.size(); i++) {
+            if (SqlParams::bindValue(stmt, static_cast<int>(i + 1), row[i]) != SQLITE_OK) {
+                bindError = sqlite3_errmsg(sqlite3_db_handle(stmt));
+                return false;
+            }
+        }
+        return true;
+    };
+
+    uint64_t written = 0;           // 本帧已提交（客户端事务中为已写入）的行数
+    std::string failure;
+    int64_t failedRow = -1;
+    {
+        // 超过截止时间时中止当前批次（已提交的批次保留）；归还连接前清除
+        Sqlite3Handler::InterruptScope interrupt(*db, stream.getDeadlineFlag());
+        while (true) {
+            if (ownsTransaction && !db->beginTransaction()) {
+                failure = "Failed to begin transaction: " + db->getLastError();
+                break;
+            }
+            size_t executed = 0;
+            bool ok = db->executeBatch(load->sql, batchSize, bindRow, executed);
+            if (!ok || decodeFailed || !bindError.empty()) {
+                if (decodeFailed) {
+                    failedRow = static_cast<int64_t>(load->rows + decoded);
+                    failure = decoder->getError();
+                } else if (!bindError.empty()) {
+                    failedRow = static_cast<int64_t>(load->rows + decoded - 1);
+                    failure = bindError;
+                } else if (decoded > 0) {
+                    failedRow = static_cast<int64_t>(load->rows + decoded - 1);
+                    failure = db->getLastError();
+                } else {
+                    failure = db->getLastError();   // prepare失败，如表或列不存在
+                }
+                if (ownsTransaction) {
+                    db->rollback();
+                } else {
+                    written += executed;
+                }
+                break;
+            }
+            if (ownsTransaction && !db->commitTransaction()) {
+                failure = "Failed to commit transaction: " + db->getLastError();
+                db->rollback();
+                break;
+            }
+            written += executed;
+            if (ownsTransaction && executed > 0) {
+                load->batches++;
+            }
+            if (executed < batchSize) {
+                break;
+            }
+        }
+    }
+    session.release(lease);
+    load->rows += written;
+
+    std::string out;
+    JsonWriter writer(out);
+    writer.beginObject();
+    if (!failure.empty()) {
+        writer.key("status").value(-1);
+        if (failedRow >= 0) {
+            writer.key("msg").value("Row " + std::to_string(failedRow) + ": " + failure);
+            writer.key("row").value(failedRow);
+        } else {
+            writer.key("msg").value(failure);
+        }
+        writer.key("committed").value(static_cast<int64_t>(load->rows));
+    } else {
+        writer.key("status").value(0);
+        writer.key("rows").value(static_cast<int64_t>(load->rows));
+        writer.key("batches").value(static_cast<int64_t>(load->batches));
+        if (request.more) {
+            writer.key("msg").value(std::string("Bulk load in progress"));
+            session.setBulkLoad(load);
+        } else {
+            double seconds = static_cast<double>(Metrics::now() - load->started) / 1e9;
+            writer.key("msg").value(std::string("Bulk load successful"));
+            writer.key("elapsed_ms").value(seconds * 1000);
+            writer.key("rows_per_sec").value(seconds > 0 ? static_cast<double>(load->rows) / seconds : 0.0);
+        }
+    }
+    writer.endObject();
+    return out;
+}
+
+void BulkIngestHandler::handleAsync(const RequestView& view, Connection& conn,
+                                    const std::shared_ptr<ResponseStream>& stream) {
+    // 请求字段在Reactor线程上拷贝出来，解码和写入在工作线程上进行
+    std::shared_ptr<BulkRequest> request = std::make_shared<BulkRequest>();
+    std::string error;
+    if (!parseRequest(view, conn, *request, error)) {
+        stream->send(error);
+        return;
+    }
+
+    uint64_t queued = Metrics::now();
+    WorkerPool::Task task = [this, request, stream, queued]() {
+        Metrics::recordPhase(Metrics::DISPATCH, Metrics::now() - queued);
+        if (stream->isExpired() || WorkerPool::shouldShed()) {
+            request->session->setBulkLoad(nullptr);
+            stream->send(stream->isExpired() ? errorResponse(Sqlite3Handler::kDeadlineExceeded)
+                                             : AdmissionControl::overloadedResponse());
+            return;
+        }
+        try {
+            stream->send(execute(*request, *stream));
+        } catch (const std::exception& e) {
+            stream->send(errorResponse(std::string("Exception occurred: ") + e.what()));
+        }
+    };
+
+    // 与其他写请求一起在数据库的写串行队列中执行；会话持有跨请求事务时直接执行
+    if (request->session->hasPinnedConnection()) {
+        workers->submit(task, stream->getPriority());
+    } else {
+        request->session->getPool().getWriteQueue().post(*workers, task, stream->getPriority());
+    }
+}
@@ -0,0 +1,22 @@
+#include "connection.h"
+#include <sys/socket.h>
+#include <netinet/in.h>
+#include <arpa/inet.h>
+
+void Connection::setPeer(const struct sockaddr_in& addr) {
+    clientAddr = addr.sin_addr.s_addr;
+    char ip[INET_ADDRSTRLEN];
+    inet_ntop(AF_INET, &(addr.sin_addr), ip, INET_ADDRSTRLEN);
+    peer = "Client[" + std::to_string(fd) + ": " + ip + ":" + std::to_string(ntohs(addr.sin_port)) + "]";
+}
+
+void Connection::resolvePeer() {
+    struct sockaddr_in addr;
+    socklen_t addrLen = sizeof(addr);
+    if (getpeername(fd, (struct sockaddr*)&addr, &addrLen) == 0 && addr.sin_family == AF_INET) {
+        setPeer(addr);
+        return;
+    }
+    clientAddr = 0;
+    peer = "Client[" + std::to_string(fd) + "]";
+}
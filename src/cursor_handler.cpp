@@ -0,0 +1,234 @@
+#include "cursor_handler.h"
+#include "connection.h"
+#include "sql_lexer.h"
+#include "json_writer.h"
+#include "metrics.h"
+#include <cstdlib>
+
+CursorHandler::CursorHandler(std::shared_ptr<WorkerPool> workers, size_t maxPerConnection, int idleTimeoutMs)
+    : workers(workers)
+    , maxPerConnection(maxPerConnection)
+    , idleTimeoutNs(static_cast<uint64_t>(idleTimeoutMs > 0 ? idleTimeoutMs : kDefaultIdleTimeoutMs) * 1000000)
+{
+}
+
+std::string CursorHandler::errorResponse(const std::string& msg) {
+    std::string out;
+    JsonWriter writer(out);
+    writer.beginObject();
+    writer.key("status").value(-1);
+    writer.key("msg").value(msg);
+    writer.endObject();
+    return out;
+}
+
+bool CursorHandler::parseCommon(const RequestView& view, Connection& conn, bool needCursor,
+                                CursorRequest& request, std::string& error) {
+    request.session = conn.session;
+    if (!request.session) {
+        error = errorResponse("Database connection not initialized");
+        return false;
+    }
+
+    std::string text;
+    if (needCursor) {
+        if (!view.getString("cursor", text) || std::atoll(text.c_str()) <= 0) {
+            error = errorResponse("Missing or invalid cursor in request");
+            return false;
+        }
+        request.cursorId = static_cast<uint64_t>(std::atoll(text.c_str()));
+    }
+    if (view.getString("count", text)) {
+        long long count = std::atoll(text.c_str());
+        // 打开时可以只执行不取行；读取时至少一行
+        if (count < 0 || (count == 0 && needCursor)) {
+            error = errorResponse("count must be a positive integer");
+            return false;
+        }
+        request.count = static_cast<size_t>(count);
+    }
+    return true;
+}
+
+void CursorHandler::handleOpen(const RequestView& view, Connection& conn,
+                               const std::shared_ptr<ResponseStream>& stream) {
+    std::shared_ptr<CursorRequest> request = std::make_shared<CursorRequest>();
+    std::string error;
+    if (!parseCommon(view, conn, false, *request, error)) {
+        stream->send(error);
+        return;
+    }
+
+    if (!view.getString("sqlstr", request->sql) || request->sql.empty()) {
+        stream->send(errorResponse("Missing sqlstr in request"));
+        return;
+    }
+    // 游标只用于单条只读查询：写语句不能在只读连接上执行，也不该跨请求挂着
+    SqlLexer lexer(request->sql.data(), request->sql.size());
+    SqlLexer::Statement statement;
+    if (!lexer.next(statement)) {
+        stream->send(errorResponse("No valid SQL statements"));
+        return;
+    }
+    SqlLexer::Statement extra;
+    if (lexer.next(extra)) {
+        stream->send(errorResponse("Cursor requires a single SQL statement"));
+        return;
+    }
+    if (!SqlLexer::isReadOnly(statement.kind)) {
+        stream->send(errorResponse("Cursor requires a read-only query"));
+        return;
+    }
+
+    std::string paramError;
+    if (!request->params.parse(view, "params", paramError)) {
+        stream->send(errorResponse("Invalid params: " + paramError));
+        return;
+    }
+
+    uint64_t queued = Metrics::now();
+    workers->submit([this, request, stream, queued]() {
+        Metrics::recordPhase(Metrics::DISPATCH, Metrics::now() - queued);
+        open(*request, *stream);
+    }, stream->getPriority());
+}
+
+void CursorHandler::handleFetch(const RequestView& view, Connection& conn,
+                                const std::shared_ptr<ResponseStream>& stream) {
+    std::shared_ptr<CursorRequest> request = std::make_shared<CursorRequest>();
+    std::string error;
+    if (!parseCommon(view, conn, true, *request, error)) {
+        stream->send(error);
+        return;
+    }
+
+    uint64_t queued = Metrics::now();
+    workers->submit([this, request, stream, queued]() {
+        Metrics::recordPhase(Metrics::DISPATCH, Metrics::now() - queued);
+        fetch(*request, *stream);
+    }, stream->getPriority());
+}
+
+std::string CursorHandler::handleClose(const RequestView& view, Connection& conn) {
+    CursorRequest request;
+    std::string error;
+    if (!parseCommon(view, conn, true, request, error)) {
+        return error;
+    }
+    if (!request.session->removeCursor(request.cursorId)) {
+        return errorResponse("Cursor " + std::to_string(request.cursorId) + " not found (closed or expired)");
+    }
+
+    std::string out;
+    JsonWriter writer(out);
+    writer.beginObject();
+    writer.key("status").value(0);
+    writer.key("msg").value(std::string("Cursor closed"));
+    writer.key("cursor").value(static_cast<int64_t>(request.cursorId));
+    writer.endObject();
+    return out;
+}
+
+void CursorHandler::open(CursorRequest& request, ResponseStream& stream) {
+    if (stream.isExpired()) {
+        stream.send(errorResponse(Sqlite3Handler::kDeadlineExceeded));
+        return;
+    }
+    if (WorkerPool::shouldShed()) {
+        stream.send(AdmissionControl::overloadedResponse());
+        return;
+    }
+    DbSession& session = *request.session;
+    if (session.getCursorCount() >= maxPerConnection) {
+        stream.send(errorResponse("Too many open cursors on this connection (limit " +
+                                  std::to_string(maxPerConnection) + ")"));
+        return;
+    }
+
+    std::shared_ptr<Cursor> cursor = std::make_shared<Cursor>();
+    try {
+        std::string error;
+        if (!session.getPool().acquireCursorReader(cursor->lease, error)) {
+            stream.send(errorResponse(error));
+            return;
+        }
+        cursor->params = std::move(request.params);
+        const SqlParams* bound = cursor->params.empty() ? nullptr : &cursor->params;
+        {
+            Sqlite3Handler::InterruptScope interrupt(*cursor->lease.get(), stream.getDeadlineFlag());
+            cursor->stmt = cursor->lease->openCursor(request.sql, bound);
+        }
+        if (!cursor->stmt) {
+            stream.send(errorResponse(cursor->lease->getLastError()));
+            return;
+        }
+    } catch (const std::exception& e) {
+        stream.send(errorResponse(std::string("Exception occurred: ") + e.what()));
+        return;
+    }
+
+    cursor->timeoutNs = idleTimeoutNs;
+    uint64_t id = session.addCursor(cursor);
+    fetchAndSend(session, id, std::move(cursor), request.count, stream);
+}
+
+void CursorHandler::fetch(CursorRequest& request, ResponseStream& stream) {
+    if (stream.isExpired()) {
+        stream.send(errorResponse(Sqlite3Handler::kDeadlineExceeded));
+        return;
+    }
+    if (WorkerPool::shouldShed()) {
+        stream.send(AdmissionControl::overloadedResponse());
+        return;
+    }
+    std::shared_ptr<Cursor> cursor = request.session->findCursor(request.cursorId);
+    if (!cursor) {
+        stream.send(errorResponse("Cursor " + std::to_string(request.cursorId) + " not found (closed or expired)"));
+        return;
+    }
+    fetchAndSend(*request.session, request.cursorId, std::move(cursor), request.count, stream);
+}
+
+void CursorHandler::fetchAndSend(DbSession& session, uint64_t id, std::shared_ptr<Cursor> cursor,
+                                 size_t count, ResponseStream& stream) {
+    ResultWriter::Sink sink;
+    if (stream.isChunked()) {
+        sink = [&stream](std::string& chunk) { return stream.write(chunk); };
+    }
+    ResultWriter writer(kStreamChunkSize, sink);
+    writer.setEncoding(session.getEncoding());
+    bool done = false;
+    bool ok = false;
+    std::string error;
+    try {
+        // 游标的连接在请求之间归游标所有，中止标记只在本次读取期间有效
+        Sqlite3Handler::InterruptScope interrupt(*cursor->lease.get(), stream.getDeadlineFlag());
+        ok = cursor->lease->fetchCursor(cursor->stmt, count, writer, done);
+        if (!ok) {
+            error = cursor->lease->getLastError();
+        }
+    } catch (const std::exception& e) {
+        error = std::string("Exception occurred: ") + e.what();
+    }
+    cursor->rows += writer.getRowCount();
+    cursor->lastUsed = Metrics::now();
+
+    // 读完或出错后游标不再可用，在响应发出前关闭并归还连接
+    bool closed = !ok || done;
+    if (closed) {
+        session.removeCursor(id);
+        cursor.reset();
+    }
+
+    std::string extra = "\"cursor\":";
+    JsonWriter::appendInteger(extra, static_cast<int64_t>(id));
+    extra += closed ? ",\"done\":true" : ",\"done\":false";
+    writer.setExtra(extra);
+    writer.end(ok ? 0 : -1, ok ? "Fetch successful" : error);
+
+    if (writer.hasFlushed()) {
+        stream.end(writer.getBuffer());
+    } else {
+        stream.send(writer.getSegments(), std::move(writer.getBuffer()));
+    }
+}
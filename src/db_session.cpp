@@ -0,0 +1,65 @@
+#include "db_session.h"
+#include "cursor_handler.h"
+
+DbSession::DbSession(std::shared_ptr<SqlitePool> pool, ResultEncoding encoding)
+    : pool(std::move(pool))
+    , encoding(encoding)
+    , nextCursorId(1)
+{
+}
+
+bool DbSession::acquire(bool readOnly, SqlitePool::Lease& lease, std::string& error, uint64_t deadline) {
+    // 会话上有进行中的事务时，所有语句都必须在同一个连接上执行
+    if (pinned) {
+        lease = std::move(pinned);
+        return true;
+    }
+    return readOnly ? pool->acquireReader(lease, error, deadline) : pool->acquireWriter(lease, error, deadline);
+}
+
+void DbSession::release(SqlitePool::Lease& lease) {
+    if (lease && lease.isWriter() && lease->inTransaction()) {
+        pinned = std::move(lease);
+        return;
+    }
+    lease.release();
+}
+
+uint64_t DbSession::addCursor(std::shared_ptr<Cursor> cursor) {
+    uint64_t id = nextCursorId++;
+    cursors[id] = std::move(cursor);
+    return id;
+}
+
+std::shared_ptr<Cursor> DbSession::findCursor(uint64_t id) const {
+    auto it = cursors.find(id);
+    return it != cursors.end() ? it->second : nullptr;
+}
+
+bool DbSession::removeCursor(uint64_t id) {
+    return cursors.erase(id) > 0;
+}
+
+size_t DbSession::closeIdleCursors(uint64_t now) {
+    size_t closed = 0;
+    for (auto it = cursors.begin(); it != cursors.end();) {
+        if (now - it->second->lastUsed >= it->second->timeoutNs) {
+            it = cursors.erase(it);
+            closed++;
+        } else {
+            ++it;
+        }
+    }
+    return closed;
+}
+
+uint64_t DbSession::nextCursorExpiry() const {
+    uint64_t next = 0;
+    for (const auto& entry : cursors) {
+        uint64_t expiry = entry.second->lastUsed + entry.second->timeoutNs;
+        if (next == 0 || expiry < next) {
+            next = expiry;
+        }
+    }
+    return next;
+}
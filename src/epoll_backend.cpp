@@ -0,0 +1,274 @@
+#include "epoll_backend.h"
+#include "reactor.h"
+#include "logger.h"
+#include <sys/socket.h>
+#include <netinet/in.h>
+#include <linux/errqueue.h>
+#include <unistd.h>
+#include <cstring>
+#include <errno.h>
+
+namespace {
+const int kMaxEvents = 256;
+const size_t kReadChunkSize = 64 * 1024;
+const int kMaxIov = 64;     // 一次sendmsg最多写出的段数
+const uint32_t kBaseEvents = EPOLLET | EPOLLRDHUP;
+}
+
+EpollBackend::EpollBackend(Reactor& reactor, size_t zerocopyThreshold)
+    : reactor(reactor)
+    , epollFd(-1)
+    , listenFd(-1)
+    , wakeFd(-1)
+    , timerFd(-1)
+    , zerocopyThreshold(zerocopyThreshold)
+    , events(kMaxEvents)
+    , ready(0)
+{
+}
+
+EpollBackend::~EpollBackend() {
+    if (epollFd >= 0) {
+        ::close(epollFd);
+    }
+}
+
+bool EpollBackend::init(int listenFd, int wakeFd, int timerFd, std::string& error) {
+    epollFd = epoll_create1(EPOLL_CLOEXEC);
+    if (epollFd < 0) {
+        error = std::string("epoll_create1 failed: ") + std::strerror(errno);
+        return false;
+    }
+    this->listenFd = listenFd;
+    this->wakeFd = wakeFd;
+    this->timerFd = timerFd;
+
+    int fds[] = { listenFd, wakeFd, timerFd };
+    for (int fd : fds) {
+        struct epoll_event ev;
+        ev.events = EPOLLIN;
+        ev.data.u64 = static_cast<uint64_t>(fd);
+        epoll_ctl(epollFd, EPOLL_CTL_ADD, fd, &ev);
+    }
+    return true;
+}
+
+bool EpollBackend::wait() {
+    ready = epoll_wait(epollFd, events.data(), static_cast<int>(events.size()), -1);
+    if (ready < 0) {
+        int err = errno;
+        ready = 0;
+        if (err == EINTR) {
+            return true;
+        }
+        LOG_ERROR("epoll_wait failed: " + std::string(std::strerror(err)));
+        return false;
+    }
+    return true;
+}
+
+void EpollBackend::dispatch() {
+    for (int i = 0; i < ready; i++) {
+        uint64_t token = events[i].data.u64;
+        uint32_t revents = events[i].events;
+        if (token == static_cast<uint64_t>(listenFd)) {
+            handleAccept();
+            continue;
+        }
+        if (token == static_cast<uint64_t>(wakeFd)) {
+            reactor.drainCompletions();
+            continue;
+        }
+        if (token == static_cast<uint64_t>(timerFd)) {
+            uint64_t expirations;
+            ssize_t n = read(timerFd, &expirations, sizeof(expirations));
+            (void)n;    // 只用来唤醒，到期的定时器在本批事件之后统一处理
+            continue;
+        }
+
+        // 同一批事件里，前面的处理可能已关闭该连接，fd还可能已被新接受的连接复用：
+        // 编号带着槽位代数，过期的事件在这里被丢弃
+        Connection* conn = reactor.connections.find(token);
+        if (conn && (revents & EPOLLERR) && conn->output.hasZerocopyPending()) {
+            reapZerocopy(*conn);
+            conn = reactor.connections.find(token);
+        }
+        if (conn && (revents & EPOLLOUT)) {
+            reactor.handleWrite(*conn);
+            conn = reactor.connections.find(token);
+        }
+        if (conn && (revents & (EPOLLIN | EPOLLRDHUP | EPOLLHUP | EPOLLERR))) {
+            handleRead(*conn);
+        }
+    }
+}
+
+void EpollBackend::handleAccept() {
+    // 监听socket为水平触发，这里一次取完所有已完成握手的连接；
+    // accept4直接得到非阻塞socket，TCP_NODELAY从监听socket继承
+    while (true) {
+        struct sockaddr_in clientAddr;
+        socklen_t clientAddrLen = sizeof(clientAddr);
+        int clientFd = accept4(listenFd, (struct sockaddr*)&clientAddr, &clientAddrLen,
+                               SOCK_NONBLOCK | SOCK_CLOEXEC);
+        if (clientFd < 0) {
+            if (errno != EAGAIN && errno != EWOULDBLOCK && errno != EINTR) {
+                LOG_ERROR("Accept failed: " + std::string(std::strerror(errno)));
+            }
+            return;
+        }
+        reactor.acceptConnection(clientFd, &clientAddr);
+    }
+}
+
+void EpollBackend::attach(Connection& conn) {
+    struct epoll_event ev;
+    ev.events = kBaseEvents | EPOLLIN;
+    ev.data.u64 = conn.id;
+    epoll_ctl(epollFd, EPOLL_CTL_ADD, conn.fd, &ev);
+    conn.events = ev.events;
+}
+
+void EpollBackend::handleRead(Connection& conn) {
+    // 输出积压时不读取：让内核接收缓冲区填满，由TCP窗口把压力传回客户端
+    if (!conn.readPaused && !receive(conn)) {
+        return;
+    }
+    reactor.handleInput(conn);
+}
+
+bool EpollBackend::receive(Connection& conn) {
+    if (conn.closeAfterFlush) {
+        return true;    // 对端已关闭写端，不会再有数据
+    }
+    // 边缘触发：必须一直读到EAGAIN，否则剩余数据不会再次触发事件
+    char buffer[kReadChunkSize];
+    while (true) {
+        ssize_t n = read(conn.fd, buffer, sizeof(buffer));
+        if (n > 0) {
+            reactor.received(conn, buffer, static_cast<size_t>(n));
+            continue;
+        }
+        if (n == 0) {
+            conn.closeAfterFlush = true;
+            return true;
+        }
+        if (errno == EINTR) {
+            continue;
+        }
+        if (errno == EAGAIN || errno == EWOULDBLOCK) {
+            return true;
+        }
+        LOG_ERROR(conn.getPeer() + " Read error: " + std::strerror(errno));
+        reactor.closeConnection(conn);
+        return false;
+    }
+}
+
+bool EpollBackend::send(Connection& conn) {
+    size_t sent = 0;
+    bool zerocopyAllowed = true;
+    while (!conn.output.empty()) {
+        struct iovec iov[kMaxIov];
+        size_t len = 0;
+        struct msghdr msg;
+        std::memset(&msg, 0, sizeof(msg));
+        msg.msg_iov = iov;
+        msg.msg_iovlen = static_cast<size_t>(conn.output.fill(iov, kMaxIov, len));
+        bool zerocopy = zerocopyAllowed && useZerocopy(conn, len);
+
+        ssize_t n = sendmsg(conn.fd, &msg, MSG_NOSIGNAL | (zerocopy ? MSG_ZEROCOPY : 0));
+        if (n > 0) {
+            conn.output.consume(static_cast<size_t>(n), zerocopy);
+            sent += n;
+            continue;
+        }
+        if (n < 0 && errno == EINTR) {
+            continue;
+        }
+        if (n < 0 && (errno == EAGAIN || errno == EWOULDBLOCK)) {
+            break;
+        }
+        if (n < 0 && errno == ENOBUFS && zerocopy) {
+            // 未取走的完成通知占满了socket的附加内存：这一轮改为普通发送
+            zerocopyAllowed = false;
+            continue;
+        }
+        LOG_ERROR(conn.getPeer() + " Write error: " + std::string(std::strerror(errno)));
+        reactor.closeConnection(conn);
+        return false;
+    }
+    reactor.sent(conn, sent);
+    return true;
+}
+
+bool EpollBackend::useZerocopy(Connection& conn, size_t len) {
+    if (zerocopyThreshold == 0 || len < zerocopyThreshold || conn.zerocopy == Connection::ZEROCOPY_OFF) {
+        return false;
+    }
+    if (conn.zerocopy == Connection::ZEROCOPY_UNTRIED) {
+        int one = 1;
+        conn.zerocopy = setsockopt(conn.fd, SOL_SOCKET, SO_ZEROCOPY, &one, sizeof(one)) == 0
+                        ? Connection::ZEROCOPY_ON : Connection::ZEROCOPY_OFF;
+    }
+    return conn.zerocopy == Connection::ZEROCOPY_ON;
+}
+
+void EpollBackend::reapZerocopy(Connection& conn) {
+    while (true) {
+        char control[128];
+        struct msghdr msg;
+        std::memset(&msg, 0, sizeof(msg));
+        msg.msg_control = control;
+        msg.msg_controllen = sizeof(control);
+        if (recvmsg(conn.fd, &msg, MSG_ERRQUEUE) < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            break;  // EAGAIN：通知已取完
+        }
+        for (struct cmsghdr* cmsg = CMSG_FIRSTHDR(&msg); cmsg; cmsg = CMSG_NXTHDR(&msg, cmsg)) {
+            if (!(cmsg->cmsg_level == SOL_IP && cmsg->cmsg_type == IP_RECVERR)) {
+                continue;
+            }
+            struct sock_extended_err err;
+            std::memcpy(&err, CMSG_DATA(cmsg), sizeof(err));
+            if (err.ee_origin != SO_EE_ORIGIN_ZEROCOPY || err.ee_errno != 0) {
+                continue;
+            }
+            // 内核仍然做了拷贝（如回环连接、网卡不支持）：零拷贝只剩通知的开销，该连接不再使用
+            if (err.ee_code & SO_EE_CODE_ZEROCOPY_COPIED) {
+                conn.zerocopy = Connection::ZEROCOPY_OFF;
+            }
+            conn.output.completeZerocopy(err.ee_info, err.ee_data);
+        }
+    }
+    // 通知到齐后，对端已关闭的连接可能正等着关闭
+    if (!conn.output.hasZerocopyPending()) {
+        reactor.handleWrite(conn);
+    }
+}
+
+void EpollBackend::updateInterest(Connection& conn) {
+    uint32_t wanted = kBaseEvents;
+    if (!conn.readPaused) {
+        wanted |= EPOLLIN;
+    }
+    if (conn.pendingOutput() > 0) {
+        wanted |= EPOLLOUT;
+    }
+    if (wanted == conn.events) {
+        return;
+    }
+
+    struct epoll_event ev;
+    ev.events = wanted;
+    ev.data.u64 = conn.id;
+    epoll_ctl(epollFd, EPOLL_CTL_MOD, conn.fd, &ev);
+    conn.events = wanted;
+}
+
+void EpollBackend::close(Connection& conn) {
+    epoll_ctl(epollFd, EPOLL_CTL_DEL, conn.fd, nullptr);
+    ::close(conn.fd);
+}
@@ -0,0 +1,108 @@
+#include "frame_codec.h"
+#include <cstring>
+
+FrameCodec::FrameCodec(Mode mode, size_t maxFrameSize)
+    : mode(mode)
+    , maxFrameSize(maxFrameSize)
+{
+}
+
+FrameCodec::Result FrameCodec::decode(const char* data, size_t len, size_t& consumed,
+                                      const char*& payload, size_t& payloadLen) {
+    if (mode == AUTO) {
+        if (len == 0) {
+            return NEED_MORE;
+        }
+        // JSON文本以'{'或空白开头；合理的长度前缀首字节必然是很小的值
+        char c = data[0];
+        mode = (c == '{' || c == ' ' || c == '\t' || c == '\r' || c == '\n') ? NEWLINE : LENGTH_PREFIXED;
+    }
+
+    if (mode == LENGTH_PREFIXED) {
+        if (len < 4) {
+            return NEED_MORE;
+        }
+        const unsigned char* p = reinterpret_cast<const unsigned char*>(data);
+        size_t frameLen = (static_cast<size_t>(p[0]) << 24) | (static_cast<size_t>(p[1]) << 16) |
+                          (static_cast<size_t>(p[2]) << 8) | static_cast<size_t>(p[3]);
+        if (frameLen > maxFrameSize) {
+            return FRAME_ERROR;
+        }
+        if (len - 4 < frameLen) {
+            return NEED_MORE;
+        }
+        payload = data + 4;
+        payloadLen = frameLen;
+        consumed = 4 + frameLen;
+        return FRAME;
+    }
+
+    // 换行分隔：跳过空行
+    size_t start = 0;
+    while (start < len && (data[start] == '\n' || data[start] == '\r')) {
+        start++;
+    }
+    const char* nl = static_cast<const char*>(std::memchr(data + start, '\n', len - start));
+    if (!nl) {
+        if (len - start > maxFrameSize) {
+            return FRAME_ERROR;
+        }
+        return NEED_MORE;
+    }
+    size_t end = nl - data;
+    consumed = end + 1;
+    if (end > start && data[end - 1] == '\r') {
+        end--;
+    }
+    if (end - start > maxFrameSize) {
+        return FRAME_ERROR;
+    }
+    payload = data + start;
+    payloadLen = end - start;
+    return FRAME;
+}
+
+void FrameCodec::encode(std::string& payload, OutputQueue& out) const {
+    std::vector<std::string> head;
+    encode(head, payload, out);
+}
+
+void FrameCodec::encode(std::vector<std::string>& head, std::string& payload, OutputQueue& out) const {
+    size_t total = payload.size();
+    for (const std::string& segment : head) {
+        total += segment.size();
+    }
+
+    if (mode == LENGTH_PREFIXED) {
+        uint32_t n = static_cast<uint32_t>(total);
+        char header[4] = {
+            static_cast<char>((n >> 24) & 0xff), static_cast<char>((n >> 16) & 0xff),
+            static_cast<char>((n >> 8) & 0xff), static_cast<char>(n & 0xff)
+        };
+        out.append(header, 4);
+        for (std::string& segment : head) {
+            out.take(segment);
+        }
+        out.take(payload);
+        return;
+    }
+
+    // 换行分隔：负载不以换行结尾时补一个（要在取走负载之前判断）
+    char last = 0;
+    if (!payload.empty()) {
+        last = payload[payload.size() - 1];
+    } else {
+        for (const std::string& segment : head) {
+            if (!segment.empty()) {
+                last = segment[segment.size() - 1];
+            }
+        }
+    }
+    for (std::string& segment : head) {
+        out.take(segment);
+    }
+    out.take(payload);
+    if (total == 0 || last != '\n') {
+        out.append("\n", 1);
+    }
+}
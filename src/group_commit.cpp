@@ -0,0 +1,186 @@
+#include "group_commit.h"
+#include "sqlite_pool.h"
+#include "metrics.h"
+#include <algorithm>
+#include <chrono>
+
+GroupCommit::GroupCommit(SqlitePool& pool, size_t maxBatch, int windowUs)
+    : pool(pool)
+    , maxBatch(maxBatch)
+    , windowNs(windowUs > 0 ? static_cast<uint64_t>(windowUs) * 1000 : 0)
+    , scheduled(false)
+{
+}
+
+void GroupCommit::submit(WorkerPool& workers, Work work, Done done, std::string buffer,
+                         TaskPriority priority, const std::atomic<bool>* expired, uint64_t deadline,
+                         ResultEncoding encoding) {
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        Entry entry;
+        entry.work = std::move(work);
+        entry.done = std::move(done);
+        entry.response = std::move(buffer);
+        entry.arrived = Metrics::now();
+        entry.priority = priority;
+        entry.expired = expired;
+        entry.deadline = deadline;
+        entry.encoding = encoding;
+        pending.push_back(std::move(entry));
+        if (pending.size() >= maxBatch) {
+            filled.notify_one();
+        }
+        if (scheduled) {
+            return;     // 已排队的取批任务会带上这个请求
+        }
+        scheduled = true;
+    }
+    pool.getWriteQueue().post(workers, [this, &workers]() { flush(workers); }, priority);
+}
+
+void GroupCommit::flush(WorkerPool& workers) {
+    batch.clear();
+    bool more = false;
+    TaskPriority next = PRIORITY_NORMAL;
+    {
+        std::unique_lock<std::mutex> lock(mutex);
+        if (pending.empty()) {
+            // 排队期间剩下的请求都已到期答复（answerExpired），下一个请求会重新安排取批
+            scheduled = false;
+            return;
+        }
+        if (windowNs > 0 && pending.size() < maxBatch) {
+            uint64_t waited = Metrics::now() - pending.front().arrived;
+            if (waited < windowNs) {
+                filled.wait_for(lock, std::chrono::nanoseconds(windowNs - waited),
+                                [this]() { return pending.size() >= maxBatch; });
+            }
+        }
+        size_t count = std::min(pending.size(), maxBatch);
+        batch.reserve(count);
+        std::move(pending.begin(), pending.begin() + count, std::back_inserter(batch));
+        pending.erase(pending.begin(), pending.begin() + count);
+        // 剩下的请求排到写串行队列末尾，不插在其他写请求前面
+        more = !pending.empty();
+        scheduled = more;
+        if (more) {
+            next = pending.front().priority;
+        }
+    }
+    if (more) {
+        pool.getWriteQueue().post(workers, [this, &workers]() { flush(workers); }, next);
+    }
+
+    SqlitePool::Lease lease;
+    std::string error;
+    bool acquired = false;
+    // 等待期间新到的请求只进入pending，不会唤醒这里，所以分段等待，每段之后清理一次到期的请求
+    uint64_t giveUp = Metrics::now() + static_cast<uint64_t>(pool.getLeaseTimeoutMs()) * 1000000;
+    while (!acquired) {
+        uint64_t deadline = answerExpired();
+        if (batch.empty()) {
+            return;
+        }
+        uint64_t now = Metrics::now();
+        if (now >= giveUp) {
+            error = SqlitePool::kWriterBusy;
+            break;
+        }
+        uint64_t limit = std::min(giveUp, now + kSweepIntervalNs);
+        acquired = pool.acquireWriter(lease, error, deadline > 0 ? std::min(deadline, limit) : limit);
+        if (!acquired && error != Sqlite3Handler::kDeadlineExceeded) {
+            break;
+        }
+    }
+    if (!acquired) {
+        // 与其他执行错误格式相同，按各请求会话的编码输出
+        for (Entry& entry : batch) {
+            entry.response.clear();
+            TableData::writeStatus(entry.response, -1, error.c_str(), entry.encoding);
+            entry.done(std::move(entry.response));
+        }
+        batch.clear();
+        return;
+    }
+
+    Sqlite3Handler* db = lease.get();
+    if (batch.size() == 1 || !runGrouped(db)) {
+        // 单个请求，或外层事务失败（修改已全部回滚）：逐个单独执行
+        for (Entry& entry : batch) {
+            entry.response.clear();
+            entry.work(db, entry.response);
+        }
+    }
+    lease.release();
+
+    for (Entry& entry : batch) {
+        entry.done(std::move(entry.response));
+    }
+    batch.clear();
+}
+
+uint64_t GroupCommit::answerExpired() {
+    uint64_t now = Metrics::now();
+    uint64_t earliest = 0;
+    std::vector<Entry> expired;
+    takeExpired(batch, now, expired, earliest);
+    {
+        // 排在后面的请求要等这一批拿到写连接后才会被取走，到期的不必陪着等
+        std::lock_guard<std::mutex> lock(mutex);
+        takeExpired(pending, now, expired, earliest);
+    }
+    for (Entry& entry : expired) {
+        entry.response.clear();
+        TableData::writeStatus(entry.response, -1, Sqlite3Handler::kDeadlineExceeded, entry.encoding);
+        entry.done(std::move(entry.response));
+    }
+    return earliest;
+}
+
+void GroupCommit::takeExpired(std::vector<Entry>& entries, uint64_t now,
+                              std::vector<Entry>& expired, uint64_t& earliest) {
+    size_t kept = 0;
+    for (size_t i = 0; i < entries.size(); i++) {
+        Entry& entry = entries[i];
+        if (entry.isExpired(now)) {
+            expired.push_back(std::move(entry));
+            continue;
+        }
+        if (entry.deadline > 0 && (earliest == 0 || entry.deadline < earliest)) {
+            earliest = entry.deadline;
+        }
+        if (kept != i) {
+            entries[kept] = std::move(entry);
+        }
+        kept++;
+    }
+    entries.erase(entries.begin() + kept, entries.end());
+}
+
+bool GroupCommit::runGrouped(Sqlite3Handler* db) {
+    if (!db->beginTransaction()) {
+        return false;
+    }
+    bool grouped = true;
+    for (Entry& entry : batch) {
+        if (!db->executeUpdate("SAVEPOINT group_commit;")) {
+            grouped = false;
+            break;
+        }
+        bool ok = entry.work(db, entry.response);
+        // 语句出错可能导致SQLite回滚整个事务，之前的请求也要重做
+        if (!db->inTransaction() ||
+            (!ok && !db->executeUpdate("ROLLBACK TO group_commit;")) ||
+            !db->executeUpdate("RELEASE group_commit;")) {
+            grouped = false;
+            break;
+        }
+    }
+    if (grouped && db->commitTransaction()) {
+        return true;
+    }
+    if (db->inTransaction()) {
+        db->rollback();
+    }
+    return false;
+}
@@ -0,0 +1,36 @@
+#include "io_backend.h"
+#include "epoll_backend.h"
+#include "uring_backend.h"
+#include "logger.h"
+#include <stdexcept>
+
+std::unique_ptr<IoBackend> IoBackend::create(IoBackendType type, Reactor& reactor,
+                                             int listenFd, int wakeFd, int timerFd,
+                                             size_t zerocopyThreshold) {
+    std::string error;
+    if (type == IO_BACKEND_IO_URING) {
+        std::unique_ptr<UringBackend> uring(new UringBackend(reactor));
+        if (uring->init(listenFd, wakeFd, timerFd, error)) {
+            return uring;
+        }
+        LOG_WARN("io_uring unavailable (" + error + "), falling back to epoll");
+    }
+
+    std::unique_ptr<EpollBackend> epoll(new EpollBackend(reactor, zerocopyThreshold));
+    if (!epoll->init(listenFd, wakeFd, timerFd, error)) {
+        throw std::runtime_error(error);
+    }
+    return epoll;
+}
+
+bool IoBackend::parseType(const std::string& name, IoBackendType& type) {
+    if (name == "epoll") {
+        type = IO_BACKEND_EPOLL;
+        return true;
+    }
+    if (name == "io_uring" || name == "uring") {
+        type = IO_BACKEND_IO_URING;
+        return true;
+    }
+    return false;
+}
@@ -0,0 +1,276 @@
+#include "json_scanner.h"
+#include "request_view.h"
+#include "base64.h"
+#include <cstring>
+#include <cstdlib>
+#include <cstdint>
+
+namespace {
+const int kMaxDepth = 64;
+
+inline bool isHex(char c) {
+    return (c >= '0' && c <= '9') || (c >= 'a' && c <= 'f') || (c >= 'A' && c <= 'F');
+}
+
+inline bool isDigit(char c) {
+    return c >= '0' && c <= '9';
+}
+}
+
+JsonScanner::JsonScanner(Arena* arena)
+    : p(nullptr)
+    , end(nullptr)
+    , scratch(ArenaAllocator<char>(arena))
+{
+}
+
+void JsonScanner::reset(const char* data, size_t size) {
+    p = data;
+    end = data + size;
+    error.clear();
+}
+
+void JsonScanner::skipSpace() {
+    while (p < end && (*p == ' ' || *p == '\t' || *p == '\n' || *p == '\r')) {
+        p++;
+    }
+}
+
+bool JsonScanner::parseValue(SqlValue& value) {
+    skipSpace();
+    if (p >= end) {
+        fail("unexpected end of input");
+        return false;
+    }
+    switch (*p) {
+    case '"':
+        value.type = SqlValue::TEXT;
+        return parseString(value.bytes);
+    case '{': {
+        // {"$blob": "<base64>"}
+        p++;
+        skipSpace();
+        if (p >= end || *p != '"' || !parseString(scratch) || scratch != "$blob") {
+            fail("unsupported value (expected number, string, bool, null or {\"$blob\": base64})");
+            return false;
+        }
+        skipSpace();
+        if (p >= end || *p != ':') {
+            fail("expected ':' after \"$blob\"");
+            return false;
+        }
+        p++;
+        skipSpace();
+        if (p >= end || *p != '"' || !parseString(scratch)) {
+            fail("$blob must be a base64 string");
+            return false;
+        }
+        skipSpace();
+        if (p >= end || *p != '}') {
+            fail("expected '}' after $blob");
+            return false;
+        }
+        p++;
+        value.type = SqlValue::BLOB;
+        if (!base64Decode(scratch.data(), scratch.size(), value.bytes)) {
+            fail("invalid base64 in $blob");
+            return false;
+        }
+        return true;
+    }
+    case 't':
+    case 'f':
+    case 'n': {
+        const char* word = *p == 't' ? "true" : (*p == 'f' ? "false" : "null");
+        size_t n = std::strlen(word);
+        if (static_cast<size_t>(end - p) < n || std::memcmp(p, word, n) != 0) {
+            fail("invalid literal");
+            return false;
+        }
+        p += n;
+        if (*word == 'n') {
+            value.type = SqlValue::NULL_VALUE;
+        } else {
+            value.type = SqlValue::INTEGER;
+            value.intValue = *word == 't' ? 1 : 0;
+        }
+        return true;
+    }
+    default:
+        return parseNumber(value);
+    }
+}
+
+bool JsonScanner::parseString(ArenaString& out) {
+    p++;
+    const char* start = p;
+    bool escaped = false;
+    while (true) {
+        if (p >= end) {
+            fail("unterminated string");
+            return false;
+        }
+        char c = *p;
+        if (c == '"') {
+            break;
+        }
+        if (static_cast<unsigned char>(c) < 0x20) {
+            fail("control character in string");
+            return false;
+        }
+        if (c == '\\') {
+            escaped = true;
+            if (end - p < 2) {
+                fail("unterminated string");
+                return false;
+            }
+            char e = p[1];
+            if (e == 'u') {
+                if (end - p < 6 || !isHex(p[2]) || !isHex(p[3]) || !isHex(p[4]) || !isHex(p[5])) {
+                    fail("invalid \\u escape");
+                    return false;
+                }
+                p += 6;
+                continue;
+            }
+            if (e == '\0' || !std::strchr("\"\\/bfnrt", e)) {
+                fail("invalid escape in string");
+                return false;
+            }
+            p += 2;
+            continue;
+        }
+        p++;
+    }
+
+    size_t len = static_cast<size_t>(p - start);
+    p++;
+    if (escaped) {
+        RequestView::unescape(RequestView::Slice(start, len), out);
+    } else {
+        out.assign(start, len);
+    }
+    return true;
+}
+
+bool JsonScanner::parseNumber(SqlValue& value) {
+    const char* start = p;
+    bool negative = false;
+    if (p < end && *p == '-') {
+        negative = true;
+        p++;
+    }
+    const char* digits = p;
+    while (p < end && isDigit(*p)) {
+        p++;
+    }
+    if (p == digits) {
+        fail("invalid value");
+        return false;
+    }
+    bool integral = true;
+    if (p < end && *p == '.') {
+        integral = false;
+        p++;
+        const char* fraction = p;
+        while (p < end && isDigit(*p)) {
+            p++;
+        }
+        if (p == fraction) {
+            fail("invalid number");
+            return false;
+        }
+    }
+    if (p < end && (*p == 'e' || *p == 'E')) {
+        integral = false;
+        p++;
+        if (p < end && (*p == '+' || *p == '-')) {
+            p++;
+        }
+        const char* exponent = p;
+        while (p < end && isDigit(*p)) {
+            p++;
+        }
+        if (p == exponent) {
+            fail("invalid number");
+            return false;
+        }
+    }
+
+    if (integral && p - digits <= 19) {
+        uint64_t magnitude = 0;
+        for (const char* d = digits; d < p; d++) {
+            magnitude = magnitude * 10 + static_cast<uint64_t>(*d - '0');
+        }
+        // 超出int64范围的整数按REAL处理，与绑定参数一致
+        if (magnitude <= static_cast<uint64_t>(INT64_MAX) + (negative ? 1 : 0)) {
+            value.type = SqlValue::INTEGER;
+            value.intValue = negative ? static_cast<int64_t>(0 - magnitude) : static_cast<int64_t>(magnitude);
+            return true;
+        }
+    }
+    // strtod需要以NUL结尾的文本：常见长度的数字拷贝到栈上
+    char text[64];
+    size_t len = static_cast<size_t>(p - start);
+    value.type = SqlValue::REAL;
+    if (len < sizeof(text)) {
+        std::memcpy(text, start, len);
+        text[len] = '\0';
+        value.realValue = std::strtod(text, nullptr);
+    } else {
+        value.realValue = std::strtod(std::string(start, len).c_str(), nullptr);
+    }
+    return true;
+}
+
+bool JsonScanner::skipValue(int depth) {
+    skipSpace();
+    if (p >= end || depth > kMaxDepth) {
+        fail("invalid value");
+        return false;
+    }
+    if (*p == '"') {
+        return parseString(scratch);
+    }
+    if (*p == '[' || *p == '{') {
+        char close = *p == '[' ? ']' : '}';
+        bool isObject = *p == '{';
+        p++;
+        skipSpace();
+        if (p < end && *p == close) {
+            p++;
+            return true;
+        }
+        while (true) {
+            skipSpace();
+            if (isObject) {
+                if (p >= end || *p != '"' || !parseString(scratch)) {
+                    fail("expected a key");
+                    return false;
+                }
+                skipSpace();
+                if (p >= end || *p != ':') {
+                    fail("expected ':'");
+                    return false;
+                }
+                p++;
+            }
+            if (!skipValue(depth + 1)) {
+                return false;
+            }
+            skipSpace();
+            if (p < end && *p == ',') {
+                p++;
+                continue;
+            }
+            if (p < end && *p == close) {
+                p++;
+                return true;
+            }
+            fail("unterminated array or object");
+            return false;
+        }
+    }
+    SqlValue ignored;
+    return parseValue(ignored);
+}
@@ -0,0 +1,237 @@
+#include "json_writer.h"
+#include <sqlite3.h>
+#include <cmath>
+#include <cstring>
+
+namespace {
+const char kDigitPairs[] =
+    "00010203040506070809101112131415161718192021222324252627282930313233343536373839"
+    "40414243444546474849505152535455565758596061626364656667686970717273747576777879"
+    "8081828384858687888990919293949596979899";
+
+const char kHexDigits[] = "0123456789abcdef";
+
+const uint64_t kOnes = 0x0101010101010101ULL;
+const uint64_t kHighBits = 0x8080808080808080ULL;
+
+/**
+ * @brief 8个字节中是否有需要转义或需要校验UTF-8的字节
+ */
+inline bool wordNeedsAttention(uint64_t w) {
+    uint64_t control = (w - kOnes * 0x20) & ~w & kHighBits;     // < 0x20
+    uint64_t q = w ^ (kOnes * '"');
+    uint64_t quote = (q - kOnes) & ~q & kHighBits;
+    uint64_t b = w ^ (kOnes * '\\');
+    uint64_t backslash = (b - kOnes) & ~b & kHighBits;
+    return (control | quote | backslash | (w & kHighBits)) != 0;
+}
+
+/**
+ * @brief 从p开始的合法UTF-8多字节序列长度，不合法时返回0
+ */
+size_t utf8SequenceLength(const unsigned char* p, size_t avail) {
+    unsigned char c = p[0];
+    size_t n;
+    unsigned char lo = 0x80, hi = 0xBF;     // 第二个字节的范围（排除过长编码和代理区）
+    if (c >= 0xC2 && c <= 0xDF) {
+        n = 2;
+    } else if (c >= 0xE0 && c <= 0xEF) {
+        n = 3;
+        if (c == 0xE0) lo = 0xA0;
+        if (c == 0xED) hi = 0x9F;
+    } else if (c >= 0xF0 && c <= 0xF4) {
+        n = 4;
+        if (c == 0xF0) lo = 0x90;
+        if (c == 0xF4) hi = 0x8F;
+    } else {
+        return 0;
+    }
+    if (avail < n || p[1] < lo || p[1] > hi) {
+        return 0;
+    }
+    for (size_t k = 2; k < n; k++) {
+        if ((p[k] & 0xC0) != 0x80) {
+            return 0;
+        }
+    }
+    return n;
+}
+}
+
+JsonWriter::JsonWriter(std::string& out)
+    : out(out)
+    , needComma(false)
+{
+}
+
+void JsonWriter::separator() {
+    if (needComma) {
+        out.push_back(',');
+    }
+}
+
+JsonWriter& JsonWriter::beginObject() {
+    separator();
+    out.push_back('{');
+    needComma = false;
+    return *this;
+}
+
+JsonWriter& JsonWriter::endObject() {
+    out.push_back('}');
+    needComma = true;
+    return *this;
+}
+
+JsonWriter& JsonWriter::beginArray() {
+    separator();
+    out.push_back('[');
+    needComma = false;
+    return *this;
+}
+
+JsonWriter& JsonWriter::endArray() {
+    out.push_back(']');
+    needComma = true;
+    return *this;
+}
+
+JsonWriter& JsonWriter::key(const std::string& name) {
+    separator();
+    appendString(out, name.data(), name.size());
+    out.push_back(':');
+    needComma = false;
+    return *this;
+}
+
+JsonWriter& JsonWriter::value(const std::string& text) {
+    return value(text.data(), text.size());
+}
+
+JsonWriter& JsonWriter::value(const char* data, size_t len) {
+    separator();
+    appendString(out, data, len);
+    needComma = true;
+    return *this;
+}
+
+JsonWriter& JsonWriter::value(int64_t number) {
+    separator();
+    appendInteger(out, number);
+    needComma = true;
+    return *this;
+}
+
+JsonWriter& JsonWriter::value(double number) {
+    separator();
+    appendReal(out, number);
+    needComma = true;
+    return *this;
+}
+
+JsonWriter& JsonWriter::null() {
+    separator();
+    out.append("null", 4);
+    needComma = true;
+    return *this;
+}
+
+void JsonWriter::appendString(std::string& out, const char* data, size_t len) {
+    const unsigned char* p = reinterpret_cast<const unsigned char*>(data);
+    out.reserve(out.size() + len + 2);
+    out.push_back('"');
+
+    size_t start = 0;   // 尚未拷贝的第一个字节
+    size_t i = 0;
+    while (i < len) {
+        // 快速路径：整块都是普通ASCII时直接跳过
+        size_t stop = len;
+        if (len - i >= 8) {
+            uint64_t w;
+            std::memcpy(&w, p + i, 8);
+            if (!wordNeedsAttention(w)) {
+                i += 8;
+                continue;
+            }
+            stop = i + 8;
+        }
+
+        // 慢速路径：逐字节处理这一块
+        while (i < stop) {
+            unsigned char c = p[i];
+            if (c >= 0x20 && c < 0x80 && c != '"' && c != '\\') {
+                i++;
+                continue;
+            }
+            if (c >= 0x80) {
+                size_t n = utf8SequenceLength(p + i, len - i);
+                if (n > 0) {
+                    i += n;
+                    continue;
+                }
+            }
+
+            out.append(data + start, i - start);
+            switch (c) {
+            case '"':  out.append("\\\"", 2); break;
+            case '\\': out.append("\\\\", 2); break;
+            case '\b': out.append("\\b", 2); break;
+            case '\f': out.append("\\f", 2); break;
+            case '\n': out.append("\\n", 2); break;
+            case '\r': out.append("\\r", 2); break;
+            case '\t': out.append("\\t", 2); break;
+            default:
+                if (c < 0x20) {
+                    char esc[6] = { '\\', 'u', '0', '0', kHexDigits[c >> 4], kHexDigits[c & 0xf] };
+                    out.append(esc, 6);
+                } else {
+                    out.append("\\ufffd", 6);   // 非法UTF-8字节
+                }
+                break;
+            }
+            i++;
+            start = i;
+        }
+    }
+
+    out.append(data + start, len - start);
+    out.push_back('"');
+}
+
+void JsonWriter::appendInteger(std::string& out, int64_t value) {
+    char buf[24];
+    char* end = buf + sizeof(buf);
+    char* p = end;
+    uint64_t u = value < 0 ? 0 - static_cast<uint64_t>(value) : static_cast<uint64_t>(value);
+
+    while (u >= 100) {
+        size_t idx = static_cast<size_t>(u % 100) * 2;
+        u /= 100;
+        *--p = kDigitPairs[idx + 1];
+        *--p = kDigitPairs[idx];
+    }
+    if (u >= 10) {
+        size_t idx = static_cast<size_t>(u) * 2;
+        *--p = kDigitPairs[idx + 1];
+        *--p = kDigitPairs[idx];
+    } else {
+        *--p = static_cast<char>('0' + u);
+    }
+    if (value < 0) {
+        *--p = '-';
+    }
+    out.append(p, end - p);
+}
+
+void JsonWriter::appendReal(std::string& out, double value) {
+    // 绝对值小于1e15的整数值，"%!.15g"的结果就是整数加".0"
+    if (std::fabs(value) < 1e15 && value == static_cast<double>(static_cast<int64_t>(value)) &&
+        !(value == 0 && std::signbit(value))) {
+        appendInteger(out, static_cast<int64_t>(value));
+        out.append(".0", 2);
+        return;
+    }
+    char buf[64];
+    sqlite3_snprintf(sizeof(buf), buf, "%!.15g", value);
+    out.append(buf);
+}
@@ -0,0 +1,165 @@
+#include "logger.h"
+#include <unistd.h>
+#include <time.h>
+#include <cstring>
+#include <cstdio>
+#include <cctype>
+#include <chrono>
+
+std::atomic<int> Logger::runtimeLevel(Logger::DEBUG);
+
+namespace {
+const char* const kLevelTags[] = { "[DEBUG][", "[INFO][", "[WARN][", "[ERROR][" };
+
+void writeAll(int fd, const std::string& data) {
+    size_t off = 0;
+    while (off < data.size()) {
+        ssize_t n = ::write(fd, data.data() + off, data.size() - off);
+        if (n <= 0) {
+            return;     // 日志输出失败时没有更好的去处，直接放弃
+        }
+        off += n;
+    }
+}
+}
+
+Logger& Logger::instance() {
+    static Logger logger;
+    return logger;
+}
+
+bool Logger::setLevel(const std::string& name) {
+    std::string lower;
+    for (char c : name) {
+        lower.push_back(static_cast<char>(std::tolower(static_cast<unsigned char>(c))));
+    }
+    static const char* const names[] = { "debug", "info", "warn", "error", "off" };
+    for (int i = 0; i <= OFF; i++) {
+        if (lower == names[i]) {
+            setLevel(static_cast<Level>(i));
+            return true;
+        }
+    }
+    return false;
+}
+
+Logger::Logger()
+    : slots(new Slot[kCapacity])
+    , enqueuePos(0)
+    , dequeuePos(0)
+    , dropped(0)
+    , stopping(false)
+    , cachedSec(-1)
+    , reportedDropped(0)
+{
+    for (size_t i = 0; i < kCapacity; i++) {
+        slots[i].seq.store(i, std::memory_order_relaxed);
+    }
+    cachedTime[0] = '\0';
+    writer = std::thread([this]() { writerLoop(); });
+}
+
+Logger::~Logger() {
+    stopping.store(true, std::memory_order_release);
+    writer.join();
+    delete[] slots;
+}
+
+void Logger::write(Level level, const std::string& message) {
+    write(level, message.data(), message.size());
+}
+
+void Logger::write(Level level, const char* message, size_t len) {
+    // 调用线程只取粗粒度时钟（vDSO，无系统调用），格式化留给后台线程
+    struct timespec ts;
+    clock_gettime(CLOCK_REALTIME_COARSE, &ts);
+
+    size_t pos = enqueuePos.load(std::memory_order_relaxed);
+    Slot* slot;
+    while (true) {
+        slot = &slots[pos & (kCapacity - 1)];
+        size_t seq = slot->seq.load(std::memory_order_acquire);
+        intptr_t diff = static_cast<intptr_t>(seq) - static_cast<intptr_t>(pos);
+        if (diff == 0) {
+            if (enqueuePos.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed)) {
+                break;
+            }
+        } else if (diff < 0) {
+            dropped.fetch_add(1, std::memory_order_relaxed);   // 队列已满
+            return;
+        } else {
+            pos = enqueuePos.load(std::memory_order_relaxed);
+        }
+    }
+
+    if (len > kMaxMessage) {
+        len = kMaxMessage;
+        std::memcpy(slot->text, message, len - 3);
+        std::memcpy(slot->text + len - 3, "...", 3);
+    } else {
+        std::memcpy(slot->text, message, len);
+    }
+    slot->level = level;
+    slot->sec = ts.tv_sec;
+    slot->msec = static_cast<int>(ts.tv_nsec / 1000000);
+    slot->len = static_cast<uint16_t>(len);
+    slot->seq.store(pos + 1, std::memory_order_release);
+}
+
+bool Logger::drain() {
+    std::string out;
+    std::string err;
+
+    // 每批最多取一圈，持续写入时也能及时输出
+    for (size_t n = 0; n < kCapacity; n++) {
+        Slot& slot = slots[dequeuePos & (kCapacity - 1)];
+        if (slot.seq.load(std::memory_order_acquire) != dequeuePos + 1) {
+            break;
+        }
+
+        // 同一秒内的记录复用已格式化的日期时间
+        if (slot.sec != cachedSec) {
+            time_t t = static_cast<time_t>(slot.sec);
+            struct tm timeinfo;
+            localtime_r(&t, &timeinfo);
+            strftime(cachedTime, sizeof(cachedTime), "%Y-%m-%d %H:%M:%S", &timeinfo);
+            cachedSec = slot.sec;
+        }
+        std::string& target = slot.level >= WARN ? err : out;
+        char msec[8];
+        std::snprintf(msec, sizeof(msec), ".%03d] ", slot.msec);
+        target.append(kLevelTags[slot.level]);
+        target.append(cachedTime);
+        target.append(msec);
+        target.append(slot.text, slot.len);
+        target.push_back('\n');
+
+        slot.seq.store(dequeuePos + kCapacity, std::memory_order_release);
+        dequeuePos++;
+    }
+
+    uint64_t droppedNow = dropped.load(std::memory_order_relaxed);
+    if (droppedNow != reportedDropped) {
+        err.append("[WARN] logger dropped " + std::to_string(droppedNow - reportedDropped) +
+                   " records (total " + std::to_string(droppedNow) + ")\n");
+        reportedDropped = droppedNow;
+    }
+
+    if (!out.empty()) {
+        writeAll(STDOUT_FILENO, out);
+    }
+    if (!err.empty()) {
+        writeAll(STDERR_FILENO, err);
+    }
+    return !out.empty() || !err.empty();
+}
+
+void Logger::writerLoop() {
+    // 写入端无锁，不通知后台线程；队列空时短暂休眠后再取
+    while (!stopping.load(std::memory_order_acquire)) {
+        if (!drain()) {
+            std::this_thread::sleep_for(std::chrono::milliseconds(5));
+        }
+    }
+    drain();
+}
@@ -1,26 +1,159 @@
 #include "epoll_server.h"
 #include "sql_exec_handler.h"
+#include "bulk_ingest_handler.h"
+#include "cursor_handler.h"
 #include "sqlite_connect_handler.h"
+#include "worker_pool.h"
+#include "logger.h"
+#include "metrics.h"
+#include "result_cache.h"
+#include "admission_control.h"
+#include "json_writer.h"
+#include "sqlite_pool.h"
 #include <memory>
 #include <iostream>
+#include <cstdlib>
+#include <thread>
+#include <algorithm>
 
-int main() {
+int main(int argc, char* argv[]) {
     try {
-        EpollServer server(8083);
+        // 用法: server [port] [reactors] [workers]，reactors和workers默认取CPU核数
+        int cores = static_cast<int>(std::thread::hardware_concurrency());
+        int port = argc > 1 ? std::atoi(argv[1]) : 8083;
+        int reactors = argc > 2 ? std::atoi(argv[2]) : cores;
+        int workerCount = argc > 3 ? std::atoi(argv[3]) : cores;
+        // 日志级别可用环境变量LOG_LEVEL调整：debug/info/warn/error/off
+        const char* logLevel = std::getenv("LOG_LEVEL");
+        if (logLevel && !Logger::setLevel(logLevel)) {
+            std::cerr << "Unknown LOG_LEVEL: " << logLevel << std::endl;
+        }
+        // 只读查询结果缓存，默认关闭；RESULT_CACHE_MB设置容量（MiB）即启用
+        const char* resultCacheMb = std::getenv("RESULT_CACHE_MB");
+        if (resultCacheMb && std::atoi(resultCacheMb) > 0) {
+            ResultCache::instance().setCapacity(static_cast<size_t>(std::atoi(resultCacheMb)) * 1024 * 1024);
+        }
+
+        // 组提交：GROUP_COMMIT_MAX_BATCH为一批最多合并的写请求数（1表示关闭），
+        // GROUP_COMMIT_WINDOW_US为凑批的等待时间（微秒，默认0不额外等待）
+        SqlitePoolOptions poolOptions;
+        const char* groupCommitMax = std::getenv("GROUP_COMMIT_MAX_BATCH");
+        if (groupCommitMax) {
+            poolOptions.groupCommitMaxBatch = static_cast<size_t>(std::max(std::atoi(groupCommitMax), 1));
+        }
+        const char* groupCommitWindow = std::getenv("GROUP_COMMIT_WINDOW_US");
+        if (groupCommitWindow) {
+            poolOptions.groupCommitWindowUs = std::atoi(groupCommitWindow);
+        }
+        // 服务器端游标：CURSOR_MAX_PER_DB为每个数据库的游标连接上限，
+        // CURSOR_MAX_PER_CONNECTION为每个客户端连接的游标上限，CURSOR_IDLE_TIMEOUT_MS为空闲超时
+        const char* cursorMaxPerDb = std::getenv("CURSOR_MAX_PER_DB");
+        if (cursorMaxPerDb && std::atoi(cursorMaxPerDb) > 0) {
+            poolOptions.maxCursors = static_cast<size_t>(std::atoi(cursorMaxPerDb));
+        }
+        SqlitePool::setDefaultOptions(poolOptions);
+        const char* cursorMaxPerConn = std::getenv("CURSOR_MAX_PER_CONNECTION");
+        size_t cursorsPerConnection = cursorMaxPerConn && std::atoi(cursorMaxPerConn) > 0
+            ? static_cast<size_t>(std::atoi(cursorMaxPerConn)) : CursorHandler::kDefaultMaxPerConnection;
+        const char* cursorIdle = std::getenv("CURSOR_IDLE_TIMEOUT_MS");
+        int cursorIdleMs = cursorIdle ? std::atoi(cursorIdle) : CursorHandler::kDefaultIdleTimeoutMs;
+
+        // 超时：IDLE_TIMEOUT_MS为连接空闲超时，REQUEST_TIMEOUT_MS为异步请求的默认截止时间（0表示关闭）
+        const char* idleTimeout = std::getenv("IDLE_TIMEOUT_MS");
+        int idleTimeoutMs = idleTimeout ? std::atoi(idleTimeout) : EpollServer::kDefaultIdleTimeoutMs;
+        const char* requestTimeout = std::getenv("REQUEST_TIMEOUT_MS");
+        int requestTimeoutMs = requestTimeout ? std::atoi(requestTimeout) : EpollServer::kDefaultRequestTimeoutMs;
+
+        EpollServer server(port, reactors);
+        server.setTimeouts(idleTimeoutMs, requestTimeoutMs);
+        // I/O后端：IO_BACKEND=epoll（默认）或io_uring，内核不支持io_uring时自动退回epoll
+        const char* ioBackendName = std::getenv("IO_BACKEND");
+        IoBackendType ioBackend = IO_BACKEND_EPOLL;
+        if (ioBackendName && !IoBackend::parseType(ioBackendName, ioBackend)) {
+            std::cerr << "Unknown IO_BACKEND: " << ioBackendName << std::endl;
+        }
+        server.setIoBackend(ioBackend);
+        // 零拷贝发送：ZEROCOPY_THRESHOLD_KB为使用MSG_ZEROCOPY的最小写出量（KiB，0表示关闭）
+        const char* zerocopyThreshold = std::getenv("ZEROCOPY_THRESHOLD_KB");
+        if (zerocopyThreshold) {
+            server.setZerocopyThreshold(static_cast<size_t>(std::max(std::atoi(zerocopyThreshold), 0)) * 1024);
+        }
+        auto workers = std::make_shared<WorkerPool>(workerCount > 0 ? workerCount : 1);
+
+        // 准入控制：ADMISSION_CLIENT_CONCURRENCY/ADMISSION_CLIENT_RATE/ADMISSION_CLIENT_BURST为每个客户端IP的
+        // 并发上限和令牌桶（请求/秒），ADMISSION_FUNC_LIMITS按功能号设置限制和优先级
+        // （如"100002:concurrency=2,priority=low;100001:rate=500"），
+        // QUEUE_DELAY_TARGET_MS/QUEUE_DELAY_INTERVAL_MS为排队延迟目标（0表示不按排队延迟拒绝）
+        AdmissionOptions admissionOptions;
+        const char* clientConcurrency = std::getenv("ADMISSION_CLIENT_CONCURRENCY");
+        if (clientConcurrency && std::atoi(clientConcurrency) > 0) {
+            admissionOptions.clientConcurrency = static_cast<size_t>(std::atoi(clientConcurrency));
+        }
+        const char* clientRate = std::getenv("ADMISSION_CLIENT_RATE");
+        if (clientRate && std::atof(clientRate) > 0) {
+            admissionOptions.clientRate = std::atof(clientRate);
+        }
+        const char* clientBurst = std::getenv("ADMISSION_CLIENT_BURST");
+        if (clientBurst && std::atof(clientBurst) > 0) {
+            admissionOptions.clientBurst = std::atof(clientBurst);
+        }
+        const char* funcLimits = std::getenv("ADMISSION_FUNC_LIMITS");
+        std::string funcLimitsError;
+        if (funcLimits && !admissionOptions.parseFuncLimits(funcLimits, funcLimitsError)) {
+            std::cerr << "Invalid ADMISSION_FUNC_LIMITS: " << funcLimitsError << std::endl;
+        }
+        const char* queueTarget = std::getenv("QUEUE_DELAY_TARGET_MS");
+        if (queueTarget) {
+            admissionOptions.queueTargetMs = std::atoi(queueTarget);
+        }
+        const char* queueInterval = std::getenv("QUEUE_DELAY_INTERVAL_MS");
+        if (queueInterval && std::atoi(queueInterval) > 0) {
+            admissionOptions.queueIntervalMs = std::atoi(queueInterval);
+        }
+        auto admission = std::make_shared<AdmissionControl>(admissionOptions, workers);
+        server.setAdmission(admission);
+        Metrics::addSection("admission", [admission](JsonWriter& writer) { admission->writeStats(writer); });
         
         // 创建数据库连接处理器
         auto sqliteConnectHandler = std::make_shared<SqliteConnectHandler>();
-        server.registerHandler("100000", [sqliteConnectHandler](const Json::Value& request, int clientFd) {
-            return sqliteConnectHandler->handle(request, clientFd);
+        server.registerHandler("100000", [sqliteConnectHandler](const RequestView& request, Connection& conn) {
+            return sqliteConnectHandler->handle(request, conn);
+        });
+        
+        // SQL执行处理器：SQL在工作线程上执行，不阻塞Reactor
+        auto sqlExecHandler = std::make_shared<SqlExecHandler>(workers);
+        server.registerAsyncHandler("100001", [sqlExecHandler](const RequestView& request, Connection& conn,
+                                                               const std::shared_ptr<ResponseStream>& stream) {
+            sqlExecHandler->handleAsync(request, conn, stream);
+        });
+        
+        // 批量导入：一条预编译的INSERT逐行绑定，分批提交
+        auto bulkIngestHandler = std::make_shared<BulkIngestHandler>(workers);
+        server.registerAsyncHandler("100002", [bulkIngestHandler](const RequestView& request, Connection& conn,
+                                                                  const std::shared_ptr<ResponseStream>& stream) {
+            bulkIngestHandler->handleAsync(request, conn, stream);
+        });
+        
+        // 服务器端游标：打开、分批读取、关闭
+        auto cursorHandler = std::make_shared<CursorHandler>(workers, cursorsPerConnection, cursorIdleMs);
+        server.registerAsyncHandler("100003", [cursorHandler](const RequestView& request, Connection& conn,
+                                                              const std::shared_ptr<ResponseStream>& stream) {
+            cursorHandler->handleOpen(request, conn, stream);
+        });
+        server.registerAsyncHandler("100004", [cursorHandler](const RequestView& request, Connection& conn,
+                                                              const std::shared_ptr<ResponseStream>& stream) {
+            cursorHandler->handleFetch(request, conn, stream);
+        });
+        server.registerHandler("100005", [cursorHandler](const RequestView& request, Connection& conn) {
+            return cursorHandler->handleClose(request, conn);
         });
         
-        // SQL执行处理器
-        auto sqlExecHandler = std::make_shared<SqlExecHandler>();
-        server.registerHandler("100001", [sqlExecHandler](const Json::Value& request, int clientFd) {
-            return sqlExecHandler->handle(request, clientFd);
+        // 运行统计：连接、流量、各功能号延迟分布、各阶段耗时、各数据库事务数
+        server.registerHandler("100099", [](const RequestView&, Connection&) {
+            return Metrics::snapshotJson();
         });
         
-        std::cout << "Server starting on port 8083..." << std::endl;
+        std::cout << "Server starting on port " << port << "..." << std::endl;
         server.start();
         
     } catch (const std::exception& e) {
@@ -29,4 +162,4 @@ int main() {
     }
     
     return 0;
-} 
\ No newline at end of file
+} 
@@ -0,0 +1,310 @@
+#include "metrics.h"
+#include "json_writer.h"
+#include "logger.h"
+#include "result_cache.h"
+#include <map>
+#include <memory>
+#include <mutex>
+
+namespace {
+/**
+ * @brief 只由所属线程写入的计数器自增：普通的读改写，不需要lock前缀
+ */
+inline void bump(std::atomic<uint64_t>& counter, uint64_t n) {
+    counter.store(counter.load(std::memory_order_relaxed) + n, std::memory_order_relaxed);
+}
+
+const char* const kPhaseNames[Metrics::PHASE_COUNT] = {
+    "parse", "dispatch", "prepare", "step", "serialize", "write"
+};
+
+/**
+ * @brief 单个数据库的事务计数
+ */
+struct DbCounters {
+    DbCounters() : commits(0), rollbacks(0) {}
+    std::atomic<uint64_t> commits;
+    std::atomic<uint64_t> rollbacks;
+};
+
+/**
+ * @brief 一个线程的全部统计
+ * 计数只由所属线程写入；map只在所属线程插入新键时和读取快照时加锁
+ */
+struct ThreadMetrics {
+    ThreadMetrics() : accepted(0), closed(0), bytesIn(0), bytesOut(0) {}
+
+    std::atomic<uint64_t> accepted;
+    std::atomic<uint64_t> closed;
+    std::atomic<uint64_t> bytesIn;
+    std::atomic<uint64_t> bytesOut;
+    Histogram phases[Metrics::PHASE_COUNT];
+
+    std::mutex mapMutex;
+    std::map<std::string, std::unique_ptr<Histogram>> requests;
+    std::map<std::string, std::unique_ptr<DbCounters>> databases;
+
+    Histogram& request(const std::string& funcId) {
+        auto it = requests.find(funcId);
+        if (it != requests.end()) {
+            return *it->second;
+        }
+        std::lock_guard<std::mutex> lock(mapMutex);
+        return *(requests[funcId] = std::unique_ptr<Histogram>(new Histogram()));
+    }
+
+    DbCounters& database(const std::string& dbPath) {
+        auto it = databases.find(dbPath);
+        if (it != databases.end()) {
+            return *it->second;
+        }
+        std::lock_guard<std::mutex> lock(mapMutex);
+        return *(databases[dbPath] = std::unique_ptr<DbCounters>(new DbCounters()));
+    }
+};
+
+std::mutex registryMutex;
+std::vector<ThreadMetrics*> registry;      // 线程退出后保留，累计值不丢失
+std::vector<std::pair<std::string, std::function<void(JsonWriter&)>>> sections;   // 启动前登记，之后只读
+
+ThreadMetrics& local() {
+    static thread_local ThreadMetrics* metrics = nullptr;
+    if (!metrics) {
+        metrics = new ThreadMetrics();
+        std::lock_guard<std::mutex> lock(registryMutex);
+        registry.push_back(metrics);
+    }
+    return *metrics;
+}
+
+void writeHistogram(JsonWriter& writer, const Histogram::Snapshot& snapshot) {
+    writer.beginObject();
+    writer.key("count").value(static_cast<int64_t>(snapshot.count));
+    writer.key("mean_ns").value(static_cast<int64_t>(snapshot.count ? snapshot.sum / snapshot.count : 0));
+    writer.key("p50_ns").value(static_cast<int64_t>(snapshot.percentile(0.5)));
+    writer.key("p99_ns").value(static_cast<int64_t>(snapshot.percentile(0.99)));
+    writer.key("p999_ns").value(static_cast<int64_t>(snapshot.percentile(0.999)));
+    writer.key("max_ns").value(static_cast<int64_t>(snapshot.max));
+    writer.endObject();
+}
+}
+
+Histogram::Histogram() : count(0), sum(0), max(0) {
+    for (size_t i = 0; i < kBucketCount; i++) {
+        counts[i].store(0, std::memory_order_relaxed);
+    }
+}
+
+size_t Histogram::bucketOf(uint64_t ns) {
+    if (ns < kSubBuckets) {
+        return static_cast<size_t>(ns);
+    }
+    size_t msb = 63 - __builtin_clzll(ns);
+    if (msb >= kMaxExponent) {
+        return kBucketCount - 1;
+    }
+    return (msb - 3) * kSubBuckets + ((ns >> (msb - 4)) & (kSubBuckets - 1));
+}
+
+uint64_t Histogram::bucketMidpoint(size_t bucket) {
+    if (bucket < kSubBuckets) {
+        return bucket;
+    }
+    size_t msb = bucket / kSubBuckets + 3;
+    uint64_t width = uint64_t(1) << (msb - 4);
+    uint64_t lower = (kSubBuckets + bucket % kSubBuckets) * width;
+    return lower + width / 2;
+}
+
+void Histogram::record(uint64_t ns) {
+    bump(counts[bucketOf(ns)], 1);
+    bump(count, 1);
+    bump(sum, ns);
+    if (ns > max.load(std::memory_order_relaxed)) {
+        max.store(ns, std::memory_order_relaxed);
+    }
+}
+
+void Histogram::snapshot(Snapshot& out) const {
+    Snapshot mine;
+    for (size_t i = 0; i < kBucketCount; i++) {
+        mine.counts[i] = counts[i].load(std::memory_order_relaxed);
+    }
+    mine.count = count.load(std::memory_order_relaxed);
+    mine.sum = sum.load(std::memory_order_relaxed);
+    mine.max = max.load(std::memory_order_relaxed);
+    out.merge(mine);
+}
+
+Histogram::Snapshot::Snapshot()
+    : counts(kBucketCount, 0)
+    , count(0)
+    , sum(0)
+    , max(0)
+{
+}
+
+void Histogram::Snapshot::merge(const Snapshot& other) {
+    for (size_t i = 0; i < kBucketCount; i++) {
+        counts[i] += other.counts[i];
+    }
+    count += other.count;
+    sum += other.sum;
+    if (other.max > max) {
+        max = other.max;
+    }
+}
+
+uint64_t Histogram::Snapshot::percentile(double q) const {
+    uint64_t total = 0;
+    for (size_t i = 0; i < kBucketCount; i++) {
+        total += counts[i];
+    }
+    if (total == 0) {
+        return 0;
+    }
+    uint64_t rank = static_cast<uint64_t>(q * total);
+    if (rank >= total) {
+        rank = total - 1;
+    }
+    uint64_t seen = 0;
+    for (size_t i = 0; i < kBucketCount; i++) {
+        seen += counts[i];
+        if (seen > rank) {
+            uint64_t value = bucketMidpoint(i);
+            return value < max ? value : max;
+        }
+    }
+    return max;
+}
+
+void Metrics::connectionAccepted() {
+    bump(local().accepted, 1);
+}
+
+void Metrics::connectionClosed() {
+    bump(local().closed, 1);
+}
+
+void Metrics::bytesIn(size_t n) {
+    bump(local().bytesIn, n);
+}
+
+void Metrics::bytesOut(size_t n) {
+    bump(local().bytesOut, n);
+}
+
+void Metrics::recordRequest(const std::string& funcId, uint64_t ns) {
+    local().request(funcId).record(ns);
+}
+
+void Metrics::recordPhase(Phase phase, uint64_t ns) {
+    local().phases[phase].record(ns);
+}
+
+void Metrics::recordCommit(const std::string& dbPath) {
+    bump(local().database(dbPath).commits, 1);
+}
+
+void Metrics::recordRollback(const std::string& dbPath) {
+    bump(local().database(dbPath).rollbacks, 1);
+}
+
+void Metrics::addSection(const std::string& name, std::function<void(JsonWriter&)> write) {
+    sections.emplace_back(name, std::move(write));
+}
+
+std::string Metrics::snapshotJson() {
+    uint64_t accepted = 0, closed = 0, bytesIn = 0, bytesOut = 0;
+    std::vector<Histogram::Snapshot> phases(PHASE_COUNT);
+    std::map<std::string, Histogram::Snapshot> requests;
+    std::map<std::string, std::pair<uint64_t, uint64_t>> databases;
+
+    {
+        std::lock_guard<std::mutex> registryLock(registryMutex);
+        for (ThreadMetrics* t : registry) {
+            accepted += t->accepted.load(std::memory_order_relaxed);
+            closed += t->closed.load(std::memory_order_relaxed);
+            bytesIn += t->bytesIn.load(std::memory_order_relaxed);
+            bytesOut += t->bytesOut.load(std::memory_order_relaxed);
+            for (int p = 0; p < PHASE_COUNT; p++) {
+                t->phases[p].snapshot(phases[p]);
+            }
+
+            std::lock_guard<std::mutex> mapLock(t->mapMutex);
+            for (const auto& entry : t->requests) {
+                entry.second->snapshot(requests[entry.first]);
+            }
+            for (const auto& entry : t->databases) {
+                std::pair<uint64_t, uint64_t>& db = databases[entry.first];
+                db.first += entry.second->commits.load(std::memory_order_relaxed);
+                db.second += entry.second->rollbacks.load(std::memory_order_relaxed);
+            }
+        }
+    }
+
+    std::string out;
+    JsonWriter writer(out);
+    writer.beginObject();
+    writer.key("status").value(0);
+    writer.key("msg").value(std::string("ok"));
+
+    writer.key("connections").beginObject();
+    writer.key("active").value(static_cast<int64_t>(accepted - closed));
+    writer.key("accepted").value(static_cast<int64_t>(accepted));
+    writer.key("closed").value(static_cast<int64_t>(closed));
+    writer.endObject();
+
+    writer.key("bytes").beginObject();
+    writer.key("in").value(static_cast<int64_t>(bytesIn));
+    writer.key("out").value(static_cast<int64_t>(bytesOut));
+    writer.endObject();
+
+    writer.key("requests").beginObject();
+    for (const auto& entry : requests) {
+        writer.key(entry.first);
+        writeHistogram(writer, entry.second);
+    }
+    writer.endObject();
+
+    writer.key("phases").beginObject();
+    for (int p = 0; p < PHASE_COUNT; p++) {
+        writer.key(kPhaseNames[p]);
+        writeHistogram(writer, phases[p]);
+    }
+    writer.endObject();
+
+    writer.key("databases").beginObject();
+    for (const auto& entry : databases) {
+        writer.key(entry.first).beginObject();
+        writer.key("transactions").value(static_cast<int64_t>(entry.second.first + entry.second.second));
+        writer.key("commits").value(static_cast<int64_t>(entry.second.first));
+        writer.key("rollbacks").value(static_cast<int64_t>(entry.second.second));
+        writer.endObject();
+    }
+    writer.endObject();
+
+    ResultCacheStats cache = ResultCache::instance().getStats();
+    writer.key("result_cache").beginObject();
+    writer.key("enabled").value(static_cast<int64_t>(cache.capacity > 0));
+    writer.key("hits").value(static_cast<int64_t>(cache.hits));
+    writer.key("misses").value(static_cast<int64_t>(cache.misses));
+    writer.key("stores").value(static_cast<int64_t>(cache.stores));
+    writer.key("rejected").value(static_cast<int64_t>(cache.rejected));
+    writer.key("evictions").value(static_cast<int64_t>(cache.evictions));
+    writer.key("invalidations").value(static_cast<int64_t>(cache.invalidations));
+    writer.key("entries").value(static_cast<int64_t>(cache.entries));
+    writer.key("bytes").value(static_cast<int64_t>(cache.bytes));
+    writer.key("capacity").value(static_cast<int64_t>(cache.capacity));
+    writer.endObject();
+
+    for (const auto& section : sections) {
+        writer.key(section.first);
+        section.second(writer);
+    }
+
+    writer.key("log_dropped").value(static_cast<int64_t>(Logger::instance().getDroppedCount()));
+    writer.endObject();
+    out.push_back('\n');
+    return out;
+}
@@ -0,0 +1,160 @@
+#include "output_queue.h"
+
+OutputQueue::OutputQueue()
+    : frontPos(0)
+    , bytes(0)
+    , tailOpen(false)
+    , zerocopyIssued(0)
+    , zerocopyDone(0)
+{
+}
+
+void OutputQueue::append(const char* data, size_t len) {
+    if (len == 0) {
+        return;
+    }
+    if (!tailOpen) {
+        // 段的内容必须在堆上：短字符串存放在对象内部，段在vector中移动时地址会变，
+        // 而零拷贝发送的数据在内核通知之前必须留在原处
+        segments.push_back(Segment());
+        segments.back().data.reserve(kMinCapacity);
+        tailOpen = true;
+    }
+    segments.back().data.append(data, len);
+    bytes += len;
+}
+
+void OutputQueue::take(std::string& data) {
+    if (data.size() < kTakeThreshold) {
+        append(data.data(), data.size());
+        return;
+    }
+    bytes += data.size();
+    segments.push_back(Segment());
+    segments.back().data.swap(data);
+    tailOpen = false;
+}
+
+int OutputQueue::fill(struct iovec* iov, int maxCount, size_t& len) const {
+    int count = 0;
+    len = 0;
+    for (size_t i = 0; i < segments.size() && count < maxCount; i++) {
+        const std::string& data = segments[i].data;
+        size_t offset = i == 0 ? frontPos : 0;
+        if (data.size() == offset) {
+            continue;
+        }
+        iov[count].iov_base = const_cast<char*>(data.data()) + offset;
+        iov[count].iov_len = data.size() - offset;
+        len += iov[count].iov_len;
+        count++;
+    }
+    return count;
+}
+
+void OutputQueue::consume(size_t n, bool zerocopy) {
+    uint32_t seq = zerocopyIssued;
+    if (zerocopy) {
+        // 内核可能还引用着末尾的段，之后的追加写进新段（追加可能让原来的段搬家）
+        zerocopyIssued++;
+        tailOpen = false;
+    }
+    bytes -= n;
+
+    size_t done = 0;
+    while (done < segments.size()) {
+        Segment& segment = segments[done];
+        size_t remaining = segment.data.size() - frontPos;
+        size_t used = n < remaining ? n : remaining;
+        if (zerocopy && used > 0) {
+            segment.zerocopy = true;
+            segment.seq = seq;
+        }
+        n -= used;
+        frontPos += used;
+        if (frontPos < segment.data.size()) {
+            break;
+        }
+        frontPos = 0;
+        if (done + 1 == segments.size() && tailOpen && segment.data.capacity() <= kShrinkThreshold) {
+            segment.data.clear();   // 队列已写空：留下末尾的段，后续的小响应不必重新申请
+            break;
+        }
+        if (segment.zerocopy && !isDone(segment.seq)) {
+            held.push_back(std::move(segment));
+        } else {
+            std::string().swap(segment.data);
+        }
+        done++;
+    }
+    if (done > 0) {
+        segments.erase(segments.begin(), segments.begin() + done);
+    }
+
+    if (segments.empty()) {
+        tailOpen = false;
+    } else if (segments.size() == 1 && tailOpen && frontPos > segments[0].data.size() / 2) {
+        // 只剩可追加的段且已写出过半时压缩，避免它只增不减
+        segments[0].data.erase(0, frontPos);
+        frontPos = 0;
+    }
+}
+
+void OutputQueue::completeZerocopy(uint32_t first, uint32_t last) {
+    if (static_cast<int32_t>(first - zerocopyDone) > 0) {
+        doneRanges.push_back(std::make_pair(first, last));
+        return;
+    }
+    if (static_cast<int32_t>(last + 1 - zerocopyDone) > 0) {
+        zerocopyDone = last + 1;
+    }
+    // 先到达的区间接上了就一并推进
+    bool merged = true;
+    while (merged && !doneRanges.empty()) {
+        merged = false;
+        for (size_t i = 0; i < doneRanges.size(); i++) {
+            if (static_cast<int32_t>(doneRanges[i].first - zerocopyDone) > 0) {
+                continue;
+            }
+            if (static_cast<int32_t>(doneRanges[i].second + 1 - zerocopyDone) > 0) {
+                zerocopyDone = doneRanges[i].second + 1;
+            }
+            doneRanges.erase(doneRanges.begin() + i);
+            merged = true;
+            break;
+        }
+    }
+    releaseHeld();
+}
+
+void OutputQueue::releaseHeld() {
+    size_t released = 0;
+    while (released < held.size() && isDone(held[released].seq)) {
+        released++;
+    }
+    if (released > 0) {
+        held.erase(held.begin(), held.begin() + released);
+    }
+}
+
+void OutputQueue::swap(OutputQueue& other) {
+    segments.swap(other.segments);
+    std::swap(frontPos, other.frontPos);
+    std::swap(bytes, other.bytes);
+    std::swap(tailOpen, other.tailOpen);
+    held.swap(other.held);
+    std::swap(zerocopyIssued, other.zerocopyIssued);
+    std::swap(zerocopyDone, other.zerocopyDone);
+    doneRanges.swap(other.doneRanges);
+}
+
+void OutputQueue::clear() {
+    std::vector<Segment>().swap(segments);
+    std::vector<Segment>().swap(held);
+    std::vector<std::pair<uint32_t, uint32_t>>().swap(doneRanges);
+    frontPos = 0;
+    bytes = 0;
+    tailOpen = false;
+    zerocopyIssued = 0;
+    zerocopyDone = 0;
+}
@@ -0,0 +1,461 @@
+#include "reactor.h"
+#include "epoll_server.h"
+#include "logger.h"
+#include "metrics.h"
+#include "db_session.h"
+#include <sys/socket.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <arpa/inet.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <sys/eventfd.h>
+#include <sys/timerfd.h>
+#include <cstring>
+#include <errno.h>
+#include <stdexcept>
+
+namespace {
+const size_t kInBufShrinkThreshold = 1024 * 1024;
+
+void setNonBlocking(int fd) {
+    int flags = fcntl(fd, F_GETFL, 0);
+    fcntl(fd, F_SETFL, flags | O_NONBLOCK);
+}
+}
+
+Reactor::Reactor(EpollServer& server, int id, int port)
+    : server(server)
+    , id(id)
+    , listenFd(-1)
+    , wakeFd(-1)
+    , timerFd(-1)
+    , timerArmed(0)
+    , loopTime(Metrics::now())
+    , timers(loopTime)
+{
+    spareBuffers.reserve(kMaxSpareBuffers);
+
+    // 每个Reactor一个监听socket，依靠SO_REUSEPORT由内核做负载均衡
+    listenFd = socket(AF_INET, SOCK_STREAM | SOCK_CLOEXEC, 0);
+    if (listenFd < 0) {
+        throw std::runtime_error(std::string("socket failed: ") + std::strerror(errno));
+    }
+
+    int on = 1;
+    setsockopt(listenFd, SOL_SOCKET, SO_REUSEADDR, &on, sizeof(on));
+    if (setsockopt(listenFd, SOL_SOCKET, SO_REUSEPORT, &on, sizeof(on)) < 0) {
+        int err = errno;
+        close(listenFd);
+        throw std::runtime_error(std::string("SO_REUSEPORT failed: ") + std::strerror(err));
+    }
+    // 响应总是一次性写出，关闭Nagle：否则对端延迟确认时，流水线上的下一个响应会被压到下一个请求到达。
+    // 接受的连接从监听socket继承该选项，不必每个连接再设一次
+    setsockopt(listenFd, IPPROTO_TCP, TCP_NODELAY, &on, sizeof(on));
+
+    struct sockaddr_in addr;
+    std::memset(&addr, 0, sizeof(addr));
+    addr.sin_family = AF_INET;
+    addr.sin_port = htons(port);
+    addr.sin_addr.s_addr = INADDR_ANY;
+
+    if (bind(listenFd, (struct sockaddr*)&addr, sizeof(addr)) < 0 ||
+        listen(listenFd, SOMAXCONN) < 0) {
+        int err = errno;
+        close(listenFd);
+        throw std::runtime_error("bind/listen on port " + std::to_string(port) +
+                                 " failed: " + std::strerror(err));
+    }
+    setNonBlocking(listenFd);
+
+    wakeFd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+    if (wakeFd < 0) {
+        int err = errno;
+        close(listenFd);
+        throw std::runtime_error(std::string("eventfd failed: ") + std::strerror(err));
+    }
+
+    // Metrics::now()取自steady_clock，即CLOCK_MONOTONIC，时间轮的时刻可直接作为绝对时间设定
+    timerFd = timerfd_create(CLOCK_MONOTONIC, TFD_NONBLOCK | TFD_CLOEXEC);
+    if (timerFd < 0) {
+        int err = errno;
+        close(wakeFd);
+        close(listenFd);
+        throw std::runtime_error(std::string("timerfd_create failed: ") + std::strerror(err));
+    }
+
+    try {
+        backend = IoBackend::create(server.ioBackend, *this, listenFd, wakeFd, timerFd,
+                                    server.zerocopyThreshold);
+    } catch (...) {
+        close(timerFd);
+        close(wakeFd);
+        close(listenFd);
+        throw;
+    }
+}
+
+Reactor::~Reactor() {
+    backend.reset();
+    if (listenFd >= 0) {
+        close(listenFd);
+    }
+    if (wakeFd >= 0) {
+        close(wakeFd);
+    }
+    if (timerFd >= 0) {
+        close(timerFd);
+    }
+}
+
+void Reactor::run() {
+    std::string error;
+    if (!backend->start(error)) {
+        // 监听socket已加入SO_REUSEPORT组，内核仍会把连接分给它，不能就此退出而不接受连接
+        LOG_WARN("Reactor " + std::to_string(id) + " could not start " + backend->getName() +
+                 " (" + error + "), falling back to epoll");
+        backend.reset();
+        try {
+            backend = IoBackend::create(IO_BACKEND_EPOLL, *this, listenFd, wakeFd, timerFd,
+                                        server.zerocopyThreshold);
+        } catch (const std::exception& e) {
+            error = e.what();
+        }
+        if (!backend || !backend->start(error)) {
+            // 关闭监听socket，连接只分给其他Reactor
+            LOG_ERROR("Reactor " + std::to_string(id) + " failed to start: " + error);
+            backend.reset();
+            close(listenFd);
+            listenFd = -1;
+            return;
+        }
+    }
+    LOG_INFO("Reactor " + std::to_string(id) + " started (" + backend->getName() + ")");
+
+    while (true) {
+        if (!backend->wait()) {
+            return;
+        }
+        loopTime = Metrics::now();
+        backend->dispatch();
+
+        // 定时器在本批事件之后处理：刚收到数据的连接已更新了最近活动时间，不会被当作空闲关闭
+        timers.advance(loopTime, [this](TimerWheel::Timer& timer) { onTimer(timer); });
+        updateTimerFd();
+    }
+}
+
+void Reactor::acceptConnection(int fd, const struct sockaddr_in* addr) {
+    Metrics::connectionAccepted();
+    Connection& conn = connections.open(fd, server.frameMode, server.maxFrameSize, loopTime);
+    scheduleIdle(conn);
+
+    // 后端顺带拿到了对端地址就直接记下，否则等准入控制或日志用到时再取
+    if (addr) {
+        conn.setPeer(*addr);
+    }
+    LOG_DEBUG("Reactor " + std::to_string(id) + " accepted " + conn.getPeer());
+
+    backend->attach(conn);
+}
+
+void Reactor::received(Connection& conn, const char* data, size_t len) {
+    conn.inBuf.append(data, len);
+    conn.lastActive = loopTime;
+    Metrics::bytesIn(len);
+}
+
+void Reactor::sent(Connection& conn, size_t len) {
+    if (len > 0) {
+        conn.bytesSent += len;
+        conn.lastActive = loopTime;
+        Metrics::bytesOut(len);
+    }
+    // 分段响应：告诉生产者已写出多少，释放窗口
+    if (conn.stream && conn.stream->isChunked() && conn.bytesSent > conn.streamBase) {
+        conn.stream->acknowledge(conn.bytesSent - conn.streamBase);
+    }
+}
+
+void Reactor::handleInput(Connection& conn) {
+    while (true) {
+        // 按到达顺序处理已收到的完整请求（流水线），响应追加到输出队列
+        if (!processFrames(conn)) {
+            closeConnection(conn);
+            return;
+        }
+        if (!flushOutput(conn)) {
+            return;
+        }
+
+        // 积压在本轮就已写出到低水位以下：立即恢复，不能等一个不会再来的可写事件
+        if (conn.readPaused && conn.pendingOutput() <= server.outputLowWatermark) {
+            conn.readPaused = false;
+            if (!backend->receive(conn)) {
+                return;
+            }
+            continue;
+        }
+        break;
+    }
+
+    // 零拷贝发送的数据在内核通知完成前还可能重传，关闭要等到通知到齐（后端收到通知后调用handleWrite）
+    if (conn.closeAfterFlush && conn.pendingOutput() == 0 && !conn.output.hasZerocopyPending() &&
+        !conn.readPaused && !conn.inFlight) {
+        closeConnection(conn);
+        return;
+    }
+    backend->updateInterest(conn);
+}
+
+void Reactor::handleWrite(Connection& conn) {
+    if (!flushOutput(conn)) {
+        return;
+    }
+
+    // 积压降到低水位以下后恢复读取，并补处理暂停期间留在缓冲区里的请求
+    if (conn.readPaused && conn.pendingOutput() <= server.outputLowWatermark) {
+        conn.readPaused = false;
+        if (backend->receive(conn)) {
+            handleInput(conn);
+        }
+        return;
+    }
+    if (conn.closeAfterFlush && conn.pendingOutput() == 0 && !conn.output.hasZerocopyPending() &&
+        !conn.inFlight) {
+        closeConnection(conn);
+        return;
+    }
+    backend->updateInterest(conn);
+}
+
+bool Reactor::processFrames(Connection& conn) {
+    size_t pos = 0;
+    bool ok = true;
+    // 有异步请求未完成时不分发新请求，保证同一连接的响应顺序
+    while (pos < conn.inBuf.size() && !conn.inFlight) {
+        // 超过高水位后不再处理新请求，剩余帧留在输入缓冲区
+        if (conn.pendingOutput() >= server.outputHighWatermark) {
+            conn.readPaused = true;
+            break;
+        }
+
+        size_t consumed = 0;
+        const char* payload = nullptr;
+        size_t payloadLen = 0;
+        FrameCodec::Result r = conn.codec.decode(conn.inBuf.data() + pos, conn.inBuf.size() - pos,
+                                                 consumed, payload, payloadLen);
+        if (r == FrameCodec::NEED_MORE) {
+            break;
+        }
+        if (r == FrameCodec::FRAME_ERROR) {
+            LOG_ERROR(conn.getPeer() + " Invalid or oversized frame");
+            ok = false;
+            break;
+        }
+        pos += consumed;
+        std::string response;
+        if (server.processRequest(payload, payloadLen, *this, conn, response)) {
+            conn.codec.encode(response, conn.output);
+        } else {
+            conn.inFlight = true;
+        }
+    }
+
+    conn.inBuf.erase(0, pos);
+    if (conn.inBuf.empty() && conn.inBuf.capacity() > kInBufShrinkThreshold) {
+        std::string().swap(conn.inBuf);
+    }
+    return ok;
+}
+
+bool Reactor::flushOutput(Connection& conn) {
+    if (conn.pendingOutput() == 0) {
+        return true;
+    }
+    Metrics::PhaseTimer timer(Metrics::WRITE);
+    return backend->send(conn);
+}
+
+void Reactor::closeConnection(Connection& conn) {
+    Metrics::connectionClosed();
+    LOG_DEBUG(conn.getPeer() + " Closing connection");
+    // 唤醒可能在等待窗口的分段响应生产者
+    if (conn.stream) {
+        conn.stream->cancel();
+    }
+
+    timers.cancel(conn.idleTimer);
+    timers.cancel(conn.deadlineTimer);
+    backend->close(conn);
+    // 会话随连接一起释放（工作线程仍在使用时由它最后放手）
+    connections.close(conn);
+}
+
+void Reactor::scheduleIdle(Connection& conn) {
+    uint64_t due = server.idleTimeoutNs > 0 ? conn.lastActive + server.idleTimeoutNs : 0;
+    uint64_t cursorDue = conn.session ? conn.session->nextCursorExpiry() : 0;
+    if (cursorDue > 0 && (due == 0 || cursorDue < due)) {
+        due = cursorDue;
+    }
+    if (due > 0) {
+        timers.schedule(conn.idleTimer, due);
+    } else {
+        timers.cancel(conn.idleTimer);
+    }
+}
+
+void Reactor::armDeadline(Connection& conn, uint64_t deadline) {
+    if (deadline > 0) {
+        timers.schedule(conn.deadlineTimer, deadline);
+    }
+}
+
+void Reactor::onTimer(TimerWheel::Timer& timer) {
+    Connection& conn = *static_cast<Connection*>(timer.owner);
+    if (&timer == &conn.deadlineTimer) {
+        if (conn.inFlight && conn.stream) {
+            LOG_WARN(conn.getPeer() + " Request " + conn.requestFuncId + " exceeded its deadline, interrupting");
+            conn.stream->expire();
+        }
+        return;
+    }
+
+    if (conn.inFlight) {
+        return;
+    }
+    if (conn.session && conn.session->getCursorCount() > 0) {
+        size_t closed = conn.session->closeIdleCursors(loopTime);
+        if (closed > 0) {
+            LOG_INFO(conn.getPeer() + " Closed " + std::to_string(closed) + " idle cursor(s)");
+        }
+    }
+    // 对端长时间不读取时写不出数据，最近活动时间不再更新，同样按空闲超时关闭
+    if (server.idleTimeoutNs > 0 && loopTime - conn.lastActive >= server.idleTimeoutNs) {
+        LOG_INFO(conn.getPeer() + " Idle timeout, closing connection");
+        closeConnection(conn);
+        return;
+    }
+    scheduleIdle(conn);
+}
+
+void Reactor::updateTimerFd() {
+    uint64_t next = timers.nextWakeup();
+    if (next == timerArmed) {
+        return;
+    }
+    // 时刻为0时停止计时
+    struct itimerspec spec;
+    std::memset(&spec, 0, sizeof(spec));
+    spec.it_value.tv_sec = static_cast<time_t>(next / 1000000000);
+    spec.it_value.tv_nsec = static_cast<long>(next % 1000000000);
+    timerfd_settime(timerFd, TFD_TIMER_ABSTIME, &spec, nullptr);
+    timerArmed = next;
+}
+
+std::shared_ptr<ResponseStream> Reactor::makeStream(Connection& conn) {
+    // AUTO模式在收到首个请求时已经判定出帧格式
+    bool chunked = conn.codec.getMode() == FrameCodec::NEWLINE;
+    for (auto& spare : conn.spareStreams) {
+        if (spare && spare.unique()) {
+            conn.stream = std::move(spare);
+            conn.stream->restart(chunked);
+            break;
+        }
+    }
+    if (!conn.stream) {
+        conn.stream = std::make_shared<ResponseStream>(*this, conn.id, chunked,
+                                                       server.outputHighWatermark);
+    }
+    conn.streamBase = conn.bytesSent + conn.pendingOutput();
+    return conn.stream;
+}
+
+std::string Reactor::takeBuffer() {
+    std::string buffer;
+    std::lock_guard<std::mutex> lock(completionMutex);
+    if (!spareBuffers.empty()) {
+        buffer.swap(spareBuffers.back());
+        spareBuffers.pop_back();
+    }
+    return buffer;
+}
+
+void Reactor::postCompletion(uint64_t connId, std::string& response, Completion::Kind kind,
+                             std::vector<std::string>* segments) {
+    {
+        std::lock_guard<std::mutex> lock(completionMutex);
+        Completion completion;
+        completion.connId = connId;
+        completion.kind = kind;
+        completion.response.swap(response);
+        if (segments) {
+            completion.segments.swap(*segments);
+        }
+        completions.push_back(std::move(completion));
+    }
+    uint64_t one = 1;
+    ssize_t n = write(wakeFd, &one, sizeof(one));
+    (void)n;    // 计数器溢出前必然已被唤醒，失败可以忽略
+}
+
+void Reactor::drainCompletions() {
+    uint64_t count;
+    while (read(wakeFd, &count, sizeof(count)) > 0) {
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(completionMutex);
+        ready.swap(completions);
+    }
+
+    for (auto& completion : ready) {
+        // 连接可能已关闭，fd也可能已被新连接复用
+        Connection* found = connections.find(completion.connId);
+        if (!found) {
+            continue;
+        }
+        Connection& conn = *found;
+        // 大的响应和分段整段接到输出队列上，小的拷贝进去，字符串留给recycleCompletions()回收
+        if (completion.kind == Completion::CHUNK) {
+            conn.output.take(completion.response);
+            if (flushOutput(conn)) {
+                backend->updateInterest(conn);
+            }
+            continue;
+        }
+        if (completion.kind == Completion::END) {
+            bool terminated = !completion.response.empty() && completion.response.back() == '\n';
+            conn.output.take(completion.response);
+            if (!terminated) {
+                conn.output.append("\n", 1);
+            }
+        } else {
+            conn.codec.encode(completion.segments, completion.response, conn.output);
+        }
+        conn.inFlight = false;
+        conn.retireStream();
+        conn.lastActive = loopTime;
+        timers.cancel(conn.deadlineTimer);
+        scheduleIdle(conn);
+        Metrics::recordRequest(conn.requestFuncId, Metrics::now() - conn.requestStart);
+
+        // 继续处理在等待期间到达的请求（已由后端读入输入缓冲区），并把响应写出
+        handleInput(conn);
+    }
+    recycleCompletions();
+}
+
+void Reactor::recycleCompletions() {
+    // 小的响应已拷进输出队列：申请过堆内存、又不太大的字符串留给工作线程写下一个响应
+    std::lock_guard<std::mutex> lock(completionMutex);
+    for (auto& completion : ready) {
+        std::string& buffer = completion.response;
+        if (spareBuffers.size() < kMaxSpareBuffers &&
+            buffer.capacity() > std::string().capacity() && buffer.capacity() <= kMaxSpareCapacity) {
+            buffer.clear();
+            spareBuffers.push_back(std::move(buffer));
+        }
+    }
+    ready.clear();
+}
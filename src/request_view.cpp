@@ -0,0 +1,547 @@
+#include "request_view.h"
+#include <cstring>
+
+namespace {
+const int kMaxDepth = 512;
+
+int hexValue(char c) {
+    if (c >= '0' && c <= '9') return c - '0';
+    if (c >= 'a' && c <= 'f') return c - 'a' + 10;
+    if (c >= 'A' && c <= 'F') return c - 'A' + 10;
+    return -1;
+}
+
+bool readHex4(const char* p, const char* end, unsigned int& value) {
+    if (end - p < 4) {
+        return false;
+    }
+    value = 0;
+    for (int i = 0; i < 4; i++) {
+        int h = hexValue(p[i]);
+        if (h < 0) {
+            return false;
+        }
+        value = (value << 4) | static_cast<unsigned int>(h);
+    }
+    return true;
+}
+
+template<class String>
+void appendUtf8(String& out, unsigned int cp) {
+    if (cp < 0x80) {
+        out.push_back(static_cast<char>(cp));
+    } else if (cp < 0x800) {
+        out.push_back(static_cast<char>(0xC0 | (cp >> 6)));
+        out.push_back(static_cast<char>(0x80 | (cp & 0x3F)));
+    } else if (cp < 0x10000) {
+        out.push_back(static_cast<char>(0xE0 | (cp >> 12)));
+        out.push_back(static_cast<char>(0x80 | ((cp >> 6) & 0x3F)));
+        out.push_back(static_cast<char>(0x80 | (cp & 0x3F)));
+    } else {
+        out.push_back(static_cast<char>(0xF0 | (cp >> 18)));
+        out.push_back(static_cast<char>(0x80 | ((cp >> 12) & 0x3F)));
+        out.push_back(static_cast<char>(0x80 | ((cp >> 6) & 0x3F)));
+        out.push_back(static_cast<char>(0x80 | (cp & 0x3F)));
+    }
+}
+
+template<class String>
+void unescapeInto(const RequestView::Slice& raw, String& out) {
+    out.clear();
+    out.reserve(raw.size);
+    const char* p = raw.data;
+    const char* end = raw.data + raw.size;
+    while (p < end) {
+        const char* bs = static_cast<const char*>(std::memchr(p, '\\', end - p));
+        if (!bs) {
+            out.append(p, end - p);
+            return;
+        }
+        out.append(p, bs - p);
+        p = bs + 1;
+        char c = *p++;
+        switch (c) {
+        case 'b': out.push_back('\b'); break;
+        case 'f': out.push_back('\f'); break;
+        case 'n': out.push_back('\n'); break;
+        case 'r': out.push_back('\r'); break;
+        case 't': out.push_back('\t'); break;
+        case 'u': {
+            unsigned int cp = 0;
+            readHex4(p, end, cp);
+            p += 4;
+            if (cp >= 0xD800 && cp <= 0xDBFF) {
+                unsigned int low = 0;
+                if (end - p >= 6 && p[0] == '\\' && p[1] == 'u' && readHex4(p + 2, end, low) &&
+                    low >= 0xDC00 && low <= 0xDFFF) {
+                    cp = 0x10000 + ((cp - 0xD800) << 10) + (low - 0xDC00);
+                    p += 6;
+                } else {
+                    cp = 0xFFFD;
+                }
+            } else if (cp >= 0xDC00 && cp <= 0xDFFF) {
+                cp = 0xFFFD;
+            }
+            appendUtf8(out, cp);
+            break;
+        }
+        default:
+            out.push_back(c);   // '"'、'\\'、'/'
+            break;
+        }
+    }
+}
+}
+
+void RequestView::unescape(const Slice& raw, std::string& out) {
+    unescapeInto(raw, out);
+}
+
+void RequestView::unescape(const Slice& raw, ArenaString& out) {
+    unescapeInto(raw, out);
+}
+
+namespace {
+/**
+ * @brief 只校验语法、记录位置的JSON扫描器
+ */
+struct Scanner {
+    const char* p;
+    const char* end;
+
+    void skipSpace() {
+        while (p < end && (*p == ' ' || *p == '\t' || *p == '\n' || *p == '\r')) {
+            p++;
+        }
+    }
+
+    bool consume(char c) {
+        skipSpace();
+        if (p < end && *p == c) {
+            p++;
+            return true;
+        }
+        return false;
+    }
+
+    // p指向开头的引号；out为不含引号的内容
+    bool scanString(RequestView::Slice& out, bool& escaped) {
+        p++;
+        const char* start = p;
+        escaped = false;
+        while (p < end) {
+            char c = *p;
+            if (c == '"') {
+                out = RequestView::Slice(start, p - start);
+                p++;
+                return true;
+            }
+            if (c == '\\') {
+                escaped = true;
+                if (end - p < 2) {
+                    return false;
+                }
+                char e = p[1];
+                if (e == 'u') {
+                    unsigned int cp;
+                    if (!readHex4(p + 2, end, cp)) {
+                        return false;
+                    }
+                    p += 6;
+                    continue;
+                }
+                if (!std::strchr("\"\\/bfnrt", e) || e == '\0') {
+                    return false;
+                }
+                p += 2;
+                continue;
+            }
+            p++;
+        }
+        return false;
+    }
+
+    bool scanDigits() {
+        const char* start = p;
+        while (p < end && *p >= '0' && *p <= '9') {
+            p++;
+        }
+        return p > start;
+    }
+
+    bool scanNumber() {
+        if (p < end && *p == '-') {
+            p++;
+        }
+        if (!scanDigits()) {
+            return false;
+        }
+        if (p < end && *p == '.') {
+            p++;
+            if (!scanDigits()) {
+                return false;
+            }
+        }
+        if (p < end && (*p == 'e' || *p == 'E')) {
+            p++;
+            if (p < end && (*p == '+' || *p == '-')) {
+                p++;
+            }
+            if (!scanDigits()) {
+                return false;
+            }
+        }
+        return true;
+    }
+
+    bool scanLiteral(const char* word, size_t n) {
+        if (static_cast<size_t>(end - p) < n || std::memcmp(p, word, n) != 0) {
+            return false;
+        }
+        p += n;
+        return true;
+    }
+
+    // 扫描一个值，记录类型和原始文本（字符串不含引号）
+    bool scanValue(int depth, RequestView::Type& type, RequestView::Slice& raw, bool& escaped) {
+        skipSpace();
+        if (p >= end || depth > kMaxDepth) {
+            return false;
+        }
+        escaped = false;
+        const char* start = p;
+        switch (*p) {
+        case '"':
+            type = RequestView::STRING;
+            return scanString(raw, escaped);
+        case '{':
+        case '[': {
+            char close = *p == '{' ? '}' : ']';
+            bool isObject = *p == '{';
+            type = isObject ? RequestView::OBJECT : RequestView::ARRAY;
+            p++;
+            if (!consume(close)) {
+                while (true) {
+                    RequestView::Type childType;
+                    RequestView::Slice child;
+                    bool childEscaped;
+                    if (isObject) {
+                        skipSpace();
+                        if (p >= end || *p != '"' || !scanString(child, childEscaped) || !consume(':')) {
+                            return false;
+                        }
+                    }
+                    if (!scanValue(depth + 1, childType, child, childEscaped)) {
+                        return false;
+                    }
+                    if (consume(close)) {
+                        break;
+                    }
+                    if (!consume(',')) {
+                        return false;
+                    }
+                }
+            }
+            raw = RequestView::Slice(start, p - start);
+            return true;
+        }
+        case 't':
+            type = RequestView::BOOLEAN;
+            if (!scanLiteral("true", 4)) return false;
+            break;
+        case 'f':
+            type = RequestView::BOOLEAN;
+            if (!scanLiteral("false", 5)) return false;
+            break;
+        case 'n':
+            type = RequestView::NULL_VALUE;
+            if (!scanLiteral("null", 4)) return false;
+            break;
+        default:
+            type = RequestView::NUMBER;
+            if (!scanNumber()) return false;
+            break;
+        }
+        raw = RequestView::Slice(start, p - start);
+        return true;
+    }
+};
+
+bool sliceEquals(const RequestView::Slice& s, const char* text) {
+    size_t n = std::strlen(text);
+    return s.size == n && std::memcmp(s.data, text, n) == 0;
+}
+
+/**
+ * @brief 每个线程一个DOM解析器（CharReaderBuilder的构造开销比解析小对象还大）
+ */
+Json::CharReader& threadReader() {
+    static thread_local std::unique_ptr<Json::CharReader> reader;
+    if (!reader) {
+        Json::CharReaderBuilder builder;
+        reader.reset(builder.newCharReader());
+    }
+    return *reader;
+}
+
+RequestView::Type typeOf(const Json::Value& v) {
+    switch (v.type()) {
+    case Json::nullValue:    return RequestView::NULL_VALUE;
+    case Json::booleanValue: return RequestView::BOOLEAN;
+    case Json::stringValue:  return RequestView::STRING;
+    case Json::arrayValue:   return RequestView::ARRAY;
+    case Json::objectValue:  return RequestView::OBJECT;
+    default:                 return RequestView::NUMBER;
+    }
+}
+}
+
+RequestView::RequestView()
+    : funcIdType(MISSING)
+    , funcIdEscaped(false)
+    , msgType(MISSING)
+    , fieldCount(0)
+    , needDom(false)
+{
+}
+
+bool RequestView::parse(const char* data, size_t len) {
+    payload = Slice(data, len);
+    funcIdType = MISSING;
+    msgType = MISSING;
+    fieldCount = 0;
+    needDom = false;
+    root.reset();
+
+    Scanner scanner;
+    scanner.p = data;
+    scanner.end = data + len;
+    if (!scanner.consume('{')) {
+        return false;
+    }
+    if (scanner.consume('}')) {
+        scanner.skipSpace();
+        return scanner.p == scanner.end;
+    }
+
+    while (true) {
+        Slice key;
+        bool keyEscaped;
+        scanner.skipSpace();
+        if (scanner.p >= scanner.end || *scanner.p != '"' || !scanner.scanString(key, keyEscaped) ||
+            !scanner.consume(':')) {
+            return false;
+        }
+        needDom = needDom || keyEscaped;
+
+        scanner.skipSpace();
+        if (sliceEquals(key, "msg") && scanner.p < scanner.end && *scanner.p == '{') {
+            // msg对象：逐个记录字段位置（重复的键以最后一个为准）
+            msgType = OBJECT;
+            fieldCount = 0;
+            scanner.p++;
+            if (!scanner.consume('}')) {
+                while (true) {
+                    Field field;
+                    scanner.skipSpace();
+                    if (scanner.p >= scanner.end || *scanner.p != '"' ||
+                        !scanner.scanString(field.key, keyEscaped) || !scanner.consume(':') ||
+                        !scanner.scanValue(2, field.type, field.value, field.escaped)) {
+                        return false;
+                    }
+                    needDom = needDom || keyEscaped;
+                    if (fieldCount < kMaxFields) {
+                        fields[fieldCount++] = field;
+                    } else {
+                        needDom = true;
+                    }
+                    if (scanner.consume('}')) {
+                        break;
+                    }
+                    if (!scanner.consume(',')) {
+                        return false;
+                    }
+                }
+            }
+        } else {
+            Type type;
+            Slice value;
+            bool escaped;
+            if (!scanner.scanValue(1, type, value, escaped)) {
+                return false;
+            }
+            if (sliceEquals(key, "funcid")) {
+                funcIdType = type;
+                funcId = value;
+                funcIdEscaped = escaped;
+            } else if (sliceEquals(key, "msg")) {
+                msgType = type;
+                fieldCount = 0;
+            }
+        }
+
+        if (scanner.consume('}')) {
+            break;
+        }
+        if (!scanner.consume(',')) {
+            return false;
+        }
+    }
+
+    scanner.skipSpace();
+    return scanner.p == scanner.end;
+}
+
+std::string RequestView::getFuncId() const {
+    if (needDom) {
+        const Json::Value& v = dom()["funcid"];
+        return v.isString() || v.isNumeric() ? v.asString() : std::string();
+    }
+    if (funcIdType == STRING && funcIdEscaped) {
+        std::string out;
+        unescape(funcId, out);
+        return out;
+    }
+    if (funcIdType == STRING || funcIdType == NUMBER) {
+        return funcId.str();
+    }
+    return std::string();
+}
+
+const RequestView::Field* RequestView::findField(const char* key) const {
+    // 从后往前找：重复的键以最后一个为准，与DOM解析一致
+    for (size_t i = fieldCount; i > 0; i--) {
+        if (sliceEquals(fields[i - 1].key, key)) {
+            return &fields[i - 1];
+        }
+    }
+    return nullptr;
+}
+
+RequestView::Type RequestView::getType(const char* key) const {
+    if (needDom) {
+        const Json::Value& msg = dom()["msg"];
+        return msg.isObject() && msg.isMember(key) ? typeOf(msg[key]) : MISSING;
+    }
+    const Field* field = findField(key);
+    return field ? field->type : MISSING;
+}
+
+template<class String>
+bool RequestView::getStringInto(const char* key, String& out) const {
+    if (needDom) {
+        const Json::Value& msg = dom()["msg"];
+        if (!msg.isObject() || !msg.isMember(key)) {
+            return false;
+        }
+        const Json::Value& v = msg[key];
+        if (v.isArray() || v.isObject()) {
+            return false;
+        }
+        out.clear();
+        if (!v.isNull()) {
+            std::string text = v.asString();
+            out.assign(text.data(), text.size());
+        }
+        return true;
+    }
+
+    const Field* field = findField(key);
+    if (!field || field->type == ARRAY || field->type == OBJECT) {
+        return false;
+    }
+    if (field->type == NULL_VALUE) {
+        out.clear();
+    } else if (field->escaped) {
+        unescape(field->value, out);
+    } else {
+        out.assign(field->value.data, field->value.size);
+    }
+    return true;
+}
+
+bool RequestView::getString(const char* key, std::string& out) const {
+    return getStringInto(key, out);
+}
+
+bool RequestView::getString(const char* key, ArenaString& out) const {
+    return getStringInto(key, out);
+}
+
+bool RequestView::getJson(const char* key, Json::Value& out) const {
+    out = Json::Value();
+    if (needDom) {
+        const Json::Value& msg = dom()["msg"];
+        if (!msg.isObject() || !msg.isMember(key)) {
+            return false;
+        }
+        out = msg[key];
+        return true;
+    }
+
+    const Field* field = findField(key);
+    if (!field) {
+        return false;
+    }
+    // 字符串的视图不含引号，解析时把两侧的引号带上
+    const char* begin = field->value.data;
+    const char* end = begin + field->value.size;
+    if (field->type == STRING) {
+        begin--;
+        end++;
+    }
+    std::string errors;
+    threadReader().parse(begin, end, &out, &errors);
+    return true;
+}
+
+bool RequestView::getRaw(const char* key, std::string& out) const {
+    out.clear();
+    if (needDom) {
+        const Json::Value& msg = dom()["msg"];
+        if (!msg.isObject() || !msg.isMember(key)) {
+            return false;
+        }
+        Json::StreamWriterBuilder builder;
+        builder["indentation"] = "";
+        out = Json::writeString(builder, msg[key]);
+        return true;
+    }
+
+    const Field* field = findField(key);
+    if (!field) {
+        return false;
+    }
+    if (field->type == STRING) {
+        out.assign(field->value.data - 1, field->value.size + 2);
+    } else {
+        out.assign(field->value.data, field->value.size);
+    }
+    return true;
+}
+
+bool RequestView::getSlice(const char* key, Slice& out) const {
+    out = Slice();
+    if (needDom) {
+        return false;
+    }
+    const Field* field = findField(key);
+    if (!field) {
+        return false;
+    }
+    if (field->type == STRING) {
+        out = Slice(field->value.data - 1, field->value.size + 2);
+    } else {
+        out = field->value;
+    }
+    return true;
+}
+
+const Json::Value& RequestView::dom() const {
+    if (!root) {
+        root.reset(new Json::Value());
+        std::string errors;
+        threadReader().parse(payload.data, payload.data + payload.size, root.get(), &errors);
+    }
+    return *root;
+}
@@ -0,0 +1,85 @@
+#include "response_stream.h"
+#include "reactor.h"
+
+ResponseStream::ResponseStream(Reactor& reactor, uint64_t connId, bool chunked, size_t window)
+    : reactor(reactor)
+    , connId(connId)
+    , chunked(chunked)
+    , window(window)
+    , posted(0)
+    , acked(0)
+    , cancelled(false)
+    , expired(false)
+    , deadline(0)
+{
+}
+
+void ResponseStream::restart(bool chunked) {
+    std::lock_guard<std::mutex> lock(mutex);
+    this->chunked = chunked;
+    posted = 0;
+    acked = 0;
+    cancelled = false;
+    expired.store(false, std::memory_order_relaxed);
+    deadline = 0;
+    ticket = AdmissionControl::Ticket();
+}
+
+std::string ResponseStream::takeBuffer() {
+    return reactor.takeBuffer();
+}
+
+void ResponseStream::send(std::string response) {
+    // 先归还名额再投递：客户端收到响应后立即发出的下一个请求不会被自己占着的名额拒绝
+    if (ticket.owner) {
+        ticket.owner->release(ticket);
+    }
+    reactor.postCompletion(connId, response, Reactor::Completion::RESPONSE);
+}
+
+void ResponseStream::send(std::vector<std::string>& segments, std::string response) {
+    if (ticket.owner) {
+        ticket.owner->release(ticket);
+    }
+    reactor.postCompletion(connId, response, Reactor::Completion::RESPONSE, &segments);
+}
+
+bool ResponseStream::write(std::string& chunk) {
+    {
+        std::unique_lock<std::mutex> lock(mutex);
+        cond.wait(lock, [this]() { return cancelled || isExpired() || posted - acked < window; });
+        if (cancelled || isExpired()) {
+            return false;
+        }
+        posted += chunk.size();
+    }
+    reactor.postCompletion(connId, chunk, Reactor::Completion::CHUNK);
+    return true;
+}
+
+void ResponseStream::end(std::string& tail) {
+    if (ticket.owner) {
+        ticket.owner->release(ticket);
+    }
+    reactor.postCompletion(connId, tail, Reactor::Completion::END);
+}
+
+void ResponseStream::acknowledge(uint64_t sent) {
+    std::lock_guard<std::mutex> lock(mutex);
+    if (sent > acked) {
+        acked = sent;
+        cond.notify_all();
+    }
+}
+
+void ResponseStream::cancel() {
+    std::lock_guard<std::mutex> lock(mutex);
+    cancelled = true;
+    cond.notify_all();
+}
+
+void ResponseStream::expire() {
+    std::lock_guard<std::mutex> lock(mutex);
+    expired.store(true, std::memory_order_relaxed);
+    cond.notify_all();
+}
@@ -0,0 +1,162 @@
+#include "result_cache.h"
+
+ResultCache::ResultCache()
+    : enabled(false)
+    , capacity(0)
+    , maxEntryBytes(0)
+    , stats()
+{
+}
+
+ResultCache& ResultCache::instance() {
+    static ResultCache cache;
+    return cache;
+}
+
+void ResultCache::setCapacity(size_t bytes) {
+    std::lock_guard<std::mutex> lock(mutex);
+    capacity = bytes;
+    maxEntryBytes = bytes / 16;
+    stats.capacity = bytes;
+    evict(bytes);
+    enabled.store(bytes > 0, std::memory_order_relaxed);
+}
+
+std::string ResultCache::makeKey(const std::string& dbPath, const std::string& sql, const SqlParams* params,
+                                 ResultEncoding encoding) {
+    std::string key;
+    key.reserve(dbPath.size() + sql.size() + 3);
+    key.push_back(encoding == RESULT_ENCODING_BINARY ? 'b' : 'j');
+    key += dbPath;
+    key.push_back('\0');
+    key += sql;
+    key.push_back('\0');
+    if (params) {
+        params->appendKey(key);
+    }
+    return key;
+}
+
+bool ResultCache::lookup(const std::string& key, std::string& response) {
+    std::shared_ptr<const std::string> found;
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        auto it = index.find(key);
+        if (it == index.end()) {
+            stats.misses++;
+            return false;
+        }
+        stats.hits++;
+        lru.splice(lru.begin(), lru, it->second);
+        found = it->second->response;
+    }
+    response = *found;
+    return true;
+}
+
+uint64_t ResultCache::getEpoch(const std::string& dbPath) {
+    std::lock_guard<std::mutex> lock(mutex);
+    return databases[dbPath].epoch;
+}
+
+void ResultCache::store(const std::string& dbPath, const std::string& key,
+                        const std::vector<std::string>& tables, const std::string& response, uint64_t epoch) {
+    size_t bytes = key.size() + response.size() + kEntryOverhead;
+    for (const std::string& table : tables) {
+        bytes += table.size() + kEntryOverhead;
+    }
+    // 响应在锁外拷贝
+    std::shared_ptr<const std::string> copy = std::make_shared<const std::string>(response);
+
+    std::lock_guard<std::mutex> lock(mutex);
+    if (bytes > maxEntryBytes) {
+        return;
+    }
+    Database& database = databases[dbPath];
+    if (database.epoch != epoch) {
+        stats.rejected++;
+        return;
+    }
+    auto existing = index.find(key);
+    if (existing != index.end()) {
+        erase(existing->second);
+    }
+    evict(capacity - bytes);
+
+    Entry entry;
+    entry.key = key;
+    entry.dbPath = dbPath;
+    entry.tables = tables;
+    entry.response = std::move(copy);
+    entry.bytes = bytes;
+    lru.push_front(std::move(entry));
+    index[key] = lru.begin();
+    for (const std::string& table : tables) {
+        database.byTable[table].insert(&lru.front());
+    }
+    stats.stores++;
+    stats.entries++;
+    stats.bytes += bytes;
+}
+
+void ResultCache::invalidate(const std::string& dbPath, const std::vector<std::string>& tables) {
+    std::lock_guard<std::mutex> lock(mutex);
+    Database& database = databases[dbPath];
+    database.epoch++;
+    for (const std::string& table : tables) {
+        auto it = database.byTable.find(table);
+        if (it == database.byTable.end()) {
+            continue;
+        }
+        // erase会修改集合，先取出
+        std::unordered_set<Entry*> victims;
+        victims.swap(it->second);
+        database.byTable.erase(it);
+        for (Entry* entry : victims) {
+            stats.invalidations++;
+            erase(index[entry->key]);
+        }
+    }
+}
+
+void ResultCache::invalidateAll(const std::string& dbPath) {
+    std::lock_guard<std::mutex> lock(mutex);
+    databases[dbPath].epoch++;
+    for (auto it = lru.begin(); it != lru.end();) {
+        auto next = std::next(it);
+        if (it->dbPath == dbPath) {
+            stats.invalidations++;
+            erase(it);
+        }
+        it = next;
+    }
+}
+
+ResultCacheStats ResultCache::getStats() const {
+    std::lock_guard<std::mutex> lock(mutex);
+    return stats;
+}
+
+void ResultCache::erase(EntryList::iterator it) {
+    Database& database = databases[it->dbPath];
+    for (const std::string& table : it->tables) {
+        auto tableIt = database.byTable.find(table);
+        if (tableIt != database.byTable.end()) {
+            tableIt->second.erase(&*it);
+            if (tableIt->second.empty()) {
+                database.byTable.erase(tableIt);
+            }
+        }
+    }
+    stats.entries--;
+    stats.bytes -= it->bytes;
+    index.erase(it->key);
+    lru.erase(it);
+}
+
+void ResultCache::evict(size_t limit) {
+    while (!lru.empty() && stats.bytes > limit) {
+        stats.evictions++;
+        erase(std::prev(lru.end()));
+    }
+}
@@ -0,0 +1,232 @@
+#include "result_writer.h"
+#include "json_writer.h"
+#include "base64.h"
+
+ResultWriter::ResultWriter(size_t chunkSize, const Sink& sink, Arena* arena)
+    : chunkSize(chunkSize)
+    , sink(sink)
+    , encoding(RESULT_ENCODING_JSON)
+    , columns(ArenaAllocator<ColumnInfo>(arena))
+    , rowCount(0)
+    , begun(false)
+    , ended(false)
+    , flushed(false)
+{
+}
+
+void ResultWriter::begin(sqlite3_stmt* stmt) {
+    int count = sqlite3_column_count(stmt);
+    if (encoding == RESULT_ENCODING_BINARY) {
+        BinaryResult::appendHeader(buffer, static_cast<size_t>(count));
+        for (int i = 0; i < count; i++) {
+            const char* name = sqlite3_column_name(stmt, i);
+            const char* declType = sqlite3_column_decltype(stmt, i);
+            BinaryResult::appendColumn(buffer, name, std::char_traits<char>::length(name),
+                                       declType ? declType : "", declType ? std::char_traits<char>::length(declType) : 0);
+        }
+        batch.reset(static_cast<size_t>(count));
+        begun = true;
+        return;
+    }
+    columns.resize(count);
+    for (int i = 0; i < count; i++) {
+        const char* name = sqlite3_column_name(stmt, i);
+        const char* declType = sqlite3_column_decltype(stmt, i);
+        ColumnInfo& column = columns[i];
+        column.key.clear();
+        JsonWriter::appendString(column.key, name, std::char_traits<char>::length(name));
+        column.key.push_back(':');
+        column.declType = declType ? declType : "";
+        column.storageClass = SQLITE_NULL;
+    }
+    buffer.append("{\"rows\":[", 9);
+    begun = true;
+}
+
+bool ResultWriter::addRow(sqlite3_stmt* stmt) {
+    if (encoding == RESULT_ENCODING_BINARY) {
+        addBinaryRow(stmt);
+        return flushChunk();
+    }
+    buffer.append(rowCount == 0 ? "{" : ",{", rowCount == 0 ? 1 : 2);
+    for (size_t i = 0; i < columns.size(); i++) {
+        ColumnInfo& column = columns[i];
+        if (i > 0) {
+            buffer.push_back(',');
+        }
+        buffer.append(column.key);
+
+        int type = sqlite3_column_type(stmt, static_cast<int>(i));
+        if (type == SQLITE_NULL) {
+            buffer.append("null", 4);
+            continue;
+        }
+        if (column.storageClass == SQLITE_NULL) {
+            column.storageClass = type;
+        } else if (column.storageClass != type) {
+            column.storageClass = SQLITE_TEXT;
+        }
+
+        // 数值以与SQLite一致的文本形式输出，BLOB输出Base64
+        switch (type) {
+        case SQLITE_INTEGER:
+            buffer.push_back('"');
+            JsonWriter::appendInteger(buffer, sqlite3_column_int64(stmt, static_cast<int>(i)));
+            buffer.push_back('"');
+            break;
+        case SQLITE_FLOAT:
+            buffer.push_back('"');
+            JsonWriter::appendReal(buffer, sqlite3_column_double(stmt, static_cast<int>(i)));
+            buffer.push_back('"');
+            break;
+        case SQLITE_BLOB: {
+            const char* data = static_cast<const char*>(sqlite3_column_blob(stmt, static_cast<int>(i)));
+            buffer.push_back('"');
+            base64Encode(data, sqlite3_column_bytes(stmt, static_cast<int>(i)), buffer);
+            buffer.push_back('"');
+            break;
+        }
+        default: {
+            const char* text = reinterpret_cast<const char*>(sqlite3_column_text(stmt, static_cast<int>(i)));
+            JsonWriter::appendString(buffer, text, sqlite3_column_bytes(stmt, static_cast<int>(i)));
+            break;
+        }
+        }
+    }
+    buffer.push_back('}');
+    rowCount++;
+    return flushChunk();
+}
+
+void ResultWriter::addBinaryRow(sqlite3_stmt* stmt) {
+    int count = sqlite3_column_count(stmt);
+    for (int i = 0; i < count; i++) {
+        switch (sqlite3_column_type(stmt, i)) {
+        case SQLITE_NULL:
+            batch.addNull();
+            break;
+        case SQLITE_INTEGER:
+            batch.addInteger(sqlite3_column_int64(stmt, i));
+            break;
+        case SQLITE_FLOAT:
+            batch.addReal(sqlite3_column_double(stmt, i));
+            break;
+        case SQLITE_BLOB:
+            batch.addBlob(static_cast<const char*>(sqlite3_column_blob(stmt, i)), sqlite3_column_bytes(stmt, i));
+            break;
+        default:
+            batch.addText(reinterpret_cast<const char*>(sqlite3_column_text(stmt, i)), sqlite3_column_bytes(stmt, i));
+            break;
+        }
+    }
+    batch.endRow();
+    rowCount++;
+    if (batch.isFull()) {
+        batch.flush(buffer);
+    }
+}
+
+bool ResultWriter::flushChunk() {
+    if (chunkSize > 0 && buffer.size() >= chunkSize) {
+        if (!sink) {
+            // 留存写满的分段，新缓冲区预留一些余量，越过分段大小的那一行不会引起扩容
+            segments.push_back(std::move(buffer));
+            buffer = std::string();
+            buffer.reserve(chunkSize + chunkSize / 4);
+            return true;
+        }
+        flushed = true;
+        bool open = sink(buffer);
+        buffer.clear();
+        return open;
+    }
+    return true;
+}
+
+void ResultWriter::end(int status, const char* msg, size_t len) {
+    if (ended) {
+        return;
+    }
+    ended = true;
+
+    if (encoding == RESULT_ENCODING_BINARY) {
+        endBinary(status, msg, len);
+        return;
+    }
+
+    JsonWriter writer(buffer);
+    if (!flushed && status != 0) {
+        // 行还没有发出去：只返回错误，与TableData的错误响应格式相同
+        segments.clear();
+        buffer.clear();
+        writer.beginObject();
+        writer.key("columns").beginObject().endObject();
+        writer.key("msg").value(msg, len);
+        writer.key("rows").beginArray().endArray();
+        if (!extra.empty()) {
+            buffer.push_back(',');
+            buffer.append(extra);
+        }
+        writer.key("status").value(status);
+        writer.endObject();
+        buffer.push_back('\n');
+        return;
+    }
+
+    if (!begun) {
+        buffer.append("{\"rows\":[", 9);
+    }
+    buffer.append("],\"columns\":{", 13);
+    for (size_t i = 0; i < columns.size(); i++) {
+        const ColumnInfo& column = columns[i];
+        if (i > 0) {
+            buffer.push_back(',');
+        }
+        buffer.append(column.key);
+        if (!column.declType.empty()) {
+            JsonWriter::appendString(buffer, column.declType.data(), column.declType.size());
+            continue;
+        }
+        switch (column.storageClass) {
+        case SQLITE_INTEGER: buffer.append("\"INTEGER\"", 9); break;
+        case SQLITE_FLOAT:   buffer.append("\"REAL\"", 6); break;
+        case SQLITE_TEXT:    buffer.append("\"TEXT\"", 6); break;
+        case SQLITE_BLOB:    buffer.append("\"BLOB\"", 6); break;
+        default:             buffer.append("\"NULL\"", 6); break;
+        }
+    }
+    buffer.append("},\"msg\":", 8);
+    JsonWriter::appendString(buffer, msg, len);
+    if (!extra.empty()) {
+        buffer.push_back(',');
+        buffer.append(extra);
+    }
+    buffer.append(",\"status\":", 10);
+    JsonWriter::appendInteger(buffer, status);
+    buffer.append("}\n", 2);
+}
+
+void ResultWriter::endBinary(int status, const char* msg, size_t len) {
+    if (!flushed && status != 0) {
+        // 与JSON相同：行还没有发出去时只返回错误
+        segments.clear();
+        buffer.clear();
+        BinaryResult::appendHeader(buffer, 0);
+    } else if (!begun) {
+        BinaryResult::appendHeader(buffer, 0);
+    } else {
+        batch.flush(buffer);
+    }
+    BinaryResult::appendTrailer(buffer, status, msg, len, extra);
+}
+
+void ResultWriter::writeTable(const TableData& table) {
+    segments.clear();
+    buffer.clear();
+    if (encoding == RESULT_ENCODING_BINARY) {
+        table.writeBinary(buffer);
+    } else {
+        table.writeJson(buffer);
+    }
+    ended = true;
+}
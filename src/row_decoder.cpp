@@ -0,0 +1,284 @@
+#include "row_decoder.h"
+#include <cstring>
+
+RowDecoder::RowDecoder(Format format, const std::vector<std::string>& columns)
+    : format(format)
+    , columns(columns)
+    , started(false)
+    , finished(false)
+{
+}
+
+void RowDecoder::reset(const char* data, size_t size) {
+    JsonScanner::reset(data, size);
+    started = false;
+    finished = false;
+}
+
+RowDecoder::Result RowDecoder::next(std::vector<SqlValue>& row) {
+    if (row.size() != columns.size()) {
+        row.resize(columns.size());
+    }
+    switch (format) {
+    case NDJSON:
+        return nextNdjson(row);
+    case CSV:
+        return nextCsv(row);
+    default:
+        return nextJson(row);
+    }
+}
+
+RowDecoder::Result RowDecoder::fail(const std::string& message) {
+    JsonScanner::fail(message);
+    return ERROR;
+}
+
+RowDecoder::Result RowDecoder::nextJson(std::vector<SqlValue>& row) {
+    if (finished) {
+        return END;
+    }
+    skipSpace();
+    if (!started) {
+        if (p >= end || *p != '[') {
+            return fail("rows must be an array");
+        }
+        p++;
+        started = true;
+        skipSpace();
+        if (p < end && *p == ']') {
+            finished = true;
+            return END;
+        }
+    } else if (p < end && *p == ',') {
+        p++;
+    } else if (p < end && *p == ']') {
+        finished = true;
+        return END;
+    } else {
+        return fail("expected ',' or ']' after row");
+    }
+
+    skipSpace();
+    if (!parseRow(row)) {
+        return ERROR;
+    }
+    return ROW;
+}
+
+RowDecoder::Result RowDecoder::nextNdjson(std::vector<SqlValue>& row) {
+    skipSpace();
+    if (p >= end) {
+        return END;
+    }
+    if (!parseRow(row)) {
+        return ERROR;
+    }
+    while (p < end && (*p == ' ' || *p == '\t' || *p == '\r')) {
+        p++;
+    }
+    if (p < end && *p != '\n') {
+        return fail("unexpected data after row");
+    }
+    return ROW;
+}
+
+RowDecoder::Result RowDecoder::nextCsv(std::vector<SqlValue>& row) {
+    // 跳过空行（包括结尾的换行）
+    while (p < end && (*p == '\n' || *p == '\r')) {
+        p++;
+    }
+    if (p >= end) {
+        return END;
+    }
+
+    size_t count = 0;
+    bool last = false;
+    while (!last) {
+        if (count >= columns.size()) {
+            return fail("record has more than " + std::to_string(columns.size()) + " fields");
+        }
+        if (!parseCsvField(row[count++], last)) {
+            return ERROR;
+        }
+    }
+    if (count != columns.size()) {
+        return fail("record has " + std::to_string(count) + " fields, expected " +
+                    std::to_string(columns.size()));
+    }
+    return ROW;
+}
+
+bool RowDecoder::readHeader() {
+    while (p < end && (*p == '\n' || *p == '\r')) {
+        p++;
+    }
+    if (p >= end) {
+        error = "missing CSV header";
+        return false;
+    }
+
+    std::vector<std::string> names;
+    SqlValue field;
+    bool last = false;
+    while (!last) {
+        if (!parseCsvField(field, last)) {
+            return false;
+        }
+        names.push_back(std::string(field.bytes.data(), field.bytes.size()));
+    }
+    if (columns.empty()) {
+        columns.swap(names);
+    }
+    return true;
+}
+
+bool RowDecoder::parseRow(std::vector<SqlValue>& row) {
+    for (SqlValue& value : row) {
+        value.type = SqlValue::NULL_VALUE;
+    }
+
+    if (p < end && *p == '[') {
+        p++;
+        skipSpace();
+        size_t count = 0;
+        if (p < end && *p == ']') {
+            p++;
+        } else {
+            while (true) {
+                if (count >= columns.size()) {
+                    fail("row has more than " + std::to_string(columns.size()) + " values");
+                    return false;
+                }
+                if (!parseValue(row[count++])) {
+                    return false;
+                }
+                skipSpace();
+                if (p < end && *p == ',') {
+                    p++;
+                    continue;
+                }
+                if (p < end && *p == ']') {
+                    p++;
+                    break;
+                }
+                fail("expected ',' or ']' in row");
+                return false;
+            }
+        }
+        if (count != columns.size()) {
+            fail("row has " + std::to_string(count) + " values, expected " + std::to_string(columns.size()));
+            return false;
+        }
+        return true;
+    }
+
+    if (p < end && *p == '{') {
+        p++;
+        skipSpace();
+        if (p < end && *p == '}') {
+            p++;
+            return true;
+        }
+        while (true) {
+            skipSpace();
+            if (p >= end || *p != '"' || !parseString(scratch)) {
+                if (error.empty()) {
+                    fail("expected a column name");
+                }
+                return false;
+            }
+            int column = findColumn(scratch.data(), scratch.size());
+            skipSpace();
+            if (p >= end || *p != ':') {
+                fail("expected ':' after column name");
+                return false;
+            }
+            p++;
+            skipSpace();
+            // 不在列清单中的键忽略
+            if (!(column < 0 ? skipValue(0) : parseValue(row[column]))) {
+                return false;
+            }
+            skipSpace();
+            if (p < end && *p == ',') {
+                p++;
+                continue;
+            }
+            if (p < end && *p == '}') {
+                p++;
+                return true;
+            }
+            fail("expected ',' or '}' in row");
+            return false;
+        }
+    }
+
+    fail("row must be an array or an object");
+    return false;
+}
+
+bool RowDecoder::parseCsvField(SqlValue& value, bool& last) {
+    if (p < end && *p == '"') {
+        // 带引号的字段，""表示一个引号
+        value.type = SqlValue::TEXT;
+        value.bytes.clear();
+        p++;
+        while (true) {
+            const char* quote = static_cast<const char*>(std::memchr(p, '"', end - p));
+            if (!quote) {
+                fail("unterminated quoted field");
+                return false;
+            }
+            value.bytes.append(p, quote - p);
+            p = quote + 1;
+            if (p < end && *p == '"') {
+                value.bytes.push_back('"');
+                p++;
+                continue;
+            }
+            break;
+        }
+        if (p < end && *p != ',' && *p != '\n' && *p != '\r') {
+            fail("unexpected character after quoted field");
+            return false;
+        }
+    } else {
+        const char* start = p;
+        while (p < end && *p != ',' && *p != '\n' && *p != '\r') {
+            p++;
+        }
+        if (p == start) {
+            value.type = SqlValue::NULL_VALUE;
+        } else {
+            value.type = SqlValue::TEXT;
+            value.bytes.assign(start, p - start);
+        }
+    }
+
+    last = true;
+    if (p >= end) {
+        return true;
+    }
+    if (*p == ',') {
+        p++;
+        last = false;
+        return true;
+    }
+    if (*p == '\r') {
+        p++;
+    }
+    if (p < end && *p == '\n') {
+        p++;
+    }
+    return true;
+}
+
+int RowDecoder::findColumn(const char* name, size_t len) const {
+    for (size_t i = 0; i < columns.size(); i++) {
+        if (columns[i].size() == len && std::memcmp(columns[i].data(), name, len) == 0) {
+            return static_cast<int>(i);
+        }
+    }
+    return -1;
+}
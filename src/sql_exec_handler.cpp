@@ -1,166 +1,394 @@
 #include "sql_exec_handler.h"
-#include "sqlite_connect_handler.h"
+#include "connection.h"
+#include "metrics.h"
+#include "result_cache.h"
 #include <json/json.h>
-#include <sstream>
-#include <algorithm>
-#include <cctype>
-
-SqlExecHandler::SqlExecHandler() {}
-
-std::vector<std::string> SqlExecHandler::splitSqlStatements(const std::string& sqlStr) {
-    std::vector<std::string> statements;
-    std::istringstream ss(sqlStr);
-    std::string statement;
-    std::string temp;
-    
-    while (std::getline(ss, temp, ';')) {
-        temp.erase(0, temp.find_first_not_of(" \n\r\t"));
-        temp.erase(temp.find_last_not_of(" \n\r\t") + 1);
-        
-        if (!temp.empty()) {
-            statement += temp + ";";
-            statements.push_back(statement);
-            statement.clear();
-        }
+
+SqlExecHandler::SqlExecHandler(std::shared_ptr<WorkerPool> workers)
+    : workers(workers)
+{
+}
+
+void SqlExecHandler::splitSqlStatements(SqlText sqlStr, StatementList& statements) {
+    statements.clear();
+    Arena* arena = statements.get_allocator().getArena();
+    SqlLexer lexer(sqlStr.data, sqlStr.size);
+    SqlLexer::Statement token;
+    while (lexer.next(token)) {
+        statements.emplace_back(arena);
+        statements.back().sql.assign(token.data, token.size);
+        statements.back().kind = token.kind;
     }
-    
-    return statements;
 }
 
-bool SqlExecHandler::isQueryStatement(const std::string& sql) {
-    std::string lowerSql = sql;
-    std::transform(lowerSql.begin(), lowerSql.end(), lowerSql.begin(), ::tolower);
-    return lowerSql.find("select") != std::string::npos;
+bool SqlExecHandler::isReadOnlyBatch(const StatementList& statements) {
+    for (const auto& statement : statements) {
+        if (!SqlLexer::isReadOnly(statement.kind)) {
+            return false;
+        }
+    }
+    return true;
 }
 
-bool SqlExecHandler::isDeleteStatement(const std::string& sql) {
-    std::string lowerSql = sql;
-    std::transform(lowerSql.begin(), lowerSql.end(), lowerSql.begin(), ::tolower);
-    return lowerSql.find("delete") != std::string::npos;
+bool SqlExecHandler::isGroupableBatch(const StatementList& statements) {
+    for (const auto& statement : statements) {
+        switch (statement.kind) {
+        case SqlLexer::QUERY:
+        case SqlLexer::INSERT:
+        case SqlLexer::UPDATE:
+        case SqlLexer::DELETE:
+        case SqlLexer::DDL:
+            break;
+        default:
+            return false;
+        }
+    }
+    return true;
 }
 
-bool SqlExecHandler::isInsertStatement(const std::string& sql) {
-    std::string lowerSql = sql;
-    std::transform(lowerSql.begin(), lowerSql.end(), lowerSql.begin(), ::tolower);
-    return lowerSql.find("insert") != std::string::npos;
+bool SqlExecHandler::needTransaction(const StatementList& statements) {
+    if (statements.size() < 2) {
+        return false;
+    }
+    for (const auto& statement : statements) {
+        if (statement.kind == SqlLexer::TRANSACTION) {
+            return false;
+        }
+    }
+    return true;
 }
 
-bool SqlExecHandler::needTransaction(const std::vector<std::string>& statements) {
-    if (statements.size() > 1) {
-        return true;
+bool SqlExecHandler::parseRequest(const RequestView& view, Connection& conn,
+                                  SqlRequest& request, std::string& errorResponse) {
+    TableData result;
+    result.setStatus(-1);
+
+    request.session = conn.session;
+    if (!request.session) {
+        result.setMsg("Database connection not initialized");
+        errorResponse = result.toJson();
+        return false;
+    }
+
+    ArenaString sqlStr{ArenaAllocator<char>(request.arena)};
+    if (!view.getString("sqlstr", sqlStr)) {
+        result.setMsg("Missing sqlstr in request");
+        errorResponse = result.toJson();
+        return false;
+    }
+    if (sqlStr.empty()) {
+        result.setMsg("Empty SQL statement");
+        errorResponse = result.toJson();
+        return false;
+    }
+
+    splitSqlStatements(sqlStr, request.statements);
+    if (request.statements.empty()) {
+        result.setMsg("No valid SQL statements");
+        errorResponse = result.toJson();
+        return false;
+    }
+
+    // 可选的绑定参数：数组按位置绑定，对象按名称绑定；直接从请求文本解析
+    std::string paramError;
+    if (!request.params.parse(view, "params", paramError)) {
+        result.setMsg("Invalid params: " + paramError);
+        errorResponse = result.toJson();
+        return false;
+    }
+    if (request.params.isPositional() && request.statements.size() > 1) {
+        result.setMsg("Positional params require a single SQL statement; use named params");
+        errorResponse = result.toJson();
+        return false;
     }
-    
-    const std::string& sql = statements[0];
-    return !isQueryStatement(sql);
+
+    request.readOnly = isReadOnlyBatch(request.statements);
+    request.groupable = !request.readOnly && isGroupableBatch(request.statements);
+    return true;
 }
 
-std::string SqlExecHandler::handle(const Json::Value& parsedRequest, int clientFd) {
+void SqlExecHandler::execute(SqlRequest& request, std::string& response) {
     TableData result;
-    
+    ResultEncoding encoding = request.session->getEncoding();
+
     try {
-        Sqlite3Handler* dbHandler = SqliteConnectHandler::getHandler(clientFd);
-        if (!dbHandler) {
+        // 只读请求租用只读连接，其余租用写连接；请求结束即归还（未结束的事务除外）
+        SqlitePool::Lease lease;
+        std::string leaseError;
+        uint64_t deadline = request.stream ? request.stream->getDeadline() : 0;
+        if (!request.session->acquire(request.readOnly, lease, leaseError, deadline)) {
             result.setStatus(-1);
-            result.setMsg("Database connection not initialized");
-            return result.toJson();
+            result.setMsg(leaseError);
+            response.clear();
+            result.write(response, encoding);
+            return;
         }
-
-        if (!parsedRequest.isMember("msg") || !parsedRequest["msg"].isMember("sqlstr")) {
-            result.setStatus(-1);
-            result.setMsg("Missing sqlstr in request");
-            return result.toJson();
-        }
-        
-        std::string sqlStr = parsedRequest["msg"]["sqlstr"].asString();
-        if (sqlStr.empty()) {
-            result.setStatus(-1);
-            result.setMsg("Empty SQL statement");
-            return result.toJson();
+        const SqlParams* bound = request.params.empty() ? nullptr : &request.params;
+        {
+            // 超过截止时间时中止正在执行的语句；归还连接前清除
+            Sqlite3Handler::InterruptScope interrupt(*lease.get(), request.stream ? request.stream->getDeadlineFlag() : nullptr);
+            executeStatements(lease.get(), request.statements, bound, encoding, response);
         }
+        request.session->release(lease);
 
-        std::vector<std::string> sqlStatements = splitSqlStatements(sqlStr);
-        if (sqlStatements.empty()) {
-            result.setStatus(-1);
-            result.setMsg("No valid SQL statements");
-            return result.toJson();
+    } catch (const std::exception& e) {
+        result.setStatus(-1);
+        result.setMsg(std::string("Exception occurred: ") + e.what());
+        response.clear();
+        result.write(response, encoding);
+    }
+}
+
+std::string SqlExecHandler::handle(const RequestView& view, Connection& conn) {
+    SqlRequest request(nullptr);
+    std::string response;
+    if (parseRequest(view, conn, request, response)) {
+        execute(request, response);
+    }
+    return response;
+}
+
+void SqlExecHandler::executeStreaming(SqlRequest& request, ResponseStream& stream) {
+    const ArenaString& sql = request.statements[0].sql;
+    const SqlParams* bound = request.params.empty() ? nullptr : &request.params;
+    SqlitePool& pool = request.session->getPool();
+    ResultEncoding encoding = request.session->getEncoding();
+
+    // 结果缓存：会话有进行中的事务时，查询会读到本事务未提交的修改，不走缓存
+    ResultCache& cache = ResultCache::instance();
+    bool useCache = cache.isEnabled() && !request.session->hasPinnedConnection();
+    std::string cacheKey;
+    uint64_t epoch = 0;
+    if (useCache) {
+        pool.checkExternalWrites();
+        cacheKey = ResultCache::makeKey(pool.getPath(), SqlText(sql).str(), bound, encoding);
+        std::string cached;
+        if (cache.lookup(cacheKey, cached)) {
+            stream.send(std::move(cached));
+            return;
         }
+        epoch = cache.getEpoch(pool.getPath());
+    }
 
-        bool useTransaction = needTransaction(sqlStatements);
-        bool hasExplicitTransaction = false;
-        
-        for (const auto& sql : sqlStatements) {
-            std::string lowerSql = sql;
-            std::transform(lowerSql.begin(), lowerSql.end(), lowerSql.begin(), ::tolower);
-            if (lowerSql.find("begin") != std::string::npos) {
-                hasExplicitTransaction = true;
-                break;
+    // 长度前缀帧不能分段发送，写满的分段留在writer里，最后作为完整响应的各段一起交出
+    ResultWriter::Sink sink;
+    if (stream.isChunked()) {
+        sink = [&stream](std::string& chunk) { return stream.write(chunk); };
+    }
+    ResultWriter writer(kStreamChunkSize, sink, request.arena);
+    writer.setEncoding(encoding);
+    writer.setBuffer(stream.takeBuffer());
+    bool cacheable = false;
+    std::vector<std::string> tables;
+
+    try {
+        SqlitePool::Lease lease;
+        std::string leaseError;
+        if (!request.session->acquire(true, lease, leaseError, stream.getDeadline())) {
+            writer.end(-1, leaseError);
+        } else {
+            {
+                Sqlite3Handler::InterruptScope interrupt(*lease.get(), stream.getDeadlineFlag());
+                bool ok = lease->streamQuery(sql, bound, writer);
+                const StatementInfo& info = lease->getStatementInfo();
+                if (useCache && ok && info.cacheable) {
+                    cacheable = true;
+                    tables = info.tables;
+                }
             }
+            request.session->release(lease);
         }
+    } catch (const std::exception& e) {
+        writer.end(-1, std::string("Exception occurred: ") + e.what());
+    }
 
-        if (useTransaction && !hasExplicitTransaction) {
-            if (!dbHandler->beginTransaction()) {
-                result.setStatus(-1);
-                result.setMsg("Failed to begin transaction");
-                return result.toJson();
+    // 还没有分段发出时整个响应都在writer里，按完整响应发送（长度前缀帧也走这里）
+    if (writer.hasFlushed()) {
+        stream.end(writer.getBuffer());
+    } else {
+        std::vector<std::string>& segments = writer.getSegments();
+        if (cacheable && segments.empty()) {
+            cache.store(pool.getPath(), cacheKey, tables, writer.getBuffer(), epoch);
+        } else if (cacheable) {
+            // 缓存条目是一个完整的字符串，只在这里才把各段拼起来
+            size_t total = writer.getBuffer().size();
+            for (const std::string& segment : segments) {
+                total += segment.size();
+            }
+            std::string whole;
+            whole.reserve(total);
+            for (const std::string& segment : segments) {
+                whole.append(segment);
             }
+            whole.append(writer.getBuffer());
+            cache.store(pool.getPath(), cacheKey, tables, whole, epoch);
+        }
+        stream.send(segments, std::move(writer.getBuffer()));
+    }
+}
+
+void SqlExecHandler::handleAsync(const RequestView& view, Connection& conn,
+                                 const std::shared_ptr<ResponseStream>& stream) {
+    // 请求校验在Reactor线程上完成（请求视图只在此期间有效），只有真正的SQL执行交给工作线程
+    Arena* arena = Arena::acquire();
+    SqlRequest* request = arena->create<SqlRequest>(arena);
+    std::string errorResponse;
+    if (!parseRequest(view, conn, *request, errorResponse)) {
+        arena->release();
+        stream->send(errorResponse);
+        return;
+    }
+    request->stream = stream;
+    request->queued = Metrics::now();
+
+    // 任务只捕获两个指针，存放在std::function内部，不另外分配
+    WorkerPool::Task task;
+    if (request->readOnly && request->statements.size() == 1) {
+        task = [this, request]() { run(request, true); };
+    } else {
+        task = [this, request]() { run(request, false); };
+    }
+
+    // 读请求直接并行执行；写请求进入数据库的串行队列保持顺序；
+    // 持有跨请求事务的会话已独占写连接，不能排在等待写连接的任务后面
+    if (request->readOnly || request->session->hasPinnedConnection()) {
+        workers->submit(std::move(task), stream->getPriority());
+        return;
+    }
+    GroupCommit& groupCommit = request->session->getPool().getGroupCommit();
+    if (request->groupable && groupCommit.isEnabled()) {
+        // 与同一数据库上并发的写请求合并在一个事务里提交，各自在保存点中执行
+        groupCommit.submit(*workers,
+            [this, request](Sqlite3Handler* db, std::string& response) {
+                Metrics::recordPhase(Metrics::DISPATCH, Metrics::now() - request->queued);
+                ResultEncoding encoding = request->session->getEncoding();
+                if (request->stream->isExpired()) {
+                    TableData::writeStatus(response, -1, Sqlite3Handler::kDeadlineExceeded, encoding);
+                    return false;
+                }
+                Sqlite3Handler::InterruptScope interrupt(*db, request->stream->getDeadlineFlag());
+                const SqlParams* bound = request->params.empty() ? nullptr : &request->params;
+                return executeStatements(db, request->statements, bound, encoding, response);
+            },
+            [request](std::string response) {
+                request->stream->send(std::move(response));
+                request->arena->release();
+            },
+            request->stream->takeBuffer(), stream->getPriority(),
+            stream->getDeadlineFlag(), stream->getDeadline(), request->session->getEncoding());
+        return;
+    }
+    request->session->getPool().getWriteQueue().post(*workers, std::move(task), stream->getPriority());
+}
+
+void SqlExecHandler::run(SqlRequest* request, bool streaming) {
+    Metrics::recordPhase(Metrics::DISPATCH, Metrics::now() - request->queued);
+    ResultEncoding encoding = request->session->getEncoding();
+    if (request->stream->isExpired()) {
+        // 排队期间已超过截止时间，不再执行
+        std::string response = request->stream->takeBuffer();
+        TableData::writeStatus(response, -1, Sqlite3Handler::kDeadlineExceeded, encoding);
+        request->stream->send(std::move(response));
+    } else if (WorkerPool::shouldShed()) {
+        std::string response = request->stream->takeBuffer();
+        TableData::writeStatus(response, AdmissionControl::kStatusOverloaded, AdmissionControl::kOverloadedMessage,
+                               encoding);
+        request->stream->send(std::move(response));
+    } else if (streaming) {
+        executeStreaming(*request, *request->stream);
+    } else {
+        std::string response = request->stream->takeBuffer();
+        execute(*request, response);
+        request->stream->send(std::move(response));
+    }
+    // 响应已发出：请求（连同会话和响应通道的引用）随arena一起回收
+    request->arena->release();
+}
+
+bool SqlExecHandler::executeStatements(Sqlite3Handler* dbHandler,
+                                       const StatementList& sqlStatements,
+                                       const SqlParams* bound, ResultEncoding encoding,
+                                       std::string& response) {
+    TableData result;
+    response.clear();
+
+    try {
+        // 连接上已有跨请求的事务时不再包一层
+        bool useTransaction = needTransaction(sqlStatements) && !dbHandler->inTransaction();
+        if (useTransaction && !dbHandler->beginTransaction()) {
+            result.setStatus(-1);
+            result.setMsg("Failed to begin transaction");
+            result.write(response, encoding);
+            return false;
         }
 
-        for (const auto& sql : sqlStatements) {
-            if (isQueryStatement(sql)) {
-                result = dbHandler->executeQuery(sql);
+        bool hasTable = false;          // 执行过查询，响应中带着它的结果
+        const char* message = nullptr;  // 最后一条写语句的结果消息
+        for (const auto& statement : sqlStatements) {
+            if (SqlLexer::returnsRows(statement.kind)) {
+                result = dbHandler->executeQuery(statement.sql, bound);
+                hasTable = true;
+                message = nullptr;
                 if (result.getStatus() != 0) {
-                    if (useTransaction && !hasExplicitTransaction) {
+                    if (useTransaction) {
                         dbHandler->rollback();
                     }
-                    return result.toJson();
+                    result.write(response, encoding);
+                    return false;
                 }
+                continue;
+            }
+
+            const char* operation;
+            if (statement.kind == SqlLexer::DELETE) {
+                operation = "Delete";
+                message = "Delete successful";
+            } else if (statement.kind == SqlLexer::INSERT) {
+                operation = "Insert";
+                message = "Insert successful";
             } else {
-                bool success = dbHandler->executeUpdate(sql);
-                if (!success) {
-                    result.setStatus(-1);
-                    std::string operation;
-                    if (isDeleteStatement(sql)) {
-                        operation = "Delete";
-                    } else if (isInsertStatement(sql)) {
-                        operation = "Insert";
-                    } else {
-                        operation = "Update";
-                    }
-                    result.setMsg(operation + " operation failed: " + dbHandler->getLastError());
-                    if (useTransaction && !hasExplicitTransaction) {
-                        dbHandler->rollback();
-                    }
-                    return result.toJson();
-                }
-                result.setStatus(0);
-                std::string operation;
-                if (isDeleteStatement(sql)) {
-                    operation = "Delete";
-                    result.setAffectedRows(dbHandler->getAffectedRows());
-                } else if (isInsertStatement(sql)) {
-                    operation = "Insert";
-                    result.setAffectedRows(dbHandler->getAffectedRows());
-                } else {
-                    operation = "Update";
+                operation = "Update";
+                message = "Update successful";
+            }
+            if (!dbHandler->executeUpdate(statement.sql, bound)) {
+                result.setStatus(-1);
+                result.setMsg(std::string(operation) + " operation failed: " + dbHandler->getLastError());
+                if (useTransaction) {
+                    dbHandler->rollback();
                 }
-                result.setMsg(operation + " successful");
+                result.write(response, encoding);
+                return false;
+            }
+            if (statement.kind == SqlLexer::DELETE || statement.kind == SqlLexer::INSERT) {
+                result.setAffectedRows(dbHandler->getAffectedRows());
             }
         }
 
-        if (useTransaction && !hasExplicitTransaction) {
-            if (!dbHandler->commitTransaction()) {
-                result.setStatus(-1);
-                result.setMsg("Failed to commit transaction");
-                dbHandler->rollback();
-                return result.toJson();
-            }
+        if (useTransaction && !dbHandler->commitTransaction()) {
+            result.setStatus(-1);
+            result.setMsg("Failed to commit transaction");
+            dbHandler->rollback();
+            result.write(response, encoding);
+            return false;
         }
 
-        return result.toJson();
+        // 只有写语句时直接写出状态，不为消息构造字符串；之前的查询结果仍随响应返回
+        if (message && !hasTable) {
+            TableData::writeStatus(response, 0, message, encoding);
+        } else {
+            if (message) {
+                result.setStatus(0);
+                result.setMsg(message);
+            }
+            result.write(response, encoding);
+        }
+        return true;
         
     } catch (const std::exception& e) {
         result.setStatus(-1);
         result.setMsg(std::string("Exception occurred: ") + e.what());
-        return result.toJson();
+        response.clear();
+        result.write(response, encoding);
+        return false;
     }
-} 
\ No newline at end of file
+}
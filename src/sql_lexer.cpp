@@ -0,0 +1,327 @@
+#include "sql_lexer.h"
+#include <cstring>
+
+namespace {
+/**
+ * @brief 词法单元类型
+ */
+enum Token {
+    TK_SEMI,        // ;
+    TK_SPACE,       // 空白和注释
+    TK_WORD,        // 标识符、关键字、数字
+    TK_OTHER        // 字符串、带引号的标识符、其他符号
+};
+
+/**
+ * @brief 语句结束判定用的单元（与sqlite3_complete相同）
+ */
+enum CompleteToken {
+    CT_SEMI,
+    CT_WS,
+    CT_OTHER,
+    CT_EXPLAIN,
+    CT_CREATE,
+    CT_TEMP,
+    CT_TRIGGER,
+    CT_END
+};
+
+/**
+ * @brief 语句结束判定的状态转移表
+ * 状态：0 INVALID、1 START、2 NORMAL、3 EXPLAIN、4 CREATE、5 TRIGGER（触发器体内，分号不结束语句）、
+ * 6 SEMI（触发器体内见到分号）、7 END（见到";END"，再遇到分号时触发器定义结束）
+ */
+const unsigned char kTransitions[8][8] = {
+    /*              SEMI  WS  OTHER  EXPLAIN  CREATE  TEMP  TRIGGER  END */
+    /* 0 INVALID */ { 1,   0,    2,      3,      4,     2,      2,    2 },
+    /* 1 START   */ { 1,   1,    2,      3,      4,     2,      2,    2 },
+    /* 2 NORMAL  */ { 1,   2,    2,      2,      2,     2,      2,    2 },
+    /* 3 EXPLAIN */ { 1,   3,    3,      2,      4,     2,      2,    2 },
+    /* 4 CREATE  */ { 1,   4,    2,      2,      2,     4,      5,    2 },
+    /* 5 TRIGGER */ { 6,   5,    5,      5,      5,     5,      5,    5 },
+    /* 6 SEMI    */ { 6,   6,    5,      5,      5,     5,      5,    7 },
+    /* 7 END     */ { 1,   7,    5,      5,      5,     5,      5,    5 },
+};
+
+const unsigned char kStart = 1;
+const unsigned char kNormal = 2;
+
+/**
+ * @brief 字符类别表，扫描时每个字符查一次表
+ */
+enum CharClass : unsigned char {
+    CC_OTHER,
+    CC_SPACE,
+    CC_WORD,        // 字母、数字、_、$及非ASCII字节
+    CC_QUOTE,       // ' " ` [
+    CC_SEMI,
+    CC_MINUS,
+    CC_SLASH
+};
+
+struct CharTable {
+    unsigned char cls[256];
+
+    CharTable() {
+        for (int c = 0; c < 256; c++) {
+            bool word = (c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z') || (c >= '0' && c <= '9') ||
+                        c == '_' || c == '$' || c >= 0x80;
+            cls[c] = word ? CC_WORD : CC_OTHER;
+        }
+        const char spaces[] = " \t\n\r\f\v";
+        for (const char* p = spaces; *p; p++) {
+            cls[static_cast<unsigned char>(*p)] = CC_SPACE;
+        }
+        cls[static_cast<unsigned char>('\'')] = CC_QUOTE;
+        cls[static_cast<unsigned char>('"')] = CC_QUOTE;
+        cls[static_cast<unsigned char>('`')] = CC_QUOTE;
+        cls[static_cast<unsigned char>('[')] = CC_QUOTE;
+        cls[static_cast<unsigned char>(';')] = CC_SEMI;
+        cls[static_cast<unsigned char>('-')] = CC_MINUS;
+        cls[static_cast<unsigned char>('/')] = CC_SLASH;
+    }
+};
+
+const CharTable kChars;
+
+inline unsigned char charClass(const char* p) {
+    return kChars.cls[static_cast<unsigned char>(*p)];
+}
+
+/**
+ * @brief 词是否等于关键字（关键字为小写，比较时忽略大小写）
+ */
+inline bool isKeyword(const char* word, size_t len, const char* keyword) {
+    size_t i = 0;
+    for (; i < len; i++) {
+        unsigned char c = static_cast<unsigned char>(word[i]);
+        if (c >= 'A' && c <= 'Z') {
+            c = static_cast<unsigned char>(c + ('a' - 'A'));
+        }
+        if (keyword[i] == '\0' || c != static_cast<unsigned char>(keyword[i])) {
+            return false;
+        }
+    }
+    return keyword[i] == '\0';
+}
+
+/**
+ * @brief 扫描从p开始的一个词法单元
+ * @return 单元结束位置；未闭合的字符串或注释延伸到输入末尾
+ */
+const char* scanToken(const char* p, const char* end, Token& type) {
+    switch (charClass(p)) {
+    case CC_SEMI:
+        type = TK_SEMI;
+        return p + 1;
+    case CC_SPACE:
+        type = TK_SPACE;
+        for (p++; p < end && charClass(p) == CC_SPACE; p++) {
+        }
+        return p;
+    case CC_WORD:
+        type = TK_WORD;
+        for (p++; p < end && charClass(p) == CC_WORD; p++) {
+        }
+        return p;
+    case CC_QUOTE: {
+        // 转义的引号（''）相当于两个相邻的字符串，不影响切分
+        type = TK_OTHER;
+        char close = *p == '[' ? ']' : *p;
+        const void* found = memchr(p + 1, close, static_cast<size_t>(end - p - 1));
+        return found ? static_cast<const char*>(found) + 1 : end;
+    }
+    case CC_MINUS:
+        if (p + 1 < end && p[1] == '-') {
+            type = TK_SPACE;
+            const void* found = memchr(p, '\n', static_cast<size_t>(end - p));
+            return found ? static_cast<const char*>(found) : end;
+        }
+        break;
+    case CC_SLASH:
+        if (p + 1 < end && p[1] == '*') {
+            type = TK_SPACE;
+            for (p += 2; p + 1 < end; p++) {
+                if (p[0] == '*' && p[1] == '/') {
+                    return p + 2;
+                }
+            }
+            return end;
+        }
+        break;
+    default:
+        break;
+    }
+    type = TK_OTHER;
+    return p + 1;
+}
+
+CompleteToken completeToken(Token type, const char* word, size_t len) {
+    switch (type) {
+    case TK_SEMI:
+        return CT_SEMI;
+    case TK_SPACE:
+        return CT_WS;
+    case TK_OTHER:
+        return CT_OTHER;
+    default:
+        break;
+    }
+    switch (word[0] | 0x20) {
+    case 'c':
+        return isKeyword(word, len, "create") ? CT_CREATE : CT_OTHER;
+    case 'e':
+        if (isKeyword(word, len, "end")) {
+            return CT_END;
+        }
+        return isKeyword(word, len, "explain") ? CT_EXPLAIN : CT_OTHER;
+    case 't':
+        if (isKeyword(word, len, "temp") || isKeyword(word, len, "temporary")) {
+            return CT_TEMP;
+        }
+        return isKeyword(word, len, "trigger") ? CT_TRIGGER : CT_OTHER;
+    default:
+        return CT_OTHER;
+    }
+}
+
+/**
+ * @brief 主语句关键字的类别（SELECT/VALUES/INSERT/REPLACE/UPDATE/DELETE）
+ * @return 不是这些关键字时返回false
+ */
+bool dmlKind(const char* word, size_t len, SqlLexer::Kind& kind) {
+    if (isKeyword(word, len, "select") || isKeyword(word, len, "values")) {
+        kind = SqlLexer::QUERY;
+    } else if (isKeyword(word, len, "insert") || isKeyword(word, len, "replace")) {
+        kind = SqlLexer::INSERT;
+    } else if (isKeyword(word, len, "update")) {
+        kind = SqlLexer::UPDATE;
+    } else if (isKeyword(word, len, "delete")) {
+        kind = SqlLexer::DELETE;
+    } else {
+        return false;
+    }
+    return true;
+}
+
+/**
+ * @brief 按语句的首个关键字分类；WITH需要继续看公共表表达式之后的主语句
+ */
+SqlLexer::Kind leadingKind(const char* word, size_t len, bool& isWith) {
+    SqlLexer::Kind kind = SqlLexer::OTHER;
+    isWith = false;
+    if (dmlKind(word, len, kind)) {
+        return kind;
+    }
+    switch (word[0] | 0x20) {
+    case 'a':
+        return isKeyword(word, len, "alter") ? SqlLexer::DDL : SqlLexer::OTHER;
+    case 'b':
+        return isKeyword(word, len, "begin") ? SqlLexer::TRANSACTION : SqlLexer::OTHER;
+    case 'c':
+        if (isKeyword(word, len, "commit")) {
+            return SqlLexer::TRANSACTION;
+        }
+        return isKeyword(word, len, "create") ? SqlLexer::DDL : SqlLexer::OTHER;
+    case 'd':
+        return isKeyword(word, len, "drop") ? SqlLexer::DDL : SqlLexer::OTHER;
+    case 'e':
+        if (isKeyword(word, len, "end")) {
+            return SqlLexer::TRANSACTION;
+        }
+        return isKeyword(word, len, "explain") ? SqlLexer::EXPLAIN : SqlLexer::OTHER;
+    case 'p':
+        return isKeyword(word, len, "pragma") ? SqlLexer::PRAGMA : SqlLexer::OTHER;
+    case 'r':
+        if (isKeyword(word, len, "rollback") || isKeyword(word, len, "release")) {
+            return SqlLexer::TRANSACTION;
+        }
+        return SqlLexer::OTHER;
+    case 's':
+        return isKeyword(word, len, "savepoint") ? SqlLexer::TRANSACTION : SqlLexer::OTHER;
+    case 'w':
+        isWith = isKeyword(word, len, "with");
+        return SqlLexer::OTHER;
+    default:
+        return SqlLexer::OTHER;
+    }
+}
+}
+
+SqlLexer::SqlLexer(const char* data, size_t size)
+    : pos(data)
+    , end(data + size)
+{
+}
+
+bool SqlLexer::next(Statement& out) {
+    const char* start = nullptr;        // 语句第一个有效单元
+    const char* last = nullptr;         // 最后一个非空白单元的结束位置
+    unsigned char state = kStart;
+    Kind kind = OTHER;
+    bool classified = false;
+    bool inWith = false;                // 在WITH的公共表表达式中，等待主语句关键字
+    int depth = 0;                      // WITH中的括号深度
+
+    while (pos < end) {
+        const char* token = pos;
+        Token type;
+        pos = scanToken(pos, end, type);
+        size_t len = static_cast<size_t>(pos - token);
+
+        if (type != TK_SPACE && type != TK_SEMI) {
+            if (!start) {
+                start = token;
+            }
+            last = pos;
+        }
+
+        if (!classified && type == TK_WORD) {
+            if (inWith) {
+                if (depth == 0 && dmlKind(token, len, kind)) {
+                    inWith = false;
+                    classified = true;
+                }
+            } else {
+                kind = leadingKind(token, len, inWith);
+                classified = !inWith;
+            }
+        } else if (!classified && type == TK_OTHER) {
+            // 首个关键字前的左括号跳过；WITH中按括号深度找主语句
+            if (*token == '(') {
+                depth++;
+            } else if (*token == ')') {
+                depth--;
+            } else if (!inWith) {
+                classified = true;
+            }
+        }
+
+        // 普通语句中只有分号改变状态，跳过关键字比较
+        if (state != kNormal || type == TK_SEMI) {
+            state = kTransitions[state][completeToken(type, token, len)];
+        }
+        if (type == TK_SEMI && state == kStart) {
+            if (start) {
+                out.data = start;
+                out.size = static_cast<size_t>(pos - start);
+                out.kind = classified ? kind : OTHER;
+                return true;
+            }
+            // 空语句（只有分号、空白或注释）
+            kind = OTHER;
+            classified = false;
+            inWith = false;
+            depth = 0;
+        }
+    }
+
+    if (!start) {
+        return false;
+    }
+    // 最后一条语句没有分号：去掉结尾的空白和注释
+    out.data = start;
+    out.size = static_cast<size_t>(last - start);
+    out.kind = classified ? kind : OTHER;
+    return true;
+}
@@ -0,0 +1,302 @@
+#include "sql_params.h"
+#include "json_scanner.h"
+#include "request_view.h"
+#include "base64.h"
+#include <limits>
+
+namespace {
+void appendRaw(std::string& out, const void* data, size_t len) {
+    out.append(static_cast<const char*>(data), len);
+}
+
+/**
+ * @brief 编码一个值：类型标记 + 定长数值，或长度 + 字节
+ */
+void appendValue(std::string& out, const SqlValue& value) {
+    out.push_back(static_cast<char>('0' + value.type));
+    switch (value.type) {
+    case SqlValue::INTEGER:
+        appendRaw(out, &value.intValue, sizeof(value.intValue));
+        break;
+    case SqlValue::REAL:
+        appendRaw(out, &value.realValue, sizeof(value.realValue));
+        break;
+    case SqlValue::TEXT:
+    case SqlValue::BLOB: {
+        uint64_t len = value.bytes.size();
+        appendRaw(out, &len, sizeof(len));
+        out.append(value.bytes.data(), value.bytes.size());
+        break;
+    }
+    default:
+        break;
+    }
+}
+
+const char kUnsupportedValue[] =
+    "unsupported parameter value (expected number, string, bool, null or {\"$blob\": base64})";
+
+/**
+ * @brief 在请求的原始文本上解析参数（文本已由RequestView校验过语法）
+ */
+class ParamScanner : public JsonScanner {
+public:
+    ParamScanner(Arena* arena, const RequestView::Slice& text) : JsonScanner(arena) {
+        reset(text.data, text.size);
+    }
+
+    /**
+     * @brief 跳过空白后的下一个字符，输入结束时为'\0'
+     */
+    char peek() {
+        skipSpace();
+        return p < end ? *p : '\0';
+    }
+
+    bool consume(char c) {
+        if (peek() != c) {
+            return false;
+        }
+        p++;
+        return true;
+    }
+
+    bool readKey(ArenaString& key) {
+        return peek() == '"' && parseString(key) && consume(':');
+    }
+
+    bool readValue(SqlValue& value) {
+        char first = peek();
+        if (first == '[') {
+            fail(kUnsupportedValue);
+            return false;
+        }
+        if (parseValue(value)) {
+            return true;
+        }
+        // 对象只接受{"$blob": base64}，其余对象的报错与Json::Value路径一致
+        if (first == '{' && value.type != SqlValue::BLOB) {
+            fail(kUnsupportedValue);
+        }
+        return false;
+    }
+};
+}
+
+SqlParams::SqlParams(Arena* arena)
+    : arena(arena)
+    , positional(ArenaAllocator<SqlValue>(arena))
+    , named(ArenaAllocator<NamedValue>(arena))
+{
+}
+
+bool SqlParams::parse(const Json::Value& json, std::string& error) {
+    positional.clear();
+    named.clear();
+
+    if (json.isNull()) {
+        return true;
+    }
+    if (json.isArray()) {
+        positional.reserve(json.size());
+        for (Json::ArrayIndex i = 0; i < json.size(); i++) {
+            positional.emplace_back(arena);
+            if (!parseValue(json[i], positional[i], error)) {
+                error = "params[" + std::to_string(i) + "]: " + error;
+                return false;
+            }
+        }
+        return true;
+    }
+    if (json.isObject()) {
+        for (auto it = json.begin(); it != json.end(); ++it) {
+            std::string name = it.name();
+            named.push_back(NamedValue(ArenaString(name.data(), name.size(), ArenaAllocator<char>(arena)),
+                                       SqlValue(arena)));
+            if (!parseValue(*it, named.back().second, error)) {
+                error = "params." + name + ": " + error;
+                return false;
+            }
+        }
+        return true;
+    }
+
+    error = "params must be an array or an object";
+    return false;
+}
+
+bool SqlParams::parse(const RequestView& view, const char* key, std::string& error) {
+    RequestView::Slice text;
+    if (!view.getSlice(key, text)) {
+        Json::Value json;
+        view.getJson(key, json);
+        return parse(json, error);
+    }
+
+    positional.clear();
+    named.clear();
+    ParamScanner scanner(arena, text);
+    switch (scanner.peek()) {
+    case 'n':
+        return true;
+    case '[':
+        scanner.consume('[');
+        if (scanner.consume(']')) {
+            return true;
+        }
+        do {
+            positional.emplace_back(arena);
+            if (!scanner.readValue(positional.back())) {
+                error = "params[" + std::to_string(positional.size() - 1) + "]: " + scanner.getError();
+                return false;
+            }
+        } while (scanner.consume(','));
+        return true;
+    case '{':
+        scanner.consume('{');
+        if (scanner.consume('}')) {
+            return true;
+        }
+        do {
+            named.push_back(NamedValue(ArenaString(ArenaAllocator<char>(arena)), SqlValue(arena)));
+            NamedValue& param = named.back();
+            if (!scanner.readKey(param.first) || !scanner.readValue(param.second)) {
+                error = "params." + std::string(param.first.data(), param.first.size()) + ": " +
+                        scanner.getError();
+                return false;
+            }
+        } while (scanner.consume(','));
+        return true;
+    default:
+        error = "params must be an array or an object";
+        return false;
+    }
+}
+
+bool SqlParams::parseValue(const Json::Value& json, SqlValue& value, std::string& error) {
+    switch (json.type()) {
+    case Json::nullValue:
+        value.type = SqlValue::NULL_VALUE;
+        return true;
+    case Json::booleanValue:
+        value.type = SqlValue::INTEGER;
+        value.intValue = json.asBool() ? 1 : 0;
+        return true;
+    case Json::intValue:
+        value.type = SqlValue::INTEGER;
+        value.intValue = json.asInt64();
+        return true;
+    case Json::uintValue:
+        if (json.asUInt64() > static_cast<uint64_t>(std::numeric_limits<int64_t>::max())) {
+            value.type = SqlValue::REAL;
+            value.realValue = json.asDouble();
+        } else {
+            value.type = SqlValue::INTEGER;
+            value.intValue = static_cast<int64_t>(json.asUInt64());
+        }
+        return true;
+    case Json::realValue:
+        value.type = SqlValue::REAL;
+        value.realValue = json.asDouble();
+        return true;
+    case Json::stringValue: {
+        // 按原始指针取，不拷贝出中间的std::string
+        const char* begin = nullptr;
+        const char* end = nullptr;
+        json.getString(&begin, &end);
+        value.type = SqlValue::TEXT;
+        value.bytes.assign(begin, end - begin);
+        return true;
+    }
+    case Json::objectValue:
+        if (json.size() == 1 && json.isMember("$blob") && json["$blob"].isString()) {
+            value.type = SqlValue::BLOB;
+            std::string text = json["$blob"].asString();
+            if (!base64Decode(text.data(), text.size(), value.bytes)) {
+                error = "invalid base64 in $blob";
+                return false;
+            }
+            return true;
+        }
+        break;
+    default:
+        break;
+    }
+
+    error = kUnsupportedValue;
+    return false;
+}
+
+int SqlParams::bindValue(sqlite3_stmt* stmt, int index, const SqlValue& value) {
+    switch (value.type) {
+    case SqlValue::INTEGER:
+        return sqlite3_bind_int64(stmt, index, value.intValue);
+    case SqlValue::REAL:
+        return sqlite3_bind_double(stmt, index, value.realValue);
+    case SqlValue::TEXT:
+        return sqlite3_bind_text(stmt, index, value.bytes.data(),
+                                 static_cast<int>(value.bytes.size()), SQLITE_STATIC);
+    case SqlValue::BLOB:
+        return sqlite3_bind_blob(stmt, index, value.bytes.data(),
+                                 static_cast<int>(value.bytes.size()), SQLITE_STATIC);
+    default:
+        return sqlite3_bind_null(stmt, index);
+    }
+}
+
+bool SqlParams::bind(sqlite3_stmt* stmt, std::string& error) const {
+    int count = sqlite3_bind_parameter_count(stmt);
+
+    if (!positional.empty()) {
+        if (static_cast<int>(positional.size()) > count) {
+            error = "Too many parameters: statement takes " + std::to_string(count) +
+                    ", got " + std::to_string(positional.size());
+            return false;
+        }
+        for (size_t i = 0; i < positional.size(); i++) {
+            if (bindValue(stmt, static_cast<int>(i) + 1, positional[i]) != SQLITE_OK) {
+                error = "Failed to bind parameter " + std::to_string(i + 1);
+                return false;
+            }
+        }
+        return true;
+    }
+
+    // 命名参数：语句中没有用到的名字直接跳过（多条语句共享同一组命名参数）
+    static const char kPrefixes[] = {':', '@', '$'};
+    for (const auto& param : named) {
+        int index = 0;
+        const ArenaString& name = param.first;
+        if (!name.empty() && (name[0] == ':' || name[0] == '@' || name[0] == '$')) {
+            index = sqlite3_bind_parameter_index(stmt, name.c_str());
+        } else {
+            for (size_t i = 0; i < sizeof(kPrefixes) && index == 0; i++) {
+                index = sqlite3_bind_parameter_index(stmt, (kPrefixes[i] + name).c_str());
+            }
+        }
+        if (index == 0) {
+            continue;
+        }
+        if (bindValue(stmt, index, param.second) != SQLITE_OK) {
+            error = "Failed to bind parameter " + std::string(name.data(), name.size());
+            return false;
+        }
+    }
+    return true;
+}
+
+void SqlParams::appendKey(std::string& out) const {
+    if (!positional.empty()) {
+        out.push_back('P');
+        for (const SqlValue& value : positional) {
+            appendValue(out, value);
+        }
+    }
+    for (const auto& param : named) {
+        out.push_back('N');
+        uint64_t len = param.first.size();
+        appendRaw(out, &len, sizeof(len));
+        out.append(param.first.data(), param.first.size());
+        appendValue(out, param.second);
+    }
+}
@@ -1,42 +1,211 @@
 #include "sqlite3_handler.h"
-#include <iostream>
+#include "logger.h"
+#include "metrics.h"
+#include "result_cache.h"
+#include <algorithm>
+#include <cctype>
+#include <cstring>
 
-Sqlite3Handler::Sqlite3Handler(const std::string& path) 
+namespace {
+/**
+ * @brief 判断prepare剩余的尾部是否只包含空白
+ */
+bool isBlankTail(const char* tail) {
+    while (tail && *tail) {
+        if (!std::isspace(static_cast<unsigned char>(*tail))) {
+            return false;
+        }
+        tail++;
+    }
+    return true;
+}
+
+/**
+ * @brief 执行一步并把耗时累加到stepNs
+ */
+inline int timedStep(sqlite3_stmt* stmt, uint64_t& stepNs) {
+    uint64_t start = Metrics::now();
+    int rc = sqlite3_step(stmt);
+    stepNs += Metrics::now() - start;
+    return rc;
+}
+
+/**
+ * @brief 结果随调用时刻变化的内置函数，用到它们的查询不缓存
+ */
+bool isVolatileFunction(const char* name) {
+    static const char* const kVolatile[] = {
+        "random", "randomblob", "changes", "total_changes", "last_insert_rowid",
+        "date", "time", "datetime", "julianday", "unixepoch", "strftime",
+        "current_date", "current_time", "current_timestamp"
+    };
+    for (const char* candidate : kVolatile) {
+        if (sqlite3_stricmp(name, candidate) == 0) {
+            return true;
+        }
+    }
+    return false;
+}
+}
+
+const char Sqlite3Handler::kDeadlineExceeded[] = "Request deadline exceeded";
+
+Sqlite3Handler::Sqlite3Handler(const std::string& path, size_t stmtCacheCapacity)
     : db(nullptr)
     , dbPath(path)
-    , lastError() 
+    , lastError()
+    , stmtCacheCapacity(stmtCacheCapacity)
+    , stmtStats()
+    , trackChanges(false)
+    , preparingInfo(nullptr)
+    , lastInfo(&noInfo)
+    , hookedChanges(0)
+    , changesBase(0)
+    , commitPending(false)
+    , schemaChanged(false)
+    , interruptFlag(nullptr)
 {
+    stmtStats.capacity = stmtCacheCapacity;
 }
 
 Sqlite3Handler::~Sqlite3Handler() {
     close();
 }
 
-bool Sqlite3Handler::open() {
+bool Sqlite3Handler::open(int flags) {
     if (db) {
         return true;  // 已经打开
     }
     
-    int rc = sqlite3_open(dbPath.c_str(), &db);
+    int rc = sqlite3_open_v2(dbPath.c_str(), &db, flags, nullptr);
     if (rc != SQLITE_OK) {
         lastError = sqlite3_errmsg(db);
-        std::cerr << "Cannot open database: " << lastError << std::endl;
+        LOG_ERROR("Cannot open database: " + lastError);
         sqlite3_close(db);
         db = nullptr;
         return false;
     }
     
-    std::cout << "Successfully opened database: " << dbPath << std::endl;
+    // 统计每个数据库的事务提交和回滚（包括客户端显式的BEGIN/COMMIT）
+    sqlite3_commit_hook(db, commitHook, this);
+    sqlite3_rollback_hook(db, rollbackHook, this);
+
+    // 请求超过截止时间时由进度回调中止正在执行的语句
+    sqlite3_progress_handler(db, kProgressOps, progressHandler, this);
+
+    // 启用了结果缓存时：收集查询读取的表，记录写入修改了哪些表
+    trackChanges = ResultCache::instance().isEnabled();
+    if (trackChanges) {
+        sqlite3_set_authorizer(db, authorizer, this);
+        sqlite3_update_hook(db, updateHook, this);
+    }
+
+    LOG_INFO("Successfully opened database: " + dbPath);
     return true;
 }
 
 void Sqlite3Handler::close() {
     if (db) {
+        // 缓存的语句必须先finalize，否则sqlite3_close会返回SQLITE_BUSY
+        evictStatements(0);
         sqlite3_close(db);
         db = nullptr;
     }
 }
 
+int Sqlite3Handler::commitHook(void* arg) {
+    Sqlite3Handler* handler = static_cast<Sqlite3Handler*>(arg);
+    Metrics::recordCommit(handler->dbPath);
+    handler->commitPending = handler->trackChanges;
+    return 0;   // 不拦截提交
+}
+
+void Sqlite3Handler::rollbackHook(void* arg) {
+    Sqlite3Handler* handler = static_cast<Sqlite3Handler*>(arg);
+    Metrics::recordRollback(handler->dbPath);
+    // 回滚的修改不需要失效；DDL标记保留（缓存的DDL语句再次执行时不会重新prepare）
+    handler->commitPending = false;
+    handler->changedTables.clear();
+    handler->hookedChanges = 0;
+    handler->changesBase = sqlite3_total_changes(handler->db);
+}
+
+void Sqlite3Handler::updateHook(void* arg, int, const char* dbName, const char* table, sqlite3_int64) {
+    Sqlite3Handler* handler = static_cast<Sqlite3Handler*>(arg);
+    if (std::strcmp(dbName, "main") != 0) {
+        return;     // 临时库只对本连接可见，缓存的查询不会读它
+    }
+    handler->hookedChanges++;
+    std::vector<std::string>& tables = handler->changedTables;
+    if (!tables.empty() && tables.back() == table) {
+        return;     // 批量写同一张表的常见情况
+    }
+    for (const std::string& known : tables) {
+        if (known == table) {
+            return;
+        }
+    }
+    tables.push_back(table);
+}
+
+int Sqlite3Handler::authorizer(void* arg, int action, const char* arg1, const char* arg2,
+                               const char* dbName, const char*) {
+    Sqlite3Handler* handler = static_cast<Sqlite3Handler*>(arg);
+    StatementInfo* info = handler->preparingInfo;
+    switch (action) {
+    case SQLITE_READ:
+        if (!info) {
+            break;
+        }
+        if (!dbName || std::strcmp(dbName, "main") != 0) {
+            info->cacheable = false;
+        } else if (std::find(info->tables.begin(), info->tables.end(), arg1) == info->tables.end()) {
+            info->tables.push_back(arg1);
+        }
+        break;
+    case SQLITE_FUNCTION:
+        if (info && isVolatileFunction(arg2)) {
+            info->cacheable = false;
+        }
+        break;
+    case SQLITE_CREATE_INDEX:
+    case SQLITE_CREATE_TABLE:
+    case SQLITE_CREATE_TRIGGER:
+    case SQLITE_CREATE_VIEW:
+    case SQLITE_DROP_INDEX:
+    case SQLITE_DROP_TABLE:
+    case SQLITE_DROP_TRIGGER:
+    case SQLITE_DROP_VIEW:
+    case SQLITE_ALTER_TABLE:
+    case SQLITE_CREATE_VTABLE:
+    case SQLITE_DROP_VTABLE:
+        handler->schemaChanged = true;
+        break;
+    default:
+        break;
+    }
+    return SQLITE_OK;
+}
+
+void Sqlite3Handler::publishChanges() {
+    if (!commitPending || !sqlite3_get_autocommit(db)) {
+        return;
+    }
+    commitPending = false;
+
+    // truncate优化的DELETE、WITHOUT ROWID表等不触发update钩子：行数对不上时无法确定修改了哪些表
+    int total = sqlite3_total_changes(db);
+    if (schemaChanged || static_cast<uint64_t>(total - changesBase) > hookedChanges) {
+        ResultCache::instance().invalidateAll(dbPath);
+    } else {
+        ResultCache::instance().invalidate(dbPath, changedTables);
+    }
+    changedTables.clear();
+    hookedChanges = 0;
+    changesBase = total;
+    schemaChanged = false;
+}
+
 bool Sqlite3Handler::beginTransaction() {
     return executeSql("BEGIN TRANSACTION;");
 }
@@ -46,29 +215,277 @@ bool Sqlite3Handler::commitTransaction() {
 }
 
 bool Sqlite3Handler::rollback() {
-    return executeSql("ROLLBACK TRANSACTION;");
+    // 回滚本身不能被中断，否则事务会一直开着
+    const std::atomic<bool>* flag = interruptFlag;
+    interruptFlag = nullptr;
+    bool ok = executeSql("ROLLBACK TRANSACTION;");
+    interruptFlag = flag;
+    return ok;
 }
 
-bool Sqlite3Handler::executeSql(const std::string& sql) {
-    char* errMsg = nullptr;
-    int rc = sqlite3_exec(db, sql.c_str(), nullptr, nullptr, &errMsg);
-    
+int Sqlite3Handler::progressHandler(void* arg) {
+    return static_cast<Sqlite3Handler*>(arg)->deadlineExceeded() ? 1 : 0;
+}
+
+const char* Sqlite3Handler::errorMessage() const {
+    return deadlineExceeded() ? kDeadlineExceeded : sqlite3_errmsg(db);
+}
+
+size_t Sqlite3Handler::SqlTextHash::operator()(const SqlText& text) const {
+    uint64_t hash = 14695981039346656037ULL;
+    for (size_t i = 0; i < text.size; i++) {
+        hash ^= static_cast<unsigned char>(text.data[i]);
+        hash *= 1099511628211ULL;
+    }
+    return static_cast<size_t>(hash);
+}
+
+int Sqlite3Handler::acquireStatement(SqlText sql, sqlite3_stmt*& stmt, bool& cached) {
+    stmt = nullptr;
+    cached = false;
+    lastInfo = &noInfo;
+
+    auto it = stmtIndex.find(sql);
+    if (it != stmtIndex.end()) {
+        stmtStats.hits++;
+        stmtLru.splice(stmtLru.begin(), stmtLru, it->second);
+        stmt = it->second->stmt;
+        cached = true;
+        lastInfo = &it->second->info;
+        return SQLITE_OK;
+    }
+
+    stmtStats.misses++;
+    const char* tail = nullptr;
+    unsigned int flags = stmtCacheCapacity > 0 ? SQLITE_PREPARE_PERSISTENT : 0;
+    StatementInfo info;
+    info.cacheable = trackChanges;
+    preparingInfo = &info;
+    uint64_t prepareStart = Metrics::now();
+    int rc = sqlite3_prepare_v3(db, sql.data, static_cast<int>(sql.size) + 1, flags, &stmt, &tail);
+    Metrics::recordPhase(Metrics::PREPARE, Metrics::now() - prepareStart);
+    preparingInfo = nullptr;
+    if (rc != SQLITE_OK) {
+        lastError = errorMessage();
+        return rc;
+    }
+    if (!isBlankTail(tail)) {
+        // 尾部可能只是注释，试着再解析一次确认
+        sqlite3_stmt* next = nullptr;
+        if (sqlite3_prepare_v2(db, tail, -1, &next, nullptr) != SQLITE_OK || next) {
+            sqlite3_finalize(next);
+            sqlite3_finalize(stmt);
+            stmt = nullptr;
+            return SQLITE_MISUSE;
+        }
+    }
+    if (stmt && !sqlite3_stmt_readonly(stmt)) {
+        info.cacheable = false;
+    }
+    if (!stmt || stmtCacheCapacity == 0) {
+        uncachedInfo = std::move(info);
+        lastInfo = &uncachedInfo;
+        return SQLITE_OK;
+    }
+
+    evictStatements(stmtCacheCapacity - 1);
+    CachedStatement entry;
+    entry.sql.assign(sql.data, sql.size);
+    entry.stmt = stmt;
+    entry.info = std::move(info);
+    stmtLru.push_front(std::move(entry));
+    // 索引的键指向链表节点中的文本，节点在淘汰前不会移动
+    stmtIndex.emplace(SqlText(stmtLru.front().sql), stmtLru.begin());
+    cached = true;
+    lastInfo = &stmtLru.front().info;
+    return SQLITE_OK;
+}
+
+void Sqlite3Handler::releaseStatement(sqlite3_stmt* stmt, bool cached) {
+    if (!stmt) {
+        return;
+    }
+    if (cached) {
+        sqlite3_reset(stmt);
+        sqlite3_clear_bindings(stmt);
+    } else {
+        sqlite3_finalize(stmt);
+    }
+}
+
+int Sqlite3Handler::prepareAndBind(SqlText sql, const SqlParams* params,
+                                   sqlite3_stmt*& stmt, bool& cached) {
+    int rc = acquireStatement(sql, stmt, cached);
+    if (rc != SQLITE_OK || !stmt || !params || params->empty()) {
+        return rc;
+    }
+    if (!params->bind(stmt, lastError)) {
+        releaseStatement(stmt, cached);
+        stmt = nullptr;
+        return SQLITE_RANGE;
+    }
+    return SQLITE_OK;
+}
+
+void Sqlite3Handler::evictStatements(size_t capacity) {
+    while (stmtLru.size() > capacity) {
+        CachedStatement& victim = stmtLru.back();
+        sqlite3_finalize(victim.stmt);
+        stmtIndex.erase(SqlText(victim.sql));
+        stmtLru.pop_back();
+        stmtStats.evictions++;
+    }
+}
+
+void Sqlite3Handler::setStmtCacheCapacity(size_t capacity) {
+    stmtCacheCapacity = capacity;
+    stmtStats.capacity = capacity;
+    evictStatements(capacity);
+}
+
+StmtCacheStats Sqlite3Handler::getStmtCacheStats() const {
+    StmtCacheStats stats = stmtStats;
+    stats.size = stmtLru.size();
+    return stats;
+}
+
+int Sqlite3Handler::executeUncached(SqlText sql, TableData* result) {
+    // 逐条prepare执行，不进缓存；有结果集的语句把行追加到result
+    lastInfo = &noInfo;
+    const char* next = sql.data;
+    int rc = SQLITE_OK;
+    while (rc == SQLITE_OK && next && *next) {
+        sqlite3_stmt* stmt = nullptr;
+        uint64_t prepareStart = Metrics::now();
+        rc = sqlite3_prepare_v2(db, next, -1, &stmt, &next);
+        Metrics::recordPhase(Metrics::PREPARE, Metrics::now() - prepareStart);
+        if (rc != SQLITE_OK) {
+            lastError = errorMessage();
+            break;
+        }
+        if (!stmt) {
+            continue;   // 只有空白或注释
+        }
+        if (result) {
+            rc = fillResult(stmt, *result);
+        } else {
+            uint64_t stepNs = 0;
+            while ((rc = timedStep(stmt, stepNs)) == SQLITE_ROW) {
+            }
+            Metrics::recordPhase(Metrics::STEP, stepNs);
+            rc = rc == SQLITE_DONE ? SQLITE_OK : rc;
+        }
+        if (rc != SQLITE_OK) {
+            lastError = errorMessage();
+        }
+        sqlite3_finalize(stmt);
+        publishChanges();
+    }
+    return rc;
+}
+
+int Sqlite3Handler::fillResult(sqlite3_stmt* stmt, TableData& result) {
+    int columnCount = sqlite3_column_count(stmt);
+    if (columnCount > 0 && result.getColumnCount() == 0) {
+        for (int i = 0; i < columnCount; i++) {
+            const char* declType = sqlite3_column_decltype(stmt, i);
+            result.addColumn(sqlite3_column_name(stmt, i), declType ? declType : "");
+        }
+    }
+    // 一次执行多条查询时，列数不同的后续结果集无法并入同一张表
+    bool append = columnCount > 0 && static_cast<size_t>(columnCount) == result.getColumnCount();
+
+    // 取值和填表的时间记为序列化，sqlite3_step本身记为执行
+    uint64_t start = Metrics::now();
+    uint64_t stepNs = 0;
+    int rc;
+    while ((rc = timedStep(stmt, stepNs)) == SQLITE_ROW) {
+        if (!append) {
+            continue;
+        }
+        result.beginRow();
+        for (int i = 0; i < columnCount; i++) {
+            switch (sqlite3_column_type(stmt, i)) {
+            case SQLITE_INTEGER:
+                result.appendInteger(i, sqlite3_column_int64(stmt, i));
+                break;
+            case SQLITE_FLOAT:
+                result.appendReal(i, sqlite3_column_double(stmt, i));
+                break;
+            case SQLITE_TEXT: {
+                const char* text = reinterpret_cast<const char*>(sqlite3_column_text(stmt, i));
+                result.appendText(i, text, sqlite3_column_bytes(stmt, i));
+                break;
+            }
+            case SQLITE_BLOB: {
+                const void* blob = sqlite3_column_blob(stmt, i);
+                result.appendBlob(i, blob, sqlite3_column_bytes(stmt, i));
+                break;
+            }
+            default:
+                result.appendNull(i);
+                break;
+            }
+        }
+    }
+    Metrics::recordPhase(Metrics::STEP, stepNs);
+    Metrics::recordPhase(Metrics::SERIALIZE, Metrics::now() - start - stepNs);
+    return rc == SQLITE_DONE ? SQLITE_OK : rc;
+}
+
+bool Sqlite3Handler::executeSql(SqlText sql, const SqlParams* params) {
+    sqlite3_stmt* stmt = nullptr;
+    bool cached = false;
+    int rc = prepareAndBind(sql, params, stmt, cached);
+    if (rc == SQLITE_MISUSE) {
+        // 多条语句的SQL文本不进缓存，也无法绑定参数
+        if (params && !params->empty()) {
+            lastError = "Parameters require a single SQL statement";
+            return false;
+        }
+        return executeUncached(sql, nullptr) == SQLITE_OK;
+    }
     if (rc != SQLITE_OK) {
-        lastError = errMsg ? errMsg : "Unknown error";
-        sqlite3_free(errMsg);
         return false;
     }
-    return true;
+
+    uint64_t stepNs = 0;
+    while (stmt && (rc = timedStep(stmt, stepNs)) == SQLITE_ROW) {
+    }
+    Metrics::recordPhase(Metrics::STEP, stepNs);
+    bool ok = !stmt || rc == SQLITE_DONE;
+    if (!ok) {
+        lastError = errorMessage();
+    }
+    releaseStatement(stmt, cached);
+    publishChanges();
+    return ok;
 }
 
-TableData Sqlite3Handler::executeQuery(const std::string& sql) {
+TableData Sqlite3Handler::executeQuery(SqlText sql, const SqlParams* params) {
     TableData result;
-    char* errMsg = nullptr;
-    
-    if (sqlite3_exec(db, sql.c_str(), callback, &result, &errMsg) != SQLITE_OK) {
+    sqlite3_stmt* stmt = nullptr;
+    bool cached = false;
+
+    int rc = prepareAndBind(sql, params, stmt, cached);
+    if (rc == SQLITE_MISUSE) {
+        if (params && !params->empty()) {
+            lastError = "Parameters require a single SQL statement";
+        } else {
+            rc = executeUncached(sql, &result);
+        }
+    } else if (rc == SQLITE_OK && stmt) {
+        rc = fillResult(stmt, result);
+        if (rc != SQLITE_OK) {
+            lastError = errorMessage();
+        }
+        releaseStatement(stmt, cached);
+        publishChanges();
+    }
+
+    if (rc != SQLITE_OK) {
         result.setStatus(-1);
-        result.setMsg(errMsg ? errMsg : "Query failed");
-        sqlite3_free(errMsg);
+        result.setMsg(lastError.empty() ? "Query failed" : lastError);
     } else {
         result.setStatus(0);
         result.setMsg("Query successful");
@@ -77,31 +494,176 @@ TableData Sqlite3Handler::executeQuery(const std::string& sql) {
     return result;
 }
 
-bool Sqlite3Handler::executeUpdate(const std::string& sql) {
-    return executeSql(sql);
+bool Sqlite3Handler::streamQuery(SqlText sql, const SqlParams* params, ResultWriter& writer) {
+    sqlite3_stmt* stmt = nullptr;
+    bool cached = false;
+
+    int rc = prepareAndBind(sql, params, stmt, cached);
+    if (rc == SQLITE_MISUSE && !(params && !params->empty())) {
+        // 多条语句的结果要合并成一张表，无法逐行输出
+        TableData result = executeQuery(sql, params);
+        writer.writeTable(result);
+        return result.getStatus() == 0;
+    }
+    if (rc == SQLITE_MISUSE) {
+        lastError = "Parameters require a single SQL statement";
+    }
+    if (rc != SQLITE_OK) {
+        writer.end(-1, lastError.empty() ? "Query failed" : lastError);
+        return false;
+    }
+    if (!stmt) {
+        writer.end(0, "Query successful");
+        return true;
+    }
+
+    uint64_t start = Metrics::now();
+    uint64_t stepNs = 0;
+    writer.begin(stmt);
+    bool open = true;
+    while (open && (rc = timedStep(stmt, stepNs)) == SQLITE_ROW) {
+        open = writer.addRow(stmt);
+    }
+    if (!open) {
+        lastError = deadlineExceeded() ? kDeadlineExceeded : "Response stream closed";
+    } else if (rc != SQLITE_DONE) {
+        lastError = errorMessage();
+    }
+    releaseStatement(stmt, cached);
+    publishChanges();
+
+    bool ok = open && rc == SQLITE_DONE;
+    if (ok) {
+        writer.end(0, "Query successful");
+    } else {
+        writer.end(-1, lastError);
+    }
+    Metrics::recordPhase(Metrics::STEP, stepNs);
+    Metrics::recordPhase(Metrics::SERIALIZE, Metrics::now() - start - stepNs);
+    return ok;
 }
 
-int Sqlite3Handler::callback(void* data, int argc, char** argv, char** azColName) {
-    TableData* result = static_cast<TableData*>(data);
-    std::map<std::string, std::string> row;
-    
-    // 第一行数据时，添加列信息
-    if (result->getRowCount() == 0) {
-        for (int i = 0; i < argc; i++) {
-            // 获取列的实际类型
-            result->addColumnType(azColName[i], "TEXT"); // 简化处理，实际应该从schema获取
+sqlite3_stmt* Sqlite3Handler::openCursor(SqlText sql, const SqlParams* params) {
+    lastInfo = &noInfo;
+    sqlite3_stmt* stmt = nullptr;
+    const char* tail = nullptr;
+    uint64_t prepareStart = Metrics::now();
+    int rc = sqlite3_prepare_v3(db, sql.data, static_cast<int>(sql.size) + 1,
+                                SQLITE_PREPARE_PERSISTENT, &stmt, &tail);
+    Metrics::recordPhase(Metrics::PREPARE, Metrics::now() - prepareStart);
+    if (rc != SQLITE_OK) {
+        lastError = errorMessage();
+        return nullptr;
+    }
+    if (!stmt) {
+        lastError = "Empty SQL statement";
+        return nullptr;
+    }
+    if (!isBlankTail(tail)) {
+        sqlite3_stmt* next = nullptr;
+        if (sqlite3_prepare_v2(db, tail, -1, &next, nullptr) != SQLITE_OK || next) {
+            sqlite3_finalize(next);
+            sqlite3_finalize(stmt);
+            lastError = "Cursor requires a single SQL statement";
+            return nullptr;
         }
     }
-    
-    // 添加行数据
-    for (int i = 0; i < argc; i++) {
-        row[azColName[i]] = argv[i] ? argv[i] : "NULL";
+    if (!sqlite3_stmt_readonly(stmt) || sqlite3_column_count(stmt) == 0) {
+        sqlite3_finalize(stmt);
+        lastError = "Cursor requires a read-only query";
+        return nullptr;
     }
-    
-    result->addRowValue(row);
-    return 0;
+    if (params && !params->empty() && !params->bind(stmt, lastError)) {
+        sqlite3_finalize(stmt);
+        return nullptr;
+    }
+    return stmt;
+}
+
+bool Sqlite3Handler::fetchCursor(sqlite3_stmt* stmt, size_t maxRows, ResultWriter& writer, bool& done) {
+    uint64_t start = Metrics::now();
+    uint64_t stepNs = 0;
+    writer.begin(stmt);
+
+    // 语句上有一行数据时，它是上一次读取为判断是否读完而多取的一行，还没有发出
+    int rc = sqlite3_data_count(stmt) > 0 ? SQLITE_ROW : timedStep(stmt, stepNs);
+    size_t rows = 0;
+    bool open = true;
+    while (rc == SQLITE_ROW && rows < maxRows) {
+        open = writer.addRow(stmt);
+        rows++;
+        if (!open) {
+            break;
+        }
+        rc = timedStep(stmt, stepNs);
+    }
+    done = rc == SQLITE_DONE;
+    if (!open) {
+        lastError = deadlineExceeded() ? kDeadlineExceeded : "Response stream closed";
+    } else if (rc != SQLITE_ROW && rc != SQLITE_DONE) {
+        lastError = errorMessage();
+    }
+
+    Metrics::recordPhase(Metrics::STEP, stepNs);
+    Metrics::recordPhase(Metrics::SERIALIZE, Metrics::now() - start - stepNs);
+    return open && (rc == SQLITE_ROW || rc == SQLITE_DONE);
+}
+
+void Sqlite3Handler::closeCursor(sqlite3_stmt* stmt) {
+    sqlite3_finalize(stmt);
+}
+
+bool Sqlite3Handler::executeUpdate(SqlText sql, const SqlParams* params) {
+    return executeSql(sql, params);
+}
+
+bool Sqlite3Handler::executeBatch(SqlText sql, size_t maxRows,
+                                  const std::function<bool(sqlite3_stmt*)>& bindRow, size_t& executed) {
+    executed = 0;
+    sqlite3_stmt* stmt = nullptr;
+    bool cached = false;
+    int rc = acquireStatement(sql, stmt, cached);
+    if (rc == SQLITE_MISUSE) {
+        lastError = "Batch requires a single SQL statement";
+        return false;
+    }
+    if (rc != SQLITE_OK) {
+        return false;
+    }
+    if (!stmt) {
+        lastError = "Empty SQL statement";
+        return false;
+    }
+
+    bool ok = true;
+    uint64_t stepNs = 0;
+    while (executed < maxRows && bindRow(stmt)) {
+        while ((rc = timedStep(stmt, stepNs)) == SQLITE_ROW) {
+        }
+        if (rc != SQLITE_DONE) {
+            lastError = errorMessage();
+            ok = false;
+            break;
+        }
+        sqlite3_reset(stmt);
+        executed++;
+    }
+    Metrics::recordPhase(Metrics::STEP, stepNs);
+    releaseStatement(stmt, cached);
+    publishChanges();
+    return ok;
 }
 
 int Sqlite3Handler::getAffectedRows() const {
     return sqlite3_changes(db);
-} 
\ No newline at end of file
+}
+
+bool Sqlite3Handler::inTransaction() const {
+    return db && !sqlite3_get_autocommit(db);
+}
+
+void Sqlite3Handler::setBusyTimeout(int ms) {
+    if (db) {
+        sqlite3_busy_timeout(db, ms);
+    }
+}
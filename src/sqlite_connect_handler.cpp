@@ -1,37 +1,45 @@
 #include "sqlite_connect_handler.h"
+#include "connection.h"
 #include <memory>
 
-std::map<int, std::unique_ptr<Sqlite3Handler>> SqliteConnectHandler::dbHandlers_;
-
 SqliteConnectHandler::SqliteConnectHandler() {}
 
-std::string SqliteConnectHandler::handle(const Json::Value& request, int clientFd) {
+std::string SqliteConnectHandler::handle(const RequestView& request, Connection& conn) {
     Json::Value response;
     response["status"] = -1;
 
     try {
-        if (!request.isMember("msg") || !request["msg"].isMember("dbpath")) {
+        std::string dbPath;
+        if (!request.getString("dbpath", dbPath)) {
             response["msg"] = "Missing dbpath parameter";
             return Json::FastWriter().write(response);
         }
 
-        std::string dbPath = request["msg"]["dbpath"].asString();
-        std::unique_ptr<Sqlite3Handler> handler(new Sqlite3Handler(dbPath));
-        
-        if (!handler->open()) {
-            response["msg"] = "Failed to open database: " + handler->getLastError();
-            return Json::FastWriter().write(response);
+        ResultEncoding encoding = RESULT_ENCODING_JSON;
+        std::string encodingName;
+        if (request.getString("encoding", encodingName) && encodingName != "json") {
+            if (encodingName != "binary") {
+                response["msg"] = "Unsupported encoding: " + encodingName;
+                return Json::FastWriter().write(response);
+            }
+            if (conn.codec.getMode() == FrameCodec::LENGTH_PREFIXED) {
+                encoding = RESULT_ENCODING_BINARY;
+            }
         }
 
-        auto it = dbHandlers_.find(clientFd);
-        if (it != dbHandlers_.end()) {
-            dbHandlers_.erase(it);
+        // 同一数据库文件的所有客户端共享一个连接池，只有第一次会真正打开
+        std::string error;
+        std::shared_ptr<SqlitePool> pool = SqlitePool::get(dbPath, error);
+        if (!pool) {
+            response["msg"] = "Failed to open database: " + error;
+            return Json::FastWriter().write(response);
         }
 
-        dbHandlers_[clientFd] = std::move(handler);
+        conn.session = std::make_shared<DbSession>(pool, encoding);
         
         response["status"] = 0;
         response["msg"] = "Database connection established successfully";
+        response["encoding"] = encoding == RESULT_ENCODING_BINARY ? "binary" : "json";
         
     } catch (const std::exception& e) {
         response["msg"] = std::string("Exception occurred: ") + e.what();
@@ -39,12 +47,3 @@ std::string SqliteConnectHandler::handle(const Json::Value& request, int clientF
 
     return Json::FastWriter().write(response);
 }
-
-Sqlite3Handler* SqliteConnectHandler::getHandler(int clientFd) {
-    auto it = dbHandlers_.find(clientFd);
-    return it != dbHandlers_.end() ? it->second.get() : nullptr;
-}
-
-void SqliteConnectHandler::removeHandler(int clientFd) {
-    dbHandlers_.erase(clientFd);
-} 
\ No newline at end of file
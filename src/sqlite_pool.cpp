@@ -0,0 +1,306 @@
+#include "sqlite_pool.h"
+#include "result_cache.h"
+#include "metrics.h"
+#include "logger.h"
+#include <chrono>
+#include <climits>
+#include <cstdlib>
+#include <iostream>
+
+std::mutex SqlitePool::registryMutex;
+std::map<std::string, std::shared_ptr<SqlitePool>> SqlitePool::registry;
+SqlitePoolOptions SqlitePool::defaultOptions;
+const char SqlitePool::kWriterBusy[] = "Database busy: writer connection is in use";
+
+SqlitePool::Lease::Lease() : writer(false), cursor(false) {}
+
+SqlitePool::Lease::~Lease() {
+    release();
+}
+
+SqlitePool::Lease::Lease(Lease&& other)
+    : pool(std::move(other.pool))
+    , conn(std::move(other.conn))
+    , writer(other.writer)
+    , cursor(other.cursor)
+{
+}
+
+SqlitePool::Lease& SqlitePool::Lease::operator=(Lease&& other) {
+    if (this != &other) {
+        release();
+        pool = std::move(other.pool);
+        conn = std::move(other.conn);
+        writer = other.writer;
+        cursor = other.cursor;
+    }
+    return *this;
+}
+
+void SqlitePool::Lease::release() {
+    if (conn && pool) {
+        pool->giveBack(std::move(conn), writer, cursor);
+    }
+    conn.reset();
+    pool.reset();
+}
+
+SqlitePool::SqlitePool(const std::string& path, const SqlitePoolOptions& options)
+    : path(path)
+    , options(options)
+    , shareable(true)
+    , openReaders(0)
+    , openCursorReaders(0)
+    , groupCommit(*this, options.groupCommitMaxBatch, options.groupCommitWindowUs)
+    , nextVersionCheck(0)
+    , dataVersion(-1)
+{
+}
+
+SqlitePool::~SqlitePool() {}
+
+std::string SqlitePool::canonicalPath(const std::string& dbPath) {
+    if (dbPath.empty() || dbPath == ":memory:" || dbPath.compare(0, 5, "file:") == 0) {
+        return dbPath;
+    }
+
+    char resolved[PATH_MAX];
+    if (realpath(dbPath.c_str(), resolved)) {
+        return resolved;
+    }
+
+    // 文件尚不存在：规范化所在目录
+    size_t slash = dbPath.find_last_of('/');
+    std::string dir = slash == std::string::npos ? "." : dbPath.substr(0, slash == 0 ? 1 : slash);
+    std::string base = slash == std::string::npos ? dbPath : dbPath.substr(slash + 1);
+    if (realpath(dir.c_str(), resolved)) {
+        std::string result(resolved);
+        return result == "/" ? result + base : result + "/" + base;
+    }
+    return dbPath;
+}
+
+std::shared_ptr<SqlitePool> SqlitePool::get(const std::string& dbPath, std::string& error) {
+    std::string key = canonicalPath(dbPath);
+
+    std::lock_guard<std::mutex> lock(registryMutex);
+    if (registry.empty()) {
+        // 连接会在多个工作线程上并发使用：关闭内存统计，避免每次分配都争用SQLite的全局互斥锁。
+        // 必须在SQLite初始化之前设置，已初始化时调用无效但无害
+        sqlite3_config(SQLITE_CONFIG_MEMSTATUS, 0);
+    }
+    auto it = registry.find(key);
+    if (it != registry.end()) {
+        return it->second;
+    }
+
+    std::shared_ptr<SqlitePool> pool(new SqlitePool(key, defaultOptions));
+    if (!pool->init(error)) {
+        return nullptr;
+    }
+    registry[key] = pool;
+    return pool;
+}
+
+void SqlitePool::setDefaultOptions(const SqlitePoolOptions& options) {
+    std::lock_guard<std::mutex> lock(registryMutex);
+    defaultOptions = options;
+}
+
+bool SqlitePool::init(std::string& error) {
+    // 内存数据库每个连接都是独立的库，只能用唯一的写连接
+    shareable = !(path.empty() || path == ":memory:" || path.find("mode=memory") != std::string::npos);
+
+    writer = openConnection(false, error);
+    if (!writer) {
+        return false;
+    }
+    if (shareable && !writer->executeUpdate("PRAGMA journal_mode=WAL;")) {
+        error = writer->getLastError();
+        writer.reset();
+        return false;
+    }
+    return true;
+}
+
+std::unique_ptr<Sqlite3Handler> SqlitePool::openConnection(bool readOnly, std::string& error) {
+    std::unique_ptr<Sqlite3Handler> conn(new Sqlite3Handler(path, options.stmtCacheCapacity));
+
+    // 每个连接同一时刻只被一个线程使用，不需要SQLite内部的互斥锁
+    int flags = SQLITE_OPEN_NOMUTEX | (path.compare(0, 5, "file:") == 0 ? SQLITE_OPEN_URI : 0);
+    flags |= readOnly ? SQLITE_OPEN_READONLY : (SQLITE_OPEN_READWRITE | SQLITE_OPEN_CREATE);
+    if (!conn->open(flags)) {
+        error = conn->getLastError();
+        return nullptr;
+    }
+
+    conn->setBusyTimeout(options.busyTimeoutMs);
+    std::string pragmas =
+        "PRAGMA cache_size=-" + std::to_string(options.cacheSizeKiB) + ";"
+        "PRAGMA mmap_size=" + std::to_string(options.mmapSize) + ";";
+    if (!readOnly) {
+        pragmas += "PRAGMA synchronous=" + options.synchronous + ";";
+    }
+    if (!conn->executeUpdate(pragmas)) {
+        error = conn->getLastError();
+        return nullptr;
+    }
+    return conn;
+}
+
+std::chrono::steady_clock::time_point SqlitePool::waitLimit(uint64_t deadline, bool& byDeadline) const {
+    auto limit = std::chrono::steady_clock::now() + std::chrono::milliseconds(options.leaseTimeoutMs);
+    // Metrics::now()与steady_clock同一时间基准
+    std::chrono::steady_clock::time_point requestLimit(
+        std::chrono::duration_cast<std::chrono::steady_clock::duration>(std::chrono::nanoseconds(deadline)));
+    byDeadline = deadline > 0 && requestLimit < limit;
+    return byDeadline ? requestLimit : limit;
+}
+
+bool SqlitePool::acquireReader(Lease& lease, std::string& error, uint64_t deadline) {
+    if (!shareable) {
+        return acquireWriter(lease, error, deadline);
+    }
+
+    std::unique_lock<std::mutex> lock(mutex);
+    bool byDeadline;
+    auto limit = waitLimit(deadline, byDeadline);
+    while (idleReaders.empty() && openReaders >= options.maxReaders) {
+        if (available.wait_until(lock, limit) == std::cv_status::timeout &&
+            idleReaders.empty() && openReaders >= options.maxReaders) {
+            error = byDeadline ? Sqlite3Handler::kDeadlineExceeded : "Database busy: no reader connection available";
+            return false;
+        }
+    }
+
+    std::unique_ptr<Sqlite3Handler> conn;
+    if (!idleReaders.empty()) {
+        conn = std::move(idleReaders.back());
+        idleReaders.pop_back();
+    } else {
+        // 在锁外打开新连接，先占住名额
+        openReaders++;
+        lock.unlock();
+        conn = openConnection(true, error);
+        if (!conn) {
+            lock.lock();
+            openReaders--;
+            available.notify_one();
+            return false;
+        }
+    }
+
+    lease.release();
+    lease.pool = shared_from_this();
+    lease.conn = std::move(conn);
+    lease.writer = false;
+    lease.cursor = false;
+    return true;
+}
+
+bool SqlitePool::acquireCursorReader(Lease& lease, std::string& error) {
+    if (!shareable) {
+        error = "Cursors require a file database";
+        return false;
+    }
+
+    std::unique_ptr<Sqlite3Handler> conn;
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        if (!idleCursorReaders.empty()) {
+            conn = std::move(idleCursorReaders.back());
+            idleCursorReaders.pop_back();
+        } else if (openCursorReaders >= options.maxCursors) {
+            error = "Too many open cursors on database (limit " + std::to_string(options.maxCursors) + ")";
+            return false;
+        } else {
+            openCursorReaders++;
+        }
+    }
+    if (!conn) {
+        conn = openConnection(true, error);
+        if (!conn) {
+            std::lock_guard<std::mutex> lock(mutex);
+            openCursorReaders--;
+            return false;
+        }
+    }
+
+    lease.release();
+    lease.pool = shared_from_this();
+    lease.conn = std::move(conn);
+    lease.writer = false;
+    lease.cursor = true;
+    return true;
+}
+
+bool SqlitePool::acquireWriter(Lease& lease, std::string& error, uint64_t deadline) {
+    std::unique_lock<std::mutex> lock(mutex);
+    bool byDeadline;
+    auto limit = waitLimit(deadline, byDeadline);
+    while (!writer) {
+        if (available.wait_until(lock, limit) == std::cv_status::timeout && !writer) {
+            error = byDeadline ? Sqlite3Handler::kDeadlineExceeded : kWriterBusy;
+            return false;
+        }
+    }
+
+    lease.release();
+    lease.pool = shared_from_this();
+    lease.conn = std::move(writer);
+    lease.writer = true;
+    lease.cursor = false;
+    return true;
+}
+
+void SqlitePool::giveBack(std::unique_ptr<Sqlite3Handler> conn, bool isWriter, bool isCursor) {
+    // 连接不能带着未结束的事务回到池里
+    if (conn->inTransaction()) {
+        conn->rollback();
+    }
+
+    std::lock_guard<std::mutex> lock(mutex);
+    if (isCursor) {
+        idleCursorReaders.push_back(std::move(conn));
+        return;     // 游标连接与普通连接分开，没有人在等待
+    }
+    if (isWriter) {
+        writer = std::move(conn);
+    } else {
+        idleReaders.push_back(std::move(conn));
+    }
+    available.notify_all();
+}
+
+void SqlitePool::checkExternalWrites() {
+    if (!shareable) {
+        return;     // 内存数据库不会被其他进程修改
+    }
+    uint64_t now = Metrics::now();
+    uint64_t due = nextVersionCheck.load(std::memory_order_relaxed);
+    uint64_t interval = static_cast<uint64_t>(options.dataVersionCheckMs) * 1000000;
+    if (now < due || !nextVersionCheck.compare_exchange_strong(due, now + interval)) {
+        return;
+    }
+
+    std::unique_ptr<Sqlite3Handler> conn;
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        if (!writer) {
+            return;
+        }
+        conn = std::move(writer);
+    }
+    TableData result = conn->executeQuery("PRAGMA data_version;");
+    int64_t previous = dataVersion;
+    int64_t current = previous;
+    if (result.getStatus() == 0 && result.getRowCount() == 1) {
+        current = dataVersion = result.getColumn(0).getInteger(0);
+    }
+    giveBack(std::move(conn), true, false);
+
+    if (previous >= 0 && current != previous) {
+        LOG_INFO("External write detected on " + path + ", dropping cached results");
+        ResultCache::instance().invalidateAll(path);
+    }
+}
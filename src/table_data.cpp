@@ -1,6 +1,116 @@
 #include "table_data.h"
+#include "binary_result.h"
+#include "base64.h"
+#include "json_writer.h"
+#include "metrics.h"
 
-TableData::TableData() : status(0) {}
+namespace {
+std::string formatInteger(int64_t value) {
+    std::string text;
+    JsonWriter::appendInteger(text, value);
+    return text;
+}
+
+std::string formatReal(double value) {
+    // 与SQLite把REAL转成文本时使用的格式一致
+    std::string text;
+    JsonWriter::appendReal(text, value);
+    return text;
+}
+}
+
+TableData::Column::Column(const std::string& name, const std::string& declType)
+    : name(name)
+    , declType(declType)
+    , storageClass(SQLITE_NULL)
+    , count(0)
+{
+}
+
+std::string TableData::Column::getTypeName() const {
+    if (!declType.empty()) {
+        return declType;
+    }
+    switch (storageClass) {
+    case SQLITE_INTEGER: return "INTEGER";
+    case SQLITE_FLOAT:   return "REAL";
+    case SQLITE_TEXT:    return "TEXT";
+    case SQLITE_BLOB:    return "BLOB";
+    default:             return "NULL";
+    }
+}
+
+std::string TableData::Column::getText(size_t row) const {
+    if (isNull(row)) {
+        return std::string();
+    }
+    switch (storageClass) {
+    case SQLITE_INTEGER:
+        return formatInteger(ints[row]);
+    case SQLITE_FLOAT:
+        return formatReal(reals[row]);
+    default: {
+        size_t len;
+        const char* data = getBytes(row, len);
+        return std::string(data, len);
+    }
+    }
+}
+
+void TableData::Column::adopt(int cls) {
+    // 此前的值都是NULL：按新类型补齐占位
+    storageClass = cls;
+    if (cls == SQLITE_INTEGER) {
+        ints.resize(count, 0);
+    } else if (cls == SQLITE_FLOAT) {
+        reals.resize(count, 0);
+    } else {
+        ends.resize(count, 0);
+    }
+}
+
+void TableData::Column::promoteToText() {
+    if (storageClass == SQLITE_TEXT) {
+        return;
+    }
+
+    // BLOB转成Base64文本，输出与按值序列化时一致
+    std::string newArena;
+    std::vector<size_t> newEnds;
+    newEnds.reserve(count);
+    for (size_t row = 0; row < count; row++) {
+        if (isNull(row)) {
+            // 保持原样
+        } else if (storageClass == SQLITE_INTEGER) {
+            JsonWriter::appendInteger(newArena, ints[row]);
+        } else if (storageClass == SQLITE_FLOAT) {
+            JsonWriter::appendReal(newArena, reals[row]);
+        } else {
+            size_t len;
+            const char* data = getBytes(row, len);
+            base64Encode(data, len, newArena);
+        }
+        newEnds.push_back(newArena.size());
+    }
+    arena.swap(newArena);
+    ends.swap(newEnds);
+    std::vector<int64_t>().swap(ints);
+    std::vector<double>().swap(reals);
+    storageClass = SQLITE_TEXT;
+}
+
+void TableData::Column::markNull() {
+    nulls[count >> 6] |= uint64_t(1) << (count & 63);
+    switch (storageClass) {
+    case SQLITE_INTEGER: ints.push_back(0); break;
+    case SQLITE_FLOAT:   reals.push_back(0); break;
+    case SQLITE_TEXT:
+    case SQLITE_BLOB:    ends.push_back(arena.size()); break;
+    default: break;
+    }
+}
+
+TableData::TableData() : status(0), rowCount(0), affectedRows(0) {}
 
 TableData::~TableData() {}
 
@@ -12,35 +122,200 @@ void TableData::setMsg(const std::string& msg) {
     this->msg = msg;
 }
 
-void TableData::addColumnType(const std::string& column, const std::string& type) {
-    colAndType[column] = type;
+void TableData::addColumn(const std::string& name, const std::string& declType) {
+    columns.push_back(Column(name, declType));
+}
+
+void TableData::beginRow() {
+    rowCount++;
+    if (((rowCount - 1) & 63) == 0) {
+        for (auto& column : columns) {
+            column.nulls.push_back(0);
+        }
+    }
 }
 
-void TableData::addRowValue(const std::map<std::string, std::string>& row) {
-    rowAndValue.push_back(row);
+void TableData::appendNull(size_t col) {
+    Column& c = columns[col];
+    c.markNull();
+    c.count++;
+}
+
+void TableData::appendInteger(size_t col, int64_t value) {
+    Column& c = columns[col];
+    if (c.storageClass == SQLITE_NULL) {
+        c.adopt(SQLITE_INTEGER);
+    }
+    if (c.storageClass == SQLITE_INTEGER) {
+        c.ints.push_back(value);
+    } else {
+        c.promoteToText();
+        JsonWriter::appendInteger(c.arena, value);
+        c.ends.push_back(c.arena.size());
+    }
+    c.count++;
+}
+
+void TableData::appendReal(size_t col, double value) {
+    Column& c = columns[col];
+    if (c.storageClass == SQLITE_NULL) {
+        c.adopt(SQLITE_FLOAT);
+    }
+    if (c.storageClass == SQLITE_FLOAT) {
+        c.reals.push_back(value);
+    } else {
+        c.promoteToText();
+        JsonWriter::appendReal(c.arena, value);
+        c.ends.push_back(c.arena.size());
+    }
+    c.count++;
+}
+
+void TableData::appendText(size_t col, const char* data, size_t len) {
+    Column& c = columns[col];
+    if (c.storageClass == SQLITE_NULL) {
+        c.adopt(SQLITE_TEXT);
+    }
+    c.promoteToText();
+    c.arena.append(data, len);
+    c.ends.push_back(c.arena.size());
+    c.count++;
+}
+
+void TableData::appendBlob(size_t col, const void* data, size_t len) {
+    Column& c = columns[col];
+    if (c.storageClass == SQLITE_NULL) {
+        c.adopt(SQLITE_BLOB);
+    }
+    if (c.storageClass == SQLITE_BLOB) {
+        c.arena.append(static_cast<const char*>(data), len);
+    } else {
+        c.promoteToText();
+        base64Encode(static_cast<const char*>(data), len, c.arena);
+    }
+    c.ends.push_back(c.arena.size());
+    c.count++;
 }
 
 std::string TableData::toJson() const {
-    Json::Value root;
-    root["status"] = status;
-    root["msg"] = msg;
-    
-    Json::Value columns;
-    for (const auto& col : colAndType) {
-        columns[col.first] = col.second;
-    }
-    root["columns"] = columns;
-    
-    Json::Value rows(Json::arrayValue);
-    for (const auto& row : rowAndValue) {
-        Json::Value rowObj;
-        for (const auto& field : row) {
-            rowObj[field.first] = field.second;
+    std::string out;
+    writeJson(out);
+    return out;
+}
+
+void TableData::writeStatus(std::string& out, int status, const char* msg, ResultEncoding encoding) {
+    if (encoding == RESULT_ENCODING_BINARY) {
+        BinaryResult::appendHeader(out, 0);
+        BinaryResult::appendTrailer(out, status, msg, std::char_traits<char>::length(msg), std::string());
+        return;
+    }
+    JsonWriter writer(out);
+    writer.beginObject();
+    writer.key("columns").beginObject().endObject();
+    writer.key("msg").value(msg, std::char_traits<char>::length(msg));
+    writer.key("rows").beginArray().endArray();
+    writer.key("status").value(status);
+    writer.endObject();
+    out.push_back('\n');
+}
+
+void TableData::writeJson(std::string& out) const {
+    Metrics::PhaseTimer timer(Metrics::SERIALIZE);
+    // 直接写出JSON文本；键顺序与原先Json::FastWriter的输出一致
+    JsonWriter writer(out);
+    writer.beginObject();
+
+    writer.key("columns").beginObject();
+    for (const auto& column : columns) {
+        writer.key(column.getName()).value(column.getTypeName());
+    }
+    writer.endObject();
+
+    writer.key("msg").value(msg);
+
+    writer.key("rows").beginArray();
+    std::string scratch;
+    for (size_t row = 0; row < rowCount; row++) {
+        writer.beginObject();
+        for (const auto& column : columns) {
+            writer.key(column.getName());
+            if (column.isNull(row)) {
+                writer.null();
+                continue;
+            }
+            // 数值以与SQLite一致的文本形式输出，BLOB输出Base64
+            scratch.clear();
+            size_t len;
+            const char* data;
+            switch (column.getStorageClass()) {
+            case SQLITE_INTEGER:
+                JsonWriter::appendInteger(scratch, column.getInteger(row));
+                writer.value(scratch);
+                break;
+            case SQLITE_FLOAT:
+                JsonWriter::appendReal(scratch, column.getReal(row));
+                writer.value(scratch);
+                break;
+            case SQLITE_BLOB:
+                data = column.getBytes(row, len);
+                base64Encode(data, len, scratch);
+                writer.value(scratch);
+                break;
+            default:
+                data = column.getBytes(row, len);
+                writer.value(data, len);
+                break;
+            }
+        }
+        writer.endObject();
+    }
+    writer.endArray();
+
+    writer.key("status").value(status);
+    writer.endObject();
+    out.push_back('\n');
+}
+
+void TableData::writeBinary(std::string& out) const {
+    Metrics::PhaseTimer timer(Metrics::SERIALIZE);
+    BinaryResult::appendHeader(out, columns.size());
+    for (const auto& column : columns) {
+        BinaryResult::appendColumn(out, column.getName().data(), column.getName().size(),
+                                   column.getDeclType().data(), column.getDeclType().size());
+    }
+
+    BinaryBatch batch;
+    batch.reset(columns.size());
+    for (size_t row = 0; row < rowCount; row++) {
+        for (const auto& column : columns) {
+            if (column.isNull(row)) {
+                batch.addNull();
+                continue;
+            }
+            size_t len;
+            const char* data;
+            switch (column.getStorageClass()) {
+            case SQLITE_INTEGER:
+                batch.addInteger(column.getInteger(row));
+                break;
+            case SQLITE_FLOAT:
+                batch.addReal(column.getReal(row));
+                break;
+            case SQLITE_BLOB:
+                data = column.getBytes(row, len);
+                batch.addBlob(data, len);
+                break;
+            default:
+                data = column.getBytes(row, len);
+                batch.addText(data, len);
+                break;
+            }
+        }
+        batch.endRow();
+        if (batch.isFull()) {
+            batch.flush(out);
         }
-        rows.append(rowObj);
     }
-    root["rows"] = rows;
-    
-    Json::FastWriter writer;
-    return writer.write(root);
-} 
\ No newline at end of file
+    batch.flush(out);
+    BinaryResult::appendTrailer(out, status, msg.data(), msg.size(), std::string());
+}
@@ -0,0 +1,103 @@
+#include "timer_wheel.h"
+
+TimerWheel::TimerWheel(uint64_t now, uint64_t tickNs)
+    : tickNs(tickNs > 0 ? tickNs : kDefaultTickNs)
+    , current(now / this->tickNs)
+    , count(0)
+{
+    for (auto& level : slots) {
+        for (auto& slot : level) {
+            slot.prev = &slot;
+            slot.next = &slot;
+        }
+    }
+}
+
+void TimerWheel::schedule(Timer& timer, uint64_t when) {
+    if (timer.isPending()) {
+        unlink(timer);
+    } else {
+        count++;
+    }
+    // 向上取整到tick，保证不早于when到期；已过去的时刻在下一个tick到期
+    uint64_t tick = when / tickNs + (when % tickNs != 0);
+    timer.expires = tick > current ? tick : current + 1;
+    insert(timer);
+}
+
+void TimerWheel::cancel(Timer& timer) {
+    if (timer.isPending()) {
+        unlink(timer);
+        count--;
+    }
+}
+
+uint64_t TimerWheel::nextWakeup() const {
+    if (count == 0) {
+        return 0;
+    }
+    // 第0层最多看到本轮结束；本轮没有到期的就在进入下一轮（需要下移高层定时器）时醒来
+    for (uint64_t tick = current + 1; ; tick++) {
+        const Timer& slot = slots[0][tick & kSlotMask];
+        if (slot.next != &slot || (tick & kSlotMask) == 0) {
+            return tick * tickNs;
+        }
+    }
+}
+
+void TimerWheel::insert(Timer& timer) {
+    uint64_t delta = timer.expires - current;
+    if (delta >= kMaxTicks) {
+        timer.expires = current + kMaxTicks - 1;
+        delta = kMaxTicks - 1;
+    }
+    int level = 0;
+    while (delta >= (uint64_t(1) << (kSlotBits * (level + 1)))) {
+        level++;
+    }
+    link(slots[level][(timer.expires >> (kSlotBits * level)) & kSlotMask], timer);
+}
+
+void TimerWheel::cascade() {
+    // 低层每转完一圈，上一层当前槽位里的定时器都落在接下来的范围内，重新按距离放置
+    for (int level = 1; level < kLevels; level++) {
+        if (((current >> (kSlotBits * (level - 1))) & kSlotMask) != 0) {
+            return;
+        }
+        Timer moving;
+        spliceSlot(slots[level][(current >> (kSlotBits * level)) & kSlotMask], moving);
+        while (moving.next != &moving) {
+            Timer* timer = moving.next;
+            unlink(*timer);
+            insert(*timer);
+        }
+    }
+}
+
+void TimerWheel::link(Timer& head, Timer& timer) {
+    timer.prev = head.prev;
+    timer.next = &head;
+    head.prev->next = &timer;
+    head.prev = &timer;
+}
+
+void TimerWheel::unlink(Timer& timer) {
+    timer.prev->next = timer.next;
+    timer.next->prev = timer.prev;
+    timer.prev = nullptr;
+    timer.next = nullptr;
+}
+
+void TimerWheel::spliceSlot(Timer& slot, Timer& to) {
+    if (slot.next == &slot) {
+        to.prev = &to;
+        to.next = &to;
+        return;
+    }
+    to.next = slot.next;
+    to.prev = slot.prev;
+    to.next->prev = &to;
+    to.prev->next = &to;
+    slot.prev = &slot;
+    slot.next = &slot;
+}
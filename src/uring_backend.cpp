@@ -0,0 +1,498 @@
+#include "uring_backend.h"
+#include "reactor.h"
+#include "logger.h"
+#include <sys/syscall.h>
+#include <sys/mman.h>
+#include <sys/socket.h>
+#include <netinet/in.h>
+#include <poll.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <cstring>
+#include <errno.h>
+
+namespace {
+const uint64_t kIdMask = (uint64_t(1) << 56) - 1;
+
+int ioUringSetup(unsigned entries, struct io_uring_params* params) {
+    return static_cast<int>(syscall(__NR_io_uring_setup, entries, params));
+}
+
+int ioUringEnter(int ringFd, unsigned toSubmit, unsigned minComplete, unsigned flags) {
+    return static_cast<int>(syscall(__NR_io_uring_enter, ringFd, toSubmit, minComplete, flags, nullptr, 0));
+}
+
+int ioUringRegister(int ringFd, unsigned opcode, void* arg, unsigned count) {
+    return static_cast<int>(syscall(__NR_io_uring_register, ringFd, opcode, arg, count));
+}
+}
+
+UringBackend::UringBackend(Reactor& reactor)
+    : reactor(reactor)
+    , ringFd(-1)
+    , listenFd(-1)
+    , wakeFd(-1)
+    , timerFd(-1)
+    , sqRing(MAP_FAILED)
+    , sqRingSize(0)
+    , sqHead(nullptr)
+    , sqTail(nullptr)
+    , sqMask(0)
+    , sqEntries(0)
+    , sqArray(nullptr)
+    , sqes(static_cast<struct io_uring_sqe*>(MAP_FAILED))
+    , sqesSize(0)
+    , toSubmit(0)
+    , cqHead(nullptr)
+    , cqTail(nullptr)
+    , cqMask(0)
+    , cqes(nullptr)
+    , bufRing(static_cast<struct io_uring_buf*>(MAP_FAILED))
+    , bufRingSize(0)
+    , bufPool(static_cast<char*>(MAP_FAILED))
+    , bufTail(0)
+{
+}
+
+UringBackend::~UringBackend() {
+    if (bufPool != MAP_FAILED) {
+        munmap(bufPool, kBufCount * kBufSize);
+    }
+    if (bufRing != MAP_FAILED) {
+        munmap(bufRing, bufRingSize);
+    }
+    if (sqes != MAP_FAILED) {
+        munmap(sqes, sqesSize);
+    }
+    if (sqRing != MAP_FAILED) {
+        munmap(sqRing, sqRingSize);
+    }
+    if (ringFd >= 0) {
+        ::close(ringFd);
+    }
+}
+
+bool UringBackend::init(int listenFd, int wakeFd, int timerFd, std::string& error) {
+    this->listenFd = listenFd;
+    this->wakeFd = wakeFd;
+    this->timerFd = timerFd;
+
+    // 只有Reactor线程提交，先试DEFER_TASKRUN（6.1），完成事件只在等待时处理；
+    // SINGLE_ISSUER（6.0）不被接受说明内核也不支持多次触发的recv。
+    // 环在这里（主线程）创建、由start()在Reactor线程上启用，提交者按启用的线程认定
+    const unsigned base = IORING_SETUP_SINGLE_ISSUER | IORING_SETUP_R_DISABLED |
+                          IORING_SETUP_SUBMIT_ALL | IORING_SETUP_CQSIZE;
+    const unsigned variants[] = { base | IORING_SETUP_DEFER_TASKRUN, base | IORING_SETUP_COOP_TASKRUN };
+    struct io_uring_params params;
+    for (unsigned flags : variants) {
+        std::memset(&params, 0, sizeof(params));
+        params.flags = flags;
+        params.cq_entries = kCompletionDepth;
+        ringFd = ioUringSetup(kQueueDepth, &params);
+        if (ringFd >= 0 || errno != EINVAL) {
+            break;
+        }
+    }
+    if (ringFd < 0) {
+        error = errno == EINVAL ? std::string("kernel too old, multishot receive needs Linux 6.0")
+                                : std::string("io_uring_setup failed: ") + std::strerror(errno);
+        return false;
+    }
+    if (!(params.features & IORING_FEAT_SINGLE_MMAP) || !(params.features & IORING_FEAT_NODROP)) {
+        error = "io_uring lacks single mmap or no-drop completions";
+        return false;
+    }
+
+    size_t sqSize = params.sq_off.array + params.sq_entries * sizeof(unsigned);
+    size_t cqSize = params.cq_off.cqes + params.cq_entries * sizeof(struct io_uring_cqe);
+    sqRingSize = sqSize > cqSize ? sqSize : cqSize;
+    sqRing = mmap(nullptr, sqRingSize, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE,
+                  ringFd, IORING_OFF_SQ_RING);
+    if (sqRing == MAP_FAILED) {
+        error = std::string("mmap of io_uring rings failed: ") + std::strerror(errno);
+        return false;
+    }
+    sqesSize = params.sq_entries * sizeof(struct io_uring_sqe);
+    sqes = static_cast<struct io_uring_sqe*>(mmap(nullptr, sqesSize, PROT_READ | PROT_WRITE,
+                                                  MAP_SHARED | MAP_POPULATE, ringFd, IORING_OFF_SQES));
+    if (sqes == MAP_FAILED) {
+        error = std::string("mmap of io_uring entries failed: ") + std::strerror(errno);
+        return false;
+    }
+
+    char* ring = static_cast<char*>(sqRing);
+    sqHead = reinterpret_cast<unsigned*>(ring + params.sq_off.head);
+    sqTail = reinterpret_cast<unsigned*>(ring + params.sq_off.tail);
+    sqMask = *reinterpret_cast<unsigned*>(ring + params.sq_off.ring_mask);
+    sqEntries = *reinterpret_cast<unsigned*>(ring + params.sq_off.ring_entries);
+    sqArray = reinterpret_cast<unsigned*>(ring + params.sq_off.array);
+    cqHead = reinterpret_cast<unsigned*>(ring + params.cq_off.head);
+    cqTail = reinterpret_cast<unsigned*>(ring + params.cq_off.tail);
+    cqMask = *reinterpret_cast<unsigned*>(ring + params.cq_off.ring_mask);
+    cqes = reinterpret_cast<struct io_uring_cqe*>(ring + params.cq_off.cqes);
+    // 提交项与数组下标一一对应，之后只需推进尾指针
+    for (unsigned i = 0; i < sqEntries; i++) {
+        sqArray[i] = i;
+    }
+
+    bufRingSize = kBufCount * sizeof(struct io_uring_buf);
+    bufRing = static_cast<struct io_uring_buf*>(mmap(nullptr, bufRingSize, PROT_READ | PROT_WRITE,
+                                                     MAP_PRIVATE | MAP_ANONYMOUS, -1, 0));
+    bufPool = static_cast<char*>(mmap(nullptr, kBufCount * kBufSize, PROT_READ | PROT_WRITE,
+                                      MAP_PRIVATE | MAP_ANONYMOUS, -1, 0));
+    if (bufRing == MAP_FAILED || bufPool == MAP_FAILED) {
+        error = std::string("mmap of receive buffers failed: ") + std::strerror(errno);
+        return false;
+    }
+    struct io_uring_buf_reg reg;
+    std::memset(&reg, 0, sizeof(reg));
+    reg.ring_addr = reinterpret_cast<uint64_t>(bufRing);
+    reg.ring_entries = kBufCount;
+    reg.bgid = kBufGroup;
+    if (ioUringRegister(ringFd, IORING_REGISTER_PBUF_RING, &reg, 1) < 0) {
+        error = std::string("registering the receive buffer ring failed: ") + std::strerror(errno);
+        return false;
+    }
+    for (unsigned i = 0; i < kBufCount; i++) {
+        recycleBuffer(static_cast<unsigned short>(i));
+    }
+    return true;
+}
+
+bool UringBackend::start(std::string& error) {
+    if (ioUringRegister(ringFd, IORING_REGISTER_ENABLE_RINGS, nullptr, 0) < 0) {
+        error = std::string("enabling io_uring failed: ") + std::strerror(errno);
+        return false;
+    }
+    // 内核不会对设了O_NONBLOCK的文件挂起等待，accept改回阻塞模式，由io_uring在就绪时完成。
+    // 环启用后才改：启用失败时监听socket保持非阻塞，Reactor可以直接换用epoll
+    int listenFlags = fcntl(listenFd, F_GETFL, 0);
+    fcntl(listenFd, F_SETFL, listenFlags & ~O_NONBLOCK);
+    armAccept();
+    armPoll(wakeFd, OP_WAKE);
+    armPoll(timerFd, OP_TIMER);
+    return true;
+}
+
+uint64_t UringBackend::makeUserData(Op op, uint64_t connId) {
+    // 高8位为操作类型，其余为连接编号（槽位代数截去高8位，低32位仍是fd）
+    return (static_cast<uint64_t>(op) << 56) | (connId & kIdMask);
+}
+
+UringBackend::Slot& UringBackend::slotOf(int fd) {
+    size_t index = static_cast<size_t>(fd);
+    if (index >= slots.size()) {
+        slots.resize(index + 1);
+    }
+    if (!slots[index]) {
+        slots[index].reset(new Slot());
+    }
+    return *slots[index];
+}
+
+bool UringBackend::sqFull() const {
+    return *sqTail - __atomic_load_n(sqHead, __ATOMIC_ACQUIRE) >= sqEntries;
+}
+
+struct io_uring_sqe* UringBackend::nextSqe() {
+    if (sqBacklog.empty() && sqFull()) {
+        enter(false);
+    }
+    if (!sqBacklog.empty() || sqFull()) {
+        // 内核没有取走（完成队列满时提交返回EBUSY）：不能覆盖尚未提交的项，先暂存，
+        // 处理完完成事件后由enter()按顺序补进提交队列
+        sqBacklog.emplace_back();
+        return &sqBacklog.back();
+    }
+    unsigned tail = *sqTail;
+    struct io_uring_sqe* sqe = &sqes[tail & sqMask];
+    std::memset(sqe, 0, sizeof(*sqe));
+    // 没有SQPOLL线程，内核只在io_uring_enter时读取提交队列，尾指针可以先于内容推进
+    __atomic_store_n(sqTail, tail + 1, __ATOMIC_RELEASE);
+    toSubmit++;
+    return sqe;
+}
+
+void UringBackend::moveBacklog() {
+    while (!sqBacklog.empty() && !sqFull()) {
+        unsigned tail = *sqTail;
+        sqes[tail & sqMask] = sqBacklog.front();
+        __atomic_store_n(sqTail, tail + 1, __ATOMIC_RELEASE);
+        toSubmit++;
+        sqBacklog.pop_front();
+    }
+}
+
+bool UringBackend::enter(bool wait) {
+    for (;;) {
+        moveBacklog();
+        // 还有暂存的提交项时先不等待，提交后接着补
+        bool more = !sqBacklog.empty();
+        bool block = wait && !more;
+        int submitted = ioUringEnter(ringFd, toSubmit, block ? 1 : 0, block ? IORING_ENTER_GETEVENTS : 0);
+        if (submitted < 0) {
+            // 被信号打断或完成队列暂满：提交项仍在队列里，处理完已有的完成事件后再提交
+            return errno == EINTR || errno == EAGAIN || errno == EBUSY;
+        }
+        toSubmit -= static_cast<unsigned>(submitted) < toSubmit ? static_cast<unsigned>(submitted) : toSubmit;
+        if (!more || submitted == 0) {
+            return true;
+        }
+    }
+}
+
+bool UringBackend::wait() {
+    if (!enter(true)) {
+        LOG_ERROR("io_uring_enter failed: " + std::string(std::strerror(errno)));
+        return false;
+    }
+    return true;
+}
+
+void UringBackend::armAccept() {
+    struct io_uring_sqe* sqe = nextSqe();
+    sqe->opcode = IORING_OP_ACCEPT;
+    sqe->fd = listenFd;
+    sqe->ioprio = IORING_ACCEPT_MULTISHOT;
+    sqe->accept_flags = SOCK_NONBLOCK | SOCK_CLOEXEC;
+    sqe->user_data = makeUserData(OP_ACCEPT, 0);
+}
+
+void UringBackend::armPoll(int fd, Op op) {
+    struct io_uring_sqe* sqe = nextSqe();
+    sqe->opcode = IORING_OP_POLL_ADD;
+    sqe->fd = fd;
+    sqe->len = IORING_POLL_ADD_MULTI;
+    sqe->poll32_events = POLLIN;
+    sqe->user_data = makeUserData(op, 0);
+}
+
+void UringBackend::armRecv(Connection& conn, Slot& slot) {
+    struct io_uring_sqe* sqe = nextSqe();
+    sqe->opcode = IORING_OP_RECV;
+    sqe->fd = conn.fd;
+    sqe->ioprio = IORING_RECV_MULTISHOT;
+    sqe->flags = IOSQE_BUFFER_SELECT;
+    sqe->buf_group = kBufGroup;
+    sqe->user_data = makeUserData(OP_RECV, conn.id);
+    slot.recvArmed = true;
+    slot.pending++;
+}
+
+void UringBackend::submitSend(int fd, Slot& slot) {
+    if (slot.iov.size() < kMaxIov) {
+        slot.iov.resize(kMaxIov);
+    }
+    size_t len = 0;
+    slot.msg.msg_iov = slot.iov.data();
+    slot.msg.msg_iovlen = static_cast<size_t>(slot.sendQueue.fill(slot.iov.data(), kMaxIov, len));
+
+    struct io_uring_sqe* sqe = nextSqe();
+    sqe->opcode = IORING_OP_SENDMSG;
+    sqe->fd = fd;
+    sqe->addr = reinterpret_cast<uint64_t>(&slot.msg);
+    sqe->len = 1;
+    sqe->msg_flags = MSG_NOSIGNAL;
+    sqe->user_data = makeUserData(OP_SEND, slot.connId);
+    slot.sending = true;
+    slot.pending++;
+}
+
+void UringBackend::recycleBuffer(unsigned short bid) {
+    struct io_uring_buf& buf = bufRing[bufTail & (kBufCount - 1)];
+    buf.addr = reinterpret_cast<uint64_t>(bufPool + bid * kBufSize);
+    buf.len = static_cast<uint32_t>(kBufSize);
+    buf.bid = bid;
+    bufTail++;
+    __atomic_store_n(&bufRing[0].resv, bufTail, __ATOMIC_RELEASE);
+}
+
+void UringBackend::resetSlot(Slot& slot) {
+    slot.connId = 0;
+    slot.pending = 0;
+    slot.recvArmed = false;
+    slot.cancelling = false;
+    slot.sending = false;
+    slot.closing = false;
+    slot.sendQueue.clear();
+    std::vector<struct iovec>().swap(slot.iov);
+}
+
+void UringBackend::dispatch() {
+    // 只处理进入时已有的完成事件，处理期间新到的留到下一轮，不耽误定时器
+    unsigned head = *cqHead;
+    unsigned tail = __atomic_load_n(cqTail, __ATOMIC_ACQUIRE);
+    while (head != tail) {
+        const struct io_uring_cqe& cqe = cqes[head & cqMask];
+        uint64_t data = cqe.user_data;
+        int res = cqe.res;
+        uint32_t flags = cqe.flags;
+        head++;
+        __atomic_store_n(cqHead, head, __ATOMIC_RELEASE);
+
+        int fd = static_cast<int>(static_cast<uint32_t>(data));
+        switch (static_cast<Op>(data >> 56)) {
+        case OP_ACCEPT:
+            onAccept(res, flags);
+            break;
+        case OP_WAKE:
+            if (!(flags & IORING_CQE_F_MORE)) {
+                armPoll(wakeFd, OP_WAKE);
+            }
+            reactor.drainCompletions();
+            break;
+        case OP_TIMER: {
+            if (!(flags & IORING_CQE_F_MORE)) {
+                armPoll(timerFd, OP_TIMER);
+            }
+            uint64_t expirations;
+            ssize_t n = read(timerFd, &expirations, sizeof(expirations));
+            (void)n;    // 只用来唤醒，到期的定时器在本批事件之后统一处理
+            break;
+        }
+        case OP_RECV:
+            onRecv(fd, res, flags);
+            break;
+        case OP_SEND:
+            onSend(fd, res);
+            break;
+        case OP_CANCEL:
+            break;      // 结果体现在被取消的recv上
+        }
+    }
+}
+
+void UringBackend::onAccept(int res, uint32_t flags) {
+    if (!(flags & IORING_CQE_F_MORE)) {
+        armAccept();
+    }
+    if (res < 0) {
+        if (res != -EAGAIN && res != -EINTR && res != -ECANCELED) {
+            LOG_ERROR("Accept failed: " + std::string(std::strerror(-res)));
+        }
+        return;
+    }
+    // 多次触发的accept不能为每个连接带回对端地址，由Connection在用到时再取，接受连接不多花系统调用；
+    // 与epoll后端一样得到非阻塞socket，TCP_NODELAY从监听socket继承
+    reactor.acceptConnection(res, nullptr);
+}
+
+void UringBackend::attach(Connection& conn) {
+    Slot& slot = slotOf(conn.fd);
+    slot.connId = conn.id;
+    armRecv(conn, slot);
+}
+
+bool UringBackend::retire(int fd, Slot& slot) {
+    slot.pending--;
+    if (!slot.closing) {
+        return false;
+    }
+    if (slot.pending == 0) {
+        ::close(fd);
+        resetSlot(slot);
+    }
+    return true;
+}
+
+void UringBackend::onRecv(int fd, int res, uint32_t flags) {
+    Slot& slot = slotOf(fd);
+    Connection* conn = slot.closing ? nullptr : reactor.connections.find(slot.connId);
+    if (res > 0 && (flags & IORING_CQE_F_BUFFER)) {
+        unsigned short bid = static_cast<unsigned short>(flags >> IORING_CQE_BUFFER_SHIFT);
+        if (conn) {
+            reactor.received(*conn, bufPool + bid * kBufSize, static_cast<size_t>(res));
+        }
+        recycleBuffer(bid);
+    }
+    if (!(flags & IORING_CQE_F_MORE)) {
+        slot.recvArmed = false;
+        slot.cancelling = false;
+        if (retire(fd, slot)) {
+            return;
+        }
+    }
+    if (!conn) {
+        return;
+    }
+
+    if (res == 0) {
+        conn->closeAfterFlush = true;   // 对端关闭写端，多次触发的recv随之结束
+    } else if (res < 0 && res != -ENOBUFS && res != -ECANCELED) {
+        LOG_ERROR(conn->getPeer() + " Read error: " + std::strerror(-res));
+        reactor.closeConnection(*conn);
+        return;
+    }
+    if (res >= 0) {
+        reactor.handleInput(*conn);
+    } else {
+        // 缓冲区用完或读暂停取消了recv：按当前状态决定是否重新提交
+        updateInterest(*conn);
+    }
+}
+
+bool UringBackend::send(Connection& conn) {
+    Slot& slot = slotOf(conn.fd);
+    if (slot.sending || conn.output.empty()) {
+        return true;    // 上一次发送归还后接着发
+    }
+    // 输出队列整体换出：发送期间新的响应追加到换回来的空队列里（它留着上次用过的段）
+    slot.sendQueue.swap(conn.output);
+    conn.sending = slot.sendQueue.size();
+    submitSend(conn.fd, slot);
+    return true;
+}
+
+void UringBackend::onSend(int fd, int res) {
+    Slot& slot = slotOf(fd);
+    slot.sending = false;
+    if (retire(fd, slot)) {
+        return;
+    }
+    Connection* conn = reactor.connections.find(slot.connId);
+    if (!conn) {
+        return;
+    }
+    if (res < 0) {
+        LOG_ERROR(conn->getPeer() + " Write error: " + std::string(std::strerror(-res)));
+        reactor.closeConnection(*conn);
+        return;
+    }
+
+    size_t sent = static_cast<size_t>(res);
+    slot.sendQueue.consume(sent, false);
+    conn->sending -= sent;
+    if (!slot.sendQueue.empty()) {
+        submitSend(fd, slot);   // 只写出了一部分（或超过了一次的段数），剩余的接着发
+    }
+    reactor.sent(*conn, sent);
+    reactor.handleWrite(*conn);
+}
+
+void UringBackend::updateInterest(Connection& conn) {
+    Slot& slot = slotOf(conn.fd);
+    bool wanted = !conn.readPaused && !conn.closeAfterFlush;
+    if (wanted && !slot.recvArmed) {
+        armRecv(conn, slot);
+    } else if (!wanted && slot.recvArmed && !slot.cancelling) {
+        // 输出积压：取消recv，让数据留在内核接收缓冲区，由TCP窗口把压力传回客户端
+        struct io_uring_sqe* sqe = nextSqe();
+        sqe->opcode = IORING_OP_ASYNC_CANCEL;
+        sqe->fd = -1;
+        sqe->addr = makeUserData(OP_RECV, conn.id);
+        sqe->user_data = makeUserData(OP_CANCEL, 0);
+        slot.cancelling = true;
+    }
+}
+
+void UringBackend::close(Connection& conn) {
+    Slot& slot = slotOf(conn.fd);
+    if (slot.pending == 0) {
+        ::close(conn.fd);
+        resetSlot(slot);
+        return;
+    }
+    // 还有recv或send在内核里：先让它们尽快结束，全部归还后retire()关闭fd
+    slot.closing = true;
+    shutdown(conn.fd, SHUT_RDWR);
+}
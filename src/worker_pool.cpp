@@ -0,0 +1,222 @@
+#include "worker_pool.h"
+#include "logger.h"
+#include "metrics.h"
+
+namespace {
+thread_local bool shedding = false;    // 当前线程正在执行的任务是否应放弃
+}
+
+void TaskQueue::push(QueuedTask&& item) {
+    if (count == slots.size()) {
+        // 满了：按顺序搬到两倍大的新数组，队首回到0号槽
+        std::vector<QueuedTask> grown(slots.empty() ? kInitialCapacity : slots.size() * 2);
+        for (size_t i = 0; i < count; i++) {
+            grown[i] = std::move(slots[(head + i) & (slots.size() - 1)]);
+        }
+        slots.swap(grown);
+        head = 0;
+    }
+    slots[(head + count) & (slots.size() - 1)] = std::move(item);
+    count++;
+}
+
+QueuedTask TaskQueue::pop() {
+    QueuedTask item = std::move(slots[head]);
+    slots[head].task = nullptr;
+    head = (head + 1) & (slots.size() - 1);
+    count--;
+    return item;
+}
+
+WorkerPool::WorkerPool(size_t threadCount)
+    : runningLow(0)
+    , bypassed(0)
+    , targetNs(0)
+    , intervalNs(0)
+    , stopping(false)
+{
+    if (threadCount < 1) {
+        threadCount = 1;
+    }
+    maxRunningLow = threadCount > 1 ? threadCount - 1 : 1;
+    for (int p = 0; p < PRIORITY_COUNT; p++) {
+        overloadAt[p] = 0;
+        overloaded[p].store(false, std::memory_order_relaxed);
+    }
+    for (size_t i = 0; i < threadCount; i++) {
+        threads.emplace_back([this]() { workerLoop(); });
+    }
+}
+
+WorkerPool::~WorkerPool() {
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        stopping = true;
+    }
+    cond.notify_all();
+    for (auto& t : threads) {
+        t.join();
+    }
+}
+
+void WorkerPool::submit(Task task, TaskPriority priority) {
+    QueuedTask item;
+    item.task = std::move(task);
+    item.queued = Metrics::now();
+    item.priority = priority;
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        queues[priority].push(std::move(item));
+    }
+    cond.notify_one();
+}
+
+void WorkerPool::setQueueDelayTarget(int targetMs, int intervalMs) {
+    std::lock_guard<std::mutex> lock(mutex);
+    targetNs = targetMs > 0 ? static_cast<uint64_t>(targetMs) * 1000000 : 0;
+    intervalNs = intervalMs > 0 ? static_cast<uint64_t>(intervalMs) * 1000000 : 0;
+}
+
+void WorkerPool::getStats(Stats& out) {
+    std::lock_guard<std::mutex> lock(mutex);
+    for (int p = 0; p < PRIORITY_COUNT; p++) {
+        out.queued[p] = queues[p].size();
+        out.overloaded[p] = overloaded[p].load(std::memory_order_relaxed);
+    }
+    out.runningLow = runningLow;
+}
+
+bool WorkerPool::runnable(int priority) const {
+    return !queues[priority].empty() && (priority != PRIORITY_LOW || runningLow < maxRunningLow);
+}
+
+int WorkerPool::pick() const {
+    int first = PRIORITY_COUNT;
+    for (int p = 0; p < PRIORITY_COUNT; p++) {
+        if (runnable(p)) {
+            first = p;
+            break;
+        }
+    }
+    if (first != PRIORITY_COUNT && bypassed >= kMaxBypass) {
+        // 低优先级已经连续让了多次，这次先取最低的非空队列
+        for (int p = PRIORITY_COUNT - 1; p > first; p--) {
+            if (runnable(p)) {
+                return p;
+            }
+        }
+    }
+    return first;
+}
+
+bool WorkerPool::shouldShed() {
+    return shedding;
+}
+
+void WorkerPool::trackDelay(int priority, uint64_t waited, uint64_t now) {
+    if (targetNs == 0) {
+        return;
+    }
+    // CoDel：偶尔超标的突发不算过载，排队时间持续一个interval都没有降到目标以下才算
+    if (waited < targetNs || queues[priority].empty()) {
+        overloadAt[priority] = 0;
+        overloaded[priority].store(false, std::memory_order_relaxed);
+    } else if (overloadAt[priority] == 0) {
+        overloadAt[priority] = now + intervalNs;
+    } else if (now >= overloadAt[priority]) {
+        overloaded[priority].store(true, std::memory_order_relaxed);
+    }
+}
+
+void WorkerPool::workerLoop() {
+    while (true) {
+        QueuedTask item;
+        int priority;
+        {
+            std::unique_lock<std::mutex> lock(mutex);
+            cond.wait(lock, [this, &priority]() {
+                priority = pick();
+                return stopping || priority != PRIORITY_COUNT;
+            });
+            if (priority == PRIORITY_COUNT) {
+                return;
+            }
+            bool lowerWaiting = false;
+            for (int p = priority + 1; p < PRIORITY_COUNT; p++) {
+                lowerWaiting = lowerWaiting || runnable(p);
+            }
+            bypassed = lowerWaiting ? bypassed + 1 : 0;
+            item = queues[priority].pop();
+            if (priority == PRIORITY_LOW) {
+                runningLow++;
+            }
+            uint64_t now = Metrics::now();
+            uint64_t waited = now - item.queued;
+            trackDelay(priority, waited, now);
+            shedding = waited >= targetNs && overloaded[priority].load(std::memory_order_relaxed);
+        }
+
+        try {
+            item.task();
+        } catch (const std::exception& e) {
+            LOG_ERROR(std::string("Worker task threw: ") + e.what());
+        }
+        shedding = false;
+
+        if (priority == PRIORITY_LOW) {
+            // 腾出的低优先级名额可能正有任务在等
+            bool waiting;
+            {
+                std::lock_guard<std::mutex> lock(mutex);
+                runningLow--;
+                waiting = !queues[PRIORITY_LOW].empty();
+            }
+            if (waiting) {
+                cond.notify_one();
+            }
+        }
+    }
+}
+
+SerialQueue::SerialQueue() : running(false) {}
+
+void SerialQueue::post(WorkerPool& workers, WorkerPool::Task task, TaskPriority priority) {
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        QueuedTask item;
+        item.task = std::move(task);
+        item.priority = priority;
+        tasks.push(std::move(item));
+        if (running) {
+            return;     // 正在执行的线程会接着取走这个任务
+        }
+        running = true;
+    }
+    workers.submit([this, &workers]() { drain(workers); }, priority);
+}
+
+void SerialQueue::drain(WorkerPool& workers) {
+    WorkerPool::Task task;
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        task = std::move(tasks.pop().task);
+    }
+
+    try {
+        task();
+    } catch (const std::exception& e) {
+        LOG_ERROR(std::string("Serial task threw: ") + e.what());
+    }
+
+    // 每次只执行一个任务后重新排队（按下一个任务的优先级），避免长队列独占工作线程
+    TaskPriority next;
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        if (tasks.empty()) {
+            running = false;
+            return;
+        }
+        next = tasks.front().priority;
+    }
+    workers.submit([this, &workers]() { drain(workers); }, next);
+}